@@ -25,33 +25,40 @@ using namespace Qt::Literals::StringLiterals;
 
 namespace bt
 {
-DownloadStatus::DownloadStatus()
+DownloadStatus::DownloadStatus(Uint32 num_pieces, Uint32 *requests)
     : timeouts(0)
+    , status(num_pieces)
+    , requests(requests)
 {
 }
 
 DownloadStatus::~DownloadStatus()
 {
+    clear();
 }
 
 void DownloadStatus::add(Uint32 p)
 {
-    status.insert(p);
+    if (!status.get(p)) {
+        status.set(p, true);
+        requests[p]++;
+    }
 }
 
 void DownloadStatus::remove(Uint32 p)
 {
-    status.remove(p);
-}
-
-bool DownloadStatus::contains(Uint32 p)
-{
-    return status.contains(p);
+    if (status.get(p)) {
+        status.set(p, false);
+        requests[p]--;
+    }
 }
 
 void DownloadStatus::clear()
 {
-    status.clear();
+    const Uint32 num = status.getNumBits();
+    for (Uint32 i = 0; i < num && status.numOnBits() > 0; i++) {
+        remove(i);
+    }
 }
 
 ////////////////////////////////////////////////////
@@ -70,6 +77,7 @@ ChunkDownload::ChunkDownload(Chunk *chunk)
     pieces = BitSet(num);
     pieces.clear();
     piece_data = new PieceData::Ptr[num]; // array of pointers to the piece data
+    piece_requests.resize(num, 0);
 
     dstatus.setAutoDelete(true);
 
@@ -141,7 +149,7 @@ bool ChunkDownload::assign(PieceDownloader *pd)
 
     pd->grab();
     pdown.append(pd);
-    dstatus.insert(pd, new DownloadStatus());
+    dstatus.insert(pd, new DownloadStatus(num, piece_requests.data()));
     connect(pd, &PieceDownloader::timedout, this, &ChunkDownload::onTimeout);
     connect(pd, &PieceDownloader::rejected, this, &ChunkDownload::onRejected);
     sendRequests();
@@ -212,27 +220,17 @@ void ChunkDownload::onTimeout(const Request &r)
 
 Uint32 ChunkDownload::bestPiece(PieceDownloader *pd)
 {
+    const DownloadStatus *ds = dstatus.find(pd);
     Uint32 best = num;
     Uint32 best_count = 0;
     // select the piece which is being downloaded the least
     for (Uint32 i = 0; i < num; i++) {
-        if (pieces.get(i)) {
+        if (pieces.get(i) || (ds && ds->contains(i))) {
             continue;
         }
 
-        DownloadStatus *ds = dstatus.find(pd);
-        if (ds && ds->contains(i)) {
-            continue;
-        }
-
-        Uint32 times_downloading = 0;
-        PtrMap<PieceDownloader *, DownloadStatus>::iterator j = dstatus.begin();
-        while (j != dstatus.end()) {
-            if (j->first != pd && j->second->contains(i)) {
-                times_downloading++;
-            }
-            ++j;
-        }
+        // pd is not downloading i, so all requests come from other downloaders
+        const Uint32 times_downloading = piece_requests[i];
 
         // nobody is downloading this piece, so return it
         if (times_downloading == 0) {
@@ -303,18 +301,23 @@ void ChunkDownload::sendCancels(PieceDownloader *pd)
         return;
     }
 
-    DownloadStatus::iterator itr = ds->begin();
-    while (itr != ds->end()) {
-        const Uint32 i = *itr;
-        pd->cancel(Request(chunk->getIndex(), i * MAX_PIECE_LEN, i + 1 < num ? MAX_PIECE_LEN : last_size, nullptr));
-        ++itr;
+    for (Uint32 i = 0; i < num && ds->count() > 0; i++) {
+        if (ds->contains(i)) {
+            pd->cancel(Request(chunk->getIndex(), i * MAX_PIECE_LEN, i + 1 < num ? MAX_PIECE_LEN : last_size, nullptr));
+            ds->remove(i);
+        }
     }
-    ds->clear();
     timer.update();
 }
 
 void ChunkDownload::endgameCancel(const Piece &p)
 {
+    // the piece has been removed from the status of the sender, so when
+    // nobody else requested it, there is nothing to cancel
+    if (piece_requests[p.getOffset() / MAX_PIECE_LEN] == 0) {
+        return;
+    }
+
     auto i = pdown.constBegin();
     while (i != pdown.constEnd()) {
         PieceDownloader *pd = *i;
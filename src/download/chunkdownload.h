@@ -16,6 +16,8 @@
 #include <util/sha1hashgen.h>
 #include <util/timer.h>
 
+#include <vector>
+
 namespace bt
 {
 class File;
@@ -47,19 +49,37 @@ struct PieceHeader {
 
 /*!
  * \headerfile download/chunkdownload.h
- * \brief The status of one piece inside a chunk.
+ * \brief The pieces of a chunk which have been requested from one PieceDownloader.
+ *
+ * The requested pieces are kept in a bitmap the size of the chunk. Every change is also
+ * applied to the request counters of the ChunkDownload, so it always knows how many
+ * PieceDownloaders are busy with a piece.
  */
 class DownloadStatus
 {
 public:
-    DownloadStatus();
+    /*!
+     * Constructor
+     * \param num_pieces The number of pieces in the chunk
+     * \param requests Request counter for each piece, shared by all DownloadStatus objects of a chunk
+     */
+    DownloadStatus(Uint32 num_pieces, Uint32 *requests);
     ~DownloadStatus();
 
     void add(Uint32 p);
     void remove(Uint32 p);
-    bool contains(Uint32 p);
+    [[nodiscard]] bool contains(Uint32 p) const
+    {
+        return status.get(p);
+    }
     void clear();
 
+    //! Get the number of requested pieces
+    [[nodiscard]] Uint32 count() const
+    {
+        return status.numOnBits();
+    }
+
     void timeout()
     {
         timeouts++;
@@ -69,19 +89,10 @@ public:
         return timeouts;
     }
 
-    using iterator = QSet<Uint32>::iterator;
-    iterator begin()
-    {
-        return status.begin();
-    }
-    iterator end()
-    {
-        return status.end();
-    }
-
 private:
     Uint32 timeouts;
-    QSet<Uint32> status;
+    BitSet status;
+    Uint32 *requests;
 };
 
 /*!
@@ -244,6 +255,8 @@ private:
     Uint32 last_size;
     Timer timer;
     QList<PieceDownloader *> pdown;
+    // must outlive dstatus, the DownloadStatus destructors update it
+    std::vector<Uint32> piece_requests;
     PtrMap<PieceDownloader *, DownloadStatus> dstatus;
     QSet<PieceDownloader *> piece_providers;
     PieceData::Ptr *piece_data;
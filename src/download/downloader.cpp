@@ -686,12 +686,18 @@ void Downloader::recalcDownloaded()
     bytes_downloaded = (total - cman.bytesLeft());
 }
 
-void Downloader::onChunkReady(Chunk *c)
+void Downloader::onChunkReady(Chunk *c, bool verified)
 {
     WebSeed *ws = webseeds_chunks.find(c->getIndex());
     webseeds_chunks.erase(c->getIndex());
     const PieceData::Ptr piece = c->getPiece(0, c->getSize(), true);
-    if (piece && c->checkHash(tor.getHash(c->getIndex()))) {
+    // The webseed hashed the data as it arrived, only when peers are downloading
+    // the chunk too can the data in memory differ from what was hashed.
+    if (current_chunks.find(c->getIndex())) {
+        verified = c->checkHash(tor.getHash(c->getIndex()));
+    }
+
+    if (piece && verified) {
         // hash ok so save it
         try {
             bytes_downloaded += c->getSize();
@@ -274,8 +274,9 @@ private:
     /*!
      * A WebSeed has finished a Chunk
      * \param c The chunk
+     * \param verified Whether the WebSeed found the data to match the hash
      */
-    void onChunkReady(Chunk *c);
+    void onChunkReady(Chunk *c, bool verified);
 
     void chunkDownloadStarted(WebSeedChunkDownload *cd, Uint32 chunk);
     void chunkDownloadFinished(WebSeedChunkDownload *cd, Uint32 chunk);
@@ -24,7 +24,6 @@ HttpConnection::HttpConnection()
     : sock(nullptr)
     , state(State::IDLE)
     , mutex()
-    , request(nullptr)
     , using_proxy(false)
     , status(i18n("Not connected"))
     , response_code(0)
@@ -43,7 +42,7 @@ HttpConnection::~HttpConnection()
         delete sock;
     }
 
-    delete request;
+    qDeleteAll(requests);
 }
 
 void HttpConnection::setGroupIDs(Uint32 up, Uint32 down)
@@ -83,7 +82,19 @@ bool HttpConnection::closed() const
 bool HttpConnection::ready() const
 {
     const QMutexLocker locker(&mutex);
-    return !request;
+    return !no_more_requests && Uint32(requests.size()) < max_pipelined;
+}
+
+Uint32 HttpConnection::numPendingRequests() const
+{
+    const QMutexLocker locker(&mutex);
+    return requests.size();
+}
+
+void HttpConnection::setMaxPipelined(Uint32 max)
+{
+    const QMutexLocker locker(&mutex);
+    max_pipelined = qMax<Uint32>(max, 1);
 }
 
 void HttpConnection::connectToProxy(const QString &proxy, Uint16 proxy_port)
@@ -118,33 +129,71 @@ void HttpConnection::onDataReady(Uint8 *buf, Uint32 size)
 {
     const QMutexLocker locker(&mutex);
 
-    if (state != State::ERROR && request) {
+    if (state == State::ERROR || requests.isEmpty()) {
+        return;
+    }
+
+    if (size == 0) {
+        // connection closed
+        state = State::CLOSED;
+        status = i18n("Connection closed");
+        return;
+    }
+
+    // the responses arrive in the order of the requests, so hand each request its part
+    for (HttpGet *g : std::as_const(requests)) {
         if (size == 0) {
-            // connection closed
-            state = State::CLOSED;
-            status = i18n("Connection closed");
-        } else {
-            if (!request->onDataReady(buf, size)) {
-                state = State::ERROR;
-                status = i18n("Error: request failed: %1", request->failure_reason);
-                response_code = request->response_code;
-            } else if (request->response_header_received) {
-                Q_EMIT stopReplyTimer();
+            break;
+        } else if (g->finished()) {
+            continue;
+        }
+
+        const int consumed = g->onDataReady(buf, size);
+        if (consumed < 0) {
+            state = State::ERROR;
+            status = i18n("Error: request failed: %1", g->failure_reason);
+            response_code = g->response_code;
+            return;
+        }
+
+        if (g->response_header_received) {
+            Q_EMIT stopReplyTimer();
+            if (g->connection_close) {
+                // the server closes the connection after this one, so do not queue more
+                no_more_requests = true;
             }
         }
+
+        buf += consumed;
+        size -= consumed;
+    }
+
+    // A reply to a request which is still in flight, wait for it
+    if (!requests.isEmpty() && !requests.back()->finished()) {
+        Q_EMIT startReplyTimer(60 * 1000);
     }
 }
 
 void HttpConnection::dataSent()
 {
     const QMutexLocker locker(&mutex);
-    if (state == State::ACTIVE && request) {
-        request->buffer.clear();
+    if (state == State::ACTIVE && !requests.isEmpty()) {
         // wait 60 seconds for a reply
         Q_EMIT startReplyTimer(60 * 1000);
     }
 }
 
+void HttpConnection::sendPending()
+{
+    for (HttpGet *g : std::as_const(requests)) {
+        if (!g->request_sent) {
+            sock->addData(g->request_data);
+            g->request_data.clear();
+            g->request_sent = true;
+        }
+    }
+}
+
 void HttpConnection::connectFinished(bool succeeded)
 {
     const QMutexLocker locker(&mutex);
@@ -152,10 +201,7 @@ void HttpConnection::connectFinished(bool succeeded)
         if (succeeded) {
             state = State::ACTIVE;
             status = i18n("Connected");
-            if (request && !request->request_sent) {
-                sock->addData(request->buffer);
-                request->request_sent = true;
-            }
+            sendPending();
         } else {
             Out(SYS_CON | LOG_IMPORTANT) << "HttpConnection: failed to connect to webseed " << endl;
             state = State::ERROR;
@@ -180,6 +226,7 @@ void HttpConnection::hostResolved(net::AddressResolver *ar)
         if (sock->socketDevice()->connectTo(addr)) {
             status = i18n("Connected");
             state = State::ACTIVE;
+            sendPending();
             net::SocketMonitor::instance().add(sock);
             net::SocketMonitor::instance().signalPacketReady();
         } else if (sock->socketDevice()->state() == net::SocketDevice::State::CONNECTING) {
@@ -204,14 +251,13 @@ void HttpConnection::hostResolved(net::AddressResolver *ar)
 bool HttpConnection::get(const QString &host, const QString &path, const QString &query, bt::Uint64 start, bt::Uint64 len)
 {
     const QMutexLocker locker(&mutex);
-    if (state == State::ERROR || request) {
+    if (state == State::ERROR || no_more_requests || Uint32(requests.size()) >= max_pipelined) {
         return false;
     }
 
-    request = new HttpGet(host, path, query, start, len, using_proxy);
-    if (sock) {
-        sock->addData(request->buffer);
-        request->request_sent = true;
+    requests.append(new HttpGet(host, path, query, start, len, using_proxy));
+    if (sock && state == State::ACTIVE) {
+        sendPending();
     }
     return true;
 }
@@ -219,44 +265,47 @@ bool HttpConnection::get(const QString &host, const QString &path, const QString
 bool HttpConnection::getData(QByteArray &data)
 {
     const QMutexLocker locker(&mutex);
-    if (!request) {
-        return false;
-    }
+    while (!requests.isEmpty()) {
+        HttpGet *g = requests.front();
+        if (g->redirected) {
+            // wait until we have the entire content if we are redirected
+            if (g->data_received < g->content_length) {
+                return false;
+            }
 
-    HttpGet *g = request;
-    if (g->redirected) {
-        // wait until we have the entire content if we are redirected
-        if (g->data_received < g->content_length) {
+            // we have the content so we can redirect the connection
+            redirected_url = g->redirected_to;
+            redirected = true;
             return false;
         }
 
-        // we have the content so we can redirect the connection
-        redirected_url = g->redirected_to;
-        redirected = true;
-        return false;
-    }
+        const bool has_data = g->piece_data.size() > 0;
+        if (has_data) {
+            data = g->piece_data;
+            g->piece_data.clear();
+        } else if (!g->finished()) {
+            return false;
+        }
 
-    if (g->piece_data.size() == 0) {
-        return false;
-    }
+        // if all the data has been received and passed on to something else
+        // remove the current request from the queue
+        if (g->finished()) {
+            delete g;
+            requests.pop_front();
+            if (close_when_finished && requests.isEmpty()) {
+                state = State::CLOSED;
+                Out(SYS_CON | LOG_DEBUG) << "HttpConnection: closing connection due to redirection" << endl;
+                // reset connection
+                sock->socketDevice()->reset();
+            }
+        }
 
-    data = g->piece_data;
-    g->piece_data.clear();
-
-    // if all the data has been received and passed on to something else
-    // remove the current request from the queue
-    if (g->piece_data.size() == 0 && g->finished()) {
-        delete g;
-        request = nullptr;
-        if (close_when_finished) {
-            state = State::CLOSED;
-            Out(SYS_CON | LOG_DEBUG) << "HttpConnection: closing connection due to redirection" << endl;
-            // reset connection
-            sock->socketDevice()->reset();
+        if (has_data) {
+            return true;
         }
     }
 
-    return true;
+    return false;
 }
 
 int HttpConnection::getDownloadRate() const
@@ -282,7 +331,7 @@ void HttpConnection::connectTimeout()
 void HttpConnection::replyTimeout()
 {
     const QMutexLocker locker(&mutex);
-    if (!request || !request->response_header_received) {
+    if (!requests.isEmpty() && !requests.front()->finished()) {
         status = i18n("Error: request timed out");
         state = State::ERROR;
         reply_timer.stop();
@@ -306,49 +355,56 @@ HttpConnection::HttpGet::HttpGet(const QString &host, const QString &path, const
     url.setPath(path);
     url.setQuery(query);
 
-    buffer.clear();
-    buffer += QByteArrayLiteral("GET ") + (using_proxy ? url.toEncoded() : (url.path(QUrl::FullyEncoded).toLatin1() + '?' + url.query(QUrl::FullyEncoded).toLatin1())) + " HTTP/1.1\r\n"
-              "Host: " + host.toLatin1() + "\r\n"
-              "Range: bytes=" + QByteArray::number(start) + '-' + QByteArray::number(start + len - 1) + "\r\n"
-              "User-Agent: " + bt::GetVersionString().toLatin1() + "\r\n"
-              "Accept:  text/xml,application/xml,application/xhtml+xml,text/html;q=0.9,text/plain;q=0.8,image/png,*/*;q=0.5\r\n"
-              "Accept-Language: en-us,en;q=0.5\r\n"
-              "Accept-Charset: ISO-8859-1,utf-8;q=0.7,*;q=0.7\r\n"
-              + (using_proxy ?
-                 "Keep-Alive: 300\r\n"
-                 "Proxy-Connection: keep-alive\r\n\r\n" :
-                 "Connection: Keep-Alive\r\n\r\n");
+    request_data = QByteArrayLiteral("GET ") + (using_proxy ? url.toEncoded() : (url.path(QUrl::FullyEncoded).toLatin1() + '?' + url.query(QUrl::FullyEncoded).toLatin1())) + " HTTP/1.1\r\n"
+                   "Host: " + host.toLatin1() + "\r\n"
+                   "Range: bytes=" + QByteArray::number(start) + '-' + QByteArray::number(start + len - 1) + "\r\n"
+                   "User-Agent: " + bt::GetVersionString().toLatin1() + "\r\n"
+                   "Accept:  text/xml,application/xml,application/xhtml+xml,text/html;q=0.9,text/plain;q=0.8,image/png,*/*;q=0.5\r\n"
+                   "Accept-Language: en-us,en;q=0.5\r\n"
+                   "Accept-Charset: ISO-8859-1,utf-8;q=0.7,*;q=0.7\r\n"
+                   + (using_proxy ?
+                      "Keep-Alive: 300\r\n"
+                      "Proxy-Connection: keep-alive\r\n\r\n" :
+                      "Connection: Keep-Alive\r\n\r\n");
 
     redirected = false;
     content_length = 0;
+    body_length = len;
+    connection_close = false;
     Out(SYS_CON | LOG_DEBUG) << "HttpConnection: sending http request:" << endl;
-    Out(SYS_CON | LOG_DEBUG) << buffer.constData() << endl;
+    Out(SYS_CON | LOG_DEBUG) << request_data.constData() << endl;
 }
 
 HttpConnection::HttpGet::~HttpGet()
 {
 }
 
-bool HttpConnection::HttpGet::onDataReady(Uint8 *buf, Uint32 size)
+int HttpConnection::HttpGet::onDataReady(const Uint8 *buf, Uint32 size)
 {
     if (!response_header_received) {
         // append the data
-        buffer.append(QByteArray::fromRawData((char *)buf, size));
+        const int old_size = buffer.size();
+        buffer.append(QByteArrayView(buf, size));
         // look for the end of the header
-        const int idx = buffer.indexOf("\r\n\r\n");
+        const int idx = buffer.indexOf("\r\n\r\n", qMax(old_size - 3, 0));
         if (idx == -1) { // haven't got the full header yet
-            return true;
+            return size;
         }
 
         response_header_received = true;
         HttpResponseHeader hdr(QString::fromLatin1(buffer.mid(0, idx + 4)));
 
         if (hdr.hasKey(u"Content-Length"_s)) {
-            content_length = hdr.value(u"Content-Length"_s).toInt();
+            content_length = hdr.value(u"Content-Length"_s).toULongLong();
+            body_length = content_length;
         } else {
             content_length = 0;
+            body_length = len;
         }
 
+        connection_close = hdr.value(u"Connection"_s).compare("close"_L1, Qt::CaseInsensitive) == 0
+            || hdr.value(u"Proxy-Connection"_s).compare("close"_L1, Qt::CaseInsensitive) == 0;
+
         Out(SYS_CON | LOG_DEBUG) << "HttpConnection: http reply header received" << endl;
         Out(SYS_CON | LOG_DEBUG) << buffer.mid(0, idx + 4).constData() << endl;
         response_code = hdr.statusCode();
@@ -356,7 +412,7 @@ bool HttpConnection::HttpGet::onDataReady(Uint8 *buf, Uint32 size)
             // we got redirected to somewhere else
             if (!hdr.hasKey(u"Location"_s)) {
                 failure_reason = i18n("Redirected without a new location.");
-                return false;
+                return -1;
             } else {
                 Out(SYS_CON | LOG_DEBUG) << "Redirected to " << hdr.value(u"Location"_s) << endl;
                 redirected = true;
@@ -364,21 +420,26 @@ bool HttpConnection::HttpGet::onDataReady(Uint8 *buf, Uint32 size)
             }
         } else if (!(hdr.statusCode() == 200 || hdr.statusCode() == 206)) {
             failure_reason = hdr.reasonPhrase();
-            return false;
+            return -1;
         }
 
-        if (buffer.size() - (idx + 4) > 0) {
-            // more data then the header has arrived so append it to piece_data
-            data_received += buffer.size() - (idx + 4);
-            piece_data.append(buffer.mid(idx + 4));
+        // more data then the header may have arrived, the part which belongs to
+        // the body goes into piece_data, the rest is for the next response
+        const Uint64 extra = buffer.size() - (idx + 4);
+        const Uint64 body = qMin(extra, body_length);
+        if (body > 0) {
+            data_received += body;
+            piece_data.append(buffer.mid(idx + 4, body));
         }
+        buffer.clear();
+        return size - (extra - body);
     } else {
         // append the data to the list
-        data_received += size;
-        piece_data.append(QByteArray((char *)buf, size));
+        const Uint32 body = qMin<Uint64>(size, body_length - data_received);
+        data_received += body;
+        piece_data.append(QByteArrayView(buf, body));
+        return body;
     }
-    return true;
-}
 }
 
 #include "moc_httpconnection.cpp"
@@ -7,9 +7,11 @@
 #ifndef BTHTTPCONNECTION_H
 #define BTHTTPCONNECTION_H
 
+#include <QList>
 #include <QRecursiveMutex>
 #include <QTimer>
 #include <QUrl>
+#include <ktorrent_export.h>
 #include <net/addressresolver.h>
 #include <net/streamsocket.h>
 
@@ -24,8 +26,12 @@ namespace bt
     \brief HTTP connection for webseeding.
 
     We do not use KIO here, because we want to be able to apply the maximum upload and download rate to webseeds;
+
+    The connection is kept alive between requests, and up to maxPipelined() requests
+    are sent without waiting for the previous responses. The responses arrive in the
+    order of the requests, so the body of each one ends where the next header starts.
 */
-class HttpConnection : public QObject, public net::SocketReader, public net::StreamSocketListener
+class KTORRENT_EXPORT HttpConnection : public QObject, public net::SocketReader, public net::StreamSocketListener
 {
     Q_OBJECT
 public:
@@ -82,6 +88,23 @@ public:
     //! Ready to do another request
     bool ready() const;
 
+    //! Number of requests which have not been fully passed on by getData yet
+    Uint32 numPendingRequests() const;
+
+    /*!
+     * Set the maximum number of requests in flight on the connection,
+     * 1 disables pipelining.
+     */
+    void setMaxPipelined(Uint32 max);
+
+    //! Get the maximum number of requests in flight on the connection
+    Uint32 maxPipelined() const
+    {
+        return max_pipelined;
+    }
+
+    static constexpr Uint32 DEFAULT_MAX_PIPELINED = 8;
+
     /*!
      * Do a HTTP GET request
      * \param host The hostname of the webseed
@@ -112,6 +135,7 @@ public:
 private:
     void connectTimeout();
     void replyTimeout();
+    void sendPending();
 
 Q_SIGNALS:
     void startReplyTimer(int timeout);
@@ -138,6 +162,7 @@ private:
         bt::Uint64 start;
         bt::Uint64 len;
         bt::Uint64 data_received;
+        QByteArray request_data;
         QByteArray buffer;
         QByteArray piece_data;
         bool response_header_received;
@@ -146,22 +171,32 @@ private:
         bool redirected;
         QUrl redirected_to;
         bt::Uint64 content_length;
+        bt::Uint64 body_length;
+        bool connection_close;
         int response_code;
 
         HttpGet(const QString &host, const QString &path, const QString &query, bt::Uint64 start, bt::Uint64 len, bool using_proxy);
         virtual ~HttpGet();
 
-        bool onDataReady(Uint8 *buf, Uint32 size);
+        /*!
+         * Feed data of the response to the request.
+         * \return The number of bytes which belong to this response, or -1 on failure
+         */
+        int onDataReady(const Uint8 *buf, Uint32 size);
+
+        //! Has the entire response been received
         [[nodiscard]] bool finished() const
         {
-            return data_received >= len;
+            return response_header_received && data_received >= body_length;
         }
     };
 
     net::StreamSocket *sock;
     State state;
     mutable QRecursiveMutex mutex;
-    HttpGet *request;
+    QList<HttpGet *> requests;
+    Uint32 max_pipelined = DEFAULT_MAX_PIPELINED;
+    bool no_more_requests = false;
     bool using_proxy;
     QString status;
     QTimer connect_timer;
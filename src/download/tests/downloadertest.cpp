@@ -0,0 +1,170 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QFile>
+#include <QLocale>
+#include <QObject>
+#include <QTest>
+
+#include "testlib/dummytorrentcreator.h"
+#include <download/downloader.h>
+#include <download/piece.h>
+#include <download/streamingchunkselector.h>
+#include <interfaces/piecedownloader.h>
+#include <torrent/torrentcontrol.h>
+#include <util/error.h>
+#include <util/functions.h>
+#include <util/log.h>
+
+#include <utility>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+const bt::Uint64 TEST_FILE_SIZE = 15 * 1024 * 1024;
+
+/*
+    PieceDownloader which records all requests, so the test can answer them
+*/
+class RecordingDownloader : public PieceDownloader
+{
+public:
+    ~RecordingDownloader() override
+    {
+    }
+
+    [[nodiscard]] bool canAddRequest() const override
+    {
+        return true;
+    }
+    void cancel(const bt::Request &) override
+    {
+    }
+    void cancelAll() override
+    {
+    }
+    [[nodiscard]] bool canDownloadChunk() const override
+    {
+        return getNumGrabbed() < 4;
+    }
+    void download(const bt::Request &req) override
+    {
+        requests.append(req);
+    }
+    void checkTimeouts() override
+    {
+    }
+    [[nodiscard]] Uint32 getDownloadRate() const override
+    {
+        return 0;
+    }
+    [[nodiscard]] QString getName() const override
+    {
+        return u"recorder"_s;
+    }
+    [[nodiscard]] bool isChoked() const override
+    {
+        return false;
+    }
+
+    QList<Request> requests;
+};
+
+class DownloaderAccessor : public bt::StreamingChunkSelector
+{
+public:
+    Downloader *downloader()
+    {
+        return downer;
+    }
+};
+
+class DownloaderTest : public QObject
+{
+    Q_OBJECT
+public:
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QLocale::setDefault(QLocale(u"main"_s));
+        QVERIFY(bt::InitLibKTorrent());
+        bt::InitLog(u"downloadertest.log"_s, false, false);
+
+        QVERIFY(creator.createSingleFileTorrent(TEST_FILE_SIZE, u"test.avi"_s));
+        QFile fptr(creator.dataPath());
+        QVERIFY(fptr.open(QIODevice::ReadOnly));
+        data = fptr.readAll();
+        QCOMPARE((Uint64)data.size(), TEST_FILE_SIZE);
+    }
+
+    void testDownload()
+    {
+        QCOMPARE(downloadAll(u"tor0"_s), (Uint32)(TEST_FILE_SIZE / MAX_PIECE_LEN));
+    }
+
+    void benchmarkPieceReceived()
+    {
+        Uint32 num_pieces = 0;
+        QBENCHMARK_ONCE {
+            num_pieces = downloadAll(u"tor1"_s);
+        }
+        QCOMPARE(num_pieces, (Uint32)(TEST_FILE_SIZE / MAX_PIECE_LEN));
+    }
+
+private:
+    /*
+        Download the whole torrent by answering every request from the original data,
+        returns the number of pieces passed to Downloader::pieceReceived
+    */
+    Uint32 downloadAll(const QString &tor_dir)
+    {
+        bt::TorrentControl tc;
+        try {
+            tc.init(nullptr, bt::LoadFile(creator.torrentPath()), creator.tempPath() + tor_dir, creator.tempPath() + "data/"_L1);
+            tc.createFiles();
+        } catch (bt::Error &err) {
+            Out(SYS_GEN | LOG_DEBUG) << "Failed to load torrent: " << creator.torrentPath() << endl;
+            return 0;
+        }
+
+        DownloaderAccessor *csel = new DownloaderAccessor();
+        tc.setChunkSelector(std::unique_ptr<DownloaderAccessor>(csel));
+        Downloader *downer = csel->downloader();
+        PieceHandler *handler = downer;
+        const Uint64 chunk_size = tc.getTorrent().getChunkSize();
+
+        RecordingDownloader rd;
+        downer->addPieceDownloader(&rd);
+
+        Uint32 num_pieces = 0;
+        while (!downer->isFinished()) {
+            downer->update();
+            if (rd.requests.isEmpty()) {
+                break;
+            }
+
+            const QList<Request> reqs = std::exchange(rd.requests, QList<Request>());
+            for (const Request &r : reqs) {
+                const Uint8 *d = (const Uint8 *)data.constData() + r.getIndex() * chunk_size + r.getOffset();
+                handler->pieceReceived(Piece(r.getIndex(), r.getOffset(), r.getLength(), &rd, d));
+                num_pieces++;
+            }
+        }
+
+        const bool finished = downer->isFinished();
+        downer->removePieceDownloader(&rd);
+        tc.setChunkSelector(nullptr);
+        return finished ? num_pieces : 0;
+    }
+
+private:
+    DummyTorrentCreator creator;
+    QByteArray data;
+};
+
+QTEST_MAIN(DownloaderTest)
+
+#include "downloadertest.moc"
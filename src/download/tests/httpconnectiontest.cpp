@@ -0,0 +1,178 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTest>
+
+#include "localhttpserver.h"
+#include <download/httpconnection.h>
+#include <util/functions.h>
+#include <util/log.h>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+using RangeList = QList<QPair<Uint64, Uint64>>;
+
+class HttpConnectionTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    HttpConnectionTest()
+    {
+    }
+    ~HttpConnectionTest() override
+    {
+    }
+
+private:
+    // Request all ranges, keeping the pipeline full, and collect the data
+    QByteArray fetch(HttpConnection &conn, const RangeList &ranges)
+    {
+        QByteArray result;
+        int next = 0;
+        QElapsedTimer timer;
+        timer.start();
+        while (timer.elapsed() < 10000) {
+            while (next < ranges.size() && conn.ready()) {
+                if (!conn.get(u"127.0.0.1"_s, u"/file"_s, QString(), ranges[next].first, ranges[next].second)) {
+                    break;
+                }
+                next++;
+            }
+
+            QByteArray tmp;
+            while (conn.getData(tmp)) {
+                result.append(tmp);
+                tmp.clear();
+            }
+
+            if ((next == ranges.size() && conn.numPendingRequests() == 0) || !conn.ok() || conn.closed()) {
+                break;
+            }
+            QTest::qWait(1);
+        }
+
+        // the last data can arrive right before the connection is closed
+        QByteArray tmp;
+        while (conn.getData(tmp)) {
+            result.append(tmp);
+            tmp.clear();
+        }
+        return result;
+    }
+
+    QByteArray expected(const RangeList &ranges) const
+    {
+        QByteArray ret;
+        for (const auto &[off, len] : ranges) {
+            ret.append(file.mid(off, len));
+        }
+        return ret;
+    }
+
+    // Lots of small ranges, like the files in the chunks of a torrent with many small files
+    static RangeList smallRanges(int count, Uint64 size)
+    {
+        RangeList ranges;
+        for (int i = 0; i < count; i++) {
+            ranges.append({i * size + (i % 3), size - (i % 7)});
+        }
+        return ranges;
+    }
+
+    void benchmarkFetch(Uint32 max_pipelined)
+    {
+        LocalHttpServer server;
+        server.addFile(u"/file"_s, file);
+        server.setLatency(2);
+
+        HttpConnection conn;
+        conn.setMaxPipelined(max_pipelined);
+        conn.connectTo(server.url(u"/file"_s));
+
+        const RangeList ranges = smallRanges(64, 16 * 1024);
+        const QByteArray exp = expected(ranges);
+        QBENCHMARK {
+            QCOMPARE(fetch(conn, ranges), exp);
+        }
+        // everything went over the same connection
+        QCOMPARE(server.num_connections, 1);
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"httpconnectiontest.log"_s);
+        file.resize(4 * 1024 * 1024);
+        for (int i = 0; i < file.size(); i++) {
+            file[i] = char(i * 31 + i / 4099);
+        }
+    }
+
+    void testPipelining_data()
+    {
+        QTest::addColumn<Uint32>("max_pipelined");
+        QTest::newRow("no pipelining") << Uint32(1);
+        QTest::newRow("pipelining") << Uint32(8);
+    }
+
+    void testPipelining()
+    {
+        QFETCH(Uint32, max_pipelined);
+        LocalHttpServer server;
+        server.addFile(u"/file"_s, file);
+
+        HttpConnection conn;
+        conn.setMaxPipelined(max_pipelined);
+        conn.connectTo(server.url(u"/file"_s));
+
+        RangeList ranges = smallRanges(40, 1000);
+        ranges.append({100000, 300000});
+        ranges.append({7, 1});
+        QCOMPARE(fetch(conn, ranges), expected(ranges));
+        QVERIFY(conn.ok());
+        QCOMPARE(conn.numPendingRequests(), 0u);
+        QCOMPARE(server.num_connections, 1);
+        QCOMPARE(server.num_requests, int(ranges.size()));
+    }
+
+    void testConnectionClose()
+    {
+        LocalHttpServer server;
+        server.addFile(u"/file"_s, file);
+        server.setMaxRequestsPerConnection(2);
+
+        HttpConnection conn;
+        conn.connectTo(server.url(u"/file"_s));
+
+        // the server only answers the first two, and says it will close the connection
+        const RangeList ranges = smallRanges(6, 5000);
+        const QByteArray data = fetch(conn, ranges);
+        QCOMPARE(data, expected(ranges.mid(0, 2)));
+        QVERIFY(!conn.ready());
+        QCOMPARE(conn.numPendingRequests(), 4u);
+    }
+
+    void benchmarkNoPipelining()
+    {
+        benchmarkFetch(1);
+    }
+
+    void benchmarkPipelining()
+    {
+        benchmarkFetch(HttpConnection::DEFAULT_MAX_PIPELINED);
+    }
+
+private:
+    QByteArray file;
+};
+
+QTEST_MAIN(HttpConnectionTest)
+
+#include "httpconnectiontest.moc"
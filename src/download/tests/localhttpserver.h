@@ -0,0 +1,190 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef LOCALHTTPSERVER_H
+#define LOCALHTTPSERVER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QMap>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+#include <deque>
+
+/*
+    Minimal HTTP/1.1 server for testing webseeds. It serves files from memory,
+    supports Range requests, keep-alive and pipelining, and can delay every
+    response to simulate the round trip time to a real server.
+*/
+class LocalHttpServer
+{
+public:
+    LocalHttpServer()
+    {
+        QObject::connect(&server, &QTcpServer::newConnection, &server, [this]() {
+            while (QTcpSocket *s = server.nextPendingConnection()) {
+                accept(s);
+            }
+        });
+        server.listen(QHostAddress::LocalHost, 0);
+    }
+
+    //! Serve data under path
+    void addFile(const QString &path, const QByteArray &data)
+    {
+        files.insert(path, data);
+    }
+
+    //! Delay each response by ms milliseconds, counted from the arrival of its request
+    void setLatency(int ms)
+    {
+        latency = ms;
+    }
+
+    //! Close the connection after this many responses (0 means never)
+    void setMaxRequestsPerConnection(int max)
+    {
+        max_requests_per_connection = max;
+    }
+
+    [[nodiscard]] quint16 port() const
+    {
+        return server.serverPort();
+    }
+
+    [[nodiscard]] QUrl url(const QString &path) const
+    {
+        return QUrl(QStringLiteral("http://127.0.0.1:%1%2").arg(port()).arg(path));
+    }
+
+    int num_connections = 0;
+    int num_requests = 0;
+
+private:
+    struct Response {
+        qint64 due;
+        QByteArray data;
+        bool close;
+    };
+
+    struct Connection {
+        QTcpSocket *sock;
+        QByteArray buffer;
+        std::deque<Response> responses;
+        QTimer *timer;
+        int num_requests = 0;
+    };
+
+    void accept(QTcpSocket *s)
+    {
+        num_connections++;
+        // the socket owns everything of the connection, it is a child of the server
+        auto *c = new Connection;
+        c->sock = s;
+        c->timer = new QTimer(s);
+        c->timer->setSingleShot(true);
+        QObject::connect(c->timer, &QTimer::timeout, s, [this, c]() {
+            sendDue(c);
+        });
+        QObject::connect(s, &QTcpSocket::readyRead, s, [this, c]() {
+            c->buffer.append(c->sock->readAll());
+            parseRequests(c);
+        });
+        QObject::connect(s, &QTcpSocket::disconnected, s, &QObject::deleteLater);
+        QObject::connect(s, &QObject::destroyed, [c]() {
+            delete c;
+        });
+    }
+
+    void parseRequests(Connection *c)
+    {
+        int idx;
+        while ((idx = c->buffer.indexOf("\r\n\r\n")) >= 0) {
+            const QByteArray header = c->buffer.left(idx);
+            c->buffer.remove(0, idx + 4);
+            num_requests++;
+            c->num_requests++;
+
+            const bool close = max_requests_per_connection > 0 && c->num_requests >= max_requests_per_connection;
+            c->responses.push_back(Response{clock.elapsed() + latency, respond(header, close), close});
+            if (close) {
+                // anything else which was pipelined is dropped
+                c->buffer.clear();
+                break;
+            }
+        }
+        sendDue(c);
+    }
+
+    QByteArray respond(const QByteArray &header, bool close) const
+    {
+        const QList<QByteArray> lines = header.split('\n');
+        const QList<QByteArray> request_line = lines.value(0).trimmed().split(' ');
+        QString path = QString::fromLatin1(request_line.value(1));
+        const int q = path.indexOf(QLatin1Char('?'));
+        if (q >= 0) {
+            path.truncate(q);
+        }
+        path = QUrl::fromPercentEncoding(path.toLatin1());
+
+        const QByteArray connection = close ? "Connection: close\r\n" : "Connection: Keep-Alive\r\n";
+        auto f = files.constFind(path);
+        if (f == files.cend()) {
+            return "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n" + connection + "\r\n";
+        }
+
+        const QByteArray &data = f.value();
+        qint64 start = 0;
+        qint64 end = data.size() - 1;
+        for (const QByteArray &l : lines) {
+            if (l.toLower().startsWith("range: bytes=")) {
+                const QList<QByteArray> r = l.mid(13).trimmed().split('-');
+                start = r.value(0).toLongLong();
+                end = qMin<qint64>(r.value(1).toLongLong(), data.size() - 1);
+            }
+        }
+
+        const QByteArray body = data.mid(start, end - start + 1);
+        return "HTTP/1.1 206 Partial Content\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\nContent-Range: bytes "
+            + QByteArray::number(start) + '-' + QByteArray::number(end) + '/' + QByteArray::number(data.size()) + "\r\n" + connection + "\r\n" + body;
+    }
+
+    void sendDue(Connection *c)
+    {
+        const qint64 now = clock.elapsed();
+        while (!c->responses.empty() && c->responses.front().due <= now) {
+            const Response r = c->responses.front();
+            c->responses.pop_front();
+            c->sock->write(r.data);
+            if (r.close) {
+                c->sock->disconnectFromHost();
+                return;
+            }
+        }
+
+        if (!c->responses.empty()) {
+            c->timer->start(int(c->responses.front().due - now));
+        }
+    }
+
+    QTcpServer server;
+    QMap<QString, QByteArray> files;
+    QElapsedTimer clock = startedClock();
+    int latency = 0;
+    int max_requests_per_connection = 0;
+
+    static QElapsedTimer startedClock()
+    {
+        QElapsedTimer t;
+        t.start();
+        return t;
+    }
+};
+
+#endif // LOCALHTTPSERVER_H
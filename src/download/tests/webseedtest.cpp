@@ -0,0 +1,192 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QFile>
+#include <QObject>
+#include <QTest>
+
+#include "localhttpserver.h"
+#include "testlib/dummytorrentcreator.h"
+#include <diskio/chunk.h>
+#include <diskio/chunkmanager.h>
+#include <diskio/piecedata.h>
+#include <download/downloader.h>
+#include <download/streamingchunkselector.h>
+#include <download/webseed.h>
+#include <torrent/torrentcontrol.h>
+#include <util/bitset.h>
+#include <util/error.h>
+#include <util/functions.h>
+#include <util/log.h>
+
+#include <map>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+const bt::Uint64 TEST_FILE_SIZE = 2 * 1024 * 1024;
+
+class SelectorAccessor : public bt::StreamingChunkSelector
+{
+public:
+    Downloader *downloader()
+    {
+        return downer;
+    }
+
+    ChunkManager *chunkManager()
+    {
+        return cman;
+    }
+};
+
+class WebSeedTest : public QObject
+{
+    Q_OBJECT
+public:
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QVERIFY(bt::InitLibKTorrent());
+        bt::InitLog(u"webseedtest.log"_s, false, false);
+
+        QVERIFY(creator.createSingleFileTorrent(TEST_FILE_SIZE, u"test.avi"_s));
+        QFile fptr(creator.dataPath());
+        QVERIFY(fptr.open(QIODevice::ReadOnly));
+        data = fptr.readAll();
+        QCOMPARE((Uint64)data.size(), TEST_FILE_SIZE);
+    }
+
+    void testStreamingHash()
+    {
+        server.addFile(u"/good/test.avi"_s, data);
+
+        bt::TorrentControl tc;
+        SelectorAccessor *csel = load(tc, u"tor0"_s);
+        QVERIFY(csel);
+        WebSeed *ws = csel->downloader()->addWebSeed(server.url(u"/good/test.avi"_s));
+        QVERIFY(ws);
+
+        std::map<Uint32, bool> ready;
+        connect(ws, &WebSeed::chunkReady, this, [&ready](Chunk *c, bool verified) {
+            ready[c->getIndex()] = verified;
+        });
+
+        for (int i = 0; i < 1000 && !csel->chunkManager()->completed(); i++) {
+            csel->downloader()->update();
+            QTest::qWait(10);
+        }
+        QVERIFY(csel->chunkManager()->completed());
+
+        // every chunk was hashed while it arrived, so none of them had to be read back
+        const Uint32 num_chunks = tc.getTorrent().getNumChunks();
+        QCOMPARE((Uint32)ready.size(), num_chunks);
+        for (const auto &[index, verified] : ready) {
+            QVERIFY(verified);
+        }
+        QVERIFY(ws->isEnabled());
+        tc.setChunkSelector(nullptr);
+    }
+
+    void testFallbackToFullHash()
+    {
+        bt::TorrentControl tc;
+        SelectorAccessor *csel = load(tc, u"tor1"_s);
+        QVERIFY(csel);
+        WebSeed *ws = csel->downloader()->addWebSeed(server.url(u"/unused/test.avi"_s));
+        QVERIFY(ws);
+
+        // a chunk which could not be hashed while streaming is hashed in full, and kept when it is good
+        QVERIFY(deliver(ws, csel->chunkManager(), 0));
+        QVERIFY(tc.downloadedChunksBitSet().get(0));
+        QCOMPARE(csel->chunkManager()->getChunk(0)->getStatus(), Chunk::Status::ON_DISK);
+        QVERIFY(ws->isEnabled());
+        tc.setChunkSelector(nullptr);
+    }
+
+    void testCorruptedChunkRejected()
+    {
+        bt::TorrentControl tc;
+        SelectorAccessor *csel = load(tc, u"tor2"_s);
+        QVERIFY(csel);
+
+        const Uint32 bad_chunk = 1;
+        const int bad_byte = (int)tc.getTorrent().getChunkSize() * bad_chunk + 10;
+        QByteArray corrupted = data;
+        corrupted[bad_byte] = ~corrupted[bad_byte];
+        server.addFile(u"/bad/test.avi"_s, corrupted);
+
+        WebSeed *ws = csel->downloader()->addWebSeed(server.url(u"/bad/test.avi"_s));
+        QVERIFY(ws);
+
+        std::map<Uint32, bool> ready;
+        connect(ws, &WebSeed::chunkReady, this, [&ready](Chunk *c, bool verified) {
+            ready[c->getIndex()] = verified;
+        });
+
+        for (int i = 0; i < 1000 && ws->isEnabled() && !csel->chunkManager()->completed(); i++) {
+            csel->downloader()->update();
+            QTest::qWait(10);
+        }
+
+        // the streaming hash did not match, and neither did the full one
+        QVERIFY(ready.count(bad_chunk));
+        QVERIFY(!ready[bad_chunk]);
+        QVERIFY(!tc.downloadedChunksBitSet().get(bad_chunk));
+        QVERIFY(!ws->isEnabled());
+
+        // the good chunks which came before it were kept
+        for (const auto &[index, verified] : ready) {
+            if (index != bad_chunk) {
+                QVERIFY(verified);
+                QVERIFY(tc.downloadedChunksBitSet().get(index));
+            }
+        }
+        tc.setChunkSelector(nullptr);
+    }
+
+private:
+    // load the torrent in tor_dir with nothing downloaded, returns the chunk selector
+    SelectorAccessor *load(bt::TorrentControl &tc, const QString &tor_dir)
+    {
+        try {
+            tc.init(nullptr, bt::LoadFile(creator.torrentPath()), creator.tempPath() + tor_dir, creator.tempPath() + tor_dir + "_data/"_L1);
+            tc.createFiles();
+        } catch (bt::Error &err) {
+            Out(SYS_GEN | LOG_DEBUG) << "Failed to load torrent: " << creator.torrentPath() << endl;
+            return nullptr;
+        }
+
+        SelectorAccessor *csel = new SelectorAccessor();
+        tc.setChunkSelector(std::unique_ptr<SelectorAccessor>(csel));
+        return csel;
+    }
+
+    // write the data of a chunk, and report it like a webseed which could not hash it while streaming
+    bool deliver(WebSeed *ws, ChunkManager *cman, Uint32 index)
+    {
+        Chunk *c = cman->getChunk(index);
+        PieceData::Ptr piece = c->getPiece(0, c->getSize(), false);
+        if (!piece || !piece->ok()) {
+            return false;
+        }
+
+        const Uint8 *d = (const Uint8 *)data.constData() + (Uint64)index * cman->getTorrent().getChunkSize();
+        piece->write(d, c->getSize(), 0);
+        piece = PieceData::Ptr(nullptr);
+        Q_EMIT ws->chunkReady(c, false);
+        return true;
+    }
+
+private:
+    DummyTorrentCreator creator;
+    LocalHttpServer server;
+    QByteArray data;
+};
+
+QTEST_MAIN(WebSeedTest)
+
+#include "webseedtest.moc"
@@ -192,14 +192,8 @@ void WebSeed::download(Uint32 first, Uint32 last)
             fillRangeList(i);
         }
 
-        if (range_queue.count() > 0) {
-            // send the first request
-            const Range r = range_queue[0];
-            range_queue.pop_front();
-            const TorrentFile &tf = tor.getFile(r.file);
-            const QString host = redirected_url.isValid() ? redirected_url.host() : url.host();
-            conn->get(host, path + '/'_L1 + tf.getPath(), query, r.off, r.len);
-        }
+        // send as many requests as the connection will pipeline
+        requestRanges();
     } else {
         Uint64 len = (last_chunk - first_chunk) * tor.getChunkSize();
         // last chunk can have a different size
@@ -344,18 +338,8 @@ Uint32 WebSeed::update()
                     connectToServer();
                 }
 
-                QString path = url.path();
-                const QString query = url.query();
-                if (path.endsWith('/'_L1)) {
-                    path += tor.getNameSuggestion();
-                }
-
-                // ask for the next range
-                const Range r = range_queue[0];
-                range_queue.pop_front();
-                const TorrentFile &tf = tor.getFile(r.file);
-                const QString host = redirected_url.isValid() ? redirected_url.host() : url.host();
-                conn->get(host, path + '/'_L1 + tf.getPath(), query, r.off, r.len);
+                // ask for the next ranges
+                requestRanges();
             }
             status = conn->getStatusString();
         }
@@ -403,8 +387,23 @@ void WebSeed::handleData(const QByteArray &tmp)
                 cur_piece = c->getPiece(0, c->getSize(), false);
             }
 
+            // hash the data while it is still hot in the cache, so the chunk
+            // does not need to be read back again to verify it
+            if (bytes_of_cur_chunk == 0) {
+                cur_hash.start();
+                cur_hash_valid = true;
+            }
+
+            const Uint8 *data = (const Uint8 *)tmp.data() + off;
             if (cur_piece) {
-                cur_piece->write((const Uint8 *)tmp.data() + off, bl, bytes_of_cur_chunk);
+                cur_piece->write(data, bl, bytes_of_cur_chunk);
+            } else {
+                // the data is lost, so the hash says nothing about the chunk
+                cur_hash_valid = false;
+            }
+
+            if (cur_hash_valid) {
+                cur_hash.update(data, bl);
             }
             downloaded += bl;
         }
@@ -417,7 +416,14 @@ void WebSeed::handleData(const QByteArray &tmp)
             bytes_of_cur_chunk = 0;
             cur_chunk++;
             if (c->getStatus() != Chunk::Status::ON_DISK) {
-                Q_EMIT chunkReady(c);
+                bool verified = false;
+                if (cur_hash_valid) {
+                    cur_hash.end();
+                    verified = cur_hash.get() == tor.getHash(c->getIndex());
+                }
+                cur_hash_valid = false;
+
+                Q_EMIT chunkReady(c, verified);
                 // It is possible that the webseed has been disabled due receiving a bad chunk
                 if (!isEnabled()) {
                     throw AutoDisabled();
@@ -435,6 +441,25 @@ void WebSeed::handleData(const QByteArray &tmp)
     }
 }
 
+void WebSeed::requestRanges()
+{
+    QString path = url.path();
+    const QString query = url.query();
+    if (path.endsWith('/'_L1)) {
+        path += tor.getNameSuggestion();
+    }
+
+    const QString host = redirected_url.isValid() ? redirected_url.host() : url.host();
+    while (range_queue.count() > 0 && conn->ready()) {
+        const Range r = range_queue.front();
+        const TorrentFile &tf = tor.getFile(r.file);
+        if (!conn->get(host, path + '/'_L1 + tf.getPath(), query, r.off, r.len)) {
+            break;
+        }
+        range_queue.pop_front();
+    }
+}
+
 void WebSeed::fillRangeList(Uint32 chunk)
 {
     Torrent::FileIndexList tflist;
@@ -459,8 +484,10 @@ void WebSeed::fillRangeList(Uint32 chunk)
             r.len = tf.getSize();
         }
 
-        // add the range
-        if (range_queue.count() == 0) {
+        // add the range, empty files do not need a request
+        if (r.len == 0) {
+            continue;
+        } else if (range_queue.count() == 0) {
             range_queue.append(r);
         } else if (range_queue.back().file != r.file) {
             range_queue.append(r);
@@ -15,6 +15,7 @@
 #include <ktorrent_export.h>
 #include <peer/connectionlimit.h>
 #include <util/constants.h>
+#include <util/sha1hashgen.h>
 
 namespace bt
 {
@@ -128,8 +129,9 @@ Q_SIGNALS:
     /*!
      * Emitted when a chunk is downloaded
      * \param c The chunk
+     * \param verified Whether the data matched the hash of the chunk, it is hashed while it arrives
      */
-    void chunkReady(bt::Chunk *c);
+    void chunkReady(bt::Chunk *c, bool verified);
 
     /*!
      * Emitted when a range has been fully downloaded
@@ -165,6 +167,7 @@ private:
     }; // Exception
 
     void fillRangeList(Uint32 chunk);
+    void requestRanges();
     void handleData(const QByteArray &data);
     void chunkStarted(Uint32 chunk);
     void chunkStopped();
@@ -177,7 +180,6 @@ private:
     const Torrent &tor;
     ChunkManager &cman;
     HttpConnection *conn = nullptr;
-    QList<QByteArray> chunks;
     Uint32 first_chunk;
     Uint32 last_chunk;
     Uint32 cur_chunk = -1;
@@ -190,6 +192,8 @@ private:
     QList<Range> range_queue;
     QUrl redirected_url;
     PieceData::Ptr cur_piece;
+    SHA1HashGen cur_hash;
+    bool cur_hash_valid = false;
     QTimer retry_timer;
     std::unique_ptr<ConnectionLimit::Token> token;
 
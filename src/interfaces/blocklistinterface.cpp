@@ -14,4 +14,10 @@ BlockListInterface::BlockListInterface()
 BlockListInterface::~BlockListInterface()
 {
 }
+
+bool BlockListInterface::compile(IPFilter::Builder &builder) const
+{
+    Q_UNUSED(builder);
+    return false;
+}
 }
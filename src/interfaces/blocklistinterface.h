@@ -8,6 +8,7 @@
 #define IPBLOCKINGINTERFACE_H
 
 #include <ktorrent_export.h>
+#include <peer/ipfilter.h>
 
 namespace net
 {
@@ -33,6 +34,15 @@ public:
      * \param addr Address of the peer
      */
     [[nodiscard]] virtual bool blocked(const net::Address &addr) const = 0;
+
+    /*!
+     * Add all blocked addresses to the filter of the AccessManager. When this succeeds,
+     * blocked is no longer called, and AccessManager::blockListChanged must be called
+     * whenever the list changes.
+     * \param builder The builder of the filter
+     * \return FALSE if the list can not be expressed as ranges, the default
+     */
+    virtual bool compile(IPFilter::Builder &builder) const;
 };
 }
 #endif
@@ -42,4 +42,18 @@ PeerInterface::~PeerInterface()
 {
 }
 
+void PeerInterface::handlePackets(const bt::Uint8 *packets, bt::Uint32 size)
+{
+    Uint32 off = 0;
+    while (off + 4 <= size) {
+        const Uint32 len = ReadUint32(packets, off);
+        if (off + 4 + len > size) {
+            break;
+        }
+
+        handlePacket(packets + off + 4, len);
+        off += 4 + len;
+    }
+}
+
 }
@@ -185,6 +185,13 @@ public:
     //! Handle a received packet
     virtual void handlePacket(const bt::Uint8 *packet, bt::Uint32 size) = 0;
 
+    /*!
+        Handle a batch of received packets. The packets are stored back to back,
+        each one prefixed by its length as a 4 byte big endian integer.
+        The default implementation calls handlePacket for each of them.
+    */
+    virtual void handlePackets(const bt::Uint8 *packets, bt::Uint32 size);
+
 protected:
     mutable PeerInterface::Stats stats;
     bool paused;
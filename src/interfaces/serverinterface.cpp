@@ -5,6 +5,7 @@
 */
 
 #include "serverinterface.h"
+#include <QHash>
 #include <QHostAddress>
 #include <mse/encryptedpacketsocket.h>
 #include <mse/encryptedserverauthenticate.h>
@@ -27,6 +28,21 @@ bool ServerInterface::utp_enabled = false;
 bool ServerInterface::only_use_utp = false;
 TransportProtocol ServerInterface::primary_transport_protocol = TCP;
 
+// Indexes over peer_managers, so incoming connections can be matched to their torrent without
+// walking all torrents. The skey hash of MSE is hashed once per torrent instead of once per
+// torrent per connection.
+static QHash<PeerManager *, SHA1Hash> registered_info_hashes;
+static QMultiHash<SHA1Hash, PeerManager *> peer_manager_index;
+static QHash<SHA1Hash, SHA1Hash> skey_index;
+
+static SHA1Hash SKeyHash(const SHA1Hash &info_hash)
+{
+    Uint8 buf[24];
+    memcpy(buf, "req2", 4);
+    memcpy(buf + 4, info_hash.getData(), 20);
+    return SHA1Hash::generate(buf, 24);
+}
+
 ServerInterface::ServerInterface(QObject *parent)
     : QObject(parent)
 {
@@ -38,46 +54,60 @@ ServerInterface::~ServerInterface()
 
 void ServerInterface::addPeerManager(PeerManager *pman)
 {
+    if (registered_info_hashes.contains(pman)) {
+        return;
+    }
+
+    const SHA1Hash &info_hash = pman->getTorrent().getInfoHash();
+    if (!peer_manager_index.contains(info_hash)) {
+        skey_index.insert(SKeyHash(info_hash), info_hash);
+    }
+
     peer_managers.append(pman);
+    registered_info_hashes.insert(pman, info_hash);
+    peer_manager_index.insert(info_hash, pman);
 }
 
 void ServerInterface::removePeerManager(PeerManager *pman)
 {
+    // the PeerManager can be half destroyed, so do not ask it for its info hash
+    auto i = registered_info_hashes.find(pman);
+    if (i == registered_info_hashes.end()) {
+        return;
+    }
+
+    const SHA1Hash info_hash = i.value();
+    registered_info_hashes.erase(i);
     peer_managers.removeAll(pman);
+    peer_manager_index.remove(info_hash, pman);
+    if (!peer_manager_index.contains(info_hash)) {
+        skey_index.remove(SKeyHash(info_hash));
+    }
 }
 
 PeerManager *ServerInterface::findPeerManager(const bt::SHA1Hash &hash)
 {
-    QList<PeerManager *>::iterator i = peer_managers.begin();
-    while (i != peer_managers.end()) {
-        PeerManager *pm = *i;
-        if (pm && pm->getTorrent().getInfoHash() == hash) {
-            if (!pm->isStarted()) {
-                return nullptr;
-            } else {
-                return pm;
-            }
+    // the same torrent can be loaded more than once, pick the first started one, like
+    // a walk over peer_managers would; a QMultiHash returns the latest insertion first
+    PeerManager *pm = nullptr;
+    auto [i, end] = peer_manager_index.equal_range(hash);
+    for (; i != end; ++i) {
+        if (i.value()->isStarted()) {
+            pm = i.value();
         }
-        ++i;
     }
-    return nullptr;
+    return pm;
 }
 
 bool ServerInterface::findInfoHash(const bt::SHA1Hash &skey, SHA1Hash &info_hash)
 {
-    Uint8 buf[24];
-    memcpy(buf, "req2", 4);
-    QList<PeerManager *>::iterator i = peer_managers.begin();
-    while (i != peer_managers.end()) {
-        const PeerManager *pm = *i;
-        memcpy(buf + 4, pm->getTorrent().getInfoHash().getData(), 20);
-        if (SHA1Hash::generate(buf, 24) == skey) {
-            info_hash = pm->getTorrent().getInfoHash();
-            return true;
-        }
-        ++i;
+    auto i = skey_index.constFind(skey);
+    if (i == skey_index.cend()) {
+        return false;
     }
-    return false;
+
+    info_hash = i.value();
+    return true;
 }
 
 void ServerInterface::disableEncryption()
@@ -118,6 +148,11 @@ void ServerInterface::newConnection(std::unique_ptr<mse::EncryptedPacketSocket>
             return;
         }
 
+        // Too many handshakes in progress
+        if (!AuthenticationMonitor::instance().acceptIncoming()) {
+            return;
+        }
+
         ServerAuthenticate *auth = nullptr;
 
         if (encryption) {
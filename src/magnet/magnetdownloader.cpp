@@ -5,6 +5,7 @@
 */
 
 #include "magnetdownloader.h"
+#include "metadatadownload.h"
 #include <dht/dhtbase.h>
 #include <dht/dhtpeersource.h>
 #include <peer/peer.h>
@@ -18,6 +19,7 @@
 #include "bcodec/bdecoder.h"
 #include "bcodec/bnode.h"
 #include "util/error.h"
+#include "util/functions.h"
 
 namespace bt
 {
@@ -25,9 +27,11 @@ MagnetDownloader::MagnetDownloader(const bt::MagnetLink &mlink, QObject *parent)
     : QObject(parent)
     , mlink(mlink)
     , pman(nullptr)
+    , metadata_download(nullptr)
     , dht_ps(nullptr)
     , tor(mlink.infoHash())
     , found(false)
+    , dht_enabled(true)
 {
     const dht::DHTBase &dht_table = Globals::instance().getDHT();
     connect(&dht_table, &dht::DHTBase::started, this, &MagnetDownloader::dhtStarted);
@@ -52,7 +56,10 @@ void MagnetDownloader::start()
         connect(job, &KIO::StoredTransferJob::result, this, &MagnetDownloader::onTorrentDownloaded);
     }
 
+    // All peers share one download, so the pieces can be fetched from several peers at once
+    metadata_download = new MetadataDownload(mlink.infoHash());
     pman = new PeerManager(tor);
+    pman->setMetadataDownload(metadata_download);
     connect(pman, &PeerManager::newPeer, this, &MagnetDownloader::onNewPeer);
 
     const QList<QUrl> trackers_list = mlink.trackers();
@@ -69,7 +76,7 @@ void MagnetDownloader::start()
     }
 
     dht::DHTBase &dht_table = Globals::instance().getDHT();
-    if (dht_table.isRunning()) {
+    if (dht_enabled && dht_table.isRunning()) {
         dht_ps = new dht::DHTPeerSource(dht_table, mlink.infoHash(), mlink.displayName());
         dht_ps->setRequestInterval(0); // Do not wait if the announce task finishes
         connect(dht_ps, &dht::DHTPeerSource::peersReady, pman, &PeerManager::peerSourceReady);
@@ -100,12 +107,28 @@ void MagnetDownloader::stop()
     pman->stop();
     delete pman;
     pman = nullptr;
+    // after the peers, they remove themselves from it
+    delete metadata_download;
+    metadata_download = nullptr;
 }
 
 void MagnetDownloader::update()
 {
     if (pman) {
         pman->update();
+        metadata_download->update(bt::CurrentTime());
+    }
+}
+
+void MagnetDownloader::setDHTEnabled(bool on)
+{
+    dht_enabled = on;
+}
+
+void MagnetDownloader::addPotentialPeer(const net::Address &addr)
+{
+    if (pman) {
+        pman->addPotentialPeer(addr, false);
     }
 }
 
@@ -202,7 +225,7 @@ void MagnetDownloader::onMetadataDownloaded(const QByteArray &data)
 
 void MagnetDownloader::dhtStarted()
 {
-    if (running() && !dht_ps) {
+    if (running() && dht_enabled && !dht_ps) {
         dht::DHTBase &dht_table = Globals::instance().getDHT();
         dht_ps = new dht::DHTPeerSource(dht_table, mlink.infoHash(), mlink.displayName());
         dht_ps->setRequestInterval(0); // Do not wait if the announce task finishes
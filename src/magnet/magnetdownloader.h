@@ -23,6 +23,7 @@ namespace bt
 {
 class Peer;
 class PeerManager;
+class MetadataDownload;
 
 /*!
     \headerfile magnet/magnetdownloader.h
@@ -65,6 +66,16 @@ public:
     */
     void stop();
 
+    /*!
+        Enable or disable the DHTPeerSource of this MagnetDownloader.
+        Disable it when somebody else does the DHT lookups and passes
+        the results in with addPotentialPeer. Must be called before start.
+    */
+    void setDHTEnabled(bool on);
+
+    //! Add a potential peer found by someone else, only works while running
+    void addPotentialPeer(const net::Address &addr);
+
 Q_SIGNALS:
     /*!
         Emitted when downloading the metadata was successful.
@@ -87,10 +98,12 @@ private:
     MagnetLink mlink;
     QList<Tracker *> trackers;
     PeerManager *pman;
+    MetadataDownload *metadata_download;
     dht::DHTPeerSource *dht_ps;
     QByteArray metadata;
     Torrent tor;
     bool found;
+    bool dht_enabled;
 };
 
 }
@@ -0,0 +1,258 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "magnetresolver.h"
+#include "magnetdownloader.h"
+#include <algorithm>
+#include <cmath>
+#include <dht/announcetask.h>
+#include <dht/dhtbase.h>
+#include <interfaces/serverinterface.h>
+#include <torrent/globals.h>
+#include <util/functions.h>
+#include <util/log.h>
+
+namespace bt
+{
+MagnetResolver::MagnetResolver(QObject *parent)
+    : QObject(parent)
+    , max_active(DEFAULT_MAX_ACTIVE)
+    , max_lookups(DEFAULT_MAX_LOOKUPS)
+    , timeout(DEFAULT_TIMEOUT)
+    , num_failed(0)
+{
+    const dht::DHTBase &dht_table = Globals::instance().getDHT();
+    connect(&dht_table, &dht::DHTBase::stopped, this, &MagnetResolver::dhtStopped);
+}
+
+MagnetResolver::~MagnetResolver()
+{
+    const QList<SHA1Hash> hashes = active.keys();
+    for (const SHA1Hash &h : hashes) {
+        remove(h);
+    }
+}
+
+bool MagnetResolver::add(const MagnetLink &mlink)
+{
+    const SHA1Hash &info_hash = mlink.infoHash();
+    if (!mlink.isValid() || queued_hashes.contains(info_hash) || active.contains(info_hash)) {
+        return false;
+    }
+
+    queue.push_back(QueuedLink{mlink, CurrentTime()});
+    queued_hashes.insert(info_hash);
+    return true;
+}
+
+void MagnetResolver::update()
+{
+    const TimeStamp now = CurrentTime();
+    failTimedOut(now);
+    startQueued(now);
+    startLookups(now);
+
+    // a downloader can find its metadata during the update, which removes it from active
+    QList<MagnetDownloader *> downloaders;
+    downloaders.reserve(active.size());
+    for (const Entry &e : std::as_const(active)) {
+        downloaders.append(e.downloader);
+    }
+    for (MagnetDownloader *md : std::as_const(downloaders)) {
+        md->update();
+    }
+}
+
+void MagnetResolver::setMaxActive(Uint32 max)
+{
+    max_active = std::max<Uint32>(max, 1);
+}
+
+void MagnetResolver::setMaxLookups(Uint32 max)
+{
+    max_lookups = std::max<Uint32>(max, 1);
+}
+
+void MagnetResolver::setTimeout(TimeStamp ms)
+{
+    timeout = ms;
+}
+
+MagnetResolver::Stats MagnetResolver::stats() const
+{
+    Stats s;
+    s.resolved = latencies.size();
+    s.failed = num_failed;
+    std::vector<TimeStamp> tmp = latencies;
+    s.latency_p50 = percentile(tmp, 50);
+    s.latency_p90 = percentile(tmp, 90);
+    s.latency_p99 = percentile(tmp, 99);
+    s.latency_max = percentile(tmp, 100);
+    return s;
+}
+
+TimeStamp MagnetResolver::percentile(std::vector<TimeStamp> &values, double p)
+{
+    if (values.empty()) {
+        return 0;
+    }
+
+    // nearest rank: the smallest value with at least p percent of the values at or below it
+    const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    const size_t idx = std::min(values.size() - 1, rank > 0 ? rank - 1 : 0);
+    std::nth_element(values.begin(), values.begin() + idx, values.end());
+    return values[idx];
+}
+
+void MagnetResolver::startQueued(TimeStamp now)
+{
+    while (active.size() < max_active && !queue.empty()) {
+        const QueuedLink ql = queue.front();
+        queue.pop_front();
+        queued_hashes.remove(ql.mlink.infoHash());
+
+        MagnetDownloader *md = new MagnetDownloader(ql.mlink, this);
+        md->setDHTEnabled(false);
+        connect(md, &MagnetDownloader::foundMetadata, this, &MagnetResolver::onFoundMetadata);
+        md->start();
+
+        Entry e;
+        e.downloader = md;
+        e.added = ql.added;
+        e.started = now;
+        e.next_lookup = now;
+        active.insert(ql.mlink.infoHash(), e);
+    }
+}
+
+void MagnetResolver::startLookups(TimeStamp now)
+{
+    dht::DHTBase &dht_table = Globals::instance().getDHT();
+    if (!dht_table.isRunning()) {
+        return;
+    }
+
+    for (auto i = active.begin(); i != active.end() && Uint32(lookups.size()) < max_lookups; ++i) {
+        Entry &e = i.value();
+        if (e.lookup_running || e.next_lookup > now) {
+            continue;
+        }
+
+        dht::AnnounceTask *task = dht_table.announce(i.key(), ServerInterface::getPort());
+        if (!task) {
+            // no nodes to start from yet
+            e.next_lookup = now + LOOKUP_INTERVAL;
+            continue;
+        }
+
+        e.lookup_running = true;
+        lookups.insert(task, i.key());
+        connect(task, &dht::AnnounceTask::dataReady, this, &MagnetResolver::onLookupData);
+        connect(task, &dht::AnnounceTask::finished, this, &MagnetResolver::onLookupFinished);
+    }
+}
+
+void MagnetResolver::failTimedOut(TimeStamp now)
+{
+    QList<SHA1Hash> timed_out;
+    for (auto i = active.cbegin(); i != active.cend(); ++i) {
+        if (now - i.value().started >= timeout) {
+            timed_out.append(i.key());
+        }
+    }
+
+    for (const SHA1Hash &h : std::as_const(timed_out)) {
+        const MagnetLink mlink = active.value(h).downloader->magnetLink();
+        remove(h);
+        num_failed++;
+        Out(SYS_GEN | LOG_NOTICE) << "Failed to resolve " << mlink.displayName() << " in time" << endl;
+        Q_EMIT failed(mlink);
+    }
+}
+
+void MagnetResolver::remove(const SHA1Hash &info_hash)
+{
+    auto i = active.find(info_hash);
+    if (i == active.end()) {
+        return;
+    }
+
+    MagnetDownloader *md = i.value().downloader;
+    active.erase(i);
+
+    // take the lookups out before killing them, kill emits finished
+    QList<dht::Task *> tasks;
+    for (auto j = lookups.begin(); j != lookups.end();) {
+        if (j.value() == info_hash) {
+            tasks.append(j.key());
+            j = lookups.erase(j);
+        } else {
+            ++j;
+        }
+    }
+    for (dht::Task *t : std::as_const(tasks)) {
+        t->disconnect(this);
+        t->kill();
+    }
+
+    // this can be called from within a signal of the downloader, so do not delete it right away
+    md->disconnect(this);
+    md->deleteLater();
+}
+
+void MagnetResolver::onFoundMetadata(bt::MagnetDownloader *md, const QByteArray &metadata)
+{
+    const MagnetLink mlink = md->magnetLink();
+    auto i = active.constFind(mlink.infoHash());
+    if (i == active.cend()) {
+        return;
+    }
+
+    latencies.push_back(CurrentTime() - i.value().added);
+    remove(mlink.infoHash());
+    Q_EMIT resolved(mlink, metadata);
+}
+
+void MagnetResolver::onLookupData(dht::Task *t)
+{
+    auto i = lookups.constFind(t);
+    if (i == lookups.cend()) {
+        return;
+    }
+
+    const Entry e = active.value(i.value());
+    dht::AnnounceTask *task = static_cast<dht::AnnounceTask *>(t);
+    dht::DBItem item;
+    while (task->takeItem(item)) {
+        if (e.downloader) {
+            e.downloader->addPotentialPeer(item.getAddress());
+        }
+    }
+}
+
+void MagnetResolver::onLookupFinished(dht::Task *t)
+{
+    onLookupData(t);
+    const SHA1Hash info_hash = lookups.take(t);
+    auto i = active.find(info_hash);
+    if (i != active.end()) {
+        i.value().lookup_running = false;
+        i.value().next_lookup = CurrentTime() + LOOKUP_INTERVAL;
+    }
+}
+
+void MagnetResolver::dhtStopped()
+{
+    // the DHT cleans up its own tasks
+    lookups.clear();
+    for (Entry &e : active) {
+        e.lookup_running = false;
+    }
+}
+
+}
+
+#include "moc_magnetresolver.cpp"
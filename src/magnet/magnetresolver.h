@@ -0,0 +1,158 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef BT_MAGNETRESOLVER_H
+#define BT_MAGNETRESOLVER_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <deque>
+#include <ktorrent_export.h>
+#include <magnet/magnetlink.h>
+#include <util/constants.h>
+#include <vector>
+
+namespace dht
+{
+class Task;
+}
+
+namespace bt
+{
+class MagnetDownloader;
+
+/*!
+    \headerfile magnet/magnetresolver.h
+    \brief Resolves a large number of MagnetLinks at once.
+
+    A MagnetDownloader per magnet does its own DHT lookups, over and over again
+    until the metadata is found. With thousands of magnets that floods the DHT.
+    The MagnetResolver queues the magnets and only runs a limited number of
+    MagnetDownloaders at the same time. Their DHT lookups are done by the resolver
+    itself, with a global limit on the number of lookups in flight. The peers
+    which are found are handed to the MagnetDownloader of the info hash.
+
+    All MagnetDownloaders take their connections from the global ConnectionLimit
+    of the PeerManager, so the number of active magnets also bounds the share of
+    the connection slots which are spent on resolving.
+
+    update must be called periodically.
+*/
+class KTORRENT_EXPORT MagnetResolver : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MagnetResolver(QObject *parent = nullptr);
+    ~MagnetResolver() override;
+
+    static constexpr Uint32 DEFAULT_MAX_ACTIVE = 50;
+    static constexpr Uint32 DEFAULT_MAX_LOOKUPS = 16;
+    static constexpr TimeStamp DEFAULT_TIMEOUT = 10 * 60 * 1000;
+    static constexpr TimeStamp LOOKUP_INTERVAL = 30 * 1000;
+
+    /*!
+        Queue a MagnetLink for resolving.
+        \return false if the link is invalid or its info hash is already being resolved
+    */
+    bool add(const MagnetLink &mlink);
+
+    //! Start queued magnets, do DHT lookups and fail the magnets which take too long
+    void update();
+
+    //! Set the maximum number of magnets which are resolved at the same time
+    void setMaxActive(Uint32 max);
+
+    //! Set the maximum number of DHT lookups in flight
+    void setMaxLookups(Uint32 max);
+
+    //! Set the time after which an active magnet is given up
+    void setTimeout(TimeStamp ms);
+
+    //! Get the number of magnets waiting to be started
+    [[nodiscard]] Uint32 numQueued() const
+    {
+        return queue.size();
+    }
+
+    //! Get the number of magnets which are being resolved
+    [[nodiscard]] Uint32 numActive() const
+    {
+        return active.size();
+    }
+
+    //! Get the number of DHT lookups in flight
+    [[nodiscard]] Uint32 numLookups() const
+    {
+        return lookups.size();
+    }
+
+    struct Stats {
+        Uint32 resolved = 0;
+        Uint32 failed = 0;
+        //! Time from add to resolved in ms
+        TimeStamp latency_p50 = 0;
+        TimeStamp latency_p90 = 0;
+        TimeStamp latency_p99 = 0;
+        TimeStamp latency_max = 0;
+    };
+
+    //! Get the statistics of the magnets resolved so far
+    [[nodiscard]] Stats stats() const;
+
+    /*!
+        Get a percentile of a list of values (nearest rank).
+        \param values The values, will be reordered
+        \param p The percentile, between 0 and 100
+        \return The percentile, 0 if values is empty
+    */
+    static TimeStamp percentile(std::vector<TimeStamp> &values, double p);
+
+Q_SIGNALS:
+    //! The metadata of a magnet has been found
+    void resolved(const bt::MagnetLink &mlink, const QByteArray &metadata);
+
+    //! A magnet could not be resolved within the timeout
+    void failed(const bt::MagnetLink &mlink);
+
+private:
+    struct Entry {
+        MagnetDownloader *downloader = nullptr;
+        TimeStamp added = 0;
+        TimeStamp started = 0;
+        TimeStamp next_lookup = 0;
+        bool lookup_running = false;
+    };
+
+    struct QueuedLink {
+        MagnetLink mlink;
+        TimeStamp added;
+    };
+
+    void startQueued(TimeStamp now);
+    void startLookups(TimeStamp now);
+    void failTimedOut(TimeStamp now);
+    void remove(const SHA1Hash &info_hash);
+    void onFoundMetadata(bt::MagnetDownloader *md, const QByteArray &metadata);
+    void onLookupData(dht::Task *t);
+    void onLookupFinished(dht::Task *t);
+    void dhtStopped();
+
+private:
+    std::deque<QueuedLink> queue;
+    QSet<SHA1Hash> queued_hashes;
+    QHash<SHA1Hash, Entry> active;
+    QHash<dht::Task *, SHA1Hash> lookups;
+    Uint32 max_active;
+    Uint32 max_lookups;
+    TimeStamp timeout;
+    std::vector<TimeStamp> latencies;
+    Uint32 num_failed;
+};
+
+}
+
+#endif // BT_MAGNETRESOLVER_H
@@ -5,16 +5,33 @@
 */
 
 #include "metadatadownload.h"
-#include <bcodec/bencoder.h>
-#include <peer/utmetadata.h>
+#include <algorithm>
+#include <cstring>
+#include <util/functions.h>
 #include <util/log.h>
 
 namespace bt
 {
-MetadataDownload::MetadataDownload(UTMetaData *ext, Uint32 size)
-    : ext(ext)
-    , total_size(size)
+MetadataSource::~MetadataSource()
 {
+}
+
+MetadataDownload::MetadataDownload(const SHA1Hash &info_hash)
+    : info_hash(info_hash)
+    , total_size(0)
+    , num_hashed(0)
+    , single_source(false)
+    , verified(false)
+{
+}
+
+MetadataDownload::~MetadataDownload()
+{
+}
+
+void MetadataDownload::reset(Uint32 size)
+{
+    total_size = size;
     metadata.resize(size);
     Uint32 num_pieces = size / METADATA_PIECE_SIZE;
     if (size % METADATA_PIECE_SIZE > 0) {
@@ -22,25 +39,170 @@ MetadataDownload::MetadataDownload(UTMetaData *ext, Uint32 size)
     }
 
     pieces = BitSet(num_pieces);
-    download(0);
+    piece_requests.assign(num_pieces, 0);
+    piece_sources.assign(num_pieces, nullptr);
+    hash_gen.start();
+    num_hashed = 0;
+
+    for (Source &s : sources) {
+        s.requests.clear();
+        s.rejected = BitSet(num_pieces);
+    }
 }
 
-MetadataDownload::~MetadataDownload()
+void MetadataDownload::selectSize(bool restart)
+{
+    struct Candidate {
+        Uint32 size;
+        Uint32 hash_failures;
+        Uint32 healthy;
+        Uint32 usable;
+    };
+
+    std::vector<Candidate> candidates;
+    for (const Source &s : sources) {
+        if (!usable(s)) {
+            continue;
+        }
+
+        auto c = std::find_if(candidates.begin(), candidates.end(), [&s](const Candidate &o) {
+            return o.size == s.size;
+        });
+        if (c == candidates.end()) {
+            c = candidates.insert(c, Candidate{s.size, s.hash_failures, 0, 0});
+        }
+        c->hash_failures = std::min(c->hash_failures, s.hash_failures);
+        c->healthy += s.timeouts < MAX_TIMEOUTS ? 1 : 0;
+        c->usable++;
+    }
+
+    // The fewest hash failures first, then the most sources which are still answering
+    auto best = std::min_element(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        if (a.hash_failures != b.hash_failures) {
+            return a.hash_failures < b.hash_failures;
+        }
+        if (a.healthy != b.healthy) {
+            return a.healthy > b.healthy;
+        }
+        return a.usable > b.usable;
+    });
+
+    if (best == candidates.end()) {
+        if (total_size != 0) {
+            Out(SYS_GEN | LOG_NOTICE) << "Metadata download, no usable sources left" << endl;
+            reset(0);
+        }
+        return;
+    }
+
+    if (!restart) {
+        // keep what has been downloaded as long as the sources of this size are answering
+        auto current = std::find_if(candidates.begin(), candidates.end(), [this](const Candidate &c) {
+            return c.size == total_size;
+        });
+        if (current != candidates.end() && (current->healthy > 0 || best->healthy == 0)) {
+            return;
+        }
+    }
+
+    if (best->size != total_size) {
+        Out(SYS_GEN | LOG_NOTICE) << "Metadata download, trying size " << best->size << " reported by " << best->usable << " sources" << endl;
+    }
+    reset(best->size);
+}
+
+void MetadataDownload::hashFailed(TimeStamp now)
+{
+    // We cannot tell which piece is bad, so blame every source which supplied one
+    for (Source &s : sources) {
+        if (std::find(piece_sources.begin(), piece_sources.end(), s.src) != piece_sources.end()) {
+            s.hash_failures++;
+        }
+    }
+
+    Out(SYS_GEN | LOG_NOTICE) << "Metadata download, hash check failed, starting over with one source at a time" << endl;
+    single_source = true;
+    selectSize(true);
+    assignAll(now);
+}
+
+bool MetadataDownload::usable(const Source &s) const
+{
+    return s.hash_failures < MAX_HASH_FAILURES;
+}
+
+void MetadataDownload::rejectPiece(Source &s, Uint32 piece, TimeStamp now)
 {
+    if (s.rejected.numOnBits() == 0) {
+        s.rejected_time = now;
+    }
+    s.rejected.set(piece, true);
+    if (removeRequest(s, piece)) {
+        assignAll(now);
+    }
 }
 
-void MetadataDownload::reject(Uint32 piece)
+bool MetadataDownload::addSource(MetadataSource *src, Uint32 size)
 {
+    if (verified || size == 0 || findSource(src)) {
+        return false;
+    }
+
+    if (total_size != 0 && size != total_size) {
+        Out(SYS_GEN | LOG_NOTICE) << "Metadata download, source reported size " << size << " instead of " << total_size << endl;
+    }
+
+    sources.push_back(Source{src, size, {}, BitSet(pieces.getNumBits()), 0, 0, 0});
+    selectSize(false);
+    assignAll(CurrentTime());
+    return true;
+}
+
+void MetadataDownload::removeSource(MetadataSource *src)
+{
+    auto i = std::find_if(sources.begin(), sources.end(), [src](const Source &s) {
+        return s.src == src;
+    });
+    if (i == sources.end()) {
+        return;
+    }
+
+    for (const Request &r : i->requests) {
+        piece_requests[r.piece]--;
+    }
+    std::replace(piece_sources.begin(), piece_sources.end(), src, static_cast<MetadataSource *>(nullptr));
+
+    sources.erase(i);
+    if (!verified) {
+        // when it was the last source of this size, try another one
+        selectSize(false);
+        assignAll(CurrentTime());
+    }
+}
+
+void MetadataDownload::reject(MetadataSource *src, Uint32 piece)
+{
+    Source *s = findSource(src);
+    if (!s || s->size != total_size || piece >= pieces.getNumBits()) {
+        return;
+    }
+
     Out(SYS_GEN | LOG_NOTICE) << "Metadata download, piece " << piece << " rejected" << endl;
-    downloadNext();
+    rejectPiece(*s, piece, CurrentTime());
 }
 
-bool MetadataDownload::data(Uint32 piece, QByteArrayView piece_data)
+bool MetadataDownload::data(MetadataSource *src, Uint32 piece, QByteArrayView piece_data)
 {
+    Source *s = findSource(src);
+    if (!s || verified || s->size != total_size || !usable(*s)) {
+        return false;
+    }
+
+    const TimeStamp now = CurrentTime();
     // validate data
     if (piece >= pieces.getNumBits()) {
         Out(SYS_GEN | LOG_NOTICE) << "Metadata download, received piece " << piece << " is invalid " << endl;
-        downloadNext();
+        assignAll(now);
         return false;
     }
 
@@ -51,46 +213,200 @@ bool MetadataDownload::data(Uint32 piece, QByteArrayView piece_data)
 
     if (size != piece_data.size()) {
         Out(SYS_GEN | LOG_NOTICE) << "Metadata download, received piece " << piece << " has the wrong size " << endl;
-        downloadNext();
+        rejectPiece(*s, piece, now);
         return false;
     }
 
-    // piece fits, so copy into data
-    // Out(SYS_GEN|LOG_NOTICE) << "Metadata download, dowloaded " << piece << endl;
-    const Uint32 off = piece * METADATA_PIECE_SIZE;
-    if (static_cast<size_t>(metadata.size()) < off + size) {
-        Out(SYS_GEN | LOG_NOTICE) << "Metadata download, received large piece " << (off + size) << ", max " << metadata.size() << endl;
-        metadata.resize(off + size);
+    // after a hash failure, only use what was asked for, so it is clear who supplied the data
+    if (pieces.get(piece) || (single_source && !requested(*s, piece))) {
+        // a duplicate or a late answer to a request which timed out
+        removeRequest(*s, piece);
+        assignAll(now);
+        return false;
     }
-    memcpy(metadata.data() + off, piece_data.data(), size);
+
+    memcpy(metadata.data() + piece * METADATA_PIECE_SIZE, piece_data.data(), size);
     pieces.set(piece, true);
+    piece_sources[piece] = src;
+    s->timeouts = 0;
+
+    // drop the duplicate requests for this piece, so those sources can move on
+    for (Source &o : sources) {
+        removeRequest(o, piece);
+    }
+
+    hashReceived();
+    if (num_hashed < pieces.getNumBits()) {
+        assignAll(now);
+        return false;
+    }
 
-    if (!pieces.allOn()) {
-        downloadNext();
+    hash_gen.end();
+    if (hash_gen.get() == info_hash) {
+        verified = true;
+        for (Source &o : sources) {
+            o.requests.clear();
+        }
+        return true;
     }
 
-    return pieces.allOn();
+    hashFailed(now);
+    return false;
 }
 
-void MetadataDownload::download(Uint32 piece)
+void MetadataDownload::update(TimeStamp now)
 {
-    QByteArray request;
-    BEncoder enc(std::make_unique<BEncoderBufferOutput>(request));
-    enc.beginDict();
-    enc.write("msg_type", (bt::Uint32)0);
-    enc.write("piece", (bt::Uint32)piece);
-    enc.end();
-    ext->sendPacket(request);
+    if (verified) {
+        return;
+    }
+
+    bool timed_out = false;
+    bool rejects_expired = false;
+    for (Source &s : sources) {
+        auto i = std::remove_if(s.requests.begin(), s.requests.end(), [now](const Request &r) {
+            return now - r.time > REQUEST_TIMEOUT;
+        });
+        for (auto j = i; j != s.requests.end(); ++j) {
+            piece_requests[j->piece]--;
+            s.timeouts++;
+            timed_out = true;
+        }
+        s.requests.erase(i, s.requests.end());
+
+        // the source may have gotten the pieces it rejected by now
+        if (s.rejected.numOnBits() > 0 && now - s.rejected_time > REJECT_TIMEOUT) {
+            s.rejected.clear();
+            rejects_expired = true;
+        }
+    }
+
+    if (timed_out) {
+        // when all sources of this size stopped answering, try another size
+        selectSize(false);
+    }
+
+    if (timed_out || rejects_expired) {
+        assignAll(now);
+    }
+}
+
+Uint32 MetadataDownload::numRequests() const
+{
+    Uint32 num = 0;
+    for (const Source &s : sources) {
+        num += s.requests.size();
+    }
+    return num;
 }
 
-void MetadataDownload::downloadNext()
+MetadataDownload::Source *MetadataDownload::findSource(MetadataSource *src)
 {
-    Out(SYS_GEN | LOG_NOTICE) << "Metadata download, requesting " << pieces.getNumBits() << " pieces" << endl;
-    for (Uint32 i = 0; i < pieces.getNumBits(); i++) {
-        if (!pieces.get(i)) {
-            download(i);
+    for (Source &s : sources) {
+        if (s.src == src) {
+            return &s;
         }
     }
+    return nullptr;
+}
+
+bool MetadataDownload::removeRequest(Source &s, Uint32 piece)
+{
+    for (auto i = s.requests.begin(); i != s.requests.end(); ++i) {
+        if (i->piece == piece) {
+            s.requests.erase(i);
+            piece_requests[piece]--;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MetadataDownload::requested(const Source &s, Uint32 piece) const
+{
+    return std::any_of(s.requests.begin(), s.requests.end(), [piece](const Request &r) {
+        return r.piece == piece;
+    });
+}
+
+bool MetadataDownload::pickPiece(const Source &s, Uint32 &piece) const
+{
+    // Everything before num_hashed has been received, so start looking there.
+    // First try pieces nobody is working on, then the ones only one source is working on.
+    for (Uint32 max_requests = 1; max_requests <= MAX_REQUESTS_PER_PIECE; max_requests++) {
+        for (Uint32 i = num_hashed; i < pieces.getNumBits(); i++) {
+            if (!pieces.get(i) && piece_requests[i] < max_requests && !s.rejected.get(i) && !requested(s, i)) {
+                piece = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void MetadataDownload::assign(Source &s, TimeStamp now, bool stalled_ok)
+{
+    if (s.timeouts >= MAX_TIMEOUTS && !stalled_ok) {
+        return;
+    }
+
+    Uint32 piece = 0;
+    while (s.requests.size() < MAX_REQUESTS_PER_SOURCE && pickPiece(s, piece)) {
+        s.requests.push_back(Request{piece, now});
+        piece_requests[piece]++;
+        s.src->requestMetadataPiece(piece);
+    }
+}
+
+void MetadataDownload::assignAll(TimeStamp now)
+{
+    if (total_size == 0) {
+        return;
+    }
+
+    // Only the sources of the current size are asked, the ones which have been failing
+    // hash checks or timing out get the last pick
+    std::vector<Source *> order;
+    order.reserve(sources.size());
+    for (Source &s : sources) {
+        if (s.size == total_size && usable(s)) {
+            order.push_back(&s);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [](const Source *a, const Source *b) {
+        if (a->hash_failures != b->hash_failures) {
+            return a->hash_failures < b->hash_failures;
+        }
+        return a->timeouts < b->timeouts;
+    });
+
+    // After a hash failure, the first source which has or gets requests does all the work
+    for (Source *s : order) {
+        assign(*s, now, false);
+        if (single_source && !s->requests.empty()) {
+            return;
+        }
+    }
+
+    // If only stalled sources are left, keep trying them
+    if (numRequests() == 0) {
+        for (Source *s : order) {
+            assign(*s, now, true);
+            if (single_source && !s->requests.empty()) {
+                return;
+            }
+        }
+    }
+}
+
+void MetadataDownload::hashReceived()
+{
+    const Uint32 num_pieces = pieces.getNumBits();
+    while (num_hashed < num_pieces && pieces.get(num_hashed)) {
+        const Uint32 off = num_hashed * METADATA_PIECE_SIZE;
+        const Uint32 len = std::min<Uint32>(METADATA_PIECE_SIZE, total_size - off);
+        hash_gen.update(QByteArrayView(metadata.constData() + off, len));
+        num_hashed++;
+    }
 }
 
 }
@@ -8,33 +8,85 @@
 #define BT_METADATADOWNLOAD_H
 
 #include <QByteArray>
+#include <ktorrent_export.h>
 #include <util/bitset.h>
 #include <util/constants.h>
+#include <util/sha1hash.h>
+#include <util/sha1hashgen.h>
+#include <vector>
 
 namespace bt
 {
-class UTMetaData;
-
 const int METADATA_PIECE_SIZE = 16 * 1024;
 
 /*!
- * \headerfile manget/metadatadownload.h
+ * \headerfile magnet/metadatadownload.h
+ * \brief Something which can be asked for pieces of the metadata, typically a peer's UTMetaData extension.
+ */
+class KTORRENT_EXPORT MetadataSource
+{
+public:
+    virtual ~MetadataSource();
+
+    //! Send a request for a metadata piece
+    virtual void requestMetadataPiece(Uint32 piece) = 0;
+};
+
+/*!
+ * \headerfile magnet/metadatadownload.h
  * \brief Handles the downloading of torrent metadata via the UT metadata extension (BEP 0009).
+ *
+ * One MetadataDownload is shared by all peers of a magnet download. The pieces are
+ * split over all sources, with at most MAX_REQUESTS_PER_SOURCE outstanding requests
+ * per source. Requests which are not answered within REQUEST_TIMEOUT are handed to
+ * another source, and once every missing piece has been requested, the last ones are
+ * also asked from a second source.
+ *
+ * Pieces are hashed as soon as they extend the contiguous prefix of received data,
+ * so when the last piece arrives only its own bytes still need to be hashed before
+ * the result can be checked against the info hash.
+ *
+ * Sources are grouped by the size they report, and only the sources of one size are
+ * asked for pieces. Another size is tried when no source of the current size is left,
+ * or when they all stopped answering. The source of every piece is remembered, so when
+ * the info hash does not match, the sources which supplied the data are blamed and the
+ * size with the fewest failures is tried again, from then on with one source at a time.
+ * Sources which failed MAX_HASH_FAILURES times are no longer used.
  */
-class MetadataDownload
+class KTORRENT_EXPORT MetadataDownload
 {
 public:
-    MetadataDownload(UTMetaData *ext, Uint32 size);
+    explicit MetadataDownload(const SHA1Hash &info_hash);
     virtual ~MetadataDownload();
 
-    //! A reject of a piece was received
-    void reject(Uint32 piece);
+    static constexpr Uint32 MAX_REQUESTS_PER_SOURCE = 2;
+    static constexpr Uint32 MAX_REQUESTS_PER_PIECE = 2;
+    static constexpr Uint32 MAX_TIMEOUTS = 3;
+    static constexpr TimeStamp REQUEST_TIMEOUT = 15 * 1000;
+    static constexpr Uint32 MAX_HASH_FAILURES = 3;
+    static constexpr TimeStamp REJECT_TIMEOUT = 60 * 1000;
+
+    /*!
+        Add a source which reported the metadata size. Sources reporting another size
+        than the one being downloaded are kept, in case that size turns out to be wrong.
+        \return true if the source was added
+    */
+    bool addSource(MetadataSource *src, Uint32 size);
+
+    //! Remove a source, its outstanding requests will be handed to others
+    void removeSource(MetadataSource *src);
+
+    //! A reject of a piece was received, the piece is not asked from this source for REJECT_TIMEOUT
+    void reject(MetadataSource *src, Uint32 piece);
 
     /*!
         A piece was received
-        \return true if all the data has been received
+        \return true if all the data has been received and it matches the info hash
     */
-    bool data(Uint32 piece, QByteArrayView piece_data);
+    bool data(MetadataSource *src, Uint32 piece, QByteArrayView piece_data);
+
+    //! Hand requests which timed out to other sources, and forget rejects older than REJECT_TIMEOUT
+    void update(TimeStamp now);
 
     //! Get the result
     [[nodiscard]] const QByteArray &result() const
@@ -42,15 +94,80 @@ public:
         return metadata;
     }
 
+    //! Has the metadata been downloaded and verified
+    [[nodiscard]] bool isComplete() const
+    {
+        return verified;
+    }
+
+    //! Get the size of the metadata being downloaded (0 if there are no usable sources)
+    [[nodiscard]] Uint32 totalSize() const
+    {
+        return total_size;
+    }
+
+    //! Get the number of pieces
+    [[nodiscard]] Uint32 numPieces() const
+    {
+        return pieces.getNumBits();
+    }
+
+    //! Get the number of pieces which have been received
+    [[nodiscard]] Uint32 numDownloaded() const
+    {
+        return pieces.numOnBits();
+    }
+
+    //! Get the number of sources, including the ones which reported another size
+    [[nodiscard]] Uint32 numSources() const
+    {
+        return sources.size();
+    }
+
+    //! Get the number of outstanding requests
+    [[nodiscard]] Uint32 numRequests() const;
+
 private:
-    void download(Uint32 piece);
-    void downloadNext();
+    struct Request {
+        Uint32 piece;
+        TimeStamp time;
+    };
+
+    struct Source {
+        MetadataSource *src;
+        Uint32 size;
+        std::vector<Request> requests;
+        BitSet rejected;
+        TimeStamp rejected_time;
+        Uint32 timeouts;
+        Uint32 hash_failures;
+    };
+
+    void reset(Uint32 size);
+    void selectSize(bool restart);
+    void hashFailed(TimeStamp now);
+    bool usable(const Source &s) const;
+    void rejectPiece(Source &s, Uint32 piece, TimeStamp now);
+    Source *findSource(MetadataSource *src);
+    bool removeRequest(Source &s, Uint32 piece);
+    bool requested(const Source &s, Uint32 piece) const;
+    bool pickPiece(const Source &s, Uint32 &piece) const;
+    void assign(Source &s, TimeStamp now, bool stalled_ok);
+    void assignAll(TimeStamp now);
+    void hashReceived();
 
 private:
-    UTMetaData *ext;
+    SHA1Hash info_hash;
+    std::vector<Source> sources;
+    std::vector<Uint8> piece_requests;
+    std::vector<MetadataSource *> piece_sources;
     BitSet pieces;
     QByteArray metadata;
     Uint32 total_size;
+    SHA1HashGen hash_gen;
+    Uint32 num_hashed;
+    bool single_source;
+    bool verified;
 };
 
 }
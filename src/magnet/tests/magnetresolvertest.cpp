@@ -0,0 +1,112 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QSignalSpy>
+#include <QTest>
+
+#include <magnet/magnetresolver.h>
+#include <util/log.h>
+
+using namespace Qt::Literals::StringLiterals;
+using namespace bt;
+
+class MagnetResolverTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MagnetResolverTest()
+    {
+    }
+    ~MagnetResolverTest() override
+    {
+    }
+
+private:
+    static MagnetLink link(int i)
+    {
+        const QString hash = u"%1"_s.arg(i, 40, 16, QLatin1Char('0'));
+        return MagnetLink(u"magnet:?xt=urn:btih:"_s + hash + u"&dn=magnet%1"_s.arg(i));
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"magnetresolvertest.log"_s);
+    }
+
+    void testPercentile()
+    {
+        std::vector<TimeStamp> empty;
+        QCOMPARE(MagnetResolver::percentile(empty, 50), TimeStamp(0));
+
+        std::vector<TimeStamp> values;
+        for (TimeStamp i = 100; i >= 1; i--) {
+            values.push_back(i * 10);
+        }
+        QCOMPARE(MagnetResolver::percentile(values, 50), TimeStamp(500));
+        QCOMPARE(MagnetResolver::percentile(values, 90), TimeStamp(900));
+        QCOMPARE(MagnetResolver::percentile(values, 99), TimeStamp(990));
+        QCOMPARE(MagnetResolver::percentile(values, 100), TimeStamp(1000));
+        QCOMPARE(MagnetResolver::percentile(values, 0), TimeStamp(10));
+
+        std::vector<TimeStamp> one = {42};
+        QCOMPARE(MagnetResolver::percentile(one, 99), TimeStamp(42));
+    }
+
+    void testConcurrencyLimit()
+    {
+        MagnetResolver resolver;
+        resolver.setMaxActive(3);
+        for (int i = 1; i <= 10; i++) {
+            QVERIFY(resolver.add(link(i)));
+        }
+
+        // the same info hash is only resolved once
+        QVERIFY(!resolver.add(link(5)));
+        QCOMPARE(resolver.numQueued(), 10u);
+        QCOMPARE(resolver.numActive(), 0u);
+
+        resolver.update();
+        QCOMPARE(resolver.numActive(), 3u);
+        QCOMPARE(resolver.numQueued(), 7u);
+        QVERIFY(!resolver.add(link(1)));
+        QVERIFY(!resolver.add(link(10)));
+    }
+
+    void testTimeout()
+    {
+        MagnetResolver resolver;
+        QSignalSpy spy(&resolver, &MagnetResolver::failed);
+        resolver.setMaxActive(3);
+        for (int i = 1; i <= 5; i++) {
+            QVERIFY(resolver.add(link(i)));
+        }
+
+        resolver.update();
+        QCOMPARE(resolver.numActive(), 3u);
+
+        // everything which is active times out, the next ones take their place
+        resolver.setTimeout(0);
+        resolver.update();
+        QCOMPARE(spy.count(), 3);
+        QCOMPARE(resolver.numActive(), 2u);
+        QCOMPARE(resolver.numQueued(), 0u);
+
+        const MagnetResolver::Stats s = resolver.stats();
+        QCOMPARE(s.failed, 3u);
+        QCOMPARE(s.resolved, 0u);
+        QCOMPARE(s.latency_p50, TimeStamp(0));
+
+        // a failed magnet can be added again
+        QVERIFY(resolver.add(link(1)));
+    }
+};
+
+QTEST_MAIN(MagnetResolverTest)
+
+#include "magnetresolvertest.moc"
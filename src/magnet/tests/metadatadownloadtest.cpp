@@ -0,0 +1,290 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QSet>
+#include <QTest>
+
+#include <magnet/metadatadownload.h>
+#include <util/functions.h>
+#include <util/log.h>
+#include <util/sha1hash.h>
+
+using namespace Qt::Literals::StringLiterals;
+using namespace bt;
+
+class DummySource : public MetadataSource
+{
+public:
+    void requestMetadataPiece(Uint32 piece) override
+    {
+        requests.append(piece);
+    }
+
+    QList<Uint32> requests;
+};
+
+class MetadataDownloadTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MetadataDownloadTest()
+    {
+    }
+    ~MetadataDownloadTest() override
+    {
+    }
+
+private:
+    static QByteArrayView pieceOf(const QByteArray &data, Uint32 idx)
+    {
+        const int off = idx * METADATA_PIECE_SIZE;
+        return QByteArrayView(data).sliced(off, qMin(METADATA_PIECE_SIZE, int(data.size()) - off));
+    }
+
+    QByteArrayView piece(Uint32 idx) const
+    {
+        return pieceOf(metadata, idx);
+    }
+
+    // Answer the requests of all sources until nothing is requested anymore,
+    // the poisoned source answers with pieces of bad_data
+    bool answerAll(MetadataDownload &md, QList<DummySource *> &sources, const DummySource *poisoned = nullptr, const QByteArray &bad_data = {})
+    {
+        bool done = false;
+        bool busy = true;
+        while (busy) {
+            busy = false;
+            for (DummySource *s : std::as_const(sources)) {
+                if (s->requests.isEmpty()) {
+                    continue;
+                }
+                busy = true;
+                const Uint32 p = s->requests.takeFirst();
+                done = md.data(s, p, s == poisoned ? pieceOf(bad_data, p) : piece(p)) || done;
+            }
+        }
+        return done;
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"metadatadownloadtest.log"_s);
+        metadata.resize(10 * METADATA_PIECE_SIZE + 1234);
+        for (int i = 0; i < metadata.size(); i++) {
+            metadata[i] = char(i * 7 + i / 13);
+        }
+        info_hash = SHA1Hash::generate(metadata);
+    }
+
+    void testSplitOverSources()
+    {
+        MetadataDownload md(info_hash);
+        DummySource a, b, c;
+        QVERIFY(md.addSource(&a, metadata.size()));
+        QVERIFY(md.addSource(&b, metadata.size()));
+        QVERIFY(md.addSource(&c, metadata.size()));
+        QCOMPARE(md.numPieces(), 11u);
+
+        // every source gets its own pieces, up to the per source limit
+        QCOMPARE(a.requests.size(), int(MetadataDownload::MAX_REQUESTS_PER_SOURCE));
+        QCOMPARE(b.requests.size(), int(MetadataDownload::MAX_REQUESTS_PER_SOURCE));
+        QCOMPARE(c.requests.size(), int(MetadataDownload::MAX_REQUESTS_PER_SOURCE));
+        QSet<Uint32> requested;
+        for (const DummySource *s : {&a, &b, &c}) {
+            for (Uint32 p : s->requests) {
+                requested.insert(p);
+            }
+        }
+        QCOMPARE(requested.size(), 3 * int(MetadataDownload::MAX_REQUESTS_PER_SOURCE));
+
+        QList<DummySource *> sources = {&a, &b, &c};
+        QVERIFY(answerAll(md, sources));
+        QVERIFY(md.isComplete());
+        QCOMPARE(md.result(), metadata);
+        QCOMPARE(md.numRequests(), 0u);
+    }
+
+    void testSizeMismatch()
+    {
+        MetadataDownload md(info_hash);
+        DummySource a, b;
+        QVERIFY(!md.addSource(&a, 0));
+        QVERIFY(md.addSource(&a, metadata.size()));
+        QVERIFY(!md.addSource(&a, metadata.size()));
+
+        // sources reporting another size are kept, but not asked
+        QVERIFY(md.addSource(&b, metadata.size() + 1));
+        QCOMPARE(md.numSources(), 2u);
+        QCOMPARE(md.totalSize(), Uint32(metadata.size()));
+        QVERIFY(b.requests.isEmpty());
+
+        // until the sources of the current size are gone
+        md.removeSource(&a);
+        QCOMPARE(md.totalSize(), Uint32(metadata.size() + 1));
+        QCOMPARE(md.numDownloaded(), 0u);
+        QCOMPARE(b.requests.size(), int(MetadataDownload::MAX_REQUESTS_PER_SOURCE));
+
+        // and without any sources nothing is left
+        md.removeSource(&b);
+        QCOMPARE(md.totalSize(), 0u);
+        QCOMPARE(md.numRequests(), 0u);
+    }
+
+    void testTimeout()
+    {
+        MetadataDownload md(info_hash);
+        DummySource a, b;
+        const TimeStamp t1 = bt::CurrentTime() + MetadataDownload::REQUEST_TIMEOUT + 1;
+        const TimeStamp t2 = t1 + MetadataDownload::REQUEST_TIMEOUT + 1;
+        const TimeStamp t3 = t2 + MetadataDownload::REQUEST_TIMEOUT + 1;
+
+        // a never answers, as long as it is the only source it keeps getting the requests
+        QVERIFY(md.addSource(&a, metadata.size()));
+        a.requests.clear();
+        md.update(t1);
+        QCOMPARE(a.requests.size(), int(MetadataDownload::MAX_REQUESTS_PER_SOURCE));
+        a.requests.clear();
+        md.update(t2);
+        QCOMPARE(a.requests.size(), int(MetadataDownload::MAX_REQUESTS_PER_SOURCE));
+        a.requests.clear();
+
+        // once there is another source, the pieces of a are handed to it
+        QVERIFY(md.addSource(&b, metadata.size()));
+        QCOMPARE(b.requests, QList<Uint32>({2, 3}));
+        b.requests.clear();
+        md.update(t3);
+        QCOMPARE(b.requests, QList<Uint32>({0, 1}));
+        QVERIFY(a.requests.isEmpty());
+
+        // answers which arrive late are still used
+        QVERIFY(!md.data(&a, 0, piece(0)));
+        QCOMPARE(md.numDownloaded(), 1u);
+
+        QList<DummySource *> sources = {&a, &b};
+        QVERIFY(answerAll(md, sources));
+        QCOMPARE(md.result(), metadata);
+    }
+
+    void testRemoveSource()
+    {
+        MetadataDownload md(info_hash);
+        DummySource a, b;
+        QVERIFY(md.addSource(&a, metadata.size()));
+        QVERIFY(md.addSource(&b, metadata.size()));
+        md.removeSource(&a);
+        QCOMPARE(md.numSources(), 1u);
+
+        // b finishes its own pieces and then picks up the ones a had
+        QList<DummySource *> sources = {&b};
+        QVERIFY(answerAll(md, sources));
+        QVERIFY(md.isComplete());
+        QCOMPARE(md.result(), metadata);
+    }
+
+    void testReject()
+    {
+        MetadataDownload md(info_hash);
+        DummySource a, b;
+        QVERIFY(md.addSource(&a, metadata.size()));
+        const Uint32 p = a.requests.takeFirst();
+        md.reject(&a, p);
+        QVERIFY(!a.requests.contains(p));
+
+        QVERIFY(md.addSource(&b, metadata.size()));
+        QVERIFY(b.requests.contains(p));
+    }
+
+    void testRejectExpires()
+    {
+        MetadataDownload md(info_hash);
+        DummySource a;
+        QVERIFY(md.addSource(&a, metadata.size()));
+        const Uint32 p = a.requests.takeFirst();
+        md.reject(&a, p);
+        a.requests.clear();
+
+        // the only source rejected the piece, after a while it is asked again
+        md.update(bt::CurrentTime() + MetadataDownload::REJECT_TIMEOUT + 1);
+        QVERIFY(a.requests.contains(p));
+    }
+
+    void testHashFailure()
+    {
+        MetadataDownload md(info_hash);
+        DummySource a;
+        QVERIFY(md.addSource(&a, metadata.size()));
+
+        QByteArray bad = piece(0).toByteArray();
+        bad[0] = bad[0] + 1;
+        bool done = false;
+        while (!a.requests.isEmpty()) {
+            const Uint32 p = a.requests.takeFirst();
+            done = md.data(&a, p, p == 0 ? QByteArrayView(bad) : piece(p));
+            if (md.numDownloaded() == 0) {
+                break;
+            }
+        }
+        QVERIFY(!done);
+        QVERIFY(!md.isComplete());
+
+        // the download starts over
+        QCOMPARE(md.numDownloaded(), 0u);
+        QList<DummySource *> sources = {&a};
+        QVERIFY(answerAll(md, sources));
+        QCOMPARE(md.result(), metadata);
+    }
+
+    void testPoisonedFirstSourceSize()
+    {
+        MetadataDownload md(info_hash);
+        DummySource a, b, c;
+
+        // the first source reports a wrong size and sends garbage
+        const QByteArray bad(metadata.size() + METADATA_PIECE_SIZE, 'x');
+        QVERIFY(md.addSource(&a, bad.size()));
+        QVERIFY(md.addSource(&b, metadata.size()));
+        QVERIFY(md.addSource(&c, metadata.size()));
+        QCOMPARE(md.totalSize(), Uint32(bad.size()));
+        QVERIFY(b.requests.isEmpty());
+        QVERIFY(c.requests.isEmpty());
+
+        // once its data fails the hash check, the size of the others is used
+        QList<DummySource *> sources = {&a, &b, &c};
+        QVERIFY(answerAll(md, sources, &a, bad));
+        QVERIFY(md.isComplete());
+        QCOMPARE(md.totalSize(), Uint32(metadata.size()));
+        QCOMPARE(md.result(), metadata);
+    }
+
+    void testPoisonedFirstSource()
+    {
+        MetadataDownload md(info_hash);
+        DummySource a, b;
+
+        // the first source reports the right size, but always sends a bad first piece
+        QByteArray bad = metadata;
+        bad[0] = bad[0] + 1;
+        QVERIFY(md.addSource(&a, metadata.size()));
+        QVERIFY(md.addSource(&b, metadata.size()));
+
+        // both are blamed for the first failure, then they are tried one at a time
+        QList<DummySource *> sources = {&a, &b};
+        QVERIFY(answerAll(md, sources, &a, bad));
+        QVERIFY(md.isComplete());
+        QCOMPARE(md.result(), metadata);
+    }
+
+private:
+    QByteArray metadata;
+    SHA1Hash info_hash;
+};
+
+QTEST_MAIN(MetadataDownloadTest)
+
+#include "metadatadownloadtest.moc"
@@ -28,7 +28,7 @@ BigInt::BigInt(const QString &value)
 
 BigInt::BigInt(const BigInt &bi)
 {
-    mpz_set(val, bi.val);
+    mpz_init_set(val, bi.val);
 }
 
 BigInt::~BigInt()
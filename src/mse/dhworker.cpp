@@ -0,0 +1,130 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "dhworker.h"
+#include "functions.h"
+
+#include <QCoreApplication>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QThread>
+#include <QThreadPool>
+
+#include <vector>
+
+using namespace bt;
+
+namespace mse
+{
+namespace
+{
+struct DHPool {
+    DHPool()
+    {
+        pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+        if (QCoreApplication::instance()) {
+            notifier.moveToThread(QCoreApplication::instance()->thread());
+        }
+    }
+
+    ~DHPool()
+    {
+        pool.waitForDone();
+    }
+
+    // start generating keypairs until the pool is full again, mutex must be locked
+    void refill()
+    {
+        while (keys.size() + pending < num_keypairs) {
+            pending++;
+            pool.start([this]() {
+                DHWorker::KeyPair kp;
+                GeneratePublicPrivateKey(kp.priv, kp.pub);
+                QMutexLocker lock(&mutex);
+                pending--;
+                if (keys.size() < num_keypairs) {
+                    keys.push_back(kp);
+                }
+            });
+        }
+    }
+
+    QMutex mutex;
+    std::vector<DHWorker::KeyPair> keys;
+    Uint32 num_keypairs = DHWorker::DEFAULT_NUM_KEYPAIRS;
+    Uint32 pending = 0;
+    // the results are delivered through this object, it outlives all receivers
+    QObject notifier;
+    QThreadPool pool;
+};
+
+DHPool &Pool()
+{
+    static DHPool p;
+    return p;
+}
+}
+
+DHWorker::KeyPair DHWorker::takeKeyPair()
+{
+    DHPool &p = Pool();
+    QMutexLocker lock(&p.mutex);
+    KeyPair kp;
+    if (!p.keys.empty()) {
+        kp = p.keys.back();
+        p.keys.pop_back();
+        p.refill();
+        return kp;
+    }
+
+    p.refill();
+    lock.unlock();
+    GeneratePublicPrivateKey(kp.priv, kp.pub);
+    return kp;
+}
+
+void DHWorker::computeSecret(const BigInt &our_priv, const BigInt &peer_pub, QObject *receiver, std::function<void(const BigInt &)> done)
+{
+    DHPool &p = Pool();
+    QPointer<QObject> ptr(receiver);
+    p.pool.start([&p, ptr, our_priv, peer_pub, done = std::move(done)]() {
+        const BigInt s = DHSecret(our_priv, peer_pub);
+        QMetaObject::invokeMethod(
+            &p.notifier,
+            [ptr, s, done]() {
+                if (ptr) {
+                    done(s);
+                }
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void DHWorker::setNumKeyPairs(Uint32 num)
+{
+    DHPool &p = Pool();
+    QMutexLocker lock(&p.mutex);
+    p.num_keypairs = num;
+    if (p.keys.size() > num) {
+        p.keys.resize(num);
+    }
+    p.refill();
+}
+
+Uint32 DHWorker::numReadyKeyPairs()
+{
+    DHPool &p = Pool();
+    QMutexLocker lock(&p.mutex);
+    return p.keys.size();
+}
+
+void DHWorker::waitForDone()
+{
+    Pool().pool.waitForDone();
+}
+
+}
@@ -0,0 +1,67 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef MSEDHWORKER_H
+#define MSEDHWORKER_H
+
+#include "bigint.h"
+#include <functional>
+#include <ktorrent_export.h>
+#include <util/constants.h>
+
+class QObject;
+
+namespace mse
+{
+/*!
+    \headerfile mse/dhworker.h
+    \brief Does the Diffie Hellman computations of the MSE handshakes off the main thread.
+
+    Generating a keypair and computing the shared secret are both a 768 bit modular
+    exponentiation. Done on the main thread, many handshakes at once stall the event loop.
+    The keypairs are generated ahead of time on a thread pool, so a new handshake can
+    take one without waiting. The secret depends on the key of the peer, so it is computed
+    on the thread pool when the key arrives, and handed back to the handshake afterwards.
+*/
+class KTORRENT_EXPORT DHWorker
+{
+public:
+    struct KeyPair {
+        BigInt priv;
+        BigInt pub;
+    };
+
+    //! The default number of keypairs kept ready
+    static constexpr bt::Uint32 DEFAULT_NUM_KEYPAIRS = 16;
+
+    /*!
+        Take a pregenerated keypair, and generate a new one in the background.
+        If none is ready, the keypair is generated on the spot.
+    */
+    static KeyPair takeKeyPair();
+
+    /*!
+        Compute the shared secret on the thread pool.
+        \param our_priv Our private key
+        \param peer_pub The public key of the peer
+        \param receiver done is called from the event loop of the main thread, unless receiver has been destroyed by then
+        \param done Called with the secret
+    */
+    static void computeSecret(const BigInt &our_priv, const BigInt &peer_pub, QObject *receiver, std::function<void(const BigInt &)> done);
+
+    //! Set the number of keypairs which are kept ready
+    static void setNumKeyPairs(bt::Uint32 num);
+
+    //! Get the number of keypairs which are ready
+    static bt::Uint32 numReadyKeyPairs();
+
+    //! Wait until the thread pool is idle
+    static void waitForDone();
+};
+
+}
+
+#endif
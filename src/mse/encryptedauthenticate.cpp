@@ -10,6 +10,7 @@
 
 #include <QRandomGenerator>
 
+#include "dhworker.h"
 #include "encryptedpacketsocket.h"
 #include "functions.h"
 #include "rc4encryptor.h"
@@ -30,7 +31,9 @@ EncryptedAuthenticate::EncryptedAuthenticate(const net::Address &addr,
                                              PeerConnector::WPtr pcon)
     : Authenticate(addr, proto, info_hash, peer_id, pcon)
 {
-    mse::GeneratePublicPrivateKey(xa, ya);
+    const DHWorker::KeyPair kp = DHWorker::takeKeyPair();
+    xa = kp.priv;
+    ya = kp.pub;
     state = State::NOT_CONNECTED;
     buf_size = 0;
     vc_off = 0;
@@ -74,9 +77,20 @@ void EncryptedAuthenticate::handleYB()
     // read Yb
     yb = BigInt::fromBuffer(buf, 96);
 
-    // calculate s
-    s = mse::DHSecret(xa, yb);
+    // calculate s on the thread pool, data which arrives in the meantime is buffered
+    state = State::COMPUTING_S;
+    DHWorker::computeSecret(xa, yb, this, [this](const BigInt &secret) {
+        sendReq1(secret);
+    });
+}
 
+void EncryptedAuthenticate::sendReq1(const BigInt &secret)
+{
+    if (finished) {
+        return;
+    }
+
+    s = secret;
     state = State::GOT_YB;
     // now we must send line 3
     Uint8 tmp_buf[120]; // temporary buffer
@@ -259,6 +273,9 @@ void EncryptedAuthenticate::onReadyRead()
             handleYB();
         }
         break;
+    case State::COMPUTING_S:
+        // the data has been buffered, it is handled once S is known
+        break;
     case State::GOT_YB:
         findVC();
         break;
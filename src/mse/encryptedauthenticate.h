@@ -42,6 +42,7 @@ private Q_SLOTS:
 
 private:
     void handleYB();
+    void sendReq1(const BigInt &secret);
     void handleCryptoSelect();
     void findVC();
     void handlePadD();
@@ -50,6 +51,7 @@ private:
     enum class State {
         NOT_CONNECTED,
         SENT_YA,
+        COMPUTING_S,
         GOT_YB,
         FOUND_VC,
         WAIT_FOR_PAD_D,
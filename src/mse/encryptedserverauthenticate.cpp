@@ -10,6 +10,7 @@
 
 #include <QRandomGenerator>
 
+#include "dhworker.h"
 #include "encryptedpacketsocket.h"
 #include "functions.h"
 #include "rc4encryptor.h"
@@ -25,7 +26,9 @@ namespace mse
 EncryptedServerAuthenticate::EncryptedServerAuthenticate(std::unique_ptr<mse::EncryptedPacketSocket> sock)
     : bt::ServerAuthenticate(std::move(sock))
 {
-    mse::GeneratePublicPrivateKey(xb, yb);
+    const DHWorker::KeyPair kp = DHWorker::takeKeyPair();
+    xb = kp.priv;
+    yb = kp.pub;
     state = State::WAITING_FOR_YA;
     buf_size = 0;
     req1_off = 0;
@@ -53,8 +56,20 @@ void EncryptedServerAuthenticate::handleYA()
 
     ya = BigInt::fromBuffer(buf, 96);
     //  DumpBigInt("Ya",ya);
-    // now calculate secret
-    s = mse::DHSecret(xb, ya);
+    // now calculate secret on the thread pool, data which arrives in the meantime is buffered
+    state = State::COMPUTING_S;
+    DHWorker::computeSecret(xb, ya, this, [this](const BigInt &secret) {
+        onSecretComputed(secret);
+    });
+}
+
+void EncryptedServerAuthenticate::onSecretComputed(const BigInt &secret)
+{
+    if (finished || !sock) {
+        return;
+    }
+
+    s = secret;
     //  DumpBigInt("S",s);
     state = State::WAITING_FOR_REQ1;
     // see if we can find req1
@@ -276,6 +291,14 @@ void EncryptedServerAuthenticate::onReadyRead()
             }
         }
         break;
+    case State::COMPUTING_S:
+        if (buf_size + ba > MAX_SEA_BUF_SIZE) {
+            ba = MAX_SEA_BUF_SIZE - buf_size;
+        }
+
+        // findReq1 is called once S is known
+        buf_size += sock->readData(buf + buf_size, ba);
+        break;
     case State::WAITING_FOR_REQ1:
         if (buf_size + ba > MAX_SEA_BUF_SIZE) {
             ba = MAX_SEA_BUF_SIZE - buf_size;
@@ -35,6 +35,7 @@ private Q_SLOTS:
 private:
     void handleYA();
     void sendYB();
+    void onSecretComputed(const BigInt &secret);
     void findReq1();
     void calculateSKey();
     void processVC();
@@ -44,6 +45,7 @@ private:
 private:
     enum class State {
         WAITING_FOR_YA,
+        COMPUTING_S,
         WAITING_FOR_REQ1,
         FOUND_REQ1,
         FOUND_INFO_HASH,
@@ -25,8 +25,6 @@ using namespace bt;
 
 namespace mse
 {
-static Uint8 rc4_enc_buffer[bt::MAX_MSGLEN];
-
 #if defined(LIBKTORRENT_USE_OPENSSL)
 
 inline void RC4Encryptor::EVP_CIPHERDeleter::operator()(EVP_CIPHER *cipher) const noexcept
@@ -82,16 +80,22 @@ void RC4Encryptor::decrypt(Uint8 *data, Uint32 len)
     EVP_DecryptUpdate(dec.get(), data, &out_len, data, static_cast<int>(len));
 }
 
-QByteArrayView RC4Encryptor::encrypt(QByteArrayView data)
+QByteArray RC4Encryptor::encrypt(QByteArrayView data)
 {
-    static_assert(sizeof(rc4_enc_buffer) <= static_cast<unsigned int>(INT_MAX), "rc4_enc_buffer size is too large");
-    if (static_cast<size_t>(data.size()) > sizeof(rc4_enc_buffer)) {
-        throw bt::Error(QStringLiteral("RC4Encryptor::encrypt is called with a too large input: %1 bytes").arg(data.size()));
-    }
-
+    // encrypt straight from the input, there is no need to copy it first
+    QByteArray ret(data.size(), Qt::Uninitialized);
+    const Uint8 *in = reinterpret_cast<const Uint8 *>(data.data());
+    Uint8 *out = reinterpret_cast<Uint8 *>(ret.data());
+    qsizetype len = data.size();
     int out_len = 0;
-    EVP_EncryptUpdate(enc.get(), rc4_enc_buffer, &out_len, reinterpret_cast<const Uint8 *>(data.data()), static_cast<int>(data.size()));
-    return QByteArrayView{rc4_enc_buffer, data.size()};
+    while (len > INT_MAX) {
+        EVP_EncryptUpdate(enc.get(), out, &out_len, in, INT_MAX);
+        in += INT_MAX;
+        out += INT_MAX;
+        len -= INT_MAX;
+    }
+    EVP_EncryptUpdate(enc.get(), out, &out_len, in, static_cast<int>(len));
+    return ret;
 }
 
 void RC4Encryptor::encryptReplace(Uint8 *data, Uint32 len)
@@ -130,13 +134,11 @@ void RC4Encryptor::decrypt(Uint8 *data, Uint32 len)
     gcry_cipher_decrypt(dec, data, len, data, len);
 }
 
-QByteArrayView RC4Encryptor::encrypt(QByteArrayView data)
+QByteArray RC4Encryptor::encrypt(QByteArrayView data)
 {
-    if (static_cast<size_t>(data.size()) > sizeof(rc4_enc_buffer)) {
-        throw bt::Error(QStringLiteral("RC4Encryptor::encrypt is called with a too large input: %1 bytes").arg(data.size()));
-    }
-    gcry_cipher_encrypt(enc, rc4_enc_buffer, data.size(), data.data(), data.size());
-    return QByteArrayView{rc4_enc_buffer, data.size()};
+    QByteArray ret(data.size(), Qt::Uninitialized);
+    gcry_cipher_encrypt(enc, ret.data(), ret.size(), data.data(), data.size());
+    return ret;
 }
 
 void RC4Encryptor::encryptReplace(Uint8 *data, Uint32 len)
@@ -13,6 +13,7 @@
 #include <gcrypt.h>
 #endif
 
+#include <QByteArray>
 #include <QByteArrayView>
 
 #include <ktorrent_export.h>
@@ -27,8 +28,9 @@ namespace mse
  *
  * \brief Uses the RC4 algorithm to encrypt and decrypt data.
  *
- * This class has a static encryption buffer, which makes it not thread safe
- * because the buffer is not protected by mutexes.
+ * Every RC4Encryptor has its own cipher contexts and there is no shared state,
+ * so different connections can be serviced from different threads. A single
+ * RC4Encryptor must only be used by one thread at a time.
  */
 class KTORRENT_EXPORT RC4Encryptor
 {
@@ -44,14 +46,13 @@ public:
     void decrypt(bt::Uint8 *data, bt::Uint32 len);
 
     /*!
-     * Encrypt the data. Encryption happens into the static buffer.
-     * So that the data passed to this function is never overwritten.
-     * If we send pieces we point directly to the mmap region of data,
-     * this cannot be overwritten, hence the static buffer.
+     * Encrypt a copy of the data, the data passed to this function is never overwritten.
+     * Outgoing packets are encrypted with encryptReplace, this is for data which can
+     * not be changed.
      * \param data The data
-     * \return View over the static buffer
+     * \return The encrypted data
      */
-    QByteArrayView encrypt(QByteArrayView data);
+    QByteArray encrypt(QByteArrayView data);
 
     /*!
      * Encrypt data, encryption will happen in the same buffer. So data will
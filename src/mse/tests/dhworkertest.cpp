@@ -0,0 +1,91 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include <memory>
+#include <mse/dhworker.h>
+#include <mse/functions.h>
+#include <util/log.h>
+
+using namespace bt;
+using namespace mse;
+using namespace Qt::Literals::StringLiterals;
+
+static QByteArray ToByteArray(const BigInt &bi)
+{
+    QByteArray ret(96, 0);
+    ret.resize(bi.toBuffer(reinterpret_cast<Uint8 *>(ret.data()), 96));
+    return ret;
+}
+
+class DHWorkerTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    DHWorkerTest()
+    {
+    }
+    ~DHWorkerTest() override
+    {
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"dhworkertest.log"_s);
+    }
+
+    void testKeyPairPool()
+    {
+        DHWorker::setNumKeyPairs(4);
+        // the first one is generated on the spot, and the pool gets filled
+        DHWorker::takeKeyPair();
+        DHWorker::waitForDone();
+        QCOMPARE(DHWorker::numReadyKeyPairs(), 4u);
+
+        // a taken keypair is replaced
+        const DHWorker::KeyPair a = DHWorker::takeKeyPair();
+        DHWorker::waitForDone();
+        QCOMPARE(DHWorker::numReadyKeyPairs(), 4u);
+
+        // every pooled keypair is a valid one
+        const DHWorker::KeyPair b = DHWorker::takeKeyPair();
+        QVERIFY(ToByteArray(a.pub) != ToByteArray(b.pub));
+        QCOMPARE(ToByteArray(DHSecret(a.priv, b.pub)), ToByteArray(DHSecret(b.priv, a.pub)));
+    }
+
+    void testComputeSecret()
+    {
+        const DHWorker::KeyPair a = DHWorker::takeKeyPair();
+        const DHWorker::KeyPair b = DHWorker::takeKeyPair();
+
+        QByteArray secret;
+        QObject receiver;
+        DHWorker::computeSecret(a.priv, b.pub, &receiver, [&secret](const BigInt &s) {
+            secret = ToByteArray(s);
+        });
+        QTRY_VERIFY(!secret.isEmpty());
+        QCOMPARE(secret, ToByteArray(DHSecret(b.priv, a.pub)));
+
+        // nothing is delivered to a destroyed receiver
+        bool called = false;
+        auto gone = std::make_unique<QObject>();
+        DHWorker::computeSecret(a.priv, b.pub, gone.get(), [&called](const BigInt &) {
+            called = true;
+        });
+        gone.reset();
+        DHWorker::waitForDone();
+        QTest::qWait(50);
+        QVERIFY(!called);
+    }
+};
+
+QTEST_MAIN(DHWorkerTest)
+
+#include "dhworkertest.moc"
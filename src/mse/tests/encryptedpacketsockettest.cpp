@@ -0,0 +1,134 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include <download/packet.h>
+#include <memory>
+#include <mse/encryptedpacketsocket.h>
+#include <mse/rc4encryptor.h>
+#include <net/packetsocket.h>
+#include <util/functions.h>
+#include <util/log.h>
+#include <vector>
+
+#include <utils.h>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+static const SHA1Hash DKEY = SHA1Hash::generate(QByteArrayLiteral("dkey"));
+static const SHA1Hash EKEY = SHA1Hash::generate(QByteArrayLiteral("ekey"));
+
+// Read everything which is available on the socket
+static Uint32 Drain(net::SocketDevice *sock, std::vector<Uint8> &buf)
+{
+    Uint32 ret = 0;
+    Uint32 ba = sock->bytesAvailable();
+    while (ba > 0) {
+        const int r = sock->recv(buf.data(), qMin<Uint32>(ba, buf.size()));
+        if (r <= 0) {
+            break;
+        }
+        ret += r;
+        ba = sock->bytesAvailable();
+    }
+    return ret;
+}
+
+class EncryptedPacketSocketTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    EncryptedPacketSocketTest()
+    {
+    }
+    ~EncryptedPacketSocketTest() override
+    {
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QVERIFY(bt::InitLibKTorrent());
+        bt::InitLog(u"encryptedpacketsockettest.log"_s);
+    }
+
+    void testSendData()
+    {
+        auto socket_pair = CreateSocketPair();
+        QVERIFY(socket_pair.has_value());
+        mse::EncryptedPacketSocket sock(std::move(socket_pair->writer));
+        sock.setRC4Encryptor(std::make_unique<mse::RC4Encryptor>(DKEY, EKEY));
+        mse::RC4Encryptor decryptor(EKEY, DKEY);
+
+        // the data which is sent is left alone
+        const QByteArray data(4096, 'x');
+        QCOMPARE(sock.sendData(data.first(1000)), 1000u);
+        QCOMPARE(sock.sendData(data.sliced(1000)), Uint32(data.size() - 1000));
+        QCOMPARE(data, QByteArray(4096, 'x'));
+
+        // and it arrives as one RC4 stream
+        std::vector<Uint8> read_buffer(data.size());
+        Uint32 received = 0;
+        while (received < read_buffer.size()) {
+            const int ret = socket_pair->reader->recv(read_buffer.data() + received, read_buffer.size() - received);
+            QVERIFY(ret > 0);
+            received += ret;
+        }
+        decryptor.decrypt(read_buffer.data(), read_buffer.size());
+        QVERIFY(QByteArrayView(read_buffer.data(), read_buffer.size()) == data);
+    }
+
+    void benchmarkSend_data()
+    {
+        QTest::addColumn<bool>("encrypted");
+        QTest::newRow("plain") << false;
+        QTest::newRow("rc4") << true;
+    }
+
+    void benchmarkSend()
+    {
+        QFETCH(bool, encrypted);
+        auto socket_pair = CreateSocketPair();
+        QVERIFY(socket_pair.has_value());
+
+        std::unique_ptr<net::PacketSocket> sock;
+        if (encrypted) {
+            auto enc = std::make_unique<mse::EncryptedPacketSocket>(std::move(socket_pair->writer));
+            enc->setRC4Encryptor(std::make_unique<mse::RC4Encryptor>(DKEY, EKEY));
+            sock = std::move(enc);
+        } else {
+            sock = std::make_unique<net::PacketSocket>(std::move(socket_pair->writer));
+        }
+
+        // 1 MiB in packets of the size of a piece message
+        const QByteArray payload(16 * 1024, 'x');
+        constexpr Uint32 NUM_PACKETS = 64;
+        std::vector<Uint8> read_buffer(256 * 1024);
+        QBENCHMARK {
+            for (Uint32 i = 0; i < NUM_PACKETS; i++) {
+                sock->addPacket(Packet::create(Uint8(0), payload));
+            }
+
+            Uint64 sent = 0;
+            Uint64 received = 0;
+            while (sock->bytesReadyToWrite()) {
+                sent += sock->write(0, bt::Now());
+                received += Drain(socket_pair->reader.get(), read_buffer);
+            }
+            while (received < sent) {
+                received += Drain(socket_pair->reader.get(), read_buffer);
+            }
+        }
+    }
+};
+
+QTEST_MAIN(EncryptedPacketSocketTest)
+
+#include "encryptedpacketsockettest.moc"
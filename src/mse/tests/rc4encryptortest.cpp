@@ -64,6 +64,34 @@ private Q_SLOTS:
             throw;
         }
     }
+
+    void testEncryptCopy()
+    {
+        const bt::SHA1Hash dkey = randomKey();
+        const bt::SHA1Hash ekey = randomKey();
+        mse::RC4Encryptor a(dkey, ekey);
+        mse::RC4Encryptor b(dkey, ekey);
+        mse::RC4Encryptor c(ekey, dkey);
+
+        // encrypt leaves the input alone and gives the same stream as encryptReplace
+        for (int i = 0; i < 100; i++) {
+            QByteArray data(1000 + i, Qt::Uninitialized);
+            for (char &ch : data) {
+                ch = char(QRandomGenerator::global()->generate());
+            }
+
+            const QByteArray orig = data;
+            const QByteArray enc = a.encrypt(data);
+            QCOMPARE(data, orig);
+            QCOMPARE(enc.size(), data.size());
+
+            b.encryptReplace(reinterpret_cast<bt::Uint8 *>(data.data()), data.size());
+            QCOMPARE(enc, data);
+
+            c.decrypt(reinterpret_cast<bt::Uint8 *>(data.data()), data.size());
+            QCOMPARE(data, orig);
+        }
+    }
 };
 
 QTEST_MAIN(RC4EncryptorTest)
@@ -8,13 +8,24 @@
 #include <net/socketmonitor.h>
 #include <util/log.h>
 
+#include <atomic>
+
 using namespace bt;
 
 namespace net
 {
+// size of the buffer in which small control packets are coalesced
+static const Uint32 CTRL_BUFFER_SIZE = 2048;
+
+static std::atomic<Uint64> total_packets_sent = 0;
+static std::atomic<Uint64> total_send_calls = 0;
+
 PacketSocket::PacketSocket(std::unique_ptr<SocketDevice> sock)
     : TrafficShapedSocket(std::move(sock))
     , ctrl_packets_sent(0)
+    , ctrl_buffer_size(0)
+    , ctrl_buffer_written(0)
+    , ctrl_buffer_packets(0)
     , pending_upload_data_bytes(0)
     , uploaded_data_bytes(0)
 {
@@ -23,6 +34,9 @@ PacketSocket::PacketSocket(std::unique_ptr<SocketDevice> sock)
 PacketSocket::PacketSocket(int fd, int ip_version)
     : TrafficShapedSocket(fd, ip_version)
     , ctrl_packets_sent(0)
+    , ctrl_buffer_size(0)
+    , ctrl_buffer_written(0)
+    , ctrl_buffer_packets(0)
     , pending_upload_data_bytes(0)
     , uploaded_data_bytes(0)
 {
@@ -31,6 +45,9 @@ PacketSocket::PacketSocket(int fd, int ip_version)
 PacketSocket::PacketSocket(bool tcp, int ip_version)
     : TrafficShapedSocket(tcp, ip_version)
     , ctrl_packets_sent(0)
+    , ctrl_buffer_size(0)
+    , ctrl_buffer_written(0)
+    , ctrl_buffer_packets(0)
     , pending_upload_data_bytes(0)
     , uploaded_data_bytes(0)
 {
@@ -51,6 +68,10 @@ void PacketSocket::selectPacket()
     if (ctrl_packets_sent < 3) {
         // try to send another control packet
         if (control_packets.size() > 0) {
+            // when data is waiting, only take the control packets which are allowed before it
+            if (coalesceControlPackets(data_packets.empty() ? (Uint32)control_packets.size() : 3 - ctrl_packets_sent)) {
+                return;
+            }
             curr_packet = std::move(control_packets.front());
             control_packets.pop_front();
         } else if (data_packets.size() > 0) {
@@ -63,6 +84,9 @@ void PacketSocket::selectPacket()
             curr_packet = std::move(data_packets.front());
             data_packets.pop_front();
         } else if (control_packets.size() > 0) {
+            if (coalesceControlPackets((Uint32)control_packets.size())) {
+                return;
+            }
             curr_packet = std::move(control_packets.front());
             control_packets.pop_front();
         }
@@ -73,20 +97,97 @@ void PacketSocket::selectPacket()
     }
 }
 
+bool PacketSocket::coalesceControlPackets(Uint32 max_packets)
+{
+    // see how many packets at the front of the queue fit in the buffer
+    Uint32 num = 0;
+    Uint32 size = 0;
+    for (const Packet &p : control_packets) {
+        if (num == max_packets || size + p.getDataLength() > CTRL_BUFFER_SIZE) {
+            break;
+        }
+        size += p.getDataLength();
+        num++;
+    }
+
+    // a single packet can be sent without copying it
+    if (num < 2) {
+        return false;
+    }
+
+    if (ctrl_buffer.size() == 0) {
+        ctrl_buffer = Array<Uint8>(CTRL_BUFFER_SIZE);
+    }
+
+    Uint32 off = 0;
+    for (Uint32 i = 0; i < num; i++) {
+        const Packet &p = control_packets.front();
+        memcpy(ctrl_buffer.data() + off, p.getData(), p.getDataLength());
+        off += p.getDataLength();
+        control_packets.pop_front();
+    }
+
+    preProcess(ctrl_buffer.data(), size);
+    ctrl_buffer_size = size;
+    ctrl_buffer_written = 0;
+    ctrl_buffer_packets = num;
+    return true;
+}
+
+Uint32 PacketSocket::writeControlBuffer(Uint32 limit)
+{
+    Uint32 to_send = ctrl_buffer_size - ctrl_buffer_written;
+    if (limit > 0 && to_send > limit) {
+        to_send = limit;
+    }
+
+    const int ret = sock->send(QByteArrayView{ctrl_buffer.data() + ctrl_buffer_written, to_send});
+    total_send_calls++;
+    if (ret <= 0) {
+        return 0;
+    }
+
+    ctrl_buffer_written += ret;
+    if (ctrl_buffer_written == ctrl_buffer_size) {
+        ctrl_packets_sent += ctrl_buffer_packets;
+        total_packets_sent += ctrl_buffer_packets;
+        const QMutexLocker locker(&mutex);
+        ctrl_buffer_size = ctrl_buffer_written = ctrl_buffer_packets = 0;
+    }
+    return ret;
+}
+
 Uint32 PacketSocket::write(Uint32 max, bt::TimeStamp now)
 {
     if (sock->state() == net::SocketDevice::State::CONNECTING && !sock->connectSuccessful()) {
         return 0;
     }
 
-    if (!curr_packet) {
+    if (!curr_packet && ctrl_buffer_size == 0) {
         selectPacket();
     }
 
     Uint32 written = 0;
-    while (curr_packet && (written < max || max == 0)) {
+    while ((curr_packet || ctrl_buffer_size > 0) && (written < max || max == 0)) {
         const Uint32 limit = (max == 0) ? 0 : max - written;
+        if (ctrl_buffer_size > 0) {
+            const Uint32 ret = writeControlBuffer(limit);
+            if (ret == 0) {
+                break; // Socket buffer full, so stop sending for now
+            }
+
+            written += ret;
+            if (ctrl_buffer_size > 0) {
+                // we can't write it fully, so break out of loop
+                break;
+            }
+
+            selectPacket();
+            continue;
+        }
+
         const int ret = curr_packet->send(sock.get(), limit);
+        total_send_calls++;
         if (ret > 0) {
             written += ret;
             if (curr_packet->getType() == PeerMessageType::PIECE) {
@@ -107,6 +208,7 @@ Uint32 PacketSocket::write(Uint32 max, bt::TimeStamp now)
             } else {
                 ctrl_packets_sent++;
             }
+            total_packets_sent++;
             selectPacket();
         } else {
             // we can't write it fully, so break out of loop
@@ -134,7 +236,7 @@ void PacketSocket::addPacket(Packet packet)
 bool PacketSocket::bytesReadyToWrite() const
 {
     const QMutexLocker locker(&mutex);
-    return !data_packets.empty() || !control_packets.empty() || curr_packet;
+    return !data_packets.empty() || !control_packets.empty() || curr_packet || ctrl_buffer_size > 0;
 }
 
 void PacketSocket::preProcess(Uint8 *data, Uint32 size)
@@ -208,4 +310,12 @@ Uint32 PacketSocket::numPendingPieceUploadBytes() const
     return pending_upload_data_bytes;
 }
 
+PacketSocket::SendStats PacketSocket::sendStats()
+{
+    SendStats stats;
+    stats.packets = total_packets_sent;
+    stats.send_calls = total_send_calls;
+    return stats;
+}
+
 }
@@ -13,6 +13,7 @@
 
 #include <download/packet.h>
 #include <download/request.h>
+#include <util/array.h>
 #include <ktorrent_export.h>
 #include <net/socket.h>
 #include <net/trafficshapedsocket.h>
@@ -65,6 +66,17 @@ public:
     //! Get the number of pending piece upload bytes (including message headers)
     bt::Uint32 numPendingPieceUploadBytes() const;
 
+    /*!
+     * \brief Number of packets and send calls of all PacketSockets.
+     */
+    struct SendStats {
+        bt::Uint64 packets = 0;
+        bt::Uint64 send_calls = 0;
+    };
+
+    //! Get the number of packets sent and send calls made by all PacketSockets
+    static SendStats sendStats();
+
 protected:
     /*!
      * Preprocess the packet data, before it is sent. Default implementation does nothing.
@@ -75,12 +87,20 @@ protected:
 
 private:
     void selectPacket();
+    bool coalesceControlPackets(bt::Uint32 max_packets);
+    bt::Uint32 writeControlBuffer(bt::Uint32 limit);
 
     std::deque<bt::Packet> control_packets;
     std::deque<bt::Packet> data_packets; // NOTE: revert back to lists because of erase() calls?
     std::optional<bt::Packet> curr_packet;
     bt::Uint32 ctrl_packets_sent;
 
+    // consecutive control packets, already preprocessed, which are sent with one send call
+    bt::Array<bt::Uint8> ctrl_buffer;
+    bt::Uint32 ctrl_buffer_size;
+    bt::Uint32 ctrl_buffer_written;
+    bt::Uint32 ctrl_buffer_packets;
+
     bt::Uint32 pending_upload_data_bytes;
     bt::Uint32 uploaded_data_bytes;
 };
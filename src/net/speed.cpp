@@ -12,50 +12,72 @@ using namespace bt;
 
 namespace net
 {
-const Uint64 SPEED_INTERVAL = 5000;
-
 Speed::Speed()
     : rate(0)
     , bytes(0)
+    , head(0)
 {
+    buckets.fill(0);
 }
 
 Speed::~Speed()
 {
 }
 
+void Speed::reset(Uint64 bucket)
+{
+    buckets.fill(0);
+    bytes = 0;
+    head = bucket;
+}
+
+void Speed::advance(Uint64 bucket)
+{
+    if (bucket <= head) {
+        return;
+    }
+
+    if (bucket - head >= NUM_BUCKETS) {
+        // everything we have is older than the interval
+        reset(bucket);
+        return;
+    }
+
+    // expire the buckets which fall out of the interval, at most NUM_BUCKETS steps
+    while (head < bucket) {
+        head++;
+        Uint32 &b = buckets[head % NUM_BUCKETS];
+        if (bytes >= b) { // make sure we don't wrap around
+            bytes -= b;
+        } else {
+            bytes = 0;
+        }
+        b = 0;
+    }
+}
+
 void Speed::onData(Uint32 b, bt::TimeStamp ts)
 {
-    dlrate.push_back(qMakePair(b, ts));
+    // data with a timestamp older than the newest bucket is accounted in the newest bucket
+    advance(ts / BUCKET_DURATION);
+    buckets[head % NUM_BUCKETS] += b;
     bytes += b;
 }
 
 void Speed::update(bt::TimeStamp now)
 {
-    auto i = dlrate.begin();
-    while (i != dlrate.end()) {
-        const QPair<Uint32, TimeStamp> &p = *i;
-        if (now - p.second > SPEED_INTERVAL || now < p.second) {
-            if (bytes >= p.first) { // make sure we don't wrap around
-                bytes -= p.first; // subtract bytes
-            } else {
-                bytes = 0;
-            }
-            dlrate.pop_front();
-            i = dlrate.begin();
-        } else {
-            // seeing that newer entries are appended, they are in the list chronologically
-            // so once we hit an entry which is in the interval, we can just break out of the loop
-            // because all following entries will be in the interval
-            break;
-        }
+    const Uint64 bucket = now / BUCKET_DURATION;
+    if (bucket < head) {
+        // clock went backwards, all data is in the future, so drop it
+        reset(bucket);
+    } else {
+        advance(bucket);
     }
 
     if (bytes == 0) {
         rate = 0;
     } else {
-        //  Out() << "bytes = " << bytes << " d = " << d << endl;
-        rate = bytes / (SPEED_INTERVAL / 1000);
+        rate = bytes / (INTERVAL / 1000);
     }
 }
 
@@ -6,8 +6,8 @@
 #ifndef NETSPEED_H
 #define NETSPEED_H
 
-#include <QPair>
-#include <deque>
+#include <QAtomicInt>
+#include <array>
 #include <util/constants.h>
 
 namespace net
@@ -17,14 +17,20 @@ namespace net
     \author Joris Guisson <joris.guisson@gmail.com>
 
     \brief Measures the download and upload speed.
+
+    The rate is the average over the last 5 seconds. Data is accounted in a
+    fixed ring of time buckets, so memory use is constant and both onData and
+    update are O(1), regardless of how many small reads or writes happen.
 */
 class Speed
 {
-    QAtomicInt rate;
-    bt::Uint32 bytes;
-    std::deque<QPair<bt::Uint32, bt::TimeStamp>> dlrate;
-
 public:
+    //! Length of the averaging window in milliseconds
+    static constexpr bt::Uint64 INTERVAL = 5000;
+    //! Granularity of the window in milliseconds
+    static constexpr bt::Uint64 BUCKET_DURATION = 250;
+    static constexpr bt::Uint32 NUM_BUCKETS = INTERVAL / BUCKET_DURATION;
+
     Speed();
     virtual ~Speed();
 
@@ -34,6 +40,16 @@ public:
     {
         return rate;
     }
+
+private:
+    void advance(bt::Uint64 bucket);
+    void reset(bt::Uint64 bucket);
+
+private:
+    QAtomicInt rate;
+    bt::Uint32 bytes;
+    bt::Uint64 head; // bucket number (timestamp / BUCKET_DURATION) of the newest bucket
+    std::array<bt::Uint32, NUM_BUCKETS> buckets;
 };
 
 }
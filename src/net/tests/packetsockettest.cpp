@@ -12,6 +12,8 @@
 
 #include <diskio/chunkmanager.h>
 #include <download/request.h>
+#include <mse/encryptedpacketsocket.h>
+#include <mse/rc4encryptor.h>
 #include <net/packetsocket.h>
 #include <torrent/torrent.h>
 #include <util/constants.h>
@@ -597,6 +599,87 @@ private Q_SLOTS:
         QVERIFY(!packet_socket.bytesReadyToWrite());
     }
 
+    void testCoalesceControlPackets()
+    {
+        auto socket_pair = CreateSocketPair();
+        QVERIFY(socket_pair.has_value());
+        net::PacketSocket packet_socket(std::move(socket_pair->writer));
+
+        std::vector<RequestPacket> requests;
+        for (bt::Uint32 i = 0; i < 20; ++i) {
+            requests.push_back(RequestPacket{.m_chunk_index = i, .m_offset = i * 16384, .m_length = 16384});
+            packet_socket.addPacket(requests.back().toPacket());
+        }
+
+        const auto before = net::PacketSocket::sendStats();
+        const bt::Uint32 total_size = 20 * requests.front().size();
+        QCOMPARE(packet_socket.write(0, bt::Now()), total_size);
+        QVERIFY(!packet_socket.bytesReadyToWrite());
+
+        // all requests should have gone out in a single send call
+        const auto after = net::PacketSocket::sendStats();
+        QCOMPARE(after.packets - before.packets, 20u);
+        QCOMPARE(after.send_calls - before.send_calls, 1u);
+
+        std::vector<bt::Uint8> read_buffer(total_size);
+        QCOMPARE(socket_pair->reader->recv(read_buffer.data(), read_buffer.size()), total_size);
+        for (bt::Uint32 i = 0; i < 20; ++i) {
+            const QByteArrayView view(read_buffer.data() + i * requests[i].size(), requests[i].size());
+            QVERIFY(requests[i].verifyBuffer(view));
+        }
+    }
+
+    void testCoalesceEncryptedControlPackets()
+    {
+        auto socket_pair = CreateSocketPair();
+        QVERIFY(socket_pair.has_value());
+        mse::EncryptedPacketSocket packet_socket(std::move(socket_pair->writer));
+
+        const bt::SHA1Hash dkey = bt::SHA1Hash::generate(QByteArrayLiteral("dkey"));
+        const bt::SHA1Hash ekey = bt::SHA1Hash::generate(QByteArrayLiteral("ekey"));
+        packet_socket.setRC4Encryptor(std::make_unique<mse::RC4Encryptor>(dkey, ekey));
+        mse::RC4Encryptor decryptor(ekey, dkey);
+
+        // a single packet, a batch, and a single packet again must form one RC4 stream
+        const ExtensionPacket test_extension_packet{
+            .m_extension_id = 0,
+            .m_message = QByteArrayLiteral("{'m': {'ut_metadata', 3}, 'metadata_size': 31235}"),
+        };
+        std::vector<RequestPacket> requests;
+        for (bt::Uint32 i = 0; i < 5; ++i) {
+            requests.push_back(RequestPacket{.m_chunk_index = i, .m_offset = 0, .m_length = 16384});
+        }
+
+        packet_socket.addPacket(test_extension_packet.toPacket());
+        QCOMPARE(packet_socket.write(0, bt::Now()), test_extension_packet.size());
+
+        for (const RequestPacket &r : requests) {
+            packet_socket.addPacket(r.toPacket());
+        }
+        const bt::Uint32 batch_size = 5 * requests.front().size();
+        // write the batch in two parts
+        QCOMPARE(packet_socket.write(batch_size / 2, bt::Now()), batch_size / 2);
+        QCOMPARE(packet_socket.write(0, bt::Now()), batch_size - batch_size / 2);
+
+        packet_socket.addPacket(test_extension_packet.toPacket());
+        QCOMPARE(packet_socket.write(0, bt::Now()), test_extension_packet.size());
+        QVERIFY(!packet_socket.bytesReadyToWrite());
+
+        const bt::Uint32 total_size = 2 * test_extension_packet.size() + batch_size;
+        std::vector<bt::Uint8> read_buffer(total_size);
+        QCOMPARE(socket_pair->reader->recv(read_buffer.data(), read_buffer.size()), total_size);
+        decryptor.decrypt(read_buffer.data(), total_size);
+
+        bt::Uint32 off = 0;
+        QVERIFY(test_extension_packet.verifyBuffer(QByteArrayView(read_buffer.data() + off, test_extension_packet.size())));
+        off += test_extension_packet.size();
+        for (const RequestPacket &r : requests) {
+            QVERIFY(r.verifyBuffer(QByteArrayView(read_buffer.data() + off, r.size())));
+            off += r.size();
+        }
+        QVERIFY(test_extension_packet.verifyBuffer(QByteArrayView(read_buffer.data() + off, test_extension_packet.size())));
+    }
+
 private:
     DummyTorrentCreator m_creator;
     bt::Torrent m_tor;
@@ -0,0 +1,159 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <deque>
+#include <utility>
+
+#include <QObject>
+#include <QTest>
+
+#include <net/speed.h>
+#include <util/constants.h>
+
+using namespace bt;
+
+/*
+    The deque based meter which net::Speed used to be, kept here
+    to compare the cost of onData and update in the benchmarks.
+*/
+class DequeSpeed
+{
+public:
+    void onData(Uint32 b, TimeStamp ts)
+    {
+        dlrate.push_back(std::make_pair(b, ts));
+        bytes += b;
+    }
+
+    void update(TimeStamp now)
+    {
+        while (!dlrate.empty()) {
+            const auto &p = dlrate.front();
+            if (now - p.second > net::Speed::INTERVAL || now < p.second) {
+                bytes = bytes >= p.first ? bytes - p.first : 0;
+                dlrate.pop_front();
+            } else {
+                break;
+            }
+        }
+        rate = bytes / (net::Speed::INTERVAL / 1000);
+    }
+
+    int rate = 0;
+    Uint32 bytes = 0;
+    std::deque<std::pair<Uint32, TimeStamp>> dlrate;
+};
+
+class SpeedTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testRate()
+    {
+        net::Speed s;
+        QCOMPARE(s.getRate(), 0);
+
+        TimeStamp now = 100000;
+        for (int i = 0; i < 50; i++) {
+            s.onData(1000, now);
+            now += 100;
+            s.update(now);
+        }
+
+        // 50 kB over the last 5 seconds
+        QCOMPARE(s.getRate(), 10000);
+    }
+
+    void testExpire()
+    {
+        net::Speed s;
+        TimeStamp now = 100000;
+        s.onData(5000, now);
+        s.update(now);
+        QCOMPARE(s.getRate(), 1000);
+
+        s.update(now + net::Speed::INTERVAL - net::Speed::BUCKET_DURATION);
+        QCOMPARE(s.getRate(), 1000);
+
+        s.update(now + net::Speed::INTERVAL);
+        QCOMPARE(s.getRate(), 0);
+
+        // long idle periods must not take longer to expire
+        s.onData(5000, now + 10 * net::Speed::INTERVAL);
+        s.update(now + 1000 * net::Speed::INTERVAL);
+        QCOMPARE(s.getRate(), 0);
+    }
+
+    void testClockGoingBackwards()
+    {
+        net::Speed s;
+        const TimeStamp now = 100000;
+        s.onData(5000, now);
+        s.update(now);
+        QCOMPARE(s.getRate(), 1000);
+
+        s.update(now - net::Speed::INTERVAL);
+        QCOMPARE(s.getRate(), 0);
+
+        s.onData(5000, now - net::Speed::INTERVAL);
+        s.update(now - net::Speed::INTERVAL);
+        QCOMPARE(s.getRate(), 1000);
+    }
+
+    void testSameRateAsDeque()
+    {
+        net::Speed s;
+        DequeSpeed d;
+        TimeStamp now = 100000;
+        for (int i = 0; i < 10000; i++) {
+            const Uint32 b = 1 + (i * 7919) % 16384;
+            s.onData(b, now);
+            d.onData(b, now);
+            now += 1 + (i % 13);
+            if (i % 100 == 0) {
+                s.update(now);
+                d.update(now);
+                // the ring has bucket granularity, so it can miss at most the oldest bucket
+                QVERIFY(s.getRate() <= d.rate);
+                QVERIFY(d.rate - s.getRate() <= 2 * d.rate / int(net::Speed::NUM_BUCKETS) + 16384);
+            }
+        }
+    }
+
+    void benchmarkSpeed()
+    {
+        net::Speed s;
+        TimeStamp now = 100000;
+        QBENCHMARK {
+            for (int i = 0; i < 100000; i++) {
+                s.onData(1024, now + i / 10);
+                if (i % 1000 == 0) {
+                    s.update(now + i / 10);
+                }
+            }
+            now += 10000;
+        }
+    }
+
+    void benchmarkDequeSpeed()
+    {
+        DequeSpeed d;
+        TimeStamp now = 100000;
+        QBENCHMARK {
+            for (int i = 0; i < 100000; i++) {
+                d.onData(1024, now + i / 10);
+                if (i % 1000 == 0) {
+                    d.update(now + i / 10);
+                }
+            }
+            now += 10000;
+        }
+    }
+};
+
+QTEST_MAIN(SpeedTest)
+
+#include "speedtest.moc"
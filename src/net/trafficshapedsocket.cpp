@@ -93,7 +93,8 @@ void TrafficShapedSocket::updateSpeeds(bt::TimeStamp now)
     mutex.unlock();
 }
 
-static bt::Uint8 input_buffer[OUTPUT_BUFFER_SIZE];
+// one per thread, so sockets can be read from multiple network threads
+static thread_local bt::Uint8 input_buffer[OUTPUT_BUFFER_SIZE];
 
 Uint32 TrafficShapedSocket::read(bt::Uint32 max_bytes_to_read, bt::TimeStamp now)
 {
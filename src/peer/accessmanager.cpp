@@ -9,12 +9,14 @@
 #include <interfaces/blocklistinterface.h>
 #include <net/address.h>
 #include <peer/badpeerslist.h>
+#include <peer/ipfilter.h>
 #include <torrent/server.h>
 #include <tracker/tracker.h>
 
 namespace bt
 {
 AccessManager::AccessManager()
+    : filter(std::make_shared<IPFilter>())
 {
     banned = new BadPeersList();
     addBlockList(banned);
@@ -34,11 +36,29 @@ AccessManager &AccessManager::instance()
 void AccessManager::addBlockList(BlockListInterface *bl)
 {
     blocklists.append(bl);
+    blockListChanged();
 }
 
 void AccessManager::removeBlockList(BlockListInterface *bl)
 {
     blocklists.removeAll(bl);
+    blockListChanged();
+}
+
+void AccessManager::blockListChanged()
+{
+    IPFilter::Builder builder;
+    QList<const BlockListInterface *> ul;
+    for (const BlockListInterface *bl : std::as_const(blocklists)) {
+        if (!bl->compile(builder)) {
+            ul.append(bl);
+        }
+    }
+
+    auto f = std::make_shared<const IPFilter>(builder.build());
+    const QMutexLocker lock(&mutex);
+    filter = std::move(f);
+    uncompiled = std::move(ul);
 }
 
 bool AccessManager::allowed(const net::Address &addr) const
@@ -48,7 +68,20 @@ bool AccessManager::allowed(const net::Address &addr) const
         return false;
     }
 
-    for (const BlockListInterface *bl : std::as_const(blocklists)) {
+    // take a copy, so the lookups do not block a rebuild of the filter
+    std::shared_ptr<const IPFilter> f;
+    QList<const BlockListInterface *> ul;
+    {
+        const QMutexLocker lock(&mutex);
+        f = filter;
+        ul = uncompiled;
+    }
+
+    if (f->contains(addr)) {
+        return false;
+    }
+
+    for (const BlockListInterface *bl : std::as_const(ul)) {
         if (bl->blocked(addr)) {
             return false;
         }
@@ -58,29 +91,70 @@ bool AccessManager::allowed(const net::Address &addr) const
 
 void AccessManager::banPeer(const QString &addr)
 {
-    banned->addBadPeer(addr);
+    banPeers({addr});
+}
+
+void AccessManager::banPeers(const QStringList &addrs)
+{
+    // the filter is only replaced on this thread, so it can be copied without holding the lock
+    std::shared_ptr<const IPFilter> f;
+    {
+        const QMutexLocker lock(&mutex);
+        f = filter;
+    }
+
+    QList<QHostAddress> to_add;
+    for (const QString &addr : addrs) {
+        banned->addBadPeer(addr);
+        const QHostAddress address(addr);
+        if (!address.isNull() && !f->contains(address)) {
+            to_add.append(address);
+        }
+    }
+
+    if (to_add.isEmpty()) {
+        return;
+    }
+
+    f = std::make_shared<const IPFilter>(f->withAddresses(to_add));
+    const QMutexLocker lock(&mutex);
+    filter = std::move(f);
+}
+
+bool AccessManager::isBanned(const net::Address &addr) const
+{
+    return banned->blocked(addr);
 }
 
 void AccessManager::addExternalIP(const QString &addr)
 {
-    external_addresses.append(addr);
+    const QHostAddress address(addr);
+    const QMutexLocker lock(&mutex);
+    if (!address.isNull() && !external_addresses.contains(address)) {
+        external_addresses.append(address);
+    }
 }
 
 bool AccessManager::isOurOwnAddress(const net::Address &addr) const
 {
-    const Uint16 port = bt::Server::getPort();
-    if (!Tracker::getCustomIP().isEmpty() && net::Address(Tracker::getCustomIP(), port) == addr) {
-        return true;
+    if (addr.port() != bt::Server::getPort()) {
+        return false;
     }
 
-    for (const QString &ip : std::as_const(external_addresses)) {
-        const net::Address address(ip, port);
-        if (address == addr) {
-            return true;
-        }
+    // the custom IP only needs to be parsed again when it changes
+    const QString ip = Tracker::getCustomIP();
+    const QMutexLocker lock(&mutex);
+    if (ip != custom_ip) {
+        custom_ip = ip;
+        custom_ip_address = QHostAddress(ip);
+    }
+
+    const QHostAddress &host = addr;
+    if (!custom_ip_address.isNull() && custom_ip_address == host) {
+        return true;
     }
 
-    return false;
+    return external_addresses.contains(host);
 }
 
 }
@@ -7,14 +7,18 @@
 #ifndef BTACCESSMANAGER_H
 #define BTACCESSMANAGER_H
 
+#include <QList>
+#include <QMutex>
 #include <QStringList>
 #include <ktorrent_export.h>
+#include <memory>
 #include <net/address.h>
 
 namespace bt
 {
 class BlockListInterface;
 class BadPeersList;
+class IPFilter;
 
 /*!
     \headerfile peer/accessmanager.h
@@ -24,6 +28,13 @@ class BadPeersList;
 
     It uses blocklists to do this. Blocklists should register with this class.
     By default it has one blocklist, the banned peers list.
+
+    The blocklists which can be expressed as ranges are compiled into one IPFilter.
+    The filter is rebuilt and swapped in whenever a blocklist changes. Banned peers
+    are added to the current filter without compiling the blocklists again.
+
+    The blocklists are managed on the main thread, but allowed() may be called from
+    other threads, so everything it uses is protected by the mutex.
 */
 class KTORRENT_EXPORT AccessManager
 {
@@ -38,15 +49,24 @@ public:
     //! Add a blocklist (AccessManager takes ownership unless list is explicitly remove with removeBlockList)
     void addBlockList(BlockListInterface *bl);
 
-    //! Remove a blocklist
+    //! Remove a blocklist (but does not delete it)
     void removeBlockList(BlockListInterface *bl);
 
+    //! A blocklist has changed, rebuild the filter
+    void blockListChanged();
+
     //! Are we allowed to have a connection with a peer
     [[nodiscard]] bool allowed(const net::Address &addr) const;
 
     //! Ban a peer (i.e. add it to the banned list)
     void banPeer(const QString &addr);
 
+    //! Ban several peers at once, the filter is only replaced once
+    void banPeers(const QStringList &addrs);
+
+    //! Is a peer on the banned list
+    [[nodiscard]] bool isBanned(const net::Address &addr) const;
+
     //! Add an external IP throuch which we are reacheable
     void addExternalIP(const QString &addr);
 
@@ -56,7 +76,14 @@ private:
 private:
     QList<BlockListInterface *> blocklists;
     BadPeersList *banned;
-    QStringList external_addresses;
+    // protects all members below
+    mutable QMutex mutex;
+    // the blocklists which could not be compiled into the filter
+    QList<const BlockListInterface *> uncompiled;
+    QList<QHostAddress> external_addresses;
+    mutable QString custom_ip;
+    mutable QHostAddress custom_ip_address;
+    std::shared_ptr<const IPFilter> filter;
 };
 
 }
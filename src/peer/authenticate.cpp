@@ -33,8 +33,8 @@ Authenticate::Authenticate(const net::Address &addr, TransportProtocol proto, co
         case net::Socks::State::FAILED:
             Out(SYS_CON | LOG_NOTICE) << "Failed to connect to " << addr.toString() << " via socks server " << endl;
             // Don't call onFinish here, will lead to problems
-            // Instead change the interval of timeout timer, to force a failure
-            timer.setInterval(1);
+            // Instead drop the deadline, so the monitor fails it on the next update
+            handshake_timeout = 0;
             break;
         case net::Socks::State::CONNECTED:
             socks.reset();
@@ -50,8 +50,8 @@ Authenticate::Authenticate(const net::Address &addr, TransportProtocol proto, co
             // do nothing the monitor will notify us when we are connected
         } else {
             // Don't call onFinish here, will lead to problems
-            // Instead change the interval of timeout timer, to force a failure
-            timer.setInterval(1);
+            // Instead drop the deadline, so the monitor fails it on the next update
+            handshake_timeout = 0;
         }
     }
 }
@@ -130,7 +130,6 @@ void Authenticate::onFinish(bool success)
         sock.reset();
     }
 
-    timer.stop();
     const PeerConnector::Ptr pc = pcon.toStrongRef();
     if (pc) {
         pc->authenticationFinished(this, success);
@@ -44,12 +44,6 @@ public:
         return peer_id;
     }
 
-    //! See if the authentication is successful
-    [[nodiscard]] bool isSuccessful() const
-    {
-        return success;
-    }
-
 public Q_SLOTS:
     //! Stop the authentication
     void stop();
@@ -67,7 +61,6 @@ protected:
     SHA1Hash info_hash;
     PeerID our_peer_id, peer_id;
     net::Address addr;
-    bool success;
     PeerConnector::WPtr pcon;
     std::unique_ptr<net::Socks> socks;
 };
@@ -18,11 +18,10 @@ namespace bt
 {
 AuthenticateBase::AuthenticateBase()
     : finished(false)
+    , success(false)
+    , handshake_timeout(5000)
     , local(false)
 {
-    connect(&timer, &QTimer::timeout, this, &AuthenticateBase::onTimeout);
-    timer.setSingleShot(true);
-    timer.start(5000);
     memset(handshake, 0x00, 68);
     bytes_of_handshake_received = 0;
     ext_support = 0;
@@ -31,11 +30,10 @@ AuthenticateBase::AuthenticateBase()
 AuthenticateBase::AuthenticateBase(std::unique_ptr<mse::EncryptedPacketSocket> s)
     : sock(std::move(s))
     , finished(false)
+    , success(false)
+    , handshake_timeout(5000)
     , local(false)
 {
-    connect(&timer, &QTimer::timeout, this, &AuthenticateBase::onTimeout);
-    timer.setSingleShot(true);
-    timer.start(5000);
     memset(handshake, 0x00, 68);
     bytes_of_handshake_received = 0;
     ext_support = 0;
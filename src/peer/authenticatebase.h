@@ -7,7 +7,7 @@
 #define BTAUTHENTICATEBASE_H
 
 #include <QObject>
-#include <QTimer>
+#include <ktorrent_export.h>
 #include <mse/encryptedpacketsocket.h>
 #include <util/constants.h>
 
@@ -25,9 +25,10 @@ class PeerID;
  * \brief Base class for carrying out the handshake when connecting to a Peer.
  *
  * This class just groups some common stuff between Authenticate and ServerAuthenticate.
- * It has a socket, handles the timing out, provides a function to send the handshake.
+ * It has a socket, provides a function to send the handshake and knows how long the
+ * handshake may take. The AuthenticationMonitor enforces that deadline.
  */
-class AuthenticateBase : public QObject
+class KTORRENT_EXPORT AuthenticateBase : public QObject
 {
     Q_OBJECT
 public:
@@ -53,6 +54,18 @@ public:
         return finished;
     }
 
+    //! See if the authentication is successful
+    [[nodiscard]] bool isSuccessful() const
+    {
+        return success;
+    }
+
+    //! Get the time in milliseconds the handshake may take
+    [[nodiscard]] Uint32 handshakeTimeout() const
+    {
+        return handshake_timeout;
+    }
+
     //! Flags indicating which extensions are supported
     [[nodiscard]] Uint32 supportedExtensions() const
     {
@@ -77,6 +90,9 @@ public:
     //! We can write to the socket (used to detect a successful connection)
     virtual void onReadyWrite();
 
+    //! The handshake took too long, called by the AuthenticationMonitor
+    void onTimeout();
+
 protected:
     /*!
      * Send a handshake
@@ -105,13 +121,13 @@ protected:
     void makeHandshake(bt::Uint8 *buf, const SHA1Hash &info_hash, const PeerID &our_peer_id);
 
 protected Q_SLOTS:
-    void onTimeout();
     void onError(int err);
 
 protected:
     std::unique_ptr<mse::EncryptedPacketSocket> sock;
-    QTimer timer;
     bool finished;
+    bool success;
+    Uint32 handshake_timeout;
     Uint8 handshake[68];
     Uint32 bytes_of_handshake_received;
     Uint32 ext_support;
@@ -6,16 +6,433 @@
 #include "authenticationmonitor.h"
 #include "authenticatebase.h"
 #include "peerconnector.h"
-#include <cmath>
+#include <QSocketNotifier>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
 #include <mse/encryptedpacketsocket.h>
 #include <util/functions.h>
 #include <util/log.h>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
 
 namespace bt
 {
+static const Uint32 WHEEL_SLOTS = 64;
+static const TimeStamp WHEEL_TICK = 100;
+static const int MAX_EVENTS = 64;
+
+class AuthenticationMonitor::Private
+{
+public:
+    struct Entry {
+        AuthenticateBase *auth = nullptr;
+        TimeStamp started = 0;
+        TimeStamp deadline = 0;
+        //! The file descriptor registered in the epoll set, -1 if the socket is polled in update
+        int fd = -1;
+        net::Poll::Mode mode = net::Poll::Mode::INPUT;
+        //! Registrations are one shot, so they are disarmed after every event
+        bool armed = false;
+        bool rejected = false;
+        bool timed_out = false;
+    };
+
+    Private(AuthenticationMonitor *p)
+        : p(p)
+    {
+    }
+
+    ~Private()
+    {
+        closeEpoll();
+    }
+
+    static net::SocketDevice *device(AuthenticateBase *ab)
+    {
+        mse::EncryptedPacketSocket *socket = ab->getSocket();
+        return socket ? socket->socketDevice() : nullptr;
+    }
+
+    static net::Poll::Mode mode(AuthenticateBase *ab)
+    {
+        return ab->getSocket()->connecting() ? net::Poll::Mode::OUTPUT : net::Poll::Mode::INPUT;
+    }
+
+    void add(AuthenticateBase *s)
+    {
+        if (ids.count(s)) {
+            return;
+        }
+
+        const TimeStamp now = Now();
+        if (entries.empty()) {
+            last_tick = now / WHEEL_TICK;
+        }
+
+        const Uint64 id = next_id++;
+        Entry &e = entries[id];
+        e.auth = s;
+        e.started = now;
+        ids[s] = id;
+        if (entries.size() > max_pending) {
+            // fail it on the next update, calling onFinish from here would surprise the caller
+            e.rejected = true;
+            e.deadline = now;
+            overdue.push_back(id);
+            return;
+        }
+
+        e.deadline = now + s->handshakeTimeout();
+        schedule(id, e.deadline, now);
+        watch(id, e);
+    }
+
+    void remove(AuthenticateBase *s)
+    {
+        const auto i = ids.find(s);
+        if (i == ids.end()) {
+            return;
+        }
+
+        const auto itr = entries.find(i->second);
+        unwatch(itr->first, itr->second);
+        entries.erase(itr);
+        ids.erase(i);
+    }
+
+    void clear()
+    {
+        for (auto &[id, e] : entries) {
+            e.auth->deleteLater();
+        }
+        entries.clear();
+        ids.clear();
+        for (std::vector<Uint64> &slot : wheel) {
+            slot.clear();
+        }
+        overdue.clear();
+        closeEpoll();
+    }
+
+    void schedule(Uint64 id, TimeStamp deadline, TimeStamp now)
+    {
+        if (deadline <= now) {
+            overdue.push_back(id);
+            return;
+        }
+
+        // deadlines further away than the wheel is long are moved again when their slot comes up
+        const TimeStamp tick = std::max(deadline / WHEEL_TICK, last_tick + 1);
+        wheel[tick % WHEEL_SLOTS].push_back(id);
+    }
+
+    void advance(TimeStamp now)
+    {
+        std::vector<Uint64> due;
+        due.swap(overdue);
+
+        const TimeStamp now_tick = now / WHEEL_TICK;
+        if (now_tick > last_tick) {
+            const TimeStamp steps = std::min<TimeStamp>(now_tick - last_tick, WHEEL_SLOTS);
+            for (TimeStamp i = 1; i <= steps; i++) {
+                std::vector<Uint64> &slot = wheel[(last_tick + i) % WHEEL_SLOTS];
+                due.insert(due.end(), slot.begin(), slot.end());
+                slot.clear();
+            }
+            last_tick = now_tick;
+        }
+
+        for (Uint64 id : due) {
+            const auto itr = entries.find(id);
+            if (itr == entries.end() || itr->second.auth->isFinished()) {
+                continue;
+            }
+
+            Entry &e = itr->second;
+            if (e.rejected) {
+                Out(SYS_CON | LOG_DEBUG) << "Too many pending handshakes, dropping one" << endl;
+                e.auth->onTimeout();
+            } else if (e.deadline <= now) {
+                e.timed_out = true;
+                e.auth->onTimeout();
+            } else {
+                schedule(id, e.deadline, now);
+            }
+        }
+    }
+
+    void update()
+    {
+        const TimeStamp now = Now();
+        p->reset();
+
+        bool polling = false;
+        for (auto &[id, e] : entries) {
+            AuthenticateBase *ab = e.auth;
+            net::SocketDevice *dev = ab->isFinished() ? nullptr : device(ab);
+            if (!dev) {
+                continue;
+            }
+
+            if (e.fd >= 0) {
+                // left disarmed because the last event did not make progress
+                if (!e.armed) {
+                    rearm(id, e);
+                }
+            } else {
+                dev->prepare(p, mode(ab));
+                polling = true;
+            }
+        }
+
+        // only uTP sockets and platforms without epoll end up here, so there is no need to wait
+        if (polling && p->poll(0) > 0) {
+            handlePolled();
+        }
+
+        advance(now);
+        collect();
+    }
+
+    void handlePolled()
+    {
+        std::vector<Uint64> polled;
+        for (const auto &[id, e] : entries) {
+            if (e.fd < 0) {
+                polled.push_back(id);
+            }
+        }
+
+        for (Uint64 id : polled) {
+            const auto itr = entries.find(id);
+            if (itr == entries.end() || itr->second.auth->isFinished()) {
+                continue;
+            }
+
+            AuthenticateBase *ab = itr->second.auth;
+            const net::SocketDevice *dev = device(ab);
+            const bool r = dev && dev->ready(p, net::Poll::Mode::INPUT);
+            const bool w = dev && dev->ready(p, net::Poll::Mode::OUTPUT);
+            if (r) {
+                ab->onReadyRead();
+            }
+            if (w && !ab->isFinished()) {
+                ab->onReadyWrite();
+            }
+        }
+    }
+
+    void collect()
+    {
+        auto itr = entries.begin();
+        while (itr != entries.end()) {
+            Entry &e = itr->second;
+            if (!e.auth->isFinished()) {
+                ++itr;
+                continue;
+            }
+
+            finished(e);
+            unwatch(itr->first, e);
+            ids.erase(e.auth);
+            e.auth->deleteLater();
+            itr = entries.erase(itr);
+        }
+    }
+
+    void finished(const Entry &e)
+    {
+        if (e.rejected) {
+            stats.rejected++;
+            return;
+        }
+
+        const TimeStamp latency = Now() - e.started;
+        Uint32 bucket = 0;
+        while (bucket < NUM_LATENCY_BUCKETS - 1 && latency >= Stats::bucketLimit(bucket)) {
+            bucket++;
+        }
+
+        if (e.auth->isSuccessful()) {
+            stats.succeeded++;
+            stats.success_latency[bucket]++;
+        } else {
+            stats.failed++;
+            stats.failure_latency[bucket]++;
+            if (e.timed_out) {
+                stats.timed_out++;
+            }
+        }
+    }
+
+#ifdef Q_OS_LINUX
+    bool openEpoll()
+    {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            Out(SYS_CON | LOG_NOTICE) << QStringLiteral("Failed to create epoll set for authentication : %1").arg(QString::fromUtf8(strerror(errno))) << endl;
+            return false;
+        }
+
+        notifier = std::make_unique<QSocketNotifier>(epoll_fd, QSocketNotifier::Read);
+        QObject::connect(notifier.get(), &QSocketNotifier::activated, notifier.get(), [this]() {
+            handleEvents();
+        });
+        return true;
+    }
+
+    bool arm(Uint64 id, Entry &e, int op)
+    {
+        epoll_event ev = {};
+        ev.events = (e.mode == net::Poll::Mode::OUTPUT ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+        ev.data.u64 = id;
+        e.armed = epoll_ctl(epoll_fd, op, e.fd, &ev) == 0;
+        return e.armed;
+    }
+
+    void watch(Uint64 id, Entry &e)
+    {
+        net::SocketDevice *dev = device(e.auth);
+        if (!dev || dev->transportProtocol() != TCP || dev->fd() < 0) {
+            return;
+        }
+
+        if (epoll_fd < 0 && !openEpoll()) {
+            return;
+        }
+
+        e.fd = dev->fd();
+        e.mode = mode(e.auth);
+        // EEXIST means the descriptor was reused while the old file is still open somewhere
+        if (!arm(id, e, EPOLL_CTL_ADD) && !(errno == EEXIST && arm(id, e, EPOLL_CTL_MOD))) {
+            e.fd = -1;
+            return;
+        }
+        epoll_owners[e.fd] = id;
+    }
+
+    void unwatch(Uint64 id, Entry &e)
+    {
+        if (e.fd < 0) {
+            return;
+        }
+
+        // the socket may already be closed and its descriptor reused by another handshake
+        const auto i = epoll_owners.find(e.fd);
+        if (i != epoll_owners.end() && i->second == id) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, e.fd, nullptr);
+            epoll_owners.erase(i);
+        }
+        e.fd = -1;
+        e.armed = false;
+    }
+
+    void rearm(Uint64 id, Entry &e)
+    {
+        const net::SocketDevice *dev = device(e.auth);
+        if (!dev || dev->fd() != e.fd) {
+            unwatch(id, e);
+            watch(id, e);
+            return;
+        }
+
+        e.mode = mode(e.auth);
+        if (!arm(id, e, EPOLL_CTL_MOD)) {
+            // fall back to polling in update
+            unwatch(id, e);
+        }
+    }
+
+    void handleEvents()
+    {
+        epoll_event events[MAX_EVENTS];
+        const int n = epoll_wait(epoll_fd, events, MAX_EVENTS, 0);
+        for (int i = 0; i < n; i++) {
+            const Uint64 id = events[i].data.u64;
+            auto itr = entries.find(id);
+            if (itr == entries.end() || itr->second.auth->isFinished()) {
+                continue;
+            }
+
+            AuthenticateBase *ab = itr->second.auth;
+            itr->second.armed = false;
+            net::SocketDevice *dev = device(ab);
+            if (!dev) {
+                continue;
+            }
+
+            bool progress = true;
+            if (itr->second.mode == net::Poll::Mode::OUTPUT) {
+                ab->onReadyWrite();
+            } else {
+                const Uint32 before = dev->bytesAvailable();
+                ab->onReadyRead();
+                // a partial handshake which is left in the socket would wake us up again right away
+                progress = ab->isFinished() || before == 0 || device(ab) != dev || dev->bytesAvailable() != before;
+            }
+
+            // callbacks can add handshakes, so look the entry up again
+            itr = entries.find(id);
+            if (itr != entries.end() && !ab->isFinished() && progress && itr->second.fd >= 0) {
+                rearm(id, itr->second);
+            }
+        }
+
+        collect();
+    }
+
+    void closeEpoll()
+    {
+        notifier.reset();
+        epoll_owners.clear();
+        if (epoll_fd >= 0) {
+            ::close(epoll_fd);
+            epoll_fd = -1;
+        }
+    }
+#else
+    void watch(Uint64, Entry &)
+    {
+    }
+
+    void unwatch(Uint64, Entry &)
+    {
+    }
+
+    void rearm(Uint64, Entry &)
+    {
+    }
+
+    void closeEpoll()
+    {
+    }
+#endif
+
+public:
+    AuthenticationMonitor *p;
+    std::map<Uint64, Entry> entries;
+    std::map<AuthenticateBase *, Uint64> ids;
+    Uint64 next_id = 0;
+    std::array<std::vector<Uint64>, WHEEL_SLOTS> wheel;
+    std::vector<Uint64> overdue;
+    TimeStamp last_tick = 0;
+    Uint32 max_pending = DEFAULT_MAX_PENDING;
+    Stats stats;
+    int epoll_fd = -1;
+    std::unique_ptr<QSocketNotifier> notifier;
+    std::map<int, Uint64> epoll_owners;
+};
+
 AuthenticationMonitor AuthenticationMonitor::self;
 
 AuthenticationMonitor::AuthenticationMonitor()
+    : d(std::make_unique<Private>(this))
 {
 }
 
@@ -25,13 +442,7 @@ AuthenticationMonitor::~AuthenticationMonitor()
 
 void AuthenticationMonitor::clear()
 {
-    std::list<AuthenticateBase *>::iterator itr = auths.begin();
-    while (itr != auths.end()) {
-        AuthenticateBase *ab = *itr;
-        ab->deleteLater();
-        ++itr;
-    }
-    auths.clear();
+    d->clear();
 }
 
 void AuthenticationMonitor::shutdown()
@@ -44,73 +455,46 @@ void AuthenticationMonitor::shutdown()
 void AuthenticationMonitor::add(AuthenticateBase *s)
 {
     if (s) {
-        auths.push_back(s);
+        d->add(s);
     }
 }
 
 void AuthenticationMonitor::remove(AuthenticateBase *s)
 {
     if (s) {
-        auths.remove(s);
+        d->remove(s);
     }
 }
 
 void AuthenticationMonitor::update()
 {
-    if (auths.size() == 0) {
+    if (d->entries.size() == 0) {
         return;
     }
 
-    reset();
+    d->update();
+}
 
-    std::list<AuthenticateBase *>::iterator itr = auths.begin();
-    while (itr != auths.end()) {
-        AuthenticateBase *ab = *itr;
-        if (ab->isFinished()) {
-            ab->deleteLater();
-            itr = auths.erase(itr);
-        } else {
-            mse::EncryptedPacketSocket *socket = ab->getSocket();
-            if (socket) {
-                net::SocketDevice *dev = socket->socketDevice();
-                if (dev) {
-                    const net::Poll::Mode m = socket->connecting() ? Poll::Mode::OUTPUT : Poll::Mode::INPUT;
-                    dev->prepare(this, m);
-                }
-            }
-            ++itr;
-        }
+bool AuthenticationMonitor::acceptIncoming()
+{
+    if (d->entries.size() < d->max_pending) {
+        return true;
     }
 
-    if (poll(50)) {
-        handleData();
-    }
+    d->stats.rejected++;
+    return false;
 }
 
-void AuthenticationMonitor::handleData()
+void AuthenticationMonitor::setMaxPending(Uint32 max)
 {
-    std::list<AuthenticateBase *>::iterator itr = auths.begin();
-    while (itr != auths.end()) {
-        AuthenticateBase *ab = *itr;
-        if (ab->isFinished()) {
-            ab->deleteLater();
-            itr = auths.erase(itr);
-        } else {
-            mse::EncryptedPacketSocket *socket = ab->getSocket();
-            if (socket) {
-                const net::SocketDevice *dev = socket->socketDevice();
-                const bool r = dev && dev->ready(this, Poll::Mode::INPUT);
-                const bool w = dev && dev->ready(this, Poll::Mode::OUTPUT);
-                if (r) {
-                    ab->onReadyRead();
-                }
-                if (w) {
-                    ab->onReadyWrite();
-                }
-            }
-            ++itr;
-        }
-    }
+    d->max_pending = max;
+}
+
+AuthenticationMonitor::Stats AuthenticationMonitor::stats() const
+{
+    Stats ret = d->stats;
+    ret.pending = d->entries.size();
+    return ret;
 }
 
 }
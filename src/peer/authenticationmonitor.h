@@ -6,10 +6,11 @@
 #ifndef BTAUTHENTICATIONMONITOR_H
 #define BTAUTHENTICATIONMONITOR_H
 
+#include <array>
 #include <ktorrent_export.h>
-#include <list>
+#include <memory>
 #include <net/poll.h>
-#include <vector>
+#include <util/constants.h>
 
 namespace bt
 {
@@ -20,11 +21,18 @@ class AuthenticateBase;
     \author Joris Guisson <joris.guisson@gmail.com>
 
     \brief Singleton that monitors ongoing authentication attempts.
+
+    On Linux the TCP sockets are registered in an epoll set when they are added,
+    and the epoll file descriptor is watched by the event loop, so handshake
+    data is handled as soon as it arrives. uTP sockets, and TCP sockets on other
+    platforms, are polled without blocking in update().
+
+    Every handshake has a deadline, which is kept in a timer wheel that is
+    advanced by update(). The number of pending handshakes is bounded, and
+    the time handshakes take is collected in histograms.
 */
 class KTORRENT_EXPORT AuthenticationMonitor : public net::Poll
 {
-    std::list<AuthenticateBase *> auths;
-
     static AuthenticationMonitor self;
 
     AuthenticationMonitor();
@@ -32,8 +40,36 @@ class KTORRENT_EXPORT AuthenticationMonitor : public net::Poll
 public:
     ~AuthenticationMonitor() override;
 
+    static constexpr Uint32 DEFAULT_MAX_PENDING = 500;
+    static constexpr Uint32 NUM_LATENCY_BUCKETS = 12;
+
+    //! Statistics of the handshakes
+    struct Stats {
+        Uint64 succeeded = 0;
+        Uint64 failed = 0;
+        //! Handshakes which failed because their deadline passed, also counted in failed
+        Uint64 timed_out = 0;
+        //! Handshakes which were refused because too many were pending
+        Uint64 rejected = 0;
+        Uint32 pending = 0;
+        //! Latency histogram of the successful handshakes, see bucketLimit
+        std::array<Uint64, NUM_LATENCY_BUCKETS> success_latency = {};
+        //! Latency histogram of the failed handshakes, see bucketLimit
+        std::array<Uint64, NUM_LATENCY_BUCKETS> failure_latency = {};
+
+        /*!
+            Get the upper limit of a histogram bucket in milliseconds. Bucket i
+            counts latencies below 10 * 2^i ms, the last one counts all others.
+        */
+        static Uint32 bucketLimit(Uint32 i)
+        {
+            return 10u << i;
+        }
+    };
+
     /*!
-     * Add a new AuthenticateBase object.
+     * Add a new AuthenticateBase object. If too many handshakes are pending,
+     * it will fail at the next update.
      * \param s
      */
     void add(AuthenticateBase *s);
@@ -45,7 +81,8 @@ public:
     void remove(AuthenticateBase *s);
 
     /*!
-     * Check all AuthenticateBase objects.
+     * Handle the sockets which cannot be watched by the event loop, and fail
+     * the handshakes whose deadline has passed. Also deletes the finished ones.
      */
     void update();
 
@@ -59,13 +96,23 @@ public:
      */
     void shutdown();
 
+    //! Check if there is room for an incoming connection, counts a rejection if there is not
+    [[nodiscard]] bool acceptIncoming();
+
+    //! Set the maximum number of pending handshakes
+    void setMaxPending(Uint32 max);
+
+    //! Get the statistics
+    [[nodiscard]] Stats stats() const;
+
     static AuthenticationMonitor &instance()
     {
         return self;
     }
 
 private:
-    void handleData();
+    class Private;
+    std::unique_ptr<Private> d;
 };
 
 }
@@ -22,6 +22,14 @@ bool BadPeersList::blocked(const net::Address &addr) const
     return bad_peers.contains(addr.toString());
 }
 
+bool BadPeersList::compile(IPFilter::Builder &builder) const
+{
+    for (const QString &ip : std::as_const(bad_peers)) {
+        builder.addAddress(QHostAddress(ip));
+    }
+    return true;
+}
+
 void BadPeersList::addBadPeer(const QString &ip)
 {
     bad_peers << ip;
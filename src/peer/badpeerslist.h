@@ -23,6 +23,7 @@ public:
     ~BadPeersList() override;
 
     [[nodiscard]] bool blocked(const net::Address &addr) const override;
+    bool compile(IPFilter::Builder &builder) const override;
 
     //! Add a bad peer to the list
     void addBadPeer(const QString &ip);
@@ -0,0 +1,218 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "connectadmission.h"
+
+#include <algorithm>
+#include <cmath>
+#include <util/functions.h>
+#include <vector>
+
+namespace bt
+{
+ConnectAdmission::ConnectAdmission(Uint32 max_half_open, Uint32 max_connects_per_sec)
+    : max_half_open(max_half_open)
+    , max_connects_per_sec(max_connects_per_sec)
+    , tokens(std::max<Uint32>(max_connects_per_sec, 1))
+    , last_refill(Now())
+    , admitting(nullptr)
+    , updating(false)
+    , update_scheduled(false)
+{
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, &ConnectAdmission::update);
+}
+
+ConnectAdmission::~ConnectAdmission()
+{
+}
+
+ConnectAdmission &ConnectAdmission::instance()
+{
+    static ConnectAdmission ca(DEFAULT_MAX_HALF_OPEN, DEFAULT_MAX_CONNECTS_PER_SEC);
+    return ca;
+}
+
+void ConnectAdmission::setMaxHalfOpen(Uint32 max)
+{
+    max_half_open = max;
+    scheduleUpdate();
+}
+
+void ConnectAdmission::setMaxConnectsPerSecond(Uint32 max)
+{
+    refillTokens();
+    max_connects_per_sec = max;
+    tokens = std::min<double>(tokens, std::max<Uint32>(max, 1));
+    scheduleUpdate();
+}
+
+void ConnectAdmission::request(Client *c)
+{
+    if (c != admitting && std::find(waiting.begin(), waiting.end(), c) == waiting.end()) {
+        waiting.push_back(c);
+        statistics.waiting_clients = waiting.size();
+        scheduleUpdate();
+    }
+}
+
+void ConnectAdmission::remove(Client *c)
+{
+    waiting.remove(c);
+    if (admitting == c) {
+        admitting = nullptr;
+    }
+    statistics.waiting_clients = waiting.size();
+}
+
+std::unique_ptr<ConnectAdmission::Slot> ConnectAdmission::takeSlot(const net::Address &addr)
+{
+    statistics.attempts++;
+    statistics.half_open++;
+    tokens -= 1.0;
+    return std::make_unique<Slot>(*this, addr);
+}
+
+double ConnectAdmission::expectedValue(const net::Address &addr) const
+{
+    const auto i = history.find(addr);
+    if (i == history.end()) {
+        return 0.5;
+    }
+
+    const History &h = i->second;
+    const double success_chance = (h.succeeded + 1.0) / (h.succeeded + h.failed + 2.0);
+    return success_chance / (1.0 + h.latency / 1000.0);
+}
+
+ConnectAdmission::Stats ConnectAdmission::stats() const
+{
+    return statistics;
+}
+
+void ConnectAdmission::slotFinished(const net::Address &addr, bool ok, TimeStamp latency)
+{
+    if (history.size() >= MAX_HISTORY && history.find(addr) == history.end()) {
+        // forget the older half of the addresses
+        std::vector<TimeStamp> times;
+        times.reserve(history.size());
+        for (const auto &[a, h] : history) {
+            times.push_back(h.last_attempt);
+        }
+        std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+        const TimeStamp median = times[times.size() / 2];
+        std::erase_if(history, [median](const auto &entry) {
+            return entry.second.last_attempt <= median;
+        });
+    }
+
+    History &h = history[addr];
+    h.last_attempt = CurrentTime();
+    if (ok) {
+        h.succeeded++;
+        h.latency = h.succeeded == 1 ? latency : (3 * h.latency + latency) / 4;
+        statistics.succeeded++;
+        statistics.total_latency += latency;
+    } else {
+        h.failed++;
+        statistics.failed++;
+    }
+}
+
+void ConnectAdmission::slotReleased(bool finished)
+{
+    statistics.half_open--;
+    if (!finished) {
+        statistics.aborted++;
+    }
+    // slots are often released from deep inside the client, so don't call back into it right away
+    scheduleUpdate();
+}
+
+void ConnectAdmission::scheduleUpdate()
+{
+    if (update_scheduled) {
+        return;
+    }
+
+    update_scheduled = true;
+    QTimer::singleShot(0, this, [this]() {
+        update_scheduled = false;
+        update();
+    });
+}
+
+void ConnectAdmission::refillTokens()
+{
+    const TimeStamp now = Now();
+    const double capacity = std::max<Uint32>(max_connects_per_sec, 1);
+    tokens = std::min(capacity, tokens + (now - last_refill) * max_connects_per_sec / 1000.0);
+    last_refill = now;
+}
+
+void ConnectAdmission::update()
+{
+    if (updating) {
+        return;
+    }
+
+    updating = true;
+    refillTokens();
+    while (!waiting.empty() && statistics.half_open < max_half_open && (max_connects_per_sec == 0 || tokens >= 1.0)) {
+        // round robin, the client goes to the back of the queue after every connection it starts
+        admitting = waiting.front();
+        waiting.pop_front();
+        const Uint64 attempts = statistics.attempts;
+        const bool more = admitting->connectAdmitted();
+        // the client may have removed itself in the mean time
+        if (admitting && more && statistics.attempts > attempts) {
+            waiting.push_back(admitting);
+        }
+        admitting = nullptr;
+    }
+    statistics.waiting_clients = waiting.size();
+
+    if (max_connects_per_sec == 0) {
+        tokens = 1.0;
+    } else if (!waiting.empty() && statistics.half_open < max_half_open) {
+        // out of tokens, wait until the next one is available
+        timer.start(static_cast<int>(std::ceil((1.0 - tokens) * 1000.0 / max_connects_per_sec)));
+    }
+    updating = false;
+}
+
+ConnectAdmission::Slot::Slot(ConnectAdmission &ca, const net::Address &addr)
+    : ca(ca)
+    , addr(addr)
+    , started(Now())
+    , finished(false)
+{
+}
+
+ConnectAdmission::Slot::~Slot()
+{
+    ca.slotReleased(finished);
+}
+
+void ConnectAdmission::Slot::succeeded()
+{
+    if (!finished) {
+        finished = true;
+        ca.slotFinished(addr, true, Now() - started);
+    }
+}
+
+void ConnectAdmission::Slot::failed()
+{
+    if (!finished) {
+        finished = true;
+        ca.slotFinished(addr, false, Now() - started);
+    }
+}
+
+}
+
+#include "moc_connectadmission.cpp"
@@ -0,0 +1,174 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef BT_CONNECTADMISSION_H
+#define BT_CONNECTADMISSION_H
+
+#include <QObject>
+#include <QTimer>
+#include <ktorrent_export.h>
+#include <net/address.h>
+#include <util/constants.h>
+
+#include <list>
+#include <map>
+#include <memory>
+
+namespace bt
+{
+/*!
+    \headerfile peer/connectadmission.h
+    \brief Decides when outgoing peer connections may be started, for all torrents together.
+
+    Torrents which have peers to connect to register themselves as a Client.
+    Connections are handed out round robin over the clients, so every torrent
+    gets its fair share, and are paced with a token bucket, so a torrent which
+    just received a few hundred peers from a tracker does not cause a burst of
+    half open connections.
+
+    Every connection attempt holds a Slot until it is finished. The outcome
+    and the time it took are remembered per address, which is used to estimate
+    how worthwhile it is to connect to a peer again.
+*/
+class KTORRENT_EXPORT ConnectAdmission : public QObject
+{
+    Q_OBJECT
+public:
+    ConnectAdmission(Uint32 max_half_open, Uint32 max_connects_per_sec);
+    ~ConnectAdmission() override;
+
+    static const Uint32 DEFAULT_MAX_HALF_OPEN = 50;
+    static const Uint32 DEFAULT_MAX_CONNECTS_PER_SEC = 20;
+    static const Uint32 MAX_HISTORY = 10000;
+
+    //! Get the instance which is shared by all torrents
+    static ConnectAdmission &instance();
+
+    /*!
+        \headerfile peer/connectadmission.h
+        \brief Something which wants to open connections, typically the PeerManager of a torrent.
+    */
+    class KTORRENT_EXPORT Client
+    {
+    public:
+        virtual ~Client()
+        {
+        }
+
+        /*!
+            A connection may be started now. The client should pick its best
+            potential peer and take a Slot for it with ConnectAdmission::takeSlot.
+            \return false if it has nothing left to connect to, it will then no longer be asked
+        */
+        virtual bool connectAdmitted() = 0;
+    };
+
+    /*!
+        \headerfile peer/connectadmission.h
+        \brief A half open connection. The slot is given back when it is destroyed.
+    */
+    class KTORRENT_EXPORT Slot
+    {
+    public:
+        Slot(ConnectAdmission &ca, const net::Address &addr);
+        ~Slot();
+
+        //! Get the address which is being connected to
+        [[nodiscard]] const net::Address &address() const
+        {
+            return addr;
+        }
+
+        //! The connection has been established
+        void succeeded();
+
+        //! The connection could not be established
+        void failed();
+
+    private:
+        ConnectAdmission &ca;
+        net::Address addr;
+        TimeStamp started;
+        bool finished;
+    };
+
+    //! Statistics of all connection attempts
+    struct Stats {
+        Uint64 attempts = 0;
+        Uint64 succeeded = 0;
+        Uint64 failed = 0;
+        //! Attempts which were aborted before they finished, for example because the torrent was stopped
+        Uint64 aborted = 0;
+        //! Sum of the time it took the successful attempts to connect in milliseconds
+        Uint64 total_latency = 0;
+        Uint32 half_open = 0;
+        Uint32 waiting_clients = 0;
+
+        //! Get the average connect latency in milliseconds
+        [[nodiscard]] Uint32 averageLatency() const
+        {
+            return succeeded > 0 ? total_latency / succeeded : 0;
+        }
+    };
+
+    //! Set the maximum number of half open connections, 0 stops handing out slots
+    void setMaxHalfOpen(Uint32 max);
+
+    //! Set the maximum number of connections started per second, 0 means no limit
+    void setMaxConnectsPerSecond(Uint32 max);
+
+    //! A client has potential peers and wants to connect to them
+    void request(Client *c);
+
+    //! Remove a client, it will not be asked to connect anymore
+    void remove(Client *c);
+
+    //! Take a slot for a connection to addr, only to be called from Client::connectAdmitted
+    [[nodiscard]] std::unique_ptr<Slot> takeSlot(const net::Address &addr);
+
+    /*!
+        Estimate how worthwhile a connection attempt to addr is, based on
+        earlier attempts. This is the chance the attempt succeeds, divided
+        by the latency in seconds plus one. Unknown addresses get 0.5.
+    */
+    [[nodiscard]] double expectedValue(const net::Address &addr) const;
+
+    //! Get the statistics
+    [[nodiscard]] Stats stats() const;
+
+private:
+    void slotFinished(const net::Address &addr, bool ok, TimeStamp latency);
+    void slotReleased(bool finished);
+    void update();
+    void scheduleUpdate();
+    void refillTokens();
+
+private:
+    // what happened the previous times we connected to an address
+    struct History {
+        Uint32 succeeded = 0;
+        Uint32 failed = 0;
+        //! smoothed connect latency in milliseconds
+        Uint32 latency = 0;
+        TimeStamp last_attempt = 0;
+    };
+
+    Uint32 max_half_open;
+    Uint32 max_connects_per_sec;
+    std::list<Client *> waiting;
+    std::map<net::Address, History> history;
+    Stats statistics;
+    double tokens;
+    TimeStamp last_refill;
+    Client *admitting;
+    bool updating;
+    bool update_scheduled;
+    QTimer timer;
+};
+
+}
+
+#endif // BT_CONNECTADMISSION_H
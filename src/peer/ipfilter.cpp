@@ -0,0 +1,182 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "ipfilter.h"
+
+#include <algorithm>
+#include <limits>
+#include <util/functions.h>
+
+namespace bt
+{
+static IPFilter::IPv6 ToIPv6(const QHostAddress &addr)
+{
+    const Q_IPV6ADDR a = addr.toIPv6Address();
+    return {ReadUint64(a.c, 0), ReadUint64(a.c, 8)};
+}
+
+static IPFilter::IPv6 Next(const IPFilter::IPv6 &ip)
+{
+    return ip.low == std::numeric_limits<Uint64>::max() ? IPFilter::IPv6{ip.high + 1, 0} : IPFilter::IPv6{ip.high, ip.low + 1};
+}
+
+// Sort the ranges and merge the ones which overlap or touch
+template<class T, class NextFunc>
+static void Merge(std::vector<std::pair<T, T>> &ranges, std::vector<T> &first, std::vector<T> &last, T max, NextFunc next)
+{
+    std::sort(ranges.begin(), ranges.end());
+    first.clear();
+    last.clear();
+    for (const auto &r : ranges) {
+        if (!last.empty() && (last.back() == max || r.first <= next(last.back()))) {
+            last.back() = std::max(last.back(), r.second);
+        } else {
+            first.push_back(r.first);
+            last.push_back(r.second);
+        }
+    }
+    first.shrink_to_fit();
+    last.shrink_to_fit();
+}
+
+// Insert one address into sorted and merged ranges, joining the ranges it touches
+template<class T, class NextFunc>
+static void Insert(std::vector<T> &first, std::vector<T> &last, T ip, NextFunc next)
+{
+    // i is the first range which starts after ip
+    const size_t i = std::upper_bound(first.begin(), first.end(), ip) - first.begin();
+    const bool joins_next = i < first.size() && next(ip) == first[i];
+    if (i > 0 && ip <= last[i - 1]) {
+        return;
+    }
+
+    if (i > 0 && next(last[i - 1]) == ip) {
+        if (joins_next) {
+            last[i - 1] = last[i];
+            first.erase(first.begin() + i);
+            last.erase(last.begin() + i);
+        } else {
+            last[i - 1] = ip;
+        }
+    } else if (joins_next) {
+        first[i] = ip;
+    } else {
+        first.insert(first.begin() + i, ip);
+        last.insert(last.begin() + i, ip);
+    }
+}
+
+IPFilter::IPFilter()
+{
+}
+
+IPFilter::~IPFilter()
+{
+}
+
+bool IPFilter::contains(const QHostAddress &addr) const
+{
+    if (addr.protocol() == QAbstractSocket::IPv4Protocol) {
+        return containsIPv4(addr.toIPv4Address());
+    }
+
+    bool ok = false;
+    const Uint32 ip4 = addr.toIPv4Address(&ok);
+    if (ok && containsIPv4(ip4)) {
+        return true;
+    }
+    return containsIPv6(ToIPv6(addr));
+}
+
+IPFilter IPFilter::withAddresses(const QList<QHostAddress> &addrs) const
+{
+    IPFilter f(*this);
+    for (const QHostAddress &addr : addrs) {
+        if (addr.protocol() == QAbstractSocket::IPv4Protocol) {
+            Insert(f.v4_first, f.v4_last, addr.toIPv4Address(), [](Uint32 ip) {
+                return ip + 1;
+            });
+        } else if (addr.protocol() == QAbstractSocket::IPv6Protocol) {
+            Insert(f.v6_first, f.v6_last, ToIPv6(addr), Next);
+        }
+    }
+    return f;
+}
+
+bool IPFilter::containsIPv4(Uint32 ip) const
+{
+    Uint32 n = v4_first.size();
+    if (n == 0) {
+        return false;
+    }
+
+    // find the last range which starts at or before ip, without a branch in the loop
+    const Uint32 *base = v4_first.data();
+    while (n > 1) {
+        const Uint32 half = n / 2;
+        base = (base[half] <= ip) ? base + half : base;
+        n -= half;
+    }
+    return *base <= ip && ip <= v4_last[base - v4_first.data()];
+}
+
+bool IPFilter::containsIPv6(IPv6 ip) const
+{
+    const auto i = std::upper_bound(v6_first.begin(), v6_first.end(), ip);
+    if (i == v6_first.begin()) {
+        return false;
+    }
+    return ip <= v6_last[(i - v6_first.begin()) - 1];
+}
+
+IPFilter::Builder::Builder()
+{
+}
+
+IPFilter::Builder::~Builder()
+{
+}
+
+void IPFilter::Builder::addRange(const QHostAddress &first, const QHostAddress &last)
+{
+    if (first.protocol() != last.protocol()) {
+        return;
+    }
+
+    if (first.protocol() == QAbstractSocket::IPv4Protocol) {
+        addRange(first.toIPv4Address(), last.toIPv4Address());
+    } else if (first.protocol() == QAbstractSocket::IPv6Protocol) {
+        const IPv6 a = ToIPv6(first);
+        const IPv6 b = ToIPv6(last);
+        if (a <= b) {
+            v6.emplace_back(a, b);
+        }
+    }
+}
+
+void IPFilter::Builder::addAddress(const QHostAddress &addr)
+{
+    addRange(addr, addr);
+}
+
+void IPFilter::Builder::addRange(Uint32 first, Uint32 last)
+{
+    if (first <= last) {
+        v4.emplace_back(first, last);
+    }
+}
+
+IPFilter IPFilter::Builder::build()
+{
+    IPFilter f;
+    Merge(v4, f.v4_first, f.v4_last, std::numeric_limits<Uint32>::max(), [](Uint32 ip) {
+        return ip + 1;
+    });
+    Merge(v6, f.v6_first, f.v6_last, IPv6{std::numeric_limits<Uint64>::max(), std::numeric_limits<Uint64>::max()}, Next);
+    return f;
+}
+
+}
@@ -0,0 +1,97 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef BT_IPFILTER_H
+#define BT_IPFILTER_H
+
+#include <QHostAddress>
+#include <QList>
+#include <compare>
+#include <ktorrent_export.h>
+#include <util/constants.h>
+#include <vector>
+
+namespace bt
+{
+/*!
+    \headerfile peer/ipfilter.h
+    \brief Immutable set of blocked IPv4 and IPv6 ranges.
+
+    The ranges are sorted and merged when the filter is built, so looking up
+    an address is a binary search, no matter how many blocklists the ranges
+    came from. Use IPFilter::Builder to make one.
+*/
+class KTORRENT_EXPORT IPFilter
+{
+public:
+    IPFilter();
+    ~IPFilter();
+
+    //! An IPv6 address as a number
+    struct IPv6 {
+        Uint64 high = 0;
+        Uint64 low = 0;
+
+        auto operator<=>(const IPv6 &other) const = default;
+    };
+
+    //! Collects the ranges of an IPFilter
+    class KTORRENT_EXPORT Builder
+    {
+    public:
+        Builder();
+        ~Builder();
+
+        /*!
+            Add a range of addresses, both ends are included.
+            Both addresses must have the same protocol, otherwise the range is ignored.
+        */
+        void addRange(const QHostAddress &first, const QHostAddress &last);
+
+        //! Add a single address
+        void addAddress(const QHostAddress &addr);
+
+        //! Add a range of IPv4 addresses in host byte order, both ends are included
+        void addRange(Uint32 first, Uint32 last);
+
+        //! Sort and merge all ranges into a filter
+        [[nodiscard]] IPFilter build();
+
+    private:
+        std::vector<std::pair<Uint32, Uint32>> v4;
+        std::vector<std::pair<IPv6, IPv6>> v6;
+    };
+
+    //! Is the address in one of the ranges, IPv4 mapped IPv6 addresses are matched against the IPv4 ranges
+    [[nodiscard]] bool contains(const QHostAddress &addr) const;
+
+    /*!
+        Get a copy of the filter with some more addresses. They are inserted into the
+        sorted ranges directly, which is much cheaper than building the filter again.
+    */
+    [[nodiscard]] IPFilter withAddresses(const QList<QHostAddress> &addrs) const;
+
+    //! Get the number of disjoint ranges
+    [[nodiscard]] Uint32 numRanges() const
+    {
+        return v4_first.size() + v6_first.size();
+    }
+
+private:
+    [[nodiscard]] bool containsIPv4(Uint32 ip) const;
+    [[nodiscard]] bool containsIPv6(IPv6 ip) const;
+
+private:
+    // the first and last address of every range are kept apart, so the search only touches the first ones
+    std::vector<Uint32> v4_first;
+    std::vector<Uint32> v4_last;
+    std::vector<IPv6> v6_first;
+    std::vector<IPv6> v6_last;
+};
+
+}
+
+#endif // BT_IPFILTER_H
@@ -13,6 +13,13 @@
 
 namespace bt
 {
+static const Uint32 RING_SIZE = 8 * 1024;
+// packets larger than this are stored in their own IncomingPacket
+static const Uint32 MAX_INLINE_PACKET_SIZE = 1024;
+// length values which mark special entries in the ring
+static const Uint32 QUEUE_MARKER = 0xFFFFFFFF; // next packet is the front of the packet_queue
+static const Uint32 WRAP_MARKER = 0xFFFFFFFE; // rest of the ring is unused, continue at the start
+
 IncomingPacket::IncomingPacket(Uint32 size) noexcept
     : data(size)
 {
@@ -20,6 +27,18 @@ IncomingPacket::IncomingPacket(Uint32 size) noexcept
 
 PacketReader::PacketReader(Uint32 max_packet_size)
     : error(false)
+    , ring(RING_SIZE)
+    , ring_read(0)
+    , ring_used(0)
+    , ring_write(0)
+    , num_overflowed(0)
+    , target(Target::NONE)
+    , current(nullptr)
+    , current_size(0)
+    , current_read(0)
+    , entry_offset(0)
+    , entry_size(0)
+    , entry_padding(0)
     , len_received(-1)
     , max_packet_size(max_packet_size)
 {
@@ -29,34 +48,135 @@ PacketReader::~PacketReader()
 {
 }
 
-std::optional<IncomingPacket> PacketReader::dequeuePacket()
+void PacketReader::update(PeerInterface &peer)
 {
-    const QMutexLocker lock(&mutex);
-    if (packet_queue.empty()) {
-        return std::nullopt;
+    update(peer, nullptr);
+}
+
+void PacketReader::update(PeerInterface &peer, bool (*accept)(const Uint8 *packet, Uint32 size))
+{
+    if (error) {
+        return;
     }
 
-    IncomingPacket &pck = packet_queue.front();
-    if (pck.read != pck.data.size()) {
-        return std::nullopt;
+    // The network thread only appends to the ring and the packet_queue, and only reuses ring
+    // space after ring_read has moved past it, so packets can be handled with the mutex unlocked.
+    QMutexLocker lock(&mutex);
+    while (true) {
+        if (ring_used == 0) {
+            // everything in the ring has been handled, continue with overflowed packets
+            if (num_overflowed == 0 || packet_queue.empty()) {
+                break;
+            }
+
+            IncomingPacket &pck = packet_queue.front();
+            if (pck.read != pck.data.size() || (accept && !accept(pck.data.data(), pck.data.size()))) {
+                break;
+            }
+
+            const IncomingPacket p(std::move(pck));
+            packet_queue.pop_front();
+            num_overflowed--;
+            lock.unlock();
+            peer.handlePacket(p.data.data(), p.data.size());
+            lock.relock();
+            continue;
+        }
+
+        if (RING_SIZE - ring_read < 4 || ReadUint32(ring.data(), ring_read) == WRAP_MARKER) {
+            ring_used -= RING_SIZE - ring_read;
+            ring_read = 0;
+            continue;
+        }
+
+        if (ReadUint32(ring.data(), ring_read) == QUEUE_MARKER) {
+            IncomingPacket &pck = packet_queue.front();
+            if (accept && !accept(pck.data.data(), pck.data.size())) {
+                break;
+            }
+
+            const IncomingPacket p(std::move(pck));
+            packet_queue.pop_front();
+            ring_read = (ring_read + 4) % RING_SIZE;
+            ring_used -= 4;
+            lock.unlock();
+            peer.handlePacket(p.data.data(), p.data.size());
+            lock.relock();
+            continue;
+        }
+
+        // collect all packets stored back to back
+        Uint32 batch = 0;
+        Uint32 pos = ring_read;
+        while (batch < ring_used && RING_SIZE - pos >= 4) {
+            const Uint32 packet_length = ReadUint32(ring.data(), pos);
+            if (packet_length == QUEUE_MARKER || packet_length == WRAP_MARKER) {
+                break;
+            }
+
+            if (accept && !accept(ring.data() + pos + 4, packet_length)) {
+                break;
+            }
+
+            batch += 4 + packet_length;
+            pos += 4 + packet_length;
+        }
+
+        if (batch == 0) {
+            break;
+        }
+
+        lock.unlock();
+        peer.handlePackets(ring.data() + ring_read, batch);
+        lock.relock();
+        ring_read = (ring_read + batch) % RING_SIZE;
+        ring_used -= batch;
+    }
+}
+
+bool PacketReader::reserve(Uint32 size)
+{
+    if (ring_used == 0) {
+        // nothing queued, so start again at the beginning of the ring
+        ring_read = ring_write = 0;
+    } else if (ring_write == ring_read) {
+        return false;
     }
 
-    IncomingPacket p(std::move(pck));
-    packet_queue.pop_front();
-    return p;
+    if (ring_write >= ring_read) {
+        const Uint32 tail = RING_SIZE - ring_write;
+        if (size <= tail) {
+            entry_offset = ring_write;
+            entry_padding = 0;
+        } else if (size <= ring_read) {
+            entry_offset = 0;
+            entry_padding = tail;
+        } else {
+            return false;
+        }
+    } else if (size <= ring_read - ring_write) {
+        entry_offset = ring_write;
+        entry_padding = 0;
+    } else {
+        return false;
+    }
+
+    entry_size = size;
+    return true;
 }
 
-void PacketReader::update(PeerInterface &peer)
+void PacketReader::commit()
 {
-    if (error) {
+    if (entry_size == 0) { // overflowed packet, nothing in the ring
         return;
     }
 
-    std::optional<IncomingPacket> pck = dequeuePacket();
-    while (pck.has_value()) {
-        peer.handlePacket(pck->data.data(), pck->data.size());
-        pck = dequeuePacket();
+    if (entry_padding >= 4) {
+        WriteUint32(ring.data(), ring_write, WRAP_MARKER);
     }
+
+    ring_write = (entry_offset + entry_size) % RING_SIZE;
+    ring_used += entry_padding + entry_size;
 }
 
 Uint32 PacketReader::newPacket(Uint8 *buf, Uint32 size)
@@ -93,7 +213,35 @@ Uint32 PacketReader::newPacket(Uint8 *buf, Uint32 size)
         return size;
     }
 
-    packet_queue.emplace_back(IncomingPacket(packet_length));
+    target = Target::NONE;
+    if (num_overflowed == 0) {
+        if (packet_length <= MAX_INLINE_PACKET_SIZE) {
+            if (reserve(4 + packet_length)) {
+                WriteUint32(ring.data(), entry_offset, packet_length);
+                current = ring.data() + entry_offset + 4;
+                target = Target::RING;
+            }
+        } else if (reserve(4)) {
+            WriteUint32(ring.data(), entry_offset, QUEUE_MARKER);
+            packet_queue.emplace_back(packet_length);
+            current = packet_queue.back().data.data();
+            target = Target::QUEUE;
+        }
+    }
+
+    if (target == Target::NONE) {
+        // The ring is full, or older packets have overflowed already,
+        // queue it without a marker so the order is preserved.
+        entry_size = 0;
+        entry_padding = 0;
+        packet_queue.emplace_back(packet_length);
+        num_overflowed++;
+        current = packet_queue.back().data.data();
+        target = Target::QUEUE;
+    }
+
+    current_size = packet_length;
+    current_read = 0;
     return am_of_len_read + readPacket(buf + am_of_len_read, size - am_of_len_read);
 }
 
@@ -103,20 +251,20 @@ Uint32 PacketReader::readPacket(Uint8 *buf, Uint32 size)
         return 0;
     }
 
-    IncomingPacket &pck = packet_queue.back();
-    if (pck.read + size >= pck.data.size()) {
-        // we can read the full packet
-        const Uint32 tr = pck.data.size() - pck.read;
-        memcpy(pck.data.data() + pck.read, buf, tr);
-        pck.read += tr;
-        return tr;
-    } else {
-        // we can do a partial read
-        const Uint32 tr = size;
-        memcpy(pck.data.data() + pck.read, buf, tr);
-        pck.read += tr;
-        return tr;
+    const Uint32 tr = qMin(size, current_size - current_read);
+    memcpy(current + current_read, buf, tr);
+    current_read += tr;
+    if (target == Target::QUEUE) {
+        packet_queue.back().read = current_read;
+    }
+
+    if (current_read == current_size) {
+        commit();
+        target = Target::NONE;
+        current = nullptr;
     }
+
+    return tr;
 }
 
 void PacketReader::onDataReady(Uint8 *buf, Uint32 size)
@@ -127,11 +275,8 @@ void PacketReader::onDataReady(Uint8 *buf, Uint32 size)
 
     const QMutexLocker lock(&mutex);
     Uint32 ret = 0;
-    if (!packet_queue.empty()) {
-        const IncomingPacket &pck = packet_queue.back();
-        if (pck.read < pck.data.size()) { // last packet in queue is not fully read
-            ret = readPacket(buf, size);
-        }
+    if (target != Target::NONE) { // last packet is not fully read
+        ret = readPacket(buf, size);
     }
 
     while (ret < size && !error) {
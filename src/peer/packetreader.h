@@ -8,7 +8,6 @@
 
 #include <cstddef>
 #include <deque>
-#include <optional>
 
 #include <QMutex>
 
@@ -42,6 +41,12 @@ struct IncomingPacket {
  * \headerfile peer/packetreader.h
  * \author Joris Guisson
  * \brief Chops up the raw byte stream from a socket into bittorrent packets.
+ *
+ * Small packets are stored in place in a fixed ring buffer, each one prefixed
+ * by its length, so receiving control messages does not allocate any memory.
+ * They are handed to the Peer in contiguous batches.
+ * Large packets (PIECE, big extension messages), and packets which arrive
+ * while the ring is full, are stored in their own IncomingPacket.
  */
 class KTORRENT_EXPORT PacketReader : public net::SocketReader
 {
@@ -55,6 +60,15 @@ public:
      */
     void update(PeerInterface &peer);
 
+    /*!
+     * Push packets to Peer as long as \a accept returns true for them.
+     * The first packet which is not accepted and all the packets after it stay queued,
+     * so that they can be handled in order by a later update.
+     * \param peer The PeerInterface which will handle the packets
+     * \param accept Function which decides whether a packet can be handled now
+     */
+    void update(PeerInterface &peer, bool (*accept)(const Uint8 *packet, Uint32 size));
+
     //! Did an error occur
     [[nodiscard]] bool ok() const
     {
@@ -66,12 +80,38 @@ public:
 private:
     Uint32 newPacket(Uint8 *buf, Uint32 size);
     Uint32 readPacket(Uint8 *buf, Uint32 size);
-    std::optional<IncomingPacket> dequeuePacket();
+    bool reserve(Uint32 entry_size);
+    void commit();
 
 private:
+    enum class Target {
+        NONE,
+        RING,
+        QUEUE,
+    };
+
     bool error;
-    std::deque<IncomingPacket> packet_queue;
     QMutex mutex;
+
+    // complete packets in the ring: [ring_read, ring_read + ring_used), wrapping around
+    Array<Uint8> ring;
+    Uint32 ring_read;
+    Uint32 ring_used;
+    Uint32 ring_write;
+
+    // allocated packets, either referred to by a marker in the ring, or overflowed
+    std::deque<IncomingPacket> packet_queue;
+    Uint32 num_overflowed;
+
+    // the packet which is currently being received
+    Target target;
+    Uint8 *current;
+    Uint32 current_size;
+    Uint32 current_read;
+    Uint32 entry_offset;
+    Uint32 entry_size;
+    Uint32 entry_padding;
+
     Uint8 len[4];
     int len_received;
     Uint32 max_packet_size;
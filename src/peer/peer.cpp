@@ -112,8 +112,13 @@ void Peer::closeConnection()
 
 void Peer::kill()
 {
-    sock->close();
     killed = true;
+    // the ConnectionLimit is shared by all torrents, so leave that to the main thread
+    if (handling_control_packets) {
+        return;
+    }
+
+    sock->close();
     token.reset();
 }
 
@@ -558,6 +563,47 @@ void Peer::update()
     stats.num_down_requests = downloader->getNumRequests();
 }
 
+/*
+    Messages which only touch the state of the peer and its PeerManager.
+    PIECE, REJECT and CHOKE end up emitting signals to the Downloader,
+    PORT goes to the DHT and extension messages may create QObjects, so
+    those are left for the main thread.
+*/
+static bool IsControlPacket(const Uint8 *packet, Uint32 size)
+{
+    if (size == 0) {
+        return true;
+    }
+
+    switch (packet[0]) {
+    case UNCHOKE:
+    case INTERESTED:
+    case NOT_INTERESTED:
+    case HAVE:
+    case BITFIELD:
+    case REQUEST:
+    case CANCEL:
+    case HAVE_ALL:
+    case HAVE_NONE:
+    case SUGGEST_PIECE:
+    case ALLOWED_FAST:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void Peer::handleControlPackets()
+{
+    if (killed || !preader->ok()) {
+        return;
+    }
+
+    handling_control_packets = true;
+    preader->update(*this, IsControlPacket);
+    handling_control_packets = false;
+}
+
 bool Peer::isStalled() const
 {
     return stalled_timer.getElapsedSinceUpdate() >= 2 * 60 * 1000;
@@ -637,9 +683,9 @@ void Peer::emitPortPacket()
     pman->portPacketReceived(sock->getRemoteIPAddress(), sock->getRemotePort());
 }
 
-void Peer::emitPex(const QByteArray &data, int ip_version)
+void Peer::emitPex(const QByteArray &data, const QByteArray &flags, int ip_version)
 {
-    pman->pex(data, ip_version);
+    pman->pex(data, flags, ip_version);
 }
 
 void Peer::setPexEnabled(bool on)
@@ -101,6 +101,19 @@ public:
     //! Update the up- and down- speed and handle incoming packets
     void update();
 
+    /*!
+     * Handle the received protocol messages which do not need the main thread:
+     * interest, HAVE, BITFIELD, requests and cancels. Handling stops at the first
+     * message which does need it (for example PIECE), that one and the messages
+     * after it are handled by update().
+     *
+     * This can run on a worker thread, as long as no other thread touches
+     * the peer or the PeerManager of its torrent at the same time. A peer which
+     * sends an invalid message is only marked as killed here, its socket is closed
+     * and its connection released by the next kill() on the main thread.
+     */
+    void handleControlPackets();
+
     //! Pause the peer connection
     void pause();
 
@@ -182,8 +195,11 @@ public:
 
     /*!
      * Emit the pex signal
+     * \param data The compact peers
+     * \param flags The flags of the peers, one byte per peer, may be empty
+     * \param ip_version 4 or 6
      */
-    void emitPex(const QByteArray &data, int ip_version);
+    void emitPex(const QByteArray &data, const QByteArray &flags, int ip_version);
 
     //! Disable or enable pex
     void setPexEnabled(bool on);
@@ -354,6 +370,8 @@ private:
     PeerManager *pman;
     PtrMap<Uint32, PeerProtocolExtension> extensions;
     Uint32 ut_pex_id = 0;
+    //! Set while handleControlPackets runs, possibly on a worker thread
+    bool handling_control_packets = false;
 
     Uint64 bytes_downloaded_since_unchoke;
 
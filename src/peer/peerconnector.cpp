@@ -6,6 +6,7 @@
 
 #include "peerconnector.h"
 #include "authenticationmonitor.h"
+#include "peerdatabase.h"
 #include "peermanager.h"
 #include <QPointer>
 #include <QSet>
@@ -16,12 +17,15 @@
 
 namespace bt
 {
-static ResourceManager half_open_connections(50);
-
 class PeerConnector::Private
 {
 public:
-    Private(PeerConnector *p, const net::Address &addr, bool local, PeerManager *pman, std::unique_ptr<ConnectionLimit::Token> token)
+    Private(PeerConnector *p,
+            const net::Address &addr,
+            bool local,
+            PeerManager *pman,
+            std::unique_ptr<ConnectionLimit::Token> token,
+            std::unique_ptr<ConnectAdmission::Slot> slot)
         : p(p)
         , addr(addr)
         , local(local)
@@ -29,6 +33,7 @@ public:
         , stopping(false)
         , do_not_start(false)
         , token(std::move(token))
+        , slot(std::move(slot))
     {
     }
 
@@ -43,6 +48,7 @@ public:
 
     void start(Method method);
     void authenticationFinished(Authenticate *auth, bool ok);
+    void failed(Authenticate *auth, PeerManager *pm);
 
 public:
     PeerConnector *p;
@@ -56,11 +62,15 @@ public:
     bool do_not_start;
     PeerConnector::WPtr self;
     std::unique_ptr<ConnectionLimit::Token> token;
+    std::unique_ptr<ConnectAdmission::Slot> slot;
 };
 
-PeerConnector::PeerConnector(const net::Address &addr, bool local, bt::PeerManager *pman, std::unique_ptr<ConnectionLimit::Token> token)
-    : Resource(&half_open_connections, pman->getTorrent().getInfoHash().toString())
-    , d(std::make_unique<Private>(this, addr, local, pman, std::move(token)))
+PeerConnector::PeerConnector(const net::Address &addr,
+                             bool local,
+                             bt::PeerManager *pman,
+                             std::unique_ptr<ConnectionLimit::Token> token,
+                             std::unique_ptr<ConnectAdmission::Slot> slot)
+    : d(std::make_unique<Private>(this, addr, local, pman, std::move(token), std::move(slot)))
 {
 }
 
@@ -75,15 +85,15 @@ void PeerConnector::setWeakPointer(PeerConnector::WPtr ptr)
 
 void PeerConnector::setMaxActive(Uint32 mc)
 {
-    half_open_connections.setMaxActive(mc);
+    ConnectAdmission::instance().setMaxHalfOpen(mc);
 }
 
-void PeerConnector::start()
+const net::Address &PeerConnector::address() const
 {
-    half_open_connections.add(this);
+    return d->addr;
 }
 
-void PeerConnector::acquired()
+void PeerConnector::start()
 {
     const PeerManager *pm = d->pman.data();
     if (!pm || !pm->isStarted()) {
@@ -94,19 +104,23 @@ void PeerConnector::acquired()
     const bool encryption = ServerInterface::isEncryptionEnabled();
     const bool utp = ServerInterface::isUtpEnabled();
     const bool only_use_utp = ServerInterface::onlyUseUtp();
+    bool use_utp = utp && (primary == bt::UTP || only_use_utp);
+
+    // start with the transport protocol which worked the last time, if the settings still allow it.
+    // Encryption is left to the settings, a stored record must never downgrade the connection.
+    const PeerDatabase::Record *r = pm->peerDatabase().find(d->addr);
+    if (r && r->succeeded > 0) {
+        if (r->flags & PeerDatabase::UTP) {
+            use_utp = utp;
+        } else if (!only_use_utp && OpenFileAllowed()) {
+            use_utp = false;
+        }
+    }
 
     if (encryption) {
-        if (utp && (primary == bt::UTP || only_use_utp)) {
-            d->start(Method::UTP_WITH_ENCRYPTION);
-        } else {
-            d->start(Method::TCP_WITH_ENCRYPTION);
-        }
+        d->start(use_utp ? Method::UTP_WITH_ENCRYPTION : Method::TCP_WITH_ENCRYPTION);
     } else {
-        if (utp && (primary == bt::UTP || only_use_utp)) {
-            d->start(Method::UTP_WITHOUT_ENCRYPTION);
-        } else {
-            d->start(Method::TCP_WITHOUT_ENCRYPTION);
-        }
+        d->start(use_utp ? Method::UTP_WITHOUT_ENCRYPTION : Method::TCP_WITHOUT_ENCRYPTION);
     }
 }
 
@@ -128,6 +142,9 @@ void PeerConnector::Private::authenticationFinished(Authenticate *auth, bool ok)
     }
 
     if (ok) {
+        if (slot) {
+            slot->succeeded();
+        }
         pm->peerAuthenticated(auth, self, ok, std::move(token));
         return;
     }
@@ -153,7 +170,7 @@ void PeerConnector::Private::authenticationFinished(Authenticate *auth, bool ok)
         } else if (!only_use_utp && !only_use_encryption && !tried_methods.contains(Method::TCP_WITHOUT_ENCRYPTION) && tcp_allowed) {
             start(Method::TCP_WITHOUT_ENCRYPTION);
         } else {
-            pm->peerAuthenticated(auth, self, false, std::move(token));
+            failed(auth, pm);
         }
     } else { // Primary is TCP
         if (!only_use_utp && encryption && !tried_methods.contains(Method::TCP_WITH_ENCRYPTION) && tcp_allowed) {
@@ -165,11 +182,19 @@ void PeerConnector::Private::authenticationFinished(Authenticate *auth, bool ok)
         } else if (utp && !only_use_encryption && !tried_methods.contains(Method::UTP_WITHOUT_ENCRYPTION)) {
             start(Method::UTP_WITHOUT_ENCRYPTION);
         } else {
-            pm->peerAuthenticated(auth, self, false, std::move(token));
+            failed(auth, pm);
         }
     }
 }
 
+void PeerConnector::Private::failed(Authenticate *auth, PeerManager *pm)
+{
+    if (slot) {
+        slot->failed();
+    }
+    pm->peerAuthenticated(auth, self, false, std::move(token));
+}
+
 void PeerConnector::Private::start(PeerConnector::Method method)
 {
     const PeerManager *pm = pman.data();
@@ -7,12 +7,12 @@
 #ifndef BT_PEERCONNECTOR_H
 #define BT_PEERCONNECTOR_H
 
+#include "connectadmission.h"
 #include "connectionlimit.h"
 #include <QSharedPointer>
 #include <ktorrent_export.h>
 #include <net/address.h>
 #include <util/constants.h>
-#include <util/resourcemanager.h>
 
 #include <memory>
 
@@ -24,12 +24,19 @@ class PeerManager;
 /*!
  * \headerfile peer/peerconnector.h
  * \brief Connects to a peer.
+ *
+ * The connection attempt was admitted by the ConnectAdmission, it holds the slot
+ * until the attempt is finished.
  */
-class KTORRENT_EXPORT PeerConnector : public Resource
+class KTORRENT_EXPORT PeerConnector
 {
 public:
-    PeerConnector(const net::Address &addr, bool local, PeerManager *pman, std::unique_ptr<ConnectionLimit::Token> token);
-    ~PeerConnector() override;
+    PeerConnector(const net::Address &addr,
+                  bool local,
+                  PeerManager *pman,
+                  std::unique_ptr<ConnectionLimit::Token> token,
+                  std::unique_ptr<ConnectAdmission::Slot> slot);
+    ~PeerConnector();
 
     //! Called when an authentication attempt is finished
     void authenticationFinished(bt::Authenticate *auth, bool ok);
@@ -37,8 +44,12 @@ public:
     //! Start connecting
     void start();
 
+    //! Get the address of the peer
+    [[nodiscard]] const net::Address &address() const;
+
     /*!
-     * Set the maximum number of active PeerConnectors allowed
+     * Set the maximum number of active PeerConnectors allowed,
+     * this is the maximum number of half open connections of the ConnectAdmission
      */
     static void setMaxActive(Uint32 mc);
 
@@ -49,8 +60,6 @@ public:
     void setWeakPointer(WPtr ptr);
 
 private:
-    void acquired() override;
-
     enum class Method {
         TCP_WITH_ENCRYPTION,
         TCP_WITHOUT_ENCRYPTION,
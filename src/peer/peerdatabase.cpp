@@ -0,0 +1,213 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "peerdatabase.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <util/functions.h>
+#include <util/log.h>
+
+namespace bt
+{
+static const Uint32 PEER_DATABASE_MAGIC = 0x4B545044; // KTPD
+static const Uint32 PEER_DATABASE_VERSION = 1;
+static const Uint32 HEADER_SIZE = 32;
+// address, port, succeeded, failed, download rate, upload rate, flags and last seen
+static const Uint32 RECORD_SIZE = 16 + 2 + 2 + 2 + 4 + 4 + 1 + 4;
+
+static Uint32 SecondsSinceEpoch()
+{
+    return QDateTime::currentSecsSinceEpoch();
+}
+
+static Uint16 Increment(Uint16 v)
+{
+    return v < std::numeric_limits<Uint16>::max() ? v + 1 : v;
+}
+
+PeerDatabase::PeerDatabase(const SHA1Hash &info_hash)
+    : info_hash(info_hash)
+{
+}
+
+PeerDatabase::~PeerDatabase()
+{
+}
+
+const PeerDatabase::Record *PeerDatabase::find(const net::Address &addr) const
+{
+    const auto i = records.find(addr);
+    return i != records.end() ? &i->second : nullptr;
+}
+
+void PeerDatabase::add(const net::Address &addr)
+{
+    Record &r = records[addr];
+    if (r.last_seen == 0) {
+        r.last_seen = SecondsSinceEpoch();
+    }
+}
+
+void PeerDatabase::connectFinished(const net::Address &addr, bool ok)
+{
+    Record &r = records[addr];
+    if (ok) {
+        r.succeeded = Increment(r.succeeded);
+    } else {
+        r.failed = Increment(r.failed);
+    }
+    r.last_seen = SecondsSinceEpoch();
+}
+
+void PeerDatabase::peerFinished(const net::Address &addr, Uint32 download_rate, Uint32 upload_rate, Uint8 flags)
+{
+    Record &r = records[addr];
+    // a connection which never transferred anything does not say much, so average with the previous ones
+    r.download_rate = r.download_rate == 0 ? download_rate : (r.download_rate + download_rate) / 2;
+    r.upload_rate = r.upload_rate == 0 ? upload_rate : (r.upload_rate + upload_rate) / 2;
+    r.flags = (r.flags & BANNED) | (flags & (SEEDER | UTP | ENCRYPTED));
+    r.last_seen = SecondsSinceEpoch();
+}
+
+void PeerDatabase::setBanned(const net::Address &addr)
+{
+    Record &r = records[addr];
+    r.flags |= BANNED;
+    r.last_seen = SecondsSinceEpoch();
+}
+
+double PeerDatabase::weight(const Record &r, bool seeding) const
+{
+    if (r.flags & BANNED) {
+        return 0.0;
+    }
+
+    const double success_chance = (r.succeeded + 1.0) / (r.succeeded + r.failed + 2.0);
+    const Uint32 rate = seeding ? r.upload_rate : r.download_rate;
+    return 2.0 * success_chance * (1.0 + std::min(rate / 65536.0, 4.0));
+}
+
+double PeerDatabase::weight(const net::Address &addr, bool seeding) const
+{
+    const Record *r = find(addr);
+    return r ? weight(*r, seeding) : 1.0;
+}
+
+std::vector<std::pair<net::Address, PeerDatabase::Record>> PeerDatabase::ranked(bool seeding) const
+{
+    std::vector<std::pair<double, std::pair<net::Address, Record>>> tmp;
+    tmp.reserve(records.size());
+    for (const auto &entry : records) {
+        tmp.emplace_back(weight(entry.second, seeding), entry);
+    }
+    std::stable_sort(tmp.begin(), tmp.end(), [](const auto &a, const auto &b) {
+        return a.first > b.first;
+    });
+
+    std::vector<std::pair<net::Address, Record>> ret;
+    ret.reserve(tmp.size());
+    for (auto &entry : tmp) {
+        ret.push_back(std::move(entry.second));
+    }
+    return ret;
+}
+
+bool PeerDatabase::save(const QString &file) const
+{
+    // banned peers are always kept, so a restart does not unban them
+    std::vector<std::pair<net::Address, Record>> to_save = ranked(false);
+    std::stable_partition(to_save.begin(), to_save.end(), [](const auto &entry) {
+        return entry.second.flags & BANNED;
+    });
+    if (to_save.size() > MAX_RECORDS) {
+        to_save.resize(MAX_RECORDS);
+    }
+
+    QByteArray buf(HEADER_SIZE + to_save.size() * RECORD_SIZE, 0);
+    Uint8 *ptr = reinterpret_cast<Uint8 *>(buf.data());
+    WriteUint32(ptr, 0, PEER_DATABASE_MAGIC);
+    WriteUint32(ptr, 4, PEER_DATABASE_VERSION);
+    memcpy(ptr + 8, info_hash.getData(), 20);
+    WriteUint32(ptr, 28, to_save.size());
+
+    Uint32 off = HEADER_SIZE;
+    for (const auto &[addr, r] : to_save) {
+        // IPv4 addresses are stored as IPv4 mapped IPv6 addresses, so all records have the same size
+        const Q_IPV6ADDR ip = addr.toIPv6Address();
+        memcpy(ptr + off, ip.c, 16);
+        WriteUint16(ptr, off + 16, addr.port());
+        WriteUint16(ptr, off + 18, r.succeeded);
+        WriteUint16(ptr, off + 20, r.failed);
+        WriteUint32(ptr, off + 22, r.download_rate);
+        WriteUint32(ptr, off + 26, r.upload_rate);
+        ptr[off + 30] = r.flags;
+        WriteUint32(ptr, off + 31, r.last_seen);
+        off += RECORD_SIZE;
+    }
+
+    // write to a temporary file and rename it, so a crash cannot leave a truncated database behind
+    QSaveFile fptr(file);
+    if (!fptr.open(QIODevice::WriteOnly) || fptr.write(buf) != buf.size() || !fptr.commit()) {
+        Out(SYS_GEN | LOG_DEBUG) << "Failed to save peer database " << file << " : " << fptr.errorString() << endl;
+        return false;
+    }
+    return true;
+}
+
+bool PeerDatabase::load(const QString &file)
+{
+    QFile fptr(file);
+    if (!fptr.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QByteArray buf = fptr.readAll();
+    const Uint8 *ptr = reinterpret_cast<const Uint8 *>(buf.constData());
+    if (buf.size() < (qsizetype)HEADER_SIZE || ReadUint32(ptr, 0) != PEER_DATABASE_MAGIC || ReadUint32(ptr, 4) != PEER_DATABASE_VERSION) {
+        return false;
+    }
+
+    if (SHA1Hash(ptr + 8) != info_hash) {
+        Out(SYS_GEN | LOG_NOTICE) << "Peer database " << file << " belongs to another torrent" << endl;
+        return false;
+    }
+
+    const Uint32 count = ReadUint32(ptr, 28);
+    if (buf.size() < (qsizetype)(HEADER_SIZE + (Uint64)count * RECORD_SIZE)) {
+        return false;
+    }
+
+    const Uint32 oldest = SecondsSinceEpoch() - MAX_AGE_DAYS * 24 * 3600;
+    Uint32 off = HEADER_SIZE;
+    for (Uint32 i = 0; i < count; i++, off += RECORD_SIZE) {
+        Record r;
+        r.succeeded = ReadUint16(ptr, off + 18);
+        r.failed = ReadUint16(ptr, off + 20);
+        r.download_rate = ReadUint32(ptr, off + 22);
+        r.upload_rate = ReadUint32(ptr, off + 26);
+        r.flags = ptr[off + 30];
+        r.last_seen = ReadUint32(ptr, off + 31);
+        if (r.last_seen < oldest) {
+            continue;
+        }
+
+        const Uint16 port = ReadUint16(ptr, off + 16);
+        Q_IPV6ADDR ip;
+        memcpy(ip.c, ptr + off, 16);
+        const QHostAddress host(ip);
+        bool ipv4 = false;
+        const quint32 ip4 = host.toIPv4Address(&ipv4);
+        records[ipv4 ? net::Address(ip4, port) : net::Address(ip, port)] = r;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,118 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef BT_PEERDATABASE_H
+#define BT_PEERDATABASE_H
+
+#include <QString>
+#include <ktorrent_export.h>
+#include <net/address.h>
+#include <util/constants.h>
+#include <util/sha1hash.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace bt
+{
+/*!
+    \headerfile peer/peerdatabase.h
+    \brief Remembers how good the peers of a torrent were, across sessions.
+
+    For every address it keeps the number of successful and failed connection
+    attempts, the average download and upload rate of the last connections,
+    how the last connection was made and whether the peer is banned.
+
+    The database is saved in a compact binary file together with the info hash
+    of the torrent, so a file of another torrent is never loaded by accident.
+*/
+class KTORRENT_EXPORT PeerDatabase
+{
+public:
+    PeerDatabase(const SHA1Hash &info_hash);
+    ~PeerDatabase();
+
+    //! Maximum number of records which are saved
+    static constexpr Uint32 MAX_RECORDS = 1000;
+    //! Records of peers which were not seen for this number of days are dropped
+    static constexpr Uint32 MAX_AGE_DAYS = 30;
+
+    enum Flags : Uint8 {
+        SEEDER = 0x01,
+        //! The last connection used uTP
+        UTP = 0x02,
+        //! The last connection was encrypted
+        ENCRYPTED = 0x04,
+        BANNED = 0x08,
+    };
+
+    struct Record {
+        Uint16 succeeded = 0;
+        Uint16 failed = 0;
+        //! Average download rate of the last connections in bytes/s
+        Uint32 download_rate = 0;
+        //! Average upload rate of the last connections in bytes/s
+        Uint32 upload_rate = 0;
+        Uint8 flags = 0;
+        //! When the peer was last seen, in seconds since the epoch
+        Uint32 last_seen = 0;
+    };
+
+    //! Get the record of an address, nullptr if there is none
+    [[nodiscard]] const Record *find(const net::Address &addr) const;
+
+    //! Make sure there is a record for addr, so it gets saved
+    void add(const net::Address &addr);
+
+    //! A connection attempt to addr has finished
+    void connectFinished(const net::Address &addr, bool ok);
+
+    /*!
+        A connection to a peer was closed.
+        \param addr The address of the peer
+        \param download_rate The average download rate of the connection
+        \param upload_rate The average upload rate of the connection
+        \param flags The SEEDER, UTP and ENCRYPTED flags of the connection
+    */
+    void peerFinished(const net::Address &addr, Uint32 download_rate, Uint32 upload_rate, Uint8 flags);
+
+    //! Mark a peer as banned
+    void setBanned(const net::Address &addr);
+
+    /*!
+        Get how much a connection to addr is worth compared to a connection
+        to an unknown peer, which has weight 1. It grows with the success rate
+        and the download rate, or the upload rate when we are seeding.
+    */
+    [[nodiscard]] double weight(const net::Address &addr, bool seeding) const;
+
+    //! Get all records, the ones with the highest weight first
+    [[nodiscard]] std::vector<std::pair<net::Address, Record>> ranked(bool seeding) const;
+
+    //! Get the number of records
+    [[nodiscard]] Uint32 size() const
+    {
+        return records.size();
+    }
+
+    //! Save the database to a file, returns false on failure
+    bool save(const QString &file) const;
+
+    //! Load the database from a file, returns false if the file could not be read or belongs to another torrent
+    bool load(const QString &file);
+
+private:
+    [[nodiscard]] double weight(const Record &r, bool seeding) const;
+
+private:
+    SHA1Hash info_hash;
+    std::map<net::Address, Record> records;
+};
+
+}
+
+#endif // BT_PEERDATABASE_H
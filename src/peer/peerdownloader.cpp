@@ -13,54 +13,12 @@
 
 namespace bt
 {
-TimeStampedRequest::TimeStampedRequest()
-    : time_stamp(bt::CurrentTime())
-{
-}
-
-TimeStampedRequest::TimeStampedRequest(const Request &r)
-    : req(r)
-    , time_stamp(bt::CurrentTime())
-{
-}
-
-TimeStampedRequest::TimeStampedRequest(const TimeStampedRequest &t)
-    : req(t.req)
-    , time_stamp(t.time_stamp)
-{
-}
-
-TimeStampedRequest::~TimeStampedRequest()
-{
-}
-
-bool TimeStampedRequest::operator==(const Request &r) const
-{
-    return r == req;
-}
-
-bool TimeStampedRequest::operator==(const TimeStampedRequest &r) const
-{
-    return r.req == req;
-}
-
-TimeStampedRequest &TimeStampedRequest::operator=(const Request &r)
-{
-    time_stamp = bt::CurrentTime();
-    req = r;
-    return *this;
-}
-
-TimeStampedRequest &TimeStampedRequest::operator=(const TimeStampedRequest &r)
-{
-    time_stamp = r.time_stamp;
-    req = r.req;
-    return *this;
-}
-
 PeerDownloader::PeerDownloader(Peer *peer, Uint32 chunk_size)
     : peer(peer)
     , chunk_size(chunk_size / MAX_PIECE_LEN)
+    , srtt(0)
+    , rtt_probe_sent(0)
+    , probing(false)
 {
     connect(peer, &Peer::destroyed, this, &PeerDownloader::peerDestroyed);
     max_wait_queue_size = 25;
@@ -109,6 +67,7 @@ void PeerDownloader::cancel(const Request &req)
     if (!wait_queue.removeAll(req)) {
         reqs.removeAll(req);
         peer->sendCancel(req);
+        stopProbe(req);
     }
 }
 
@@ -119,6 +78,7 @@ void PeerDownloader::onRejected(const Request &req)
     }
 
     if (reqs.removeAll(req)) {
+        stopProbe(req);
         Q_EMIT rejected(req);
     }
 }
@@ -126,12 +86,9 @@ void PeerDownloader::onRejected(const Request &req)
 void PeerDownloader::cancelAll()
 {
     if (peer) {
-        QList<TimeStampedRequest>::iterator i = reqs.begin();
-        while (i != reqs.end()) {
-            const TimeStampedRequest &tr = *i;
+        reqs.forEach([this](const TimeStampedRequest &tr) {
             peer->sendCancel(tr.req);
-            ++i;
-        }
+        });
     }
 
     wait_queue.clear();
@@ -141,11 +98,26 @@ void PeerDownloader::cancelAll()
 void PeerDownloader::piece(const Piece &p)
 {
     const Request r(p);
-    if (!reqs.removeOne(r)) {
+    if (reqs.take(r)) {
+        if (probing && r == rtt_probe) {
+            // smooth the round trip time the same way TCP does
+            const Uint32 sample = (Uint32)(bt::CurrentTime() - rtt_probe_sent);
+            srtt = srtt == 0 ? sample : (7 * srtt + sample) / 8;
+            probing = false;
+        }
+    } else {
         wait_queue.removeAll(r);
     }
 }
 
+void PeerDownloader::stopProbe(const Request &req)
+{
+    // the request may be sent again later, by then it could be queued behind others
+    if (probing && req == rtt_probe) {
+        probing = false;
+    }
+}
+
 void PeerDownloader::peerDestroyed()
 {
     peer = nullptr;
@@ -184,11 +156,13 @@ void PeerDownloader::checkTimeouts()
     // we use a 60 second interval
     const Uint32 MAX_INTERVAL = 60 * 1000;
 
-    // expire any timed-out requests: the list is sorted with the
+    // expire any timed-out requests: the pipeline is sorted with the
     // oldest requests at the front, so we simply pop off requests
     // until we find one that shouldn't be expired
     while (!reqs.isEmpty() && (now - reqs.first().time_stamp > MAX_INTERVAL)) {
-        Q_EMIT timedout(reqs.takeFirst().req);
+        const Request req = reqs.takeFirst().req;
+        stopProbe(req);
+        Q_EMIT timedout(req);
     }
 }
 
@@ -214,13 +188,10 @@ void PeerDownloader::choked()
         return;
     }
 
-    QList<TimeStampedRequest>::iterator i = reqs.begin();
-    while (i != reqs.end()) {
-        const TimeStampedRequest &tr = *i;
-        Q_EMIT rejected(tr.req);
-        ++i;
+    // take them off one by one, slots connected to rejected might touch the pipeline
+    while (!reqs.isEmpty()) {
+        Q_EMIT rejected(reqs.takeFirst().req);
     }
-    reqs.clear();
 
     QList<Request>::iterator j = wait_queue.begin();
     while (j != wait_queue.end()) {
@@ -231,22 +202,41 @@ void PeerDownloader::choked()
     wait_queue.clear();
 }
 
-void PeerDownloader::update()
+Uint32 PeerDownloader::pipelineDepth(Uint32 download_rate, Uint32 rtt, Uint32 max_request_queue)
 {
-    // modify the interval if necessary
-    const double pieces_per_sec = (double)peer->getDownloadRate() / MAX_PIECE_LEN;
-    int max_reqs = 1 + (int)ceil(10 * pieces_per_sec);
+    // keep the bandwidth delay product in flight, with 50 % extra so the measured rate
+    // is not limited by the pipeline itself and the depth can grow when the peer speeds up
+    const double pieces_per_ms = (double)download_rate / MAX_PIECE_LEN / 1000.0;
+    const double depth = ceil(1.5 * pieces_per_ms * rtt);
+    Uint32 max_reqs = MIN_PIPELINE_DEPTH;
+    if (depth >= MAX_PIPELINE_DEPTH) {
+        max_reqs = MAX_PIPELINE_DEPTH;
+    } else if (depth > MIN_PIPELINE_DEPTH) {
+        max_reqs = (Uint32)depth;
+    }
     // cap if client has supplied a reqq in extended protocol handshake
-    if (max_reqs > (int)peer->getStats().max_request_queue && peer->getStats().max_request_queue != 0) {
-        max_reqs = peer->getStats().max_request_queue;
+    if (max_request_queue != 0 && max_reqs > max_request_queue) {
+        max_reqs = max_request_queue;
     }
 
+    return max_reqs;
+}
+
+void PeerDownloader::update()
+{
+    const Uint32 max_reqs = pipelineDepth(peer->getDownloadRate(), srtt, peer->getStats().max_request_queue);
     while (wait_queue.count() > 0 && reqs.count() < max_reqs) {
         // get a request from the wait queue and send that
         const Request req = wait_queue.front();
         wait_queue.pop_front();
-        const TimeStampedRequest r = TimeStampedRequest(req);
-        reqs.append(r);
+        // a request which has to wait behind others would measure our own queue,
+        // so only time one which is sent when the pipeline is empty
+        if (reqs.isEmpty()) {
+            rtt_probe = req;
+            rtt_probe_sent = bt::CurrentTime();
+            probing = true;
+        }
+        reqs.append(req);
         peer->sendRequest(req);
     }
 
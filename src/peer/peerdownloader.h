@@ -10,6 +10,8 @@
 #include <QObject>
 #include <download/request.h>
 #include <interfaces/piecedownloader.h>
+#include <ktorrent_export.h>
+#include <peer/requestpipeline.h>
 
 namespace bt
 {
@@ -17,72 +19,12 @@ class Peer;
 class Request;
 class Piece;
 
-/*!
- * \headerfile peer/peerdownloader.h
- * \brief Request with a timestamp.
- */
-struct TimeStampedRequest {
-    Request req;
-    TimeStamp time_stamp;
-
-    TimeStampedRequest();
-
-    /*!
-     * Constructor, set the request and calculate the timestamp.
-     * \param r The Request
-     */
-    TimeStampedRequest(const Request &r);
-
-    /*!
-     * Copy constructor, copy the request and the timestamp
-     * \param t The TimeStampedRequest
-     */
-    TimeStampedRequest(const TimeStampedRequest &t);
-
-    //! Destructor
-    ~TimeStampedRequest();
-
-    //! Smaller then operator, uses timestamps to compare
-    bool operator<(const TimeStampedRequest &t) const
-    {
-        return time_stamp < t.time_stamp;
-    }
-
-    /*!
-     * Equality operator, compares requests only.
-     * \param r The Request
-     * \return true if equal
-     */
-    bool operator==(const Request &r) const;
-
-    /*!
-     * Equality operator, compares requests only.
-     * \param r The Request
-     * \return true if equal
-     */
-    bool operator==(const TimeStampedRequest &r) const;
-
-    /*!
-     * Assignment operator.
-     * \param r The Request to copy
-     * \return *this
-     */
-    TimeStampedRequest &operator=(const Request &r);
-
-    /*!
-     * Assignment operator.
-     * \param r The TimeStampedRequest to copy
-     * \return *this
-     */
-    TimeStampedRequest &operator=(const TimeStampedRequest &r);
-};
-
 /*!
  * \headerfile peer/peerdownloader.h
  * \author Joris Guisson
  * \brief Downloads pieces from a Peer.
  */
-class PeerDownloader : public PieceDownloader
+class KTORRENT_EXPORT PeerDownloader : public PieceDownloader
 {
     Q_OBJECT
 public:
@@ -101,6 +43,33 @@ public:
     //! Get the number of active requests
     [[nodiscard]] Uint32 getNumRequests() const;
 
+    //! Minimum number of outstanding requests, used for slow peers and before the round trip time is known
+    static constexpr Uint32 MIN_PIPELINE_DEPTH = 5;
+
+    //! Maximum number of outstanding requests, whatever the rate and round trip time
+    static constexpr Uint32 MAX_PIPELINE_DEPTH = 500;
+
+    /*!
+     * Get the smoothed round trip time of requests in milliseconds, 0 if not yet measured.
+     * Only requests which were sent while no others were outstanding are timed, so this is
+     * the latency of the network and the peer, not the time spent queued behind our own requests.
+     */
+    [[nodiscard]] Uint32 getRoundTripTime() const
+    {
+        return srtt;
+    }
+
+    /*!
+     * Calculate how many requests should be outstanding.
+     * This is the bandwidth delay product, the number of pieces which can be downloaded
+     * during one round trip, plus 50 %, so fast peers on high latency links can fill their pipe.
+     * It is kept between MIN_PIPELINE_DEPTH and MAX_PIPELINE_DEPTH.
+     * \param download_rate The download rate in bytes per second
+     * \param rtt The round trip time in milliseconds
+     * \param max_request_queue The reqq of the peer, 0 if it did not supply one
+     */
+    [[nodiscard]] static Uint32 pipelineDepth(Uint32 download_rate, Uint32 rtt, Uint32 max_request_queue);
+
     //! Is the Peer choked.
     [[nodiscard]] bool isChoked() const override;
 
@@ -179,12 +148,20 @@ public Q_SLOTS:
 private Q_SLOTS:
     void peerDestroyed();
 
+private:
+    void stopProbe(const Request &req);
+
 private:
     Peer *peer;
-    QList<TimeStampedRequest> reqs;
+    RequestPipeline reqs;
     QList<Request> wait_queue;
     Uint32 max_wait_queue_size;
     Uint32 chunk_size;
+    Uint32 srtt;
+    //! The request which is being timed, only valid if probing is true
+    Request rtt_probe;
+    TimeStamp rtt_probe_sent;
+    bool probing;
 };
 
 }
@@ -10,15 +10,21 @@
 #include <QFile>
 #include <QList>
 #include <QSet>
-#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
 #include <QtAlgorithms>
 
+#include <vector>
+
 #include "authenticate.h"
 #include "authenticationmonitor.h"
 #include "chunkcounter.h"
+#include "connectadmission.h"
 #include "connectionlimit.h"
 #include "peer.h"
 #include "peerconnector.h"
+#include "peerdatabase.h"
+#include "utpex.h"
 #include <dht/dhtbase.h>
 #include <mse/encryptedauthenticate.h>
 #include <mse/encryptedpacketsocket.h>
@@ -40,16 +46,29 @@ using namespace Qt::Literals::StringLiterals;
 
 namespace bt
 {
-using PPItr = std::map<net::Address, bool>::iterator;
+struct PotentialPeer {
+    bool local = false;
+    Uint8 pex_flags = 0;
+};
+
+using PPItr = std::map<net::Address, PotentialPeer>::iterator;
 using PeerMap = std::map<Uint32, std::unique_ptr<Peer>>;
 
 static ConnectionLimit climit;
+static bool parallel_packet_processing = false;
+static QList<PeerManager *> started_peer_managers;
 
-class PeerManager::Private
+static QThreadPool &PacketProcessingPool()
+{
+    static QThreadPool pool;
+    return pool;
+}
+
+class PeerManager::Private : public ConnectAdmission::Client
 {
 public:
     Private(PeerManager *p, Torrent &tor);
-    ~Private();
+    ~Private() override;
 
     void updateAvailableChunks();
     bool killBadPeer();
@@ -60,8 +79,20 @@ public:
                     std::unique_ptr<ConnectionLimit::Token> token);
     [[nodiscard]] bool connectedTo(const net::Address &addr) const;
     void update();
+    void sendPendingHaves();
+    void handleControlPackets();
     void have(Peer *peer, Uint32 index);
     void connectToPeers();
+    /*!
+        Pick the potential peer with the highest expected value: the success rate and latency
+        of past connects to the address times its weight in the peer database. Local peers
+        count double. Peers which PEX flags as seeder count double while we are downloading,
+        but only a tenth while we are seeding, because they have nothing to download from us.
+    */
+    [[nodiscard]] PPItr bestPotentialPeer();
+    [[nodiscard]] bool seeding() const;
+    void peerFinished(const Peer *peer);
+    bool connectAdmitted() override;
 
 public:
     PeerManager *p;
@@ -73,12 +104,18 @@ public:
     bool pex_on;
     bool wanted_changed;
     PieceHandler *piece_handler;
+    MetadataDownload *metadata_download;
     bool paused;
     QSet<PeerConnector::Ptr> connectors;
     QScopedPointer<SuperSeeder> superseeder;
-    std::map<net::Address, bool> potential_peers;
+    std::map<net::Address, PotentialPeer> potential_peers;
     bool partial_seed;
     Uint32 num_cleared;
+    std::vector<Uint32> pending_haves;
+    HaveStats have_stats;
+    PeerDatabase peer_db;
+    // set by processPackets, cleared by update
+    bool packets_processed = false;
 };
 
 PeerManager::PeerManager(Torrent &tor)
@@ -95,6 +132,56 @@ ConnectionLimit &PeerManager::connectionLimits()
     return climit;
 }
 
+void PeerManager::setParallelPacketProcessing(bool on, int num_threads)
+{
+    parallel_packet_processing = on;
+    if (on) {
+        PacketProcessingPool().setMaxThreadCount(num_threads > 0 ? num_threads : QThread::idealThreadCount());
+    }
+}
+
+bool PeerManager::parallelPacketProcessing()
+{
+    return parallel_packet_processing;
+}
+
+void PeerManager::processPackets()
+{
+    if (!parallel_packet_processing) {
+        return;
+    }
+
+    QList<PeerManager *> busy;
+    for (PeerManager *pman : std::as_const(started_peer_managers)) {
+        pman->d->packets_processed = true;
+        if (!pman->d->peer_map.empty()) {
+            busy.append(pman);
+        }
+    }
+
+    // not worth the thread switches, update will handle them
+    if (busy.size() < 2) {
+        return;
+    }
+
+    QThreadPool &pool = PacketProcessingPool();
+    for (PeerManager *pman : std::as_const(busy)) {
+        pool.start([pman]() {
+            pman->d->handleControlPackets();
+        });
+    }
+    pool.waitForDone();
+
+    // close the connections of the peers which were killed by the workers
+    for (PeerManager *pman : std::as_const(busy)) {
+        for (const auto &[peer_id, peer] : std::as_const(pman->d->peer_map)) {
+            if (peer->isKilled()) {
+                peer->kill();
+            }
+        }
+    }
+}
+
 void PeerManager::pause()
 {
     if (d->paused) {
@@ -124,6 +211,11 @@ void PeerManager::unpause()
 
 void PeerManager::update()
 {
+    // the first PeerManager which is updated in a tick handles the messages of all of them
+    if (parallel_packet_processing && !d->packets_processed) {
+        processPackets();
+    }
+    d->packets_processed = false;
     d->update();
 }
 
@@ -148,10 +240,14 @@ void PeerManager::setWantedChunks(const BitSet &bs)
     d->wanted_changed = true;
 }
 
-void PeerManager::addPotentialPeer(const net::Address &addr, bool local)
+void PeerManager::addPotentialPeer(const net::Address &addr, bool local, Uint8 pex_flags)
 {
-    if (d->potential_peers.size() < 500) {
-        d->potential_peers[addr] = local;
+    const PPItr i = d->potential_peers.find(addr);
+    if (i != d->potential_peers.end()) {
+        i->second.local = i->second.local || local;
+        i->second.pex_flags |= pex_flags;
+    } else if (d->potential_peers.size() < 500) {
+        d->potential_peers[addr] = PotentialPeer{local, pex_flags};
     }
 }
 
@@ -227,6 +323,9 @@ void PeerManager::peerAuthenticated(bt::Authenticate *auth, bt::PeerConnector::W
     }
 
     const PeerConnector::Ptr ptr = pcon.toStrongRef();
+    if (ptr) {
+        d->peer_db.connectFinished(ptr->address(), ok);
+    }
     d->connectors.remove(ptr);
 }
 
@@ -251,35 +350,40 @@ void PeerManager::closeAllConnections()
 
 void PeerManager::savePeerList(const QString &file)
 {
-    // Lets save the entries line based
-    QFile fptr(file);
-    if (!fptr.open(QIODevice::WriteOnly)) {
-        return;
-    }
+    Out(SYS_GEN | LOG_DEBUG) << "Saving list of peers to " << file << endl;
 
-    try {
-        Out(SYS_GEN | LOG_DEBUG) << "Saving list of peers to " << file << endl;
-
-        QTextStream out(&fptr);
-        // first the active peers
-        for (const auto &[p_id, p] : std::as_const(d->peer_map)) {
-            const net::Address &addr = p->getAddress();
-            out << addr.toString() << " " << (unsigned short)addr.port() << Qt::endl;
-        }
+    // first the active peers
+    for (const auto &[p_id, p] : std::as_const(d->peer_map)) {
+        d->peerFinished(p.get());
+    }
 
-        // now the potential_peers
-        std::map<net::Address, bool>::const_iterator i = d->potential_peers.cbegin();
-        while (i != d->potential_peers.cend()) {
-            out << i->first.toString() << " " << i->first.port() << Qt::endl;
-            ++i;
-        }
-    } catch (bt::Error &err) {
-        Out(SYS_GEN | LOG_DEBUG) << "Error happened during saving of peer list : " << err.toString() << endl;
+    // now the potential_peers
+    for (const auto &[addr, pp] : d->potential_peers) {
+        d->peer_db.add(addr);
     }
+    d->peer_db.save(file);
 }
 
 void PeerManager::loadPeerList(const QString &file)
 {
+    if (d->peer_db.load(file)) {
+        Out(SYS_GEN | LOG_DEBUG) << "Loaded " << d->peer_db.size() << " peers from " << file << endl;
+        AccessManager &aman = AccessManager::instance();
+        QStringList to_ban;
+        for (const auto &[addr, r] : d->peer_db.ranked(d->seeding())) {
+            if (r.flags & PeerDatabase::BANNED) {
+                if (!aman.isBanned(addr)) {
+                    to_ban.append(addr.toString());
+                }
+            } else {
+                addPotentialPeer(addr, false, (r.flags & PeerDatabase::SEEDER) ? UTPex::SEED_FLAG : 0);
+            }
+        }
+        // ban them all at once, so the filter is only replaced once
+        aman.banPeers(to_ban);
+        return;
+    }
+
     QFile fptr(file);
     if (!fptr.open(QIODevice::ReadOnly)) {
         return;
@@ -314,14 +418,20 @@ void PeerManager::start(bool superseed)
 
     unpause();
     ServerInterface::addPeerManager(this);
+    if (!started_peer_managers.contains(this)) {
+        started_peer_managers.append(this);
+    }
 }
 
 void PeerManager::stop()
 {
     d->cnt.reset();
     d->available_chunks.clear();
+    d->pending_haves.clear();
     d->started = false;
     ServerInterface::removePeerManager(this);
+    started_peer_managers.removeAll(this);
+    ConnectAdmission::instance().remove(d.get());
     d->connectors.clear();
     d->superseeder.reset();
     closeAllConnections();
@@ -361,12 +471,18 @@ void PeerManager::peerSourceReady(PeerSource *ps)
 {
     net::Address addr;
     bool local = false;
+    bool added = false;
     while (ps->takePeer(addr, local)) {
         addPotentialPeer(addr, local);
+        added = true;
+    }
+
+    if (added) {
+        Q_EMIT potentialPeersReady();
     }
 }
 
-void PeerManager::pex(const QByteArray &arr, int ip_version)
+void PeerManager::pex(const QByteArray &arr, const QByteArray &flags, int ip_version)
 {
     if (!d->pex_on) {
         return;
@@ -376,12 +492,14 @@ void PeerManager::pex(const QByteArray &arr, int ip_version)
     if (ip_version == 4) {
         Out(SYS_CON | LOG_NOTICE) << "PEX: found " << (arr.size() / 6) << " IPv4 peers" << endl;
         for (int i = 0; i + 6 <= arr.size(); i += 6) {
-            addPotentialPeer(net::Address::fromCompactIPv4(arr_view.sliced(i, 6)), false);
+            const Uint8 f = i / 6 < flags.size() ? flags[i / 6] : 0;
+            addPotentialPeer(net::Address::fromCompactIPv4(arr_view.sliced(i, 6)), false, f);
         }
     } else if (ip_version == 6) {
         Out(SYS_CON | LOG_NOTICE) << "PEX: found " << (arr.size() / 18) << " IPv6 peers" << endl;
-        for (int i = 0; i < arr.size(); i += 18) {
-            addPotentialPeer(net::Address::fromCompactIPv6(arr_view.sliced(i, 18)), false);
+        for (int i = 0; i + 18 <= arr.size(); i += 18) {
+            const Uint8 f = i / 18 < flags.size() ? flags[i / 18] : 0;
+            addPotentialPeer(net::Address::fromCompactIPv6(arr_view.sliced(i, 18)), false, f);
         }
     }
 }
@@ -432,6 +550,16 @@ void PeerManager::setPieceHandler(PieceHandler *ph)
     d->piece_handler = ph;
 }
 
+void PeerManager::setMetadataDownload(MetadataDownload *md)
+{
+    d->metadata_download = md;
+}
+
+MetadataDownload *PeerManager::getMetadataDownload() const
+{
+    return d->metadata_download;
+}
+
 void PeerManager::killStalePeers()
 {
     for (const auto &[p_id, p] : std::as_const(d->peer_map)) {
@@ -465,9 +593,12 @@ void PeerManager::sendHave(Uint32 index)
         return;
     }
 
-    for (const auto &[peer_id, peer] : std::as_const(d->peer_map)) {
-        peer->sendHave(index);
-    }
+    d->pending_haves.push_back(index);
+}
+
+PeerManager::HaveStats PeerManager::haveStats() const
+{
+    return d->have_stats;
 }
 
 Uint32 PeerManager::getNumConnectedPeers() const
@@ -524,6 +655,11 @@ const bt::Torrent &PeerManager::getTorrent() const
     return d->tor;
 }
 
+const PeerDatabase &PeerManager::peerDatabase() const
+{
+    return d->peer_db;
+}
+
 bool PeerManager::isStarted() const
 {
     return d->started;
@@ -583,18 +719,22 @@ PeerManager::Private::Private(PeerManager *p, Torrent &tor)
     , cnt(tor.getNumChunks())
     , partial_seed(false)
     , num_cleared(0)
+    , peer_db(tor.getInfoHash())
 {
     started = false;
     wanted_chunks.setAll(true);
     wanted_changed = false;
     pex_on = !tor.isPrivate();
     piece_handler = nullptr;
+    metadata_download = nullptr;
     paused = false;
 }
 
 PeerManager::Private::~Private()
 {
     ServerInterface::removePeerManager(p);
+    started_peer_managers.removeAll(p);
+    ConnectAdmission::instance().remove(this);
     started = false;
     connectors.clear();
 }
@@ -606,6 +746,7 @@ void PeerManager::Private::update()
     }
 
     num_cleared = 0;
+    sendPendingHaves();
 
     // update the speed of each peer,
     // and get rid of some killed peers
@@ -617,6 +758,7 @@ void PeerManager::Private::update()
         }
 
         if (peer->isKilled()) {
+            peerFinished(peer.get());
             cnt.decBitSet(peer->getBitSet());
             updateAvailableChunks();
             Q_EMIT p->peerKilled(peer.get());
@@ -642,6 +784,42 @@ void PeerManager::Private::update()
     connectToPeers();
 }
 
+void PeerManager::Private::sendPendingHaves()
+{
+    if (pending_haves.empty()) {
+        return;
+    }
+
+    // Send all HAVEs of the last tick together, so they end up in the same send call.
+    // Peers which already have the chunk don't need to know we have it too.
+    // Note that falling back to a BITFIELD is not an option, it is only allowed as first message.
+    for (const auto &[peer_id, peer] : std::as_const(peer_map)) {
+        if (peer->isKilled()) {
+            continue;
+        }
+
+        const BitSet &bs = peer->getBitSet();
+        for (const Uint32 index : std::as_const(pending_haves)) {
+            if (bs.get(index)) {
+                have_stats.suppressed++;
+            } else {
+                peer->sendHave(index);
+                have_stats.sent++;
+            }
+        }
+    }
+
+    pending_haves.clear();
+}
+
+void PeerManager::Private::handleControlPackets()
+{
+    // runs on a worker thread, peers are only added and removed on the main thread
+    for (const auto &[peer_id, peer] : std::as_const(peer_map)) {
+        peer->handleControlPackets();
+    }
+}
+
 void PeerManager::Private::have(Peer *peer, Uint32 index)
 {
     if (wanted_chunks.get(index) && !paused) {
@@ -707,33 +885,100 @@ bool PeerManager::Private::connectedTo(const net::Address &addr) const
 
 void PeerManager::Private::connectToPeers()
 {
-    if (paused || potential_peers.size() == 0 || (Uint32)connectors.size() > MAX_SIMULTANIOUS_AUTHS) {
-        return;
+    if (started && !paused && !potential_peers.empty()) {
+        ConnectAdmission::instance().request(this);
     }
+}
 
-    while (!potential_peers.empty()) {
-        if ((Uint32)connectors.size() > MAX_SIMULTANIOUS_AUTHS) {
-            return;
+PPItr PeerManager::Private::bestPotentialPeer()
+{
+    // there are at most 500 potential peers and connects are paced, so a linear search is cheap enough
+    const ConnectAdmission &ca = ConnectAdmission::instance();
+    const bool seeding = this->seeding();
+    PPItr best = potential_peers.end();
+    double best_value = -1.0;
+    for (PPItr i = potential_peers.begin(); i != potential_peers.end(); ++i) {
+        double value = ca.expectedValue(i->first) * peer_db.weight(i->first, seeding);
+        if (i->second.local) {
+            value *= 2.0;
+        }
+        if (i->second.pex_flags & UTPex::SEED_FLAG) {
+            // x2 while downloading, seeders are the best source of data,
+            // x0.1 while seeding, two seeders have nothing to exchange
+            value *= seeding ? 0.1 : 2.0;
+        }
+
+        if (value > best_value) {
+            best = i;
+            best_value = value;
         }
+    }
+    return best;
+}
 
-        const PPItr itr = potential_peers.begin();
+bool PeerManager::Private::seeding() const
+{
+    return wanted_chunks.numOnBits() == 0;
+}
 
-        const AccessManager &aman = AccessManager::instance();
+void PeerManager::Private::peerFinished(const Peer *peer)
+{
+    const PeerInterface::Stats &s = peer->getStats();
+    int secs = peer->getConnectTime().secsTo(QTime::currentTime());
+    if (secs < 0) { // connected before midnight
+        secs += 24 * 3600;
+    }
+    secs = qMax(secs, 1);
 
-        if (aman.allowed(itr->first) && !connectedTo(itr->first)) {
-            std::unique_ptr<ConnectionLimit::Token> token = climit.acquire(tor.getInfoHash());
-            if (!token) {
-                break;
-            }
+    Uint8 flags = 0;
+    if (peer->isSeeder()) {
+        flags |= PeerDatabase::SEEDER;
+    }
+    if (s.transport_protocol == UTP) {
+        flags |= PeerDatabase::UTP;
+    }
+    if (s.encrypted) {
+        flags |= PeerDatabase::ENCRYPTED;
+    }
+
+    const net::Address &addr = peer->getAddress();
+    peer_db.peerFinished(addr, s.bytes_downloaded / secs, s.bytes_uploaded / secs, flags);
+    if (AccessManager::instance().isBanned(addr)) {
+        peer_db.setBanned(addr);
+    }
+}
+
+bool PeerManager::Private::connectAdmitted()
+{
+    if (!started || paused) {
+        return false;
+    }
 
-            const PeerConnector::Ptr pcon(new PeerConnector(itr->first, itr->second, p, std::move(token)));
-            pcon->setWeakPointer(PeerConnector::WPtr(pcon));
-            connectors.insert(pcon);
-            pcon->start();
+    const AccessManager &aman = AccessManager::instance();
+    while (!potential_peers.empty()) {
+        const PPItr itr = bestPotentialPeer();
+        const net::Address addr = itr->first;
+        const bool local = itr->second.local;
+        if (!aman.allowed(addr) || connectedTo(addr)) {
+            potential_peers.erase(itr);
+            continue;
+        }
+
+        std::unique_ptr<ConnectionLimit::Token> token = climit.acquire(tor.getInfoHash());
+        if (!token) {
+            // at the connection limit, update will ask again when there is room
+            return false;
         }
 
         potential_peers.erase(itr);
+        ConnectAdmission &ca = ConnectAdmission::instance();
+        const PeerConnector::Ptr pcon(new PeerConnector(addr, local, p, std::move(token), ca.takeSlot(addr)));
+        pcon->setWeakPointer(PeerConnector::WPtr(pcon));
+        connectors.insert(pcon);
+        pcon->start();
+        return !potential_peers.empty();
     }
+    return false;
 }
 
 }
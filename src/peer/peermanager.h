@@ -24,8 +24,8 @@ class Authenticate;
 class ChunkCounter;
 class PieceDownloader;
 class ConnectionLimit;
-
-const Uint32 MAX_SIMULTANIOUS_AUTHS = 20;
+class MetadataDownload;
+class PeerDatabase;
 
 /*!
  * \headerfile peer/peermanager.h
@@ -63,9 +63,33 @@ public:
     //! Get the connection limits
     static ConnectionLimit &connectionLimits();
 
+    /*!
+     * Enable or disable handling of peer protocol messages on a pool of worker threads.
+     * \param on Whether or not to enable it
+     * \param num_threads Maximum number of worker threads, 0 means one per CPU core
+     */
+    static void setParallelPacketProcessing(bool on, int num_threads = 0);
+
+    //! Are peer protocol messages handled on worker threads
+    static bool parallelPacketProcessing();
+
+    /*!
+     * Handle the protocol messages received by the peers of all started PeerManagers
+     * on the worker pool (see Peer::handleControlPackets). There is one job per
+     * torrent, so the peers of a torrent are always handled by a single thread.
+     * This blocks until all jobs are finished, messages which need the main thread
+     * are handled in update() afterwards.
+     *
+     * It is called by update() of the first PeerManager which is updated in a tick,
+     * so the application does not need to call it. It does nothing if parallel packet
+     * processing is not enabled.
+     */
+    static void processPackets();
+
     /*!
      * Check for new connections, update down and upload speed of each Peer.
-     * Initiate new connections.
+     * Initiate new connections. When parallel packet processing is enabled and the
+     * messages were not handled yet since the last update, processPackets is called first.
      */
     void update();
 
@@ -140,6 +164,9 @@ public:
     //! Get the Torrent
     [[nodiscard]] const Torrent &getTorrent() const;
 
+    //! Get the database which remembers how good the peers of the torrent were
+    [[nodiscard]] const PeerDatabase &peerDatabase() const;
+
     //! Get the combined upload rate of all peers in bytes per sec
     [[nodiscard]] Uint32 uploadRate() const;
 
@@ -155,8 +182,9 @@ public:
      * Add a potential peer
      * \param addr The peers' address
      * \param local Is it a peer on the local network
+     * \param pex_flags The flags PEX gave for the peer
      **/
-    void addPotentialPeer(const net::Address &addr, bool local);
+    void addPotentialPeer(const net::Address &addr, bool local, Uint8 pex_flags = 0);
 
     /*!
      * Kills all connections to seeders.
@@ -190,12 +218,13 @@ public:
     void peerAuthenticated(Authenticate *auth, PeerConnector::WPtr pcon, bool ok, std::unique_ptr<ConnectionLimit::Token> token);
 
     /*!
-     * Save the IP's and port numbers of all peers.
+     * Save the peer database, with the connected and potential peers.
      */
     void savePeerList(const QString &file);
 
     /*!
-     * Load the peer list again and add them to the potential peers
+     * Load the peer database again and add the peers to the potential peers, the best ones first.
+     * Banned peers are banned again. Peer lists of older versions, which are text files, are loaded too.
      */
     void loadPeerList(const QString &file);
 
@@ -238,8 +267,8 @@ public:
     //! Does the choker need to run again
     [[nodiscard]] bool chokerNeedsToRun() const;
 
-    //! A PEX message was received
-    void pex(const QByteArray &arr, int ip_version);
+    //! A PEX message was received, flags contains the flags of the peers in arr and may be empty
+    void pex(const QByteArray &arr, const QByteArray &flags, int ip_version);
 
     //! A port packet was received
     void portPacketReceived(const QString &ip, Uint16 port);
@@ -250,12 +279,38 @@ public:
     //! Set the piece handler
     void setPieceHandler(PieceHandler *ph);
 
+    /*!
+     * Set the MetadataDownload which the ut_metadata extensions of all peers
+     * share when the torrent is not loaded yet (magnet links). The caller keeps ownership.
+     */
+    void setMetadataDownload(MetadataDownload *md);
+
+    //! Get the shared MetadataDownload, nullptr if there is none
+    [[nodiscard]] MetadataDownload *getMetadataDownload() const;
+
     //! Enable or disable super seeding
     void setSuperSeeding(bool on, const BitSet &chunks);
 
-    //! Send a have message to all peers
+    /*!
+     * Send a have message to all peers. The messages are queued and sent
+     * together on the next update, peers which already have the chunk are skipped.
+     * \param index The index of the chunk
+     */
     void sendHave(Uint32 index);
 
+    /*!
+     * \brief Statistics of the HAVE messages sent by a PeerManager.
+     */
+    struct HaveStats {
+        //! Number of HAVE messages sent
+        Uint64 sent = 0;
+        //! Number of HAVE messages not sent, because the peer already had the chunk
+        Uint64 suppressed = 0;
+    };
+
+    //! Get the HAVE statistics
+    [[nodiscard]] HaveStats haveStats() const;
+
     //! Set if we are a partial seed or not
     void setPartialSeed(bool partial_seed);
 
@@ -273,6 +328,9 @@ Q_SIGNALS:
     void newPeer(bt::Peer *p);
     void peerKilled(bt::Peer *p);
 
+    //! A PeerSource has delivered new potential peers
+    void potentialPeersReady();
+
 private:
     class Private;
     std::unique_ptr<Private> d;
@@ -0,0 +1,276 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "requestpipeline.h"
+
+#include <util/functions.h>
+
+#include <algorithm>
+
+namespace bt
+{
+static const Uint32 NOT_FOUND = 0xFFFFFFFF;
+
+TimeStampedRequest::TimeStampedRequest()
+    : time_stamp(bt::CurrentTime())
+{
+}
+
+TimeStampedRequest::TimeStampedRequest(const Request &r)
+    : req(r)
+    , time_stamp(bt::CurrentTime())
+{
+}
+
+TimeStampedRequest::TimeStampedRequest(const TimeStampedRequest &t)
+    : req(t.req)
+    , time_stamp(t.time_stamp)
+{
+}
+
+TimeStampedRequest::~TimeStampedRequest()
+{
+}
+
+bool TimeStampedRequest::operator==(const Request &r) const
+{
+    return r == req;
+}
+
+bool TimeStampedRequest::operator==(const TimeStampedRequest &r) const
+{
+    return r.req == req;
+}
+
+TimeStampedRequest &TimeStampedRequest::operator=(const Request &r)
+{
+    time_stamp = bt::CurrentTime();
+    req = r;
+    return *this;
+}
+
+TimeStampedRequest &TimeStampedRequest::operator=(const TimeStampedRequest &r)
+{
+    time_stamp = r.time_stamp;
+    req = r.req;
+    return *this;
+}
+
+static Uint32 RoundUpPowerOfTwo(Uint32 v)
+{
+    Uint32 r = 4;
+    while (r < v) {
+        r <<= 1;
+    }
+    return r;
+}
+
+RequestPipeline::RequestPipeline(Uint32 capacity)
+    : slots(RoundUpPowerOfTwo(capacity))
+    , index(2 * slots.size(), 0)
+    , mask(slots.size() - 1)
+    , index_mask(index.size() - 1)
+    , head(0)
+    , tail(0)
+    , num_requests(0)
+{
+}
+
+RequestPipeline::~RequestPipeline()
+{
+}
+
+Uint32 RequestPipeline::hash(const Request &req) const
+{
+    Uint32 h = req.getIndex() * 0x9E3779B1 + req.getOffset();
+    h ^= h >> 15;
+    h *= 0x2C1B3C6D;
+    h ^= h >> 12;
+    return h & index_mask;
+}
+
+Uint32 RequestPipeline::find(const Request &req) const
+{
+    // the index is never more than half full, so there is always a free entry to stop at
+    for (Uint32 pos = hash(req);; pos = (pos + 1) & index_mask) {
+        const Uint32 e = index[pos];
+        if (e == 0) {
+            return NOT_FOUND;
+        } else if (slots[e - 1].tr.req == req) {
+            return pos;
+        }
+    }
+}
+
+void RequestPipeline::insertIndex(Uint32 slot)
+{
+    Uint32 pos = hash(slots[slot].tr.req);
+    while (index[pos] != 0) {
+        pos = (pos + 1) & index_mask;
+    }
+    index[pos] = slot + 1;
+}
+
+void RequestPipeline::removeIndex(Uint32 pos)
+{
+    // backward shift deletion, move entries up which would
+    // otherwise no longer be reachable from their home position
+    Uint32 hole = pos;
+    Uint32 i = pos;
+    while (true) {
+        i = (i + 1) & index_mask;
+        const Uint32 e = index[i];
+        if (e == 0) {
+            break;
+        }
+
+        const Uint32 home = hash(slots[e - 1].tr.req);
+        const bool reachable = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (!reachable) {
+            index[hole] = e;
+            hole = i;
+        }
+    }
+    index[hole] = 0;
+}
+
+void RequestPipeline::release(Uint32 slot)
+{
+    slots[slot].used = false;
+    num_requests--;
+    // skip the holes at the front, so first() is always valid
+    while (head != tail && !slots[head & mask].used) {
+        head++;
+    }
+}
+
+void RequestPipeline::append(const Request &req)
+{
+    append(TimeStampedRequest(req));
+}
+
+void RequestPipeline::append(const TimeStampedRequest &tr)
+{
+    if (tail - head == slots.size()) {
+        makeRoom();
+    }
+
+    const Uint32 slot = tail & mask;
+    slots[slot].tr = tr;
+    slots[slot].used = true;
+    tail++;
+    num_requests++;
+    insertIndex(slot);
+}
+
+bool RequestPipeline::contains(const Request &req) const
+{
+    return find(req) != NOT_FOUND;
+}
+
+bool RequestPipeline::take(const Request &req, TimeStamp *time_stamp)
+{
+    const Uint32 pos = find(req);
+    if (pos == NOT_FOUND) {
+        return false;
+    }
+
+    const Uint32 slot = index[pos] - 1;
+    if (time_stamp) {
+        *time_stamp = slots[slot].tr.time_stamp;
+    }
+    removeIndex(pos);
+    release(slot);
+    return true;
+}
+
+Uint32 RequestPipeline::removeAll(const Request &req)
+{
+    Uint32 num = 0;
+    while (take(req)) {
+        num++;
+    }
+    return num;
+}
+
+TimeStampedRequest RequestPipeline::takeFirst()
+{
+    const Uint32 slot = head & mask;
+    const TimeStampedRequest tr = slots[slot].tr;
+    // look for the slot itself and not the request, there might be duplicates
+    Uint32 pos = hash(tr.req);
+    while (index[pos] != slot + 1) {
+        pos = (pos + 1) & index_mask;
+    }
+    removeIndex(pos);
+    release(slot);
+    return tr;
+}
+
+void RequestPipeline::clear()
+{
+    for (Uint32 seq = head; seq != tail; seq++) {
+        slots[seq & mask].used = false;
+    }
+    std::fill(index.begin(), index.end(), 0);
+    head = tail = 0;
+    num_requests = 0;
+}
+
+void RequestPipeline::makeRoom()
+{
+    // when at least half of the ring consists of holes, squeezing them out is enough,
+    // otherwise the pipeline has grown deeper and the ring needs to grow with it
+    if (2 * num_requests <= slots.size()) {
+        rebuild(slots.size());
+    } else {
+        rebuild(2 * slots.size());
+    }
+}
+
+void RequestPipeline::rebuild(Uint32 new_capacity)
+{
+    if (new_capacity == slots.size()) {
+        // compact in place, the write position never overtakes the read position
+        Uint32 write = head;
+        for (Uint32 seq = head; seq != tail; seq++) {
+            Slot &s = slots[seq & mask];
+            if (!s.used) {
+                continue;
+            }
+
+            if (seq != write) {
+                Slot &d = slots[write & mask];
+                d.tr = s.tr;
+                d.used = true;
+                s.used = false;
+            }
+            write++;
+        }
+        tail = write;
+    } else {
+        std::vector<Slot> tmp(new_capacity);
+        Uint32 write = 0;
+        for (Uint32 seq = head; seq != tail; seq++) {
+            const Slot &s = slots[seq & mask];
+            if (s.used) {
+                tmp[write++] = s;
+            }
+        }
+
+        slots.swap(tmp);
+        index.assign(2 * slots.size(), 0);
+        mask = slots.size() - 1;
+        index_mask = index.size() - 1;
+        head = 0;
+        tail = write;
+    }
+
+    std::fill(index.begin(), index.end(), 0);
+    for (Uint32 seq = head; seq != tail; seq++) {
+        insertIndex(seq & mask);
+    }
+}
+}
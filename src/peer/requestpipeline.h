@@ -0,0 +1,205 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef BT_REQUESTPIPELINE_H
+#define BT_REQUESTPIPELINE_H
+
+#include <download/request.h>
+#include <ktorrent_export.h>
+#include <util/constants.h>
+
+#include <vector>
+
+namespace bt
+{
+/*!
+ * \headerfile peer/requestpipeline.h
+ * \brief Request with a timestamp.
+ */
+struct KTORRENT_EXPORT TimeStampedRequest {
+    Request req;
+    TimeStamp time_stamp;
+
+    TimeStampedRequest();
+
+    /*!
+     * Constructor, set the request and calculate the timestamp.
+     * \param r The Request
+     */
+    TimeStampedRequest(const Request &r);
+
+    /*!
+     * Copy constructor, copy the request and the timestamp
+     * \param t The TimeStampedRequest
+     */
+    TimeStampedRequest(const TimeStampedRequest &t);
+
+    //! Destructor
+    ~TimeStampedRequest();
+
+    //! Smaller then operator, uses timestamps to compare
+    bool operator<(const TimeStampedRequest &t) const
+    {
+        return time_stamp < t.time_stamp;
+    }
+
+    /*!
+     * Equality operator, compares requests only.
+     * \param r The Request
+     * \return true if equal
+     */
+    bool operator==(const Request &r) const;
+
+    /*!
+     * Equality operator, compares requests only.
+     * \param r The Request
+     * \return true if equal
+     */
+    bool operator==(const TimeStampedRequest &r) const;
+
+    /*!
+     * Assignment operator.
+     * \param r The Request to copy
+     * \return *this
+     */
+    TimeStampedRequest &operator=(const Request &r);
+
+    /*!
+     * Assignment operator.
+     * \param r The TimeStampedRequest to copy
+     * \return *this
+     */
+    TimeStampedRequest &operator=(const TimeStampedRequest &r);
+};
+
+/*!
+ * \headerfile peer/requestpipeline.h
+ * \brief The requests which have been sent to a peer, but not yet answered.
+ *
+ * Requests are kept in a ring in the order in which they were sent, so the oldest
+ * request is always at the front. An open addressing hash table maps a request to its
+ * slot in the ring, so PIECE and REJECT messages can be matched in constant time.
+ * Requests which are removed from the middle leave a hole, which is skipped when the front
+ * is popped off and squeezed out when the ring runs full.
+ *
+ * Memory is only allocated when the number of outstanding requests exceeds the
+ * capacity, so once a peer's pipeline has reached its depth, no more allocations happen.
+ */
+class KTORRENT_EXPORT RequestPipeline
+{
+public:
+    /*!
+     * Constructor
+     * \param capacity The initial number of requests which fit in the pipeline, rounded up to a power of two
+     */
+    explicit RequestPipeline(Uint32 capacity = 64);
+    ~RequestPipeline();
+
+    //! Get the number of outstanding requests
+    [[nodiscard]] Uint32 count() const
+    {
+        return num_requests;
+    }
+
+    //! Are there no outstanding requests
+    [[nodiscard]] bool isEmpty() const
+    {
+        return num_requests == 0;
+    }
+
+    //! Get the number of requests which fit in the pipeline without allocating memory
+    [[nodiscard]] Uint32 capacity() const
+    {
+        return (Uint32)slots.size();
+    }
+
+    /*!
+     * Append a request, it will be timestamped with the current time.
+     * \param req The Request
+     */
+    void append(const Request &req);
+
+    /*!
+     * Append a request with a timestamp.
+     * \param tr The TimeStampedRequest
+     */
+    void append(const TimeStampedRequest &tr);
+
+    /*!
+     * Check if a request is outstanding.
+     * \param req The Request
+     */
+    [[nodiscard]] bool contains(const Request &req) const;
+
+    /*!
+     * Remove a request.
+     * \param req The Request
+     * \param time_stamp If not nullptr, the time the request was sent is stored in it
+     * \return true if the request was found and removed
+     */
+    bool take(const Request &req, TimeStamp *time_stamp = nullptr);
+
+    /*!
+     * Remove all copies of a request.
+     * \param req The Request
+     * \return The number of removed requests
+     */
+    Uint32 removeAll(const Request &req);
+
+    //! Get the oldest request, the pipeline may not be empty
+    [[nodiscard]] const TimeStampedRequest &first() const
+    {
+        return slots[head & mask].tr;
+    }
+
+    //! Remove and return the oldest request, the pipeline may not be empty
+    TimeStampedRequest takeFirst();
+
+    //! Remove all requests
+    void clear();
+
+    /*!
+     * Call a function for each outstanding request, from oldest to newest.
+     * The pipeline may not be modified by the function.
+     */
+    template<class Func>
+    void forEach(Func func) const
+    {
+        for (Uint32 seq = head; seq != tail; seq++) {
+            const Slot &s = slots[seq & mask];
+            if (s.used) {
+                func(s.tr);
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        TimeStampedRequest tr;
+        bool used = false;
+    };
+
+    [[nodiscard]] Uint32 hash(const Request &req) const;
+    [[nodiscard]] Uint32 find(const Request &req) const;
+    void insertIndex(Uint32 slot);
+    void removeIndex(Uint32 pos);
+    void release(Uint32 slot);
+    void makeRoom();
+    void rebuild(Uint32 new_capacity);
+
+private:
+    std::vector<Slot> slots;
+    // slot + 1 of each outstanding request, 0 marks a free entry
+    std::vector<Uint32> index;
+    Uint32 mask;
+    Uint32 index_mask;
+    Uint32 head;
+    Uint32 tail;
+    Uint32 num_requests;
+};
+
+}
+
+#endif
@@ -31,13 +31,12 @@ void ServerAuthenticate::onFinish(bool success)
 {
     Out(SYS_CON | LOG_NOTICE) << "Authentication(S) to " << sock->getRemoteIPAddress() << " : " << (success ? "ok" : "failure") << endl;
     finished = true;
+    this->success = success;
     setFirewalled(false);
 
     if (!success) {
         sock.reset();
     }
-
-    timer.stop();
 }
 
 void ServerAuthenticate::handshakeReceived(bool full)
@@ -14,8 +14,12 @@
 
 namespace bt
 {
+static const Uint32 NONE = 0xFFFFFFFF;
+
 SuperSeeder::SuperSeeder(Uint32 num_chunks)
     : chunk_counter(std::make_unique<ChunkCounter>(num_chunks))
+    , chunk_offers(num_chunks, NONE)
+    , free_offers(NONE)
     , num_seeders(0)
 {
 }
@@ -31,34 +35,33 @@ void SuperSeeder::have(PeerInterface *peer, Uint32 chunk)
         num_seeders++;
     }
 
-    QList<PeerInterface *> peers;
-
-    ActiveChunkItr i = active_chunks.find(chunk);
-    while (i != active_chunks.end() && i.key() == chunk) {
-        // Somebody else has an active chunk we sent to p2
-        PeerInterface *p2 = i.value();
-        if (peer != p2) {
-            active_peers.remove(p2);
-            i = active_chunks.erase(i);
-            // p2 has probably been a good boy, he can download another chunk from us
-            peers.append(p2);
-        } else {
-            ++i;
+    Uint32 o = chunk_offers[chunk];
+    while (o != NONE) {
+        const Offer &offer = offers[o];
+        const Uint32 next = offer.next_in_chunk;
+        const Uint32 p2 = offer.peer;
+        if (peers[p2].peer != peer) {
+            // Somebody else has a chunk we sent to p2, p2 has probably
+            // been a good boy, he can download another chunk from us
+            removeOffer(o);
+            peers[p2].num_propagated++;
+            refill.push_back(p2);
         }
+        o = next;
     }
 
-    for (PeerInterface *p : std::as_const(peers)) {
-        sendChunk(p);
+    for (Uint32 p2 : std::as_const(refill)) {
+        sendChunks(p2);
     }
+    refill.clear();
 }
 
 void SuperSeeder::haveAll(PeerInterface *peer)
 {
     // Lets just ignore seeders
-    if (active_peers.contains(peer)) {
-        const Uint32 chunk = active_peers[peer];
-        active_chunks.remove(chunk, peer);
-        active_peers.remove(peer);
+    const auto i = peer_index.constFind(peer);
+    if (i != peer_index.constEnd()) {
+        removeOffers(i.value());
     }
 
     num_seeders++;
@@ -85,17 +88,20 @@ void SuperSeeder::peerAdded(PeerInterface *peer)
         num_seeders++;
     } else {
         chunk_counter->incBitSet(peer->getBitSet());
-        sendChunk(peer);
+        sendChunks(addPeer(peer));
     }
 }
 
 void SuperSeeder::peerRemoved(PeerInterface *peer)
 {
     // remove the peer
-    if (active_peers.contains(peer)) {
-        const Uint32 chunk = active_peers[peer];
-        active_chunks.remove(chunk, peer);
-        active_peers.remove(peer);
+    const auto i = peer_index.constFind(peer);
+    if (i != peer_index.constEnd()) {
+        const Uint32 idx = i.value();
+        removeOffers(idx);
+        peers[idx].peer = nullptr;
+        free_peers.push_back(idx);
+        peer_index.erase(i);
     }
 
     // decrease num_seeders if the peer is a seeder
@@ -106,63 +112,167 @@ void SuperSeeder::peerRemoved(PeerInterface *peer)
     chunk_counter->decBitSet(peer->getBitSet());
 }
 
-void SuperSeeder::sendChunk(PeerInterface *peer)
+Uint32 SuperSeeder::numOffers(PeerInterface *peer) const
 {
-    if (active_peers.contains(peer)) {
-        return;
+    const auto i = peer_index.constFind(peer);
+    return i != peer_index.constEnd() ? peers[i.value()].num_offers : 0;
+}
+
+Uint32 SuperSeeder::addPeer(PeerInterface *peer)
+{
+    const auto i = peer_index.constFind(peer);
+    if (i != peer_index.constEnd()) {
+        return i.value();
     }
 
-    const BitSet &bs = peer->getBitSet();
-    if (bs.allOn()) {
-        return;
+    Uint32 idx;
+    if (!free_peers.empty()) {
+        idx = free_peers.back();
+        free_peers.pop_back();
+    } else {
+        idx = peers.size();
+        peers.emplace_back();
+    }
+
+    peers[idx] = PeerEntry{peer, NONE, 0, 0};
+    peer_index.insert(peer, idx);
+    return idx;
+}
+
+void SuperSeeder::addOffer(Uint32 peer, Uint32 chunk)
+{
+    Uint32 o;
+    if (free_offers != NONE) {
+        o = free_offers;
+        free_offers = offers[o].next_in_peer;
+    } else {
+        o = offers.size();
+        offers.emplace_back();
+    }
+
+    PeerEntry &pe = peers[peer];
+    offers[o] = Offer{peer, chunk, NONE, chunk_offers[chunk], NONE, pe.first_offer};
+    if (chunk_offers[chunk] != NONE) {
+        offers[chunk_offers[chunk]].prev_in_chunk = o;
+    }
+    chunk_offers[chunk] = o;
+
+    if (pe.first_offer != NONE) {
+        offers[pe.first_offer].prev_in_peer = o;
+    }
+    pe.first_offer = o;
+    pe.num_offers++;
+}
+
+void SuperSeeder::removeOffer(Uint32 o)
+{
+    Offer &offer = offers[o];
+    if (offer.prev_in_chunk != NONE) {
+        offers[offer.prev_in_chunk].next_in_chunk = offer.next_in_chunk;
+    } else {
+        chunk_offers[offer.chunk] = offer.next_in_chunk;
+    }
+    if (offer.next_in_chunk != NONE) {
+        offers[offer.next_in_chunk].prev_in_chunk = offer.prev_in_chunk;
+    }
+
+    PeerEntry &pe = peers[offer.peer];
+    if (offer.prev_in_peer != NONE) {
+        offers[offer.prev_in_peer].next_in_peer = offer.next_in_peer;
+    } else {
+        pe.first_offer = offer.next_in_peer;
+    }
+    if (offer.next_in_peer != NONE) {
+        offers[offer.next_in_peer].prev_in_peer = offer.prev_in_peer;
+    }
+    pe.num_offers--;
+
+    offer.next_in_peer = free_offers;
+    free_offers = o;
+}
+
+void SuperSeeder::removeOffers(Uint32 peer)
+{
+    while (peers[peer].first_offer != NONE) {
+        removeOffer(peers[peer].first_offer);
     }
+}
 
+bool SuperSeeder::offered(Uint32 peer, Uint32 chunk) const
+{
+    for (Uint32 o = peers[peer].first_offer; o != NONE; o = offers[o].next_in_peer) {
+        if (offers[o].chunk == chunk) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Uint32 SuperSeeder::selectChunk(Uint32 peer) const
+{
+    const BitSet &bs = peers[peer].peer->getBitSet();
     // Use random chunk to start searching for a potential chunk we can send
     const Uint32 num_chunks = chunk_counter->getNumChunks();
     const Uint32 start = QRandomGenerator::global()->bounded(num_chunks);
-    Uint32 chunk = (start + 1) % num_chunks;
-    Uint32 alternative = num_chunks;
-    const Uint32 alternative_num_owners = std::numeric_limits<Uint32>::max();
-    while (chunk != start) {
-        chunk = (chunk + 1) % num_chunks;
-        if (bs.get(chunk)) {
+    Uint32 alternative = NONE;
+    Uint32 alternative_num_owners = std::numeric_limits<Uint32>::max();
+    for (Uint32 i = 0; i < num_chunks; i++) {
+        const Uint32 chunk = (start + i) % num_chunks;
+        if (bs.get(chunk) || offered(peer, chunk)) {
             continue;
         }
 
         // Search for a chunk which no downloader has, or has been sent.
         // Otherwise choose the rarest chunk
         const Uint32 num_chunk_owners = chunk_counter->get(chunk);
-        if (num_chunk_owners == num_seeders && !active_chunks.contains(chunk)) {
-            peer->chunkAllowed(chunk);
-            active_chunks.insert(chunk, peer);
-            active_peers[peer] = chunk;
-            return;
+        if (num_chunk_owners == num_seeders && chunk_offers[chunk] == NONE) {
+            return chunk;
         } else if (num_chunk_owners < alternative_num_owners) {
             alternative = chunk;
+            alternative_num_owners = num_chunk_owners;
         }
     }
 
-    if (alternative < num_chunks) {
-        peer->chunkAllowed(alternative);
-        active_chunks.insert(alternative, peer);
-        active_peers[peer] = alternative;
+    return alternative;
+}
+
+void SuperSeeder::sendChunks(Uint32 peer)
+{
+    if (peers[peer].peer->getBitSet().allOn()) {
+        return;
+    }
+
+    // peers which have shown they pass on what we send them get more chunks at the same time
+    const Uint32 max_offers = qMin(MAX_CHUNKS_PER_PEER, 1 + peers[peer].num_propagated / PROPAGATIONS_PER_EXTRA_CHUNK);
+    while (peers[peer].num_offers < max_offers) {
+        const Uint32 chunk = selectChunk(peer);
+        if (chunk == NONE) {
+            break;
+        }
+
+        addOffer(peer, chunk);
+        peers[peer].peer->chunkAllowed(chunk);
     }
 }
 
 void SuperSeeder::dump()
 {
     Out(SYS_GEN | LOG_DEBUG) << "Active chunks: " << endl;
-    ActiveChunkItr i = active_chunks.begin();
-    while (i != active_chunks.end()) {
-        Out(SYS_GEN | LOG_DEBUG) << "Chunk " << i.key() << " : " << i.value()->getPeerID().toString() << endl;
-        ++i;
+    for (Uint32 chunk = 0; chunk < chunk_offers.size(); chunk++) {
+        for (Uint32 o = chunk_offers[chunk]; o != NONE; o = offers[o].next_in_chunk) {
+            Out(SYS_GEN | LOG_DEBUG) << "Chunk " << chunk << " : " << peers[offers[o].peer].peer->getPeerID().toString() << endl;
+        }
     }
 
     Out(SYS_GEN | LOG_DEBUG) << "Active peers: " << endl;
-    ActivePeerItr j = active_peers.begin();
-    while (j != active_peers.end()) {
-        Out(SYS_GEN | LOG_DEBUG) << "Peer " << j.key()->getPeerID().toString() << " : " << j.value() << endl;
-        ++j;
+    for (const PeerEntry &pe : peers) {
+        if (!pe.peer || pe.num_offers == 0) {
+            continue;
+        }
+
+        for (Uint32 o = pe.first_offer; o != NONE; o = offers[o].next_in_peer) {
+            Out(SYS_GEN | LOG_DEBUG) << "Peer " << pe.peer->getPeerID().toString() << " : " << offers[o].chunk << endl;
+        }
     }
 }
 
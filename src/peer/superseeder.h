@@ -7,12 +7,12 @@
 #ifndef BT_SUPERSEEDER_H
 #define BT_SUPERSEEDER_H
 
-#include <QMap>
-#include <QSet>
+#include <QHash>
 #include <ktorrent_export.h>
 #include <util/constants.h>
 
 #include <memory>
+#include <vector>
 
 namespace bt
 {
@@ -26,6 +26,14 @@ class BitSet;
 
     Superseeding is a way to achieve much higher seeding efficiences, thereby allowing a peer to use much less bandwidth to get a torrent seeded.
     \sa http://bittorrent.org/beps/bep_0016.html
+
+    Every chunk a peer is allowed to download is an offer. Offers are kept in a flat pool and are
+    linked into two intrusive lists: one per chunk and one per peer. This way HAVE messages only
+    need to walk the offers of one chunk and no memory is allocated once the pool has grown.
+
+    A peer starts with one offer, each time a chunk it was offered shows up at another peer, it has
+    proven it can upload. Peers which propagate chunks get more offers at the same time, up to
+    MAX_CHUNKS_PER_PEER.
 */
 class KTORRENT_EXPORT SuperSeeder
 {
@@ -69,22 +77,58 @@ public:
     */
     void peerRemoved(PeerInterface *peer);
 
+    /*!
+        Get the number of chunks a peer is currently allowed to download.
+        \param peer The Peer
+    */
+    [[nodiscard]] Uint32 numOffers(PeerInterface *peer) const;
+
     /*!
         Dump the status of the SuperSeeder for debugging purposes.
     */
     void dump();
 
+    //! Maximum number of chunks a peer is allowed to download at the same time
+    static constexpr Uint32 MAX_CHUNKS_PER_PEER = 4;
+
+    //! Number of chunks a peer needs to propagate to get an extra offer
+    static constexpr Uint32 PROPAGATIONS_PER_EXTRA_CHUNK = 2;
+
 private:
-    void sendChunk(PeerInterface *peer);
+    struct Offer {
+        Uint32 peer;
+        Uint32 chunk;
+        Uint32 prev_in_chunk;
+        Uint32 next_in_chunk;
+        Uint32 prev_in_peer;
+        Uint32 next_in_peer; // also links the free offers
+    };
+
+    struct PeerEntry {
+        PeerInterface *peer;
+        Uint32 first_offer;
+        Uint32 num_offers;
+        Uint32 num_propagated;
+    };
+
+    Uint32 addPeer(PeerInterface *peer);
+    void addOffer(Uint32 peer, Uint32 chunk);
+    void removeOffer(Uint32 offer);
+    void removeOffers(Uint32 peer);
+    [[nodiscard]] bool offered(Uint32 peer, Uint32 chunk) const;
+    [[nodiscard]] Uint32 selectChunk(Uint32 peer) const;
+    void sendChunks(Uint32 peer);
 
 private:
     std::unique_ptr<ChunkCounter> chunk_counter;
-    QMultiMap<bt::Uint32, bt::PeerInterface *> active_chunks;
-    QMap<bt::PeerInterface *, bt::Uint32> active_peers;
+    std::vector<Uint32> chunk_offers; // first offer of each chunk
+    std::vector<Offer> offers;
+    Uint32 free_offers;
+    std::vector<PeerEntry> peers;
+    std::vector<Uint32> free_peers;
+    QHash<PeerInterface *, Uint32> peer_index;
+    std::vector<Uint32> refill;
     Uint32 num_seeders;
-
-    using ActiveChunkItr = QMultiMap<bt::Uint32, bt::PeerInterface *>::iterator;
-    using ActivePeerItr = QMap<bt::PeerInterface *, bt::Uint32>::iterator;
 };
 
 }
@@ -5,10 +5,12 @@
 */
 
 #include <QObject>
+#include <QRandomGenerator>
 #include <QTest>
 
 #include <interfaces/blocklistinterface.h>
 #include <peer/accessmanager.h>
+#include <peer/ipfilter.h>
 #include <torrent/server.h>
 #include <tracker/tracker.h>
 #include <util/log.h>
@@ -32,6 +34,35 @@ public:
     }
 };
 
+class RangeBlockList : public bt::BlockListInterface
+{
+public:
+    RangeBlockList()
+    {
+    }
+
+    ~RangeBlockList() override
+    {
+    }
+
+    [[nodiscard]] bool blocked(const net::Address &addr) const override
+    {
+        Q_UNUSED(addr);
+        // never called, the list is compiled
+        return true;
+    }
+
+    bool compile(bt::IPFilter::Builder &builder) const override
+    {
+        for (const auto &r : ranges) {
+            builder.addRange(r.first, r.second);
+        }
+        return true;
+    }
+
+    QList<std::pair<bt::Uint32, bt::Uint32>> ranges;
+};
+
 class AccessManagerTest : public QObject
 {
     Q_OBJECT
@@ -69,6 +100,130 @@ private Q_SLOTS:
         QVERIFY(bt::AccessManager::instance().allowed(net::Address(u"8.8.8.9"_s, 7776)));
     }
 
+    void testBanPeer()
+    {
+        bt::AccessManager::instance().banPeer(u"9.9.9.9"_s);
+        QVERIFY(!bt::AccessManager::instance().allowed(net::Address(u"9.9.9.9"_s, 7776)));
+        QVERIFY(!bt::AccessManager::instance().allowed(net::Address(u"::ffff:9.9.9.9"_s, 7776)));
+        QVERIFY(bt::AccessManager::instance().allowed(net::Address(u"9.9.9.8"_s, 7776)));
+    }
+
+    void testBanPeers()
+    {
+        bt::AccessManager::instance().banPeers({u"9.9.8.1"_s, u"9.9.8.2"_s, u"2001:db8::9"_s, u"not an address"_s});
+        QVERIFY(!bt::AccessManager::instance().allowed(net::Address(u"9.9.8.1"_s, 7776)));
+        QVERIFY(!bt::AccessManager::instance().allowed(net::Address(u"9.9.8.2"_s, 7776)));
+        QVERIFY(!bt::AccessManager::instance().allowed(net::Address(u"2001:db8::9"_s, 7776)));
+        QVERIFY(bt::AccessManager::instance().isBanned(net::Address(u"9.9.8.2"_s, 7776)));
+        QVERIFY(bt::AccessManager::instance().allowed(net::Address(u"9.9.8.3"_s, 7776)));
+    }
+
+    void testIPFilter()
+    {
+        bt::IPFilter::Builder builder;
+        builder.addRange(QHostAddress(u"10.0.0.0"_s), QHostAddress(u"10.0.0.255"_s));
+        // overlapping and adjacent ranges get merged
+        builder.addRange(QHostAddress(u"10.0.0.100"_s), QHostAddress(u"10.0.1.10"_s));
+        builder.addRange(QHostAddress(u"10.0.1.11"_s), QHostAddress(u"10.0.1.20"_s));
+        builder.addAddress(QHostAddress(u"255.255.255.255"_s));
+        builder.addRange(QHostAddress(u"2001:db8::"_s), QHostAddress(u"2001:db8::ffff"_s));
+        // mixed protocols and reversed ranges are ignored
+        builder.addRange(QHostAddress(u"1.1.1.1"_s), QHostAddress(u"2001:db8::1"_s));
+        builder.addRange(QHostAddress(u"5.5.5.5"_s), QHostAddress(u"5.5.5.4"_s));
+        const bt::IPFilter f = builder.build();
+        QCOMPARE(f.numRanges(), 3u);
+
+        QVERIFY(!f.contains(QHostAddress(u"9.255.255.255"_s)));
+        QVERIFY(f.contains(QHostAddress(u"10.0.0.0"_s)));
+        QVERIFY(f.contains(QHostAddress(u"10.0.1.15"_s)));
+        QVERIFY(f.contains(QHostAddress(u"10.0.1.20"_s)));
+        QVERIFY(!f.contains(QHostAddress(u"10.0.1.21"_s)));
+        QVERIFY(f.contains(QHostAddress(u"255.255.255.255"_s)));
+        QVERIFY(!f.contains(QHostAddress(u"1.1.1.1"_s)));
+        QVERIFY(!f.contains(QHostAddress(u"5.5.5.5"_s)));
+        QVERIFY(f.contains(QHostAddress(u"::ffff:10.0.0.1"_s)));
+        QVERIFY(f.contains(QHostAddress(u"2001:db8::abcd"_s)));
+        QVERIFY(!f.contains(QHostAddress(u"2001:db8::1:0"_s)));
+        QVERIFY(!f.contains(QHostAddress(u"::1"_s)));
+
+        QVERIFY(!bt::IPFilter().contains(QHostAddress(u"10.0.0.0"_s)));
+    }
+
+    void testIPFilterWithAddresses()
+    {
+        bt::IPFilter::Builder builder;
+        builder.addRange(QHostAddress(u"10.0.0.0"_s), QHostAddress(u"10.0.0.9"_s));
+        builder.addRange(QHostAddress(u"10.0.0.11"_s), QHostAddress(u"10.0.0.20"_s));
+        builder.addRange(QHostAddress(u"2001:db8::"_s), QHostAddress(u"2001:db8::ffff"_s));
+        const bt::IPFilter f = builder.build();
+        QCOMPARE(f.numRanges(), 3u);
+
+        // already in a range, not touching any, and extending the end of a range
+        bt::IPFilter g = f.withAddresses({QHostAddress(u"10.0.0.5"_s), QHostAddress(u"1.1.1.1"_s), QHostAddress(u"10.0.0.21"_s)});
+        QCOMPARE(g.numRanges(), 4u);
+        QVERIFY(g.contains(QHostAddress(u"1.1.1.1"_s)));
+        QVERIFY(g.contains(QHostAddress(u"10.0.0.21"_s)));
+        QVERIFY(!g.contains(QHostAddress(u"10.0.0.10"_s)));
+        QVERIFY(!g.contains(QHostAddress(u"1.1.1.2"_s)));
+
+        // filling the gap joins two ranges, the IPv6 one gets extended at the start
+        g = g.withAddresses({QHostAddress(u"10.0.0.10"_s), QHostAddress(u"2001:db7:ffff:ffff:ffff:ffff:ffff:ffff"_s)});
+        QCOMPARE(g.numRanges(), 3u);
+        QVERIFY(g.contains(QHostAddress(u"10.0.0.10"_s)));
+        QVERIFY(g.contains(QHostAddress(u"2001:db7:ffff:ffff:ffff:ffff:ffff:ffff"_s)));
+        QVERIFY(g.contains(QHostAddress(u"2001:db8::1"_s)));
+
+        // the original is not changed
+        QCOMPARE(f.numRanges(), 3u);
+        QVERIFY(!f.contains(QHostAddress(u"1.1.1.1"_s)));
+    }
+
+    void testCompiledBlockList()
+    {
+        auto *bl = new RangeBlockList();
+        bl->ranges.append({0x01020300, 0x010203FF});
+        bt::AccessManager::instance().addBlockList(bl);
+        QVERIFY(!bt::AccessManager::instance().allowed(net::Address(u"1.2.3.4"_s, 7776)));
+        QVERIFY(bt::AccessManager::instance().allowed(net::Address(u"1.2.4.4"_s, 7776)));
+
+        // changes only take effect after a rebuild
+        bl->ranges.append({0x01020400, 0x010204FF});
+        QVERIFY(bt::AccessManager::instance().allowed(net::Address(u"1.2.4.4"_s, 7776)));
+        bt::AccessManager::instance().blockListChanged();
+        QVERIFY(!bt::AccessManager::instance().allowed(net::Address(u"1.2.4.4"_s, 7776)));
+
+        bt::AccessManager::instance().removeBlockList(bl);
+        delete bl;
+        QVERIFY(bt::AccessManager::instance().allowed(net::Address(u"1.2.3.4"_s, 7776)));
+    }
+
+    void benchmarkBlockList()
+    {
+        // a blocklist of the size of the popular level1 list, every other block of 4096 addresses
+        auto *bl = new RangeBlockList();
+        for (bt::Uint32 i = 0; i < 500000; i++) {
+            const bt::Uint32 start = 0x01000000 + i * 8192;
+            bl->ranges.append({start, start + 4095});
+        }
+        bt::AccessManager::instance().addBlockList(bl);
+
+        QList<net::Address> addresses;
+        for (int i = 0; i < 1000; i++) {
+            addresses.append(net::Address(QRandomGenerator::global()->generate(), 6881));
+        }
+
+        int num_allowed = 0;
+        QBENCHMARK {
+            for (const net::Address &addr : std::as_const(addresses)) {
+                num_allowed += bt::AccessManager::instance().allowed(addr) ? 1 : 0;
+            }
+        }
+        QVERIFY(num_allowed > 0);
+
+        bt::AccessManager::instance().removeBlockList(bl);
+        delete bl;
+    }
+
 private:
 };
 
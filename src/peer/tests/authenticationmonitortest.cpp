@@ -0,0 +1,197 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QPointer>
+#include <QTest>
+
+#include <cstring>
+#include <mse/encryptedpacketsocket.h>
+#include <numeric>
+#include <peer/authenticatebase.h>
+#include <peer/authenticationmonitor.h>
+#include <util/functions.h>
+#include <util/log.h>
+
+#include <utils.h>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+class FakeAuthenticate : public AuthenticateBase
+{
+public:
+    FakeAuthenticate(Uint32 timeout)
+    {
+        handshake_timeout = timeout;
+    }
+
+    FakeAuthenticate(std::unique_ptr<mse::EncryptedPacketSocket> s, Uint32 timeout)
+        : AuthenticateBase(std::move(s))
+    {
+        handshake_timeout = timeout;
+    }
+
+protected:
+    void onFinish(bool ok) override
+    {
+        finished = true;
+        success = ok;
+    }
+
+    void handshakeReceived(bool full) override
+    {
+        if (full) {
+            onFinish(true);
+        }
+    }
+};
+
+static Uint64 Sum(const std::array<Uint64, AuthenticationMonitor::NUM_LATENCY_BUCKETS> &histogram)
+{
+    return std::accumulate(histogram.begin(), histogram.end(), Uint64(0));
+}
+
+class AuthenticationMonitorTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    AuthenticationMonitorTest()
+    {
+    }
+    ~AuthenticationMonitorTest() override
+    {
+    }
+
+private:
+    // Finished handshakes are deleted, so the pointer may become null while waiting
+    static bool waitFinished(const QPointer<AuthenticateBase> &auth, bool call_update)
+    {
+        for (int i = 0; i < 200 && auth && !auth->isFinished(); i++) {
+            if (call_update) {
+                AuthenticationMonitor::instance().update();
+            }
+            QTest::qWait(10);
+        }
+        return !auth || auth->isFinished();
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QVERIFY(bt::InitLibKTorrent());
+        bt::InitLog(u"authenticationmonitortest.log"_s);
+    }
+
+    void cleanupTestCase()
+    {
+        AuthenticationMonitor::instance().clear();
+    }
+
+    void testBucketLimit()
+    {
+        QCOMPARE(AuthenticationMonitor::Stats::bucketLimit(0), 10u);
+        QCOMPARE(AuthenticationMonitor::Stats::bucketLimit(1), 20u);
+        QCOMPARE(AuthenticationMonitor::Stats::bucketLimit(AuthenticationMonitor::NUM_LATENCY_BUCKETS - 1), 10u << 11);
+    }
+
+    void testHandshake()
+    {
+        AuthenticationMonitor &mon = AuthenticationMonitor::instance();
+        const AuthenticationMonitor::Stats before = mon.stats();
+
+        auto socket_pair = CreateSocketPair(4);
+        QVERIFY(socket_pair.has_value());
+        QPointer<AuthenticateBase> auth = new FakeAuthenticate(std::make_unique<mse::EncryptedPacketSocket>(std::move(socket_pair->reader)), 5000);
+        mon.add(auth);
+        QCOMPARE(mon.stats().pending, before.pending + 1);
+
+        Uint8 hs[68];
+        memset(hs, 0, sizeof(hs));
+        hs[0] = 19;
+        memcpy(hs + 1, "BitTorrent protocol", 19);
+        QCOMPARE(socket_pair->writer->send(QByteArrayView(hs, sizeof(hs))), 68);
+
+        // on Linux TCP handshakes are handled by the event loop, elsewhere they need update
+#ifdef Q_OS_LINUX
+        QVERIFY(waitFinished(auth, false));
+#else
+        QVERIFY(waitFinished(auth, true));
+#endif
+        mon.update();
+
+        const AuthenticationMonitor::Stats after = mon.stats();
+        QCOMPARE(after.pending, before.pending);
+        QCOMPARE(after.succeeded, before.succeeded + 1);
+        QCOMPARE(after.failed, before.failed);
+        QCOMPARE(Sum(after.success_latency), Sum(before.success_latency) + 1);
+
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+        QVERIFY(auth.isNull());
+    }
+
+    void testTimeout()
+    {
+        AuthenticationMonitor &mon = AuthenticationMonitor::instance();
+        const AuthenticationMonitor::Stats before = mon.stats();
+
+        auto socket_pair = CreateSocketPair(4);
+        QVERIFY(socket_pair.has_value());
+        QPointer<AuthenticateBase> auth = new FakeAuthenticate(std::make_unique<mse::EncryptedPacketSocket>(std::move(socket_pair->reader)), 200);
+        const TimeStamp start = Now();
+        mon.add(auth);
+
+        QVERIFY(waitFinished(auth, true));
+        QVERIFY(Now() - start >= 200);
+
+        const AuthenticationMonitor::Stats after = mon.stats();
+        QCOMPARE(after.failed, before.failed + 1);
+        QCOMPARE(after.timed_out, before.timed_out + 1);
+        // 200 ms and a bit, which falls in the bucket below 320 or 640 ms
+        QCOMPARE(after.failure_latency[5] + after.failure_latency[6], before.failure_latency[5] + before.failure_latency[6] + 1);
+    }
+
+    void testBoundedQueue()
+    {
+        AuthenticationMonitor &mon = AuthenticationMonitor::instance();
+        const AuthenticationMonitor::Stats before = mon.stats();
+        QCOMPARE(before.pending, 0u);
+
+        mon.setMaxPending(1);
+        QVERIFY(mon.acceptIncoming());
+
+        FakeAuthenticate *a = new FakeAuthenticate(5000);
+        QPointer<AuthenticateBase> b = new FakeAuthenticate(5000);
+        mon.add(a);
+        mon.add(b);
+        QVERIFY(!mon.acceptIncoming());
+
+        // the one over the limit fails on the next update
+        mon.update();
+        QVERIFY(b->isFinished());
+        QVERIFY(!b->isSuccessful());
+        QVERIFY(!a->isFinished());
+
+        AuthenticationMonitor::Stats after = mon.stats();
+        QCOMPARE(after.pending, 1u);
+        QCOMPARE(after.rejected, before.rejected + 2);
+        QCOMPARE(after.failed, before.failed);
+
+        mon.remove(a);
+        delete a;
+        QCOMPARE(mon.stats().pending, 0u);
+        mon.setMaxPending(AuthenticationMonitor::DEFAULT_MAX_PENDING);
+        QVERIFY(mon.acceptIncoming());
+
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+        QVERIFY(b.isNull());
+    }
+};
+
+QTEST_MAIN(AuthenticationMonitorTest)
+
+#include "authenticationmonitortest.moc"
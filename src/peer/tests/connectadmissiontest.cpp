@@ -0,0 +1,141 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTest>
+
+#include <peer/connectadmission.h>
+#include <util/log.h>
+
+#include <memory>
+#include <vector>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+// Opens a connection to each of its peers in turn, and keeps the slots
+class TestClient : public ConnectAdmission::Client
+{
+public:
+    TestClient(ConnectAdmission &ca, Uint32 num_peers, Uint8 subnet)
+        : ca(ca)
+        , num_peers(num_peers)
+        , subnet(subnet)
+    {
+    }
+
+    bool connectAdmitted() override
+    {
+        if (num_peers == 0) {
+            return false;
+        }
+
+        const net::Address addr(u"10.%1.0.%2"_s.arg(subnet).arg(slots.size() + 1), 6881);
+        slots.push_back(ca.takeSlot(addr));
+        num_peers--;
+        return num_peers > 0;
+    }
+
+    ConnectAdmission &ca;
+    Uint32 num_peers;
+    Uint8 subnet;
+    std::vector<std::unique_ptr<ConnectAdmission::Slot>> slots;
+};
+
+class ConnectAdmissionTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    ConnectAdmissionTest()
+    {
+    }
+    ~ConnectAdmissionTest() override
+    {
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"connectadmissiontest.log"_s);
+    }
+
+    void testFairShare()
+    {
+        ConnectAdmission ca(6, 0);
+        TestClient a(ca, 100, 1);
+        TestClient b(ca, 3, 2);
+        ca.request(&a);
+        ca.request(&b);
+
+        // the half open connections are split evenly
+        QTRY_COMPARE(ca.stats().half_open, 6u);
+        QCOMPARE(a.slots.size(), size_t(3));
+        QCOMPARE(b.slots.size(), size_t(3));
+        QCOMPARE(ca.stats().waiting_clients, 1u);
+
+        // b has no peers left, so a gets all the freed slots
+        b.slots.clear();
+        QTRY_COMPARE(a.slots.size(), size_t(6));
+        QCOMPARE(ca.stats().half_open, 6u);
+        QCOMPARE(ca.stats().aborted, Uint64(3));
+
+        ca.remove(&a);
+        a.slots.clear();
+        QTest::qWait(50);
+        QCOMPARE(a.slots.size(), size_t(0));
+        QCOMPARE(ca.stats().half_open, 0u);
+    }
+
+    void testPacing()
+    {
+        ConnectAdmission ca(100, 10);
+        TestClient a(ca, 100, 1);
+        QElapsedTimer timer;
+        timer.start();
+        ca.request(&a);
+
+        // a burst of one second worth of connects, and then the rest is paced
+        QTRY_COMPARE(a.slots.size(), size_t(10));
+        QTest::qWait(50);
+        QVERIFY(a.slots.size() < 12u);
+        QTRY_COMPARE_WITH_TIMEOUT(a.slots.size(), size_t(15), 5000);
+        QVERIFY(timer.elapsed() >= 400);
+    }
+
+    void testMetrics()
+    {
+        ConnectAdmission ca(10, 0);
+        const net::Address good(u"10.0.0.1"_s, 6881);
+        const net::Address bad(u"10.0.0.2"_s, 6881);
+        const net::Address unknown(u"10.0.0.3"_s, 6881);
+
+        for (int i = 0; i < 3; i++) {
+            ca.takeSlot(good)->succeeded();
+            ca.takeSlot(bad)->failed();
+        }
+        {
+            const auto aborted = ca.takeSlot(unknown);
+        }
+
+        const ConnectAdmission::Stats s = ca.stats();
+        QCOMPARE(s.attempts, Uint64(7));
+        QCOMPARE(s.succeeded, Uint64(3));
+        QCOMPARE(s.failed, Uint64(3));
+        QCOMPARE(s.aborted, Uint64(1));
+        QCOMPARE(s.half_open, 0u);
+
+        // peers which could be connected to before are preferred
+        QCOMPARE(ca.expectedValue(unknown), 0.5);
+        QVERIFY(ca.expectedValue(good) > ca.expectedValue(unknown));
+        QVERIFY(ca.expectedValue(bad) < ca.expectedValue(unknown));
+    }
+};
+
+QTEST_MAIN(ConnectAdmissionTest)
+
+#include "connectadmissiontest.moc"
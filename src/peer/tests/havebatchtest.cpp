@@ -0,0 +1,182 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include <map>
+#include <memory>
+#include <mse/encryptedpacketsocket.h>
+#include <peer/peer.h>
+#include <peer/peerid.h>
+#include <peer/peermanager.h>
+#include <torrent/torrent.h>
+#include <util/constants.h>
+#include <util/error.h>
+#include <util/fileops.h>
+#include <util/functions.h>
+#include <util/log.h>
+#include <vector>
+
+#include <dummytorrentcreator.h>
+#include <utils.h>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+static const Uint32 NUM_PEERS = 3;
+
+class HaveBatchTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    HaveBatchTest()
+    {
+    }
+    ~HaveBatchTest() override
+    {
+    }
+
+private:
+    // the chunk indices of the HAVE messages a peer received
+    std::vector<Uint32> receivedHaves(Uint32 peer) const
+    {
+        std::vector<Uint32> haves;
+        const QByteArray &buf = received.at(peer);
+        int off = 0;
+        while (off + 4 <= buf.size()) {
+            const Uint32 len = ReadUint32((const Uint8 *)buf.constData(), off);
+            if (off + 4 + (int)len > buf.size()) {
+                break;
+            }
+            if (len == 5 && (Uint8)buf[off + 4] == HAVE) {
+                haves.push_back(ReadUint32((const Uint8 *)buf.constData(), off + 5));
+            }
+            off += 4 + len;
+        }
+        return haves;
+    }
+
+    // read what the peers were sent until they all got the expected number of HAVEs
+    bool waitForHaves(const std::vector<size_t> &expected)
+    {
+        for (int i = 0; i < 200; i++) {
+            bool done = true;
+            for (Uint32 j = 0; j < NUM_PEERS; j++) {
+                Uint8 tmp[1024];
+                while (writers[j]->bytesAvailable() > 0) {
+                    const int ret = writers[j]->recv(tmp, sizeof(tmp));
+                    if (ret <= 0) {
+                        break;
+                    }
+                    received[j].append((const char *)tmp, ret);
+                }
+                done = done && receivedHaves(j).size() >= expected[j];
+            }
+            if (done) {
+                return true;
+            }
+            QTest::qWait(10);
+        }
+        return false;
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QVERIFY(bt::InitLibKTorrent());
+        bt::InitLog(u"havebatchtest.log"_s);
+        Peer::setResolveHostnames(false);
+
+        QVERIFY(creator.createSingleFileTorrent(1024 * 1024, u"test.avi"_s));
+        try {
+            tor.load(bt::LoadFile(creator.torrentPath()), false);
+        } catch (bt::Error &err) {
+            Out(SYS_GEN | LOG_DEBUG) << "Failed to load torrent: " << creator.torrentPath() << endl;
+            QFAIL("Torrent load failure");
+        }
+        QVERIFY(tor.getNumChunks() >= 4);
+
+        pman = std::make_unique<PeerManager>(tor);
+        pman->start(false);
+        for (Uint32 i = 0; i < NUM_PEERS; i++) {
+            auto socket_pair = CreateSocketPair(4);
+            QVERIFY(socket_pair.has_value());
+            pman->newConnection(std::make_unique<mse::EncryptedPacketSocket>(std::move(socket_pair->reader)), PeerID(), 0);
+            writers.push_back(std::move(socket_pair->writer));
+            received[i] = QByteArray();
+        }
+        QCOMPARE(pman->getNumConnectedPeers(), NUM_PEERS);
+
+        // the first peer has chunk 1 from the start, the second one announces chunk 2 later
+        std::vector<Uint8> bitfield(5 + (tor.getNumChunks() + 7) / 8, 0);
+        WriteUint32(bitfield.data(), 0, bitfield.size() - 4);
+        bitfield[4] = BITFIELD;
+        bitfield[5] = 0x40;
+        QCOMPARE(writers[0]->send(QByteArrayView(bitfield.data(), bitfield.size())), int(bitfield.size()));
+        const Uint8 have[] = {0, 0, 0, 5, HAVE, 0, 0, 0, 2};
+        QCOMPARE(writers[1]->send(QByteArrayView(have, sizeof(have))), int(sizeof(have)));
+
+        const auto bitsets_received = [this]() {
+            Uint32 on = 0;
+            for (const Peer *peer : pman->getPeers()) {
+                on += peer->getBitSet().numOnBits();
+            }
+            return on == 2;
+        };
+        for (int i = 0; i < 200 && !bitsets_received(); i++) {
+            QTest::qWait(10);
+            pman->update();
+        }
+        QVERIFY(bitsets_received());
+    }
+
+    void cleanupTestCase()
+    {
+        pman.reset();
+        writers.clear();
+    }
+
+    void testBatchedFlush()
+    {
+        const PeerManager::HaveStats before = pman->haveStats();
+
+        // nothing goes out until the next update
+        pman->sendHave(1);
+        pman->sendHave(2);
+        pman->sendHave(3);
+        QCOMPARE(pman->haveStats().sent, before.sent);
+        QCOMPARE(pman->haveStats().suppressed, before.suppressed);
+
+        // then all of them at once, the peers which have a chunk are not told about it
+        pman->update();
+        const PeerManager::HaveStats after = pman->haveStats();
+        QCOMPARE(after.sent, before.sent + 3 * NUM_PEERS - 2);
+        QCOMPARE(after.suppressed, before.suppressed + 2);
+
+        QVERIFY(waitForHaves({2, 2, 3}));
+        QCOMPARE(receivedHaves(0), std::vector<Uint32>({2, 3}));
+        QCOMPARE(receivedHaves(1), std::vector<Uint32>({1, 3}));
+        QCOMPARE(receivedHaves(2), std::vector<Uint32>({1, 2, 3}));
+
+        // the queue is empty afterwards
+        pman->update();
+        QCOMPARE(pman->haveStats().sent, after.sent);
+        QCOMPARE(pman->haveStats().suppressed, after.suppressed);
+    }
+
+private:
+    DummyTorrentCreator creator;
+    Torrent tor;
+    std::unique_ptr<PeerManager> pman;
+    std::vector<std::unique_ptr<net::SocketDevice>> writers;
+    std::map<Uint32, QByteArray> received;
+};
+
+QTEST_MAIN(HaveBatchTest)
+
+#include "havebatchtest.moc"
@@ -0,0 +1,173 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include <memory>
+#include <mse/encryptedpacketsocket.h>
+#include <peer/peer.h>
+#include <peer/peerid.h>
+#include <peer/peermanager.h>
+#include <torrent/torrent.h>
+#include <util/functions.h>
+#include <util/log.h>
+#include <util/sha1hash.h>
+#include <vector>
+
+#include <utils.h>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+static const Uint32 NUM_TORRENTS = 4;
+static const Uint32 PEERS_PER_TORRENT = 4;
+
+class PacketProcessingTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    PacketProcessingTest()
+    {
+    }
+    ~PacketProcessingTest() override
+    {
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QVERIFY(bt::InitLibKTorrent());
+        bt::InitLog(u"packetprocessingtest.log"_s);
+        Peer::setResolveHostnames(false);
+        PeerManager::setParallelPacketProcessing(true, 4);
+    }
+
+    void cleanupTestCase()
+    {
+        PeerManager::setParallelPacketProcessing(false);
+    }
+
+    void testKillOnWorker()
+    {
+        std::vector<std::unique_ptr<Torrent>> torrents;
+        std::vector<std::unique_ptr<PeerManager>> pmans;
+        std::vector<std::unique_ptr<net::SocketDevice>> writers;
+        const Uint32 connections = PeerManager::connectionLimits().totalConnections();
+
+        for (Uint32 i = 0; i < NUM_TORRENTS; i++) {
+            Uint8 data[20] = {};
+            WriteUint32(data, 0, i);
+            torrents.push_back(std::make_unique<Torrent>(SHA1Hash(data)));
+            pmans.push_back(std::make_unique<PeerManager>(*torrents.back()));
+            pmans.back()->start(false);
+
+            for (Uint32 j = 0; j < PEERS_PER_TORRENT; j++) {
+                auto socket_pair = CreateSocketPair(4);
+                QVERIFY(socket_pair.has_value());
+                pmans.back()->newConnection(std::make_unique<mse::EncryptedPacketSocket>(std::move(socket_pair->reader)), PeerID(), 0);
+                writers.push_back(std::move(socket_pair->writer));
+            }
+        }
+        QCOMPARE(PeerManager::connectionLimits().totalConnections(), connections + NUM_TORRENTS * PEERS_PER_TORRENT);
+
+        // every other peer sends an INTERESTED with a bad length
+        const Uint8 good[] = {0, 0, 0, 1, 2};
+        const Uint8 bad[] = {0, 0, 0, 2, 2, 0};
+        for (Uint32 i = 0; i < writers.size(); i++) {
+            if (i % 2 == 0) {
+                QCOMPARE(writers[i]->send(QByteArrayView(good, sizeof(good))), int(sizeof(good)));
+            } else {
+                QCOMPARE(writers[i]->send(QByteArrayView(bad, sizeof(bad))), int(sizeof(bad)));
+            }
+        }
+
+        const auto handled = [&pmans]() {
+            for (const auto &pman : pmans) {
+                for (const Peer *peer : pman->getPeers()) {
+                    if (!peer->isKilled() && !peer->isInterested()) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+
+        for (int i = 0; i < 200 && !handled(); i++) {
+            QTest::qWait(10);
+            PeerManager::processPackets();
+        }
+        QVERIFY(handled());
+
+        // the killed peers gave back their connection on the main thread, but are still there until update
+        QCOMPARE(PeerManager::connectionLimits().totalConnections(), connections + NUM_TORRENTS * PEERS_PER_TORRENT / 2);
+        for (const auto &pman : pmans) {
+            Uint32 killed = 0;
+            for (const Peer *peer : pman->getPeers()) {
+                killed += peer->isKilled() ? 1 : 0;
+            }
+            QCOMPARE(killed, PEERS_PER_TORRENT / 2);
+        }
+
+        for (const auto &pman : pmans) {
+            pman->update();
+            QCOMPARE(pman->getNumConnectedPeers(), PEERS_PER_TORRENT / 2);
+        }
+
+        pmans.clear();
+        QCOMPARE(PeerManager::connectionLimits().totalConnections(), connections);
+    }
+
+    void testProcessedByUpdate()
+    {
+        std::vector<std::unique_ptr<Torrent>> torrents;
+        std::vector<std::unique_ptr<PeerManager>> pmans;
+        std::vector<std::unique_ptr<net::SocketDevice>> writers;
+
+        for (Uint32 i = 0; i < NUM_TORRENTS; i++) {
+            Uint8 data[20] = {};
+            WriteUint32(data, 0, i + NUM_TORRENTS);
+            torrents.push_back(std::make_unique<Torrent>(SHA1Hash(data)));
+            pmans.push_back(std::make_unique<PeerManager>(*torrents.back()));
+            pmans.back()->start(false);
+
+            for (Uint32 j = 0; j < PEERS_PER_TORRENT; j++) {
+                auto socket_pair = CreateSocketPair(4);
+                QVERIFY(socket_pair.has_value());
+                pmans.back()->newConnection(std::make_unique<mse::EncryptedPacketSocket>(std::move(socket_pair->reader)), PeerID(), 0);
+                writers.push_back(std::move(socket_pair->writer));
+            }
+        }
+
+        const Uint8 interested[] = {0, 0, 0, 1, 2};
+        for (const auto &w : writers) {
+            QCOMPARE(w->send(QByteArrayView(interested, sizeof(interested))), int(sizeof(interested)));
+        }
+
+        const auto all_interested = [&pmans]() {
+            for (const auto &pman : pmans) {
+                for (const Peer *peer : pman->getPeers()) {
+                    if (!peer->isInterested()) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+
+        // only the first torrent is updated, the messages of the others are handled on the workers
+        for (int i = 0; i < 200 && !all_interested(); i++) {
+            QTest::qWait(10);
+            pmans.front()->update();
+        }
+        QVERIFY(all_interested());
+    }
+};
+
+QTEST_MAIN(PacketProcessingTest)
+
+#include "packetprocessingtest.moc"
@@ -4,15 +4,87 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
 #include <QObject>
 #include <QTest>
 
 #include <interfaces/peerinterface.h>
 #include <peer/packetreader.h>
+#include <util/functions.h>
 #include <util/log.h>
 
 using namespace Qt::Literals::StringLiterals;
 
+// count every allocation made by this process, for the allocation benchmark
+static std::atomic<bt::Uint64> num_allocations = 0;
+
+void *operator new(std::size_t size)
+{
+    num_allocations++;
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+/*
+    Peer which only counts the packets it receives, so it doesn't allocate anything itself.
+*/
+class CountingPeer : public bt::PeerInterface
+{
+public:
+    CountingPeer()
+        : bt::PeerInterface(bt::PeerID(), 100)
+    {
+    }
+
+    void chunkAllowed(bt::Uint32) override
+    {
+    }
+
+    void handlePacket(const bt::Uint8 *packet, bt::Uint32 size) override
+    {
+        Q_UNUSED(packet);
+        num_packets++;
+        num_bytes += size;
+    }
+
+    bt::Uint32 averageDownloadSpeed() const override
+    {
+        return 0;
+    }
+
+    void kill() override
+    {
+    }
+
+    bt::Uint64 num_packets = 0;
+    bt::Uint64 num_bytes = 0;
+};
+
+// Append a packet of \a size bytes to \a data, with the first byte of the payload set to \a type
+static void AppendPacket(std::vector<bt::Uint8> &data, bt::Uint8 type, bt::Uint32 size)
+{
+    const size_t off = data.size();
+    data.resize(off + 4 + size, 0xAB);
+    bt::WriteUint32(data.data(), off, size);
+    data[off + 4] = type;
+}
+
 class PacketReaderTest : public QObject, public bt::PeerInterface
 {
     Q_OBJECT
@@ -33,6 +105,8 @@ public:
         received_packet.reset(new bt::Uint8[size]);
         memcpy(received_packet.data(), packet, size);
         received_packet_size = size;
+        num_received++;
+        received_types.push_back(packet[0]);
     }
 
     bool check(const bt::Uint8 *packet, bt::Uint32 size)
@@ -52,6 +126,8 @@ public:
     void reset()
     {
         received_packet_size = 0;
+        num_received = 0;
+        received_types.clear();
         received_packet.reset();
     }
 
@@ -186,6 +262,147 @@ private Q_SLOTS:
         QCOMPARE(received_packet_size, 2);
     }
 
+    void testFilteredUpdate()
+    {
+        reset();
+
+        bt::Uint8 data[] = {0, 0, 0, 2, 0xEE, 0xEE, 0, 0, 0, 2, 0xFF, 0xFF, 0, 0, 0, 2, 0xEE, 0xEE};
+        bt::PacketReader pr(1024);
+
+        pr.onDataReady(data, std::size(data));
+        QVERIFY(pr.ok());
+
+        // only the first packet is accepted, the ones after the rejected packet must stay queued
+        pr.update(*this, [](const bt::Uint8 *packet, bt::Uint32) {
+            return packet[0] == 0xEE;
+        });
+        QCOMPARE(num_received, 1);
+        QVERIFY(check(data + 4, 2));
+
+        pr.update(*this);
+        QCOMPARE(num_received, 3);
+        QVERIFY(check(data + 16, 2));
+    }
+
+    void testLargePackets()
+    {
+        reset();
+
+        std::vector<bt::Uint8> data;
+        AppendPacket(data, 1, 5);
+        AppendPacket(data, 2, 16 * 1024 + 9);
+        AppendPacket(data, 3, 13);
+        AppendPacket(data, 4, 4000);
+
+        bt::PacketReader pr(32 * 1024);
+        pr.onDataReady(data.data(), data.size());
+        QVERIFY(pr.ok());
+        pr.update(*this);
+        QCOMPARE(received_types, (std::vector<bt::Uint8>{1, 2, 3, 4}));
+        QCOMPARE(received_packet_size, 4000);
+    }
+
+    void testRingFull()
+    {
+        reset();
+
+        // much more data than fits in the ring, without updates in between
+        std::vector<bt::Uint8> data;
+        std::vector<bt::Uint8> expected;
+        for (int i = 0; i < 2000; i++) {
+            const bt::Uint8 type = i % 250;
+            AppendPacket(data, type, i % 7 == 0 ? 3000 : 5 + i % 100);
+            expected.push_back(type);
+        }
+
+        bt::PacketReader pr(4096);
+        bt::Uint32 off = 0;
+        int reads = 0;
+        while (off < data.size()) {
+            const bt::Uint32 size = qMin<bt::Uint32>(777, data.size() - off);
+            pr.onDataReady(data.data() + off, size);
+            off += size;
+            // update once in a while, so the ring wraps around
+            if (++reads % 7 == 0) {
+                pr.update(*this);
+            }
+        }
+        QVERIFY(pr.ok());
+        pr.update(*this);
+        QCOMPARE(received_types, expected);
+
+        // ring must be usable again afterwards
+        reset();
+        bt::Uint8 more[] = {0, 0, 0, 2, 0xEE, 0xEE};
+        pr.onDataReady(more, std::size(more));
+        pr.update(*this);
+        QVERIFY(check(more + 4, 2));
+    }
+
+    void benchmarkControlPackets()
+    {
+        // HAVE, REQUEST and CANCEL messages, received in socket sized reads
+        std::vector<bt::Uint8> data;
+        for (int i = 0; i < 1000; i++) {
+            AppendPacket(data, 4, 5);
+            AppendPacket(data, 6, 13);
+            AppendPacket(data, 8, 13);
+        }
+
+        CountingPeer peer;
+        bt::PacketReader pr(32 * 1024);
+        auto feed = [&]() {
+            bt::Uint32 off = 0;
+            while (off < data.size()) {
+                const bt::Uint32 size = qMin<bt::Uint32>(1500, data.size() - off);
+                pr.onDataReady(data.data() + off, size);
+                off += size;
+                pr.update(peer);
+            }
+        };
+
+        const bt::Uint64 before = num_allocations;
+        feed();
+        const bt::Uint64 allocations = num_allocations - before;
+        QCOMPARE(peer.num_packets, 3000u);
+        QCOMPARE(allocations, 0u);
+
+        QBENCHMARK {
+            feed();
+        }
+    }
+
+    void benchmarkPiecePackets()
+    {
+        std::vector<bt::Uint8> data;
+        for (int i = 0; i < 100; i++) {
+            AppendPacket(data, 7, 16 * 1024 + 9);
+            AppendPacket(data, 4, 5);
+        }
+
+        CountingPeer peer;
+        bt::PacketReader pr(32 * 1024);
+        auto feed = [&]() {
+            bt::Uint32 off = 0;
+            while (off < data.size()) {
+                const bt::Uint32 size = qMin<bt::Uint32>(1500, data.size() - off);
+                pr.onDataReady(data.data() + off, size);
+                off += size;
+                pr.update(peer);
+            }
+        };
+
+        const bt::Uint64 before = num_allocations;
+        feed();
+        const bt::Uint64 allocations = num_allocations - before;
+        // only the PIECE packets need their own buffer
+        QCOMPARE_LE(allocations, 100u * 2);
+
+        QBENCHMARK {
+            feed();
+        }
+    }
+
     void testUnicodeLiteral()
     {
         const QString a = u"%1Torrent"_s.arg(QChar(0x00B5));
@@ -195,6 +412,8 @@ private Q_SLOTS:
 private:
     QScopedArrayPointer<bt::Uint8> received_packet;
     bt::Uint32 received_packet_size;
+    int num_received = 0;
+    std::vector<bt::Uint8> received_types;
 };
 
 QTEST_MAIN(PacketReaderTest)
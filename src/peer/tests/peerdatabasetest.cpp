@@ -0,0 +1,140 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QFileInfo>
+#include <QObject>
+#include <QTemporaryFile>
+#include <QTest>
+
+#include <peer/peerdatabase.h>
+#include <util/log.h>
+#include <util/sha1hash.h>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+class PeerDatabaseTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    PeerDatabaseTest()
+    {
+    }
+    ~PeerDatabaseTest() override
+    {
+    }
+
+private:
+    static SHA1Hash hash(char c)
+    {
+        return SHA1Hash(QByteArray(20, c));
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"peerdatabasetest.log"_s);
+    }
+
+    void testSaveLoad()
+    {
+        const net::Address v4(u"10.0.0.1"_s, 6881);
+        const net::Address v6(u"2001:db8::1"_s, 51413);
+        const net::Address banned(u"10.0.0.66"_s, 6881);
+
+        PeerDatabase db(hash('a'));
+        db.connectFinished(v4, true);
+        db.connectFinished(v4, false);
+        db.peerFinished(v4, 100000, 2000, PeerDatabase::SEEDER | PeerDatabase::UTP);
+        db.connectFinished(v6, true);
+        db.peerFinished(v6, 0, 5000, PeerDatabase::ENCRYPTED);
+        db.setBanned(banned);
+
+        QTemporaryFile tmp;
+        QVERIFY(tmp.open());
+        QVERIFY(db.save(tmp.fileName()));
+        QCOMPARE(QFileInfo(tmp.fileName()).size(), qint64(32 + 3 * 35));
+
+        PeerDatabase loaded(hash('a'));
+        QVERIFY(loaded.load(tmp.fileName()));
+        QCOMPARE(loaded.size(), 3u);
+
+        const PeerDatabase::Record *r = loaded.find(v4);
+        QVERIFY(r);
+        QCOMPARE(r->succeeded, Uint16(1));
+        QCOMPARE(r->failed, Uint16(1));
+        QCOMPARE(r->download_rate, 100000u);
+        QCOMPARE(r->upload_rate, 2000u);
+        QCOMPARE(r->flags, Uint8(PeerDatabase::SEEDER | PeerDatabase::UTP));
+        QVERIFY(loaded.find(v4)->last_seen > 0);
+
+        r = loaded.find(v6);
+        QVERIFY(r);
+        QCOMPARE(r->upload_rate, 5000u);
+        QCOMPARE(r->flags, Uint8(PeerDatabase::ENCRYPTED));
+        QVERIFY(loaded.find(banned)->flags & PeerDatabase::BANNED);
+
+        // the file of another torrent is not loaded
+        PeerDatabase other(hash('b'));
+        QVERIFY(!other.load(tmp.fileName()));
+        QCOMPARE(other.size(), 0u);
+    }
+
+    void testRanking()
+    {
+        const net::Address fast(u"10.0.0.1"_s, 6881);
+        const net::Address slow(u"10.0.0.2"_s, 6881);
+        const net::Address failing(u"10.0.0.3"_s, 6881);
+        const net::Address banned(u"10.0.0.4"_s, 6881);
+        const net::Address unknown(u"10.0.0.5"_s, 6881);
+
+        PeerDatabase db(hash('a'));
+        db.connectFinished(fast, true);
+        db.peerFinished(fast, 200000, 0, 0);
+        db.connectFinished(slow, true);
+        db.peerFinished(slow, 1000, 50000, 0);
+        db.connectFinished(failing, false);
+        db.connectFinished(failing, false);
+        db.setBanned(banned);
+
+        QCOMPARE(db.weight(unknown, false), 1.0);
+        QCOMPARE(db.weight(banned, false), 0.0);
+        QVERIFY(db.weight(fast, false) > db.weight(slow, false));
+        QVERIFY(db.weight(failing, false) < db.weight(unknown, false));
+        // when seeding the upload rate counts
+        QVERIFY(db.weight(slow, true) > db.weight(fast, true));
+
+        const auto ranked = db.ranked(false);
+        QCOMPARE(ranked.size(), size_t(4));
+        QVERIFY(ranked.front().first == fast);
+        QVERIFY(ranked.back().first == banned);
+    }
+
+    void testMaxRecords()
+    {
+        PeerDatabase db(hash('a'));
+        const net::Address banned(u"10.1.0.1"_s, 6881);
+        db.setBanned(banned);
+        for (Uint32 i = 0; i < PeerDatabase::MAX_RECORDS + 100; i++) {
+            db.add(net::Address(0x0A000000 + i, 6881));
+        }
+
+        QTemporaryFile tmp;
+        QVERIFY(tmp.open());
+        QVERIFY(db.save(tmp.fileName()));
+
+        // banned peers are kept
+        PeerDatabase loaded(hash('a'));
+        QVERIFY(loaded.load(tmp.fileName()));
+        QCOMPARE(loaded.size(), PeerDatabase::MAX_RECORDS);
+        QVERIFY(loaded.find(banned));
+    }
+};
+
+QTEST_MAIN(PeerDatabaseTest)
+
+#include "peerdatabasetest.moc"
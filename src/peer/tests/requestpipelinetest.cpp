@@ -0,0 +1,201 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include <peer/peerdownloader.h>
+#include <peer/requestpipeline.h>
+#include <util/log.h>
+
+using namespace Qt::Literals::StringLiterals;
+using namespace bt;
+
+static Request MakeRequest(Uint32 index, Uint32 piece)
+{
+    return Request(index, piece * MAX_PIECE_LEN, MAX_PIECE_LEN, nullptr);
+}
+
+class RequestPipelineTest : public QObject
+{
+    Q_OBJECT
+public:
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"requestpipelinetest.log"_s);
+    }
+
+    void cleanupTestCase()
+    {
+    }
+
+    void testOrder()
+    {
+        RequestPipeline p(16);
+        for (Uint32 i = 0; i < 10; i++) {
+            p.append(MakeRequest(1, i));
+        }
+        QCOMPARE(p.count(), 10u);
+
+        // remove some from the middle and check that the order is kept
+        QVERIFY(p.take(MakeRequest(1, 3)));
+        QVERIFY(p.take(MakeRequest(1, 5)));
+        QVERIFY(!p.take(MakeRequest(1, 5)));
+        QVERIFY(!p.contains(MakeRequest(2, 0)));
+        QCOMPARE(p.count(), 8u);
+
+        QList<Uint32> pieces;
+        p.forEach([&pieces](const TimeStampedRequest &tr) {
+            pieces.append(tr.req.getOffset() / MAX_PIECE_LEN);
+        });
+        QCOMPARE(pieces, QList<Uint32>({0, 1, 2, 4, 6, 7, 8, 9}));
+
+        // removing the front must skip the holes
+        QVERIFY(p.take(MakeRequest(1, 0)));
+        QCOMPARE(p.takeFirst().req, MakeRequest(1, 1));
+        QCOMPARE(p.takeFirst().req, MakeRequest(1, 2));
+        QCOMPARE(p.first().req, MakeRequest(1, 4));
+        QCOMPARE(p.count(), 5u);
+
+        p.clear();
+        QVERIFY(p.isEmpty());
+        QVERIFY(!p.contains(MakeRequest(1, 4)));
+    }
+
+    void testTimeStamp()
+    {
+        RequestPipeline p;
+        TimeStampedRequest tr(MakeRequest(0, 0));
+        tr.time_stamp = 1234;
+        p.append(tr);
+
+        TimeStamp ts = 0;
+        QVERIFY(p.take(MakeRequest(0, 0), &ts));
+        QCOMPARE(ts, (TimeStamp)1234);
+    }
+
+    void testDuplicates()
+    {
+        RequestPipeline p;
+        p.append(MakeRequest(0, 0));
+        p.append(MakeRequest(0, 1));
+        p.append(MakeRequest(0, 0));
+        QCOMPARE(p.takeFirst().req, MakeRequest(0, 0));
+        QVERIFY(p.contains(MakeRequest(0, 0)));
+        p.append(MakeRequest(0, 0));
+        QCOMPARE(p.removeAll(MakeRequest(0, 0)), 2u);
+        QCOMPARE(p.count(), 1u);
+        QCOMPARE(p.first().req, MakeRequest(0, 1));
+    }
+
+    void testNoGrowthInSteadyState()
+    {
+        // a pipeline of constant depth, where pieces arrive out of order,
+        // must not need more room than its initial capacity
+        RequestPipeline p(64);
+        const Uint32 capacity = p.capacity();
+        const Uint32 depth = 32;
+        for (Uint32 i = 0; i < 10000; i++) {
+            p.append(MakeRequest(i / 16, i % 16));
+            if (p.count() > depth) {
+                // leave the oldest one stuck, answer the second oldest
+                const Uint32 j = i - depth + 1;
+                QVERIFY(p.take(MakeRequest(j / 16, j % 16)));
+            }
+        }
+        QCOMPARE(p.capacity(), capacity);
+        QCOMPARE(p.first().req, MakeRequest(0, 0));
+        QCOMPARE(p.count(), depth);
+    }
+
+    void testGrow()
+    {
+        RequestPipeline p(4);
+        for (Uint32 i = 0; i < 1000; i++) {
+            p.append(MakeRequest(i, 0));
+        }
+        QVERIFY(p.capacity() >= 1000);
+        for (Uint32 i = 0; i < 1000; i++) {
+            QVERIFY(p.contains(MakeRequest(i, 0)));
+        }
+        for (Uint32 i = 0; i < 1000; i++) {
+            QCOMPARE(p.takeFirst().req, MakeRequest(i, 0));
+        }
+        QVERIFY(p.isEmpty());
+    }
+
+    void testPipelineDepth()
+    {
+        // 16 pieces per second over a link with a round trip time of 100 ms
+        const Uint32 rate = 16 * MAX_PIECE_LEN;
+        const Uint32 network_rtt = 100;
+
+        // the round trip time is only measured on an empty pipeline, so it does not depend on the depth
+        Uint32 depth = 0;
+        for (int i = 0; i < 10; i++) {
+            depth = PeerDownloader::pipelineDepth(rate, network_rtt, 0);
+        }
+        QCOMPARE(depth, PeerDownloader::MIN_PIPELINE_DEPTH);
+        QCOMPARE(PeerDownloader::pipelineDepth(0, 0, 0), PeerDownloader::MIN_PIPELINE_DEPTH);
+
+        // at 100 ms only 1.6 pieces are in flight, below the minimum even with 50 % extra,
+        // at 1 and 2 seconds it is 16 and 32 pieces
+        QCOMPARE(PeerDownloader::pipelineDepth(rate, 1000, 0), 24u);
+        QCOMPARE(PeerDownloader::pipelineDepth(rate, 2000, 0), 48u);
+        QCOMPARE(PeerDownloader::pipelineDepth(rate, 2000, 20), 20u);
+
+        // a request which waits behind the others measures them too, that makes the depth
+        // grow with every sample, until the cap stops it
+        Uint32 previous = 0;
+        for (int i = 0; i < 15; i++) {
+            previous = depth;
+            const Uint32 rtt = network_rtt + depth * 1000 / 16;
+            depth = PeerDownloader::pipelineDepth(rate, rtt, 0);
+            QVERIFY(depth >= previous);
+        }
+        QCOMPARE(depth, PeerDownloader::MAX_PIPELINE_DEPTH);
+        QCOMPARE(previous, depth);
+
+        // a very fast peer is capped as well
+        QCOMPARE(PeerDownloader::pipelineDepth(100 * 1024 * 1024, network_rtt, 0), PeerDownloader::MAX_PIPELINE_DEPTH);
+    }
+
+    void testPipelineDepthFollowsRoundTripTime()
+    {
+        // at the same rate, a peer far away needs more requests in flight than a nearby one
+        const Uint32 rate = 1024 * 1024;
+        const Uint32 low = PeerDownloader::pipelineDepth(rate, 20, 0);
+        const Uint32 high = PeerDownloader::pipelineDepth(rate, 200, 0);
+        QCOMPARE(low, PeerDownloader::MIN_PIPELINE_DEPTH);
+        QCOMPARE(high, 20u);
+        QVERIFY(high > low);
+
+        // and the depth scales with the round trip time once above the minimum
+        QCOMPARE(PeerDownloader::pipelineDepth(100 * 1024 * 1024, 20, 0), 192u);
+        QCOMPARE(PeerDownloader::pipelineDepth(100 * 1024 * 1024, 10, 0), 96u);
+    }
+
+    void benchmarkPieceArrival()
+    {
+        RequestPipeline p(256);
+        Uint32 i = 0;
+        for (; i < 250; i++) {
+            p.append(MakeRequest(i / 16, i % 16));
+        }
+
+        QBENCHMARK {
+            const Uint32 j = i - 250;
+            p.take(MakeRequest(j / 16, j % 16));
+            p.append(MakeRequest(i / 16, i % 16));
+            i++;
+        }
+    }
+};
+
+QTEST_MAIN(RequestPipelineTest)
+
+#include "requestpipelinetest.moc"
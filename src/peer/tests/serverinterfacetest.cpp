@@ -0,0 +1,165 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include <interfaces/serverinterface.h>
+#include <memory>
+#include <peer/peermanager.h>
+#include <torrent/torrent.h>
+#include <util/functions.h>
+#include <util/log.h>
+#include <util/sha1hash.h>
+#include <vector>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+// The PeerManagers of a number of magnet like torrents, which only have an info hash
+struct Torrents {
+    explicit Torrents(Uint32 num)
+    {
+        for (Uint32 i = 0; i < num; i++) {
+            Uint8 data[20] = {};
+            WriteUint32(data, 0, i);
+            torrents.push_back(std::make_unique<Torrent>(SHA1Hash(data)));
+            pmans.push_back(std::make_unique<PeerManager>(*torrents.back()));
+            pmans.back()->start(false);
+        }
+    }
+
+    ~Torrents()
+    {
+        // the PeerManagers reference the torrents
+        pmans.clear();
+    }
+
+    std::vector<std::unique_ptr<Torrent>> torrents;
+    std::vector<std::unique_ptr<PeerManager>> pmans;
+};
+
+static SHA1Hash SKey(const SHA1Hash &info_hash)
+{
+    Uint8 buf[24];
+    memcpy(buf, "req2", 4);
+    memcpy(buf + 4, info_hash.getData(), 20);
+    return SHA1Hash::generate(buf, 24);
+}
+
+class ServerInterfaceTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    ServerInterfaceTest()
+    {
+    }
+    ~ServerInterfaceTest() override
+    {
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"serverinterfacetest.log"_s);
+    }
+
+    void testLookup()
+    {
+        Torrents t(10);
+        for (Uint32 i = 0; i < 10; i++) {
+            const SHA1Hash &h = t.torrents[i]->getInfoHash();
+            QCOMPARE(ServerInterface::findPeerManager(h), t.pmans[i].get());
+
+            SHA1Hash found;
+            QVERIFY(ServerInterface::findInfoHash(SKey(h), found));
+            QCOMPARE(found, h);
+        }
+
+        // a stopped torrent can not be found
+        const SHA1Hash h = t.torrents[3]->getInfoHash();
+        t.pmans[3]->stop();
+        QVERIFY(!ServerInterface::findPeerManager(h));
+        SHA1Hash found;
+        QVERIFY(!ServerInterface::findInfoHash(SKey(h), found));
+
+        // and can be found again when it is restarted
+        t.pmans[3]->start(false);
+        QCOMPARE(ServerInterface::findPeerManager(h), t.pmans[3].get());
+        QVERIFY(ServerInterface::findInfoHash(SKey(h), found));
+
+        // nothing is left behind by deleted PeerManagers
+        const SHA1Hash first = t.torrents[0]->getInfoHash();
+        t.pmans[0].reset();
+        QVERIFY(!ServerInterface::findPeerManager(first));
+        QVERIFY(!ServerInterface::findInfoHash(SKey(first), found));
+        QVERIFY(!ServerInterface::findInfoHash(SHA1Hash(), found));
+    }
+
+    void testDuplicateInfoHash()
+    {
+        Uint8 data[20] = {};
+        WriteUint32(data, 0, 0xCAFEBABE);
+        const SHA1Hash h(data);
+        Torrent first_tor(h);
+        Torrent second_tor(h);
+        auto first = std::make_unique<PeerManager>(first_tor);
+        auto second = std::make_unique<PeerManager>(second_tor);
+        first->start(false);
+        second->start(false);
+
+        // the one which was started first wins, whatever order the index returns them in
+        QCOMPARE(ServerInterface::findPeerManager(h), first.get());
+        SHA1Hash found;
+        QVERIFY(ServerInterface::findInfoHash(SKey(h), found));
+        QCOMPARE(found, h);
+
+        // when it stops, the other one takes over
+        first->stop();
+        QCOMPARE(ServerInterface::findPeerManager(h), second.get());
+        QVERIFY(ServerInterface::findInfoHash(SKey(h), found));
+
+        // and keeps it when the first one is restarted
+        first->start(false);
+        QCOMPARE(ServerInterface::findPeerManager(h), second.get());
+
+        second.reset();
+        QCOMPARE(ServerInterface::findPeerManager(h), first.get());
+        first.reset();
+        QVERIFY(!ServerInterface::findPeerManager(h));
+        QVERIFY(!ServerInterface::findInfoHash(SKey(h), found));
+    }
+
+    void benchmarkLookup_data()
+    {
+        QTest::addColumn<Uint32>("num_torrents");
+        QTest::newRow("10") << Uint32(10);
+        QTest::newRow("100") << Uint32(100);
+        QTest::newRow("1000") << Uint32(1000);
+        QTest::newRow("5000") << Uint32(5000);
+    }
+
+    void benchmarkLookup()
+    {
+        QFETCH(Uint32, num_torrents);
+        Torrents t(num_torrents);
+
+        // an incoming encrypted connection looks up both, for the last torrent
+        // this used to cost a hash of every info hash
+        const SHA1Hash &h = t.torrents.back()->getInfoHash();
+        const SHA1Hash skey = SKey(h);
+        QBENCHMARK {
+            SHA1Hash found;
+            QVERIFY(ServerInterface::findInfoHash(skey, found));
+            QVERIFY(ServerInterface::findPeerManager(found) == t.pmans.back().get());
+        }
+    }
+};
+
+QTEST_MAIN(ServerInterfaceTest)
+
+#include "serverinterfacetest.moc"
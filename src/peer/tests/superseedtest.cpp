@@ -5,9 +5,13 @@
 */
 
 #include <QObject>
+#include <QRandomGenerator>
 #include <QTest>
 
+#include <algorithm>
 #include <ctime>
+#include <memory>
+#include <vector>
 #include <interfaces/peerinterface.h>
 #include <peer/chunkcounter.h>
 #include <peer/superseeder.h>
@@ -24,8 +28,8 @@ static int peer_cnt = 0;
 class DummyPeer : public PeerInterface
 {
 public:
-    DummyPeer()
-        : PeerInterface(PeerID(), NUM_CHUNKS)
+    DummyPeer(Uint32 num_chunks = NUM_CHUNKS)
+        : PeerInterface(PeerID(), num_chunks)
     {
         QString name = QStringLiteral("%1").arg(peer_cnt++);
         if (name.size() < 20) {
@@ -44,6 +48,7 @@ public:
     {
         pieces.setAll(false);
         allowed_chunk = INVALID_CHUNK;
+        allowed.clear();
     }
 
     void have(Uint32 chunk)
@@ -69,6 +74,7 @@ public:
     void chunkAllowed(Uint32 chunk) override
     {
         allowed_chunk = chunk;
+        allowed.append(chunk);
         allow_called = true;
     }
 
@@ -79,6 +85,7 @@ public:
     }
 
     Uint32 allowed_chunk;
+    QList<Uint32> allowed;
     bool allow_called;
 };
 
@@ -158,6 +165,113 @@ private Q_SLOTS:
             ss.dump();
         }
     }
+
+    void testMultipleOffers()
+    {
+        Out(SYS_GEN | LOG_DEBUG) << "testMultipleOffers" << endl;
+        const Uint32 num_chunks = 100;
+        SuperSeeder ss(num_chunks);
+        DummyPeer uploader(num_chunks);
+        ss.peerAdded(&uploader);
+        QCOMPARE(ss.numOffers(&uploader), 1u);
+
+        // every chunk the uploader passes on to another peer earns it more offers
+        Uint32 expected = 1;
+        for (Uint32 i = 0; i < 2 * SuperSeeder::MAX_CHUNKS_PER_PEER * SuperSeeder::PROPAGATIONS_PER_EXTRA_CHUNK; i++) {
+            const Uint32 chunk = uploader.allowed.last();
+            uploader.have(chunk);
+            ss.have(&uploader, chunk);
+
+            DummyPeer downloader(num_chunks);
+            downloader.have(chunk);
+            ss.peerAdded(&downloader);
+            ss.have(&downloader, chunk);
+            ss.peerRemoved(&downloader);
+
+            expected = qMin(SuperSeeder::MAX_CHUNKS_PER_PEER, 1 + (i + 1) / SuperSeeder::PROPAGATIONS_PER_EXTRA_CHUNK);
+            QCOMPARE(ss.numOffers(&uploader), expected);
+        }
+        QCOMPARE(expected, SuperSeeder::MAX_CHUNKS_PER_PEER);
+
+        // seeders do not get any offers
+        ss.haveAll(&uploader);
+        QCOMPARE(ss.numOffers(&uploader), 0u);
+        ss.peerRemoved(&uploader);
+    }
+
+    void testDistributionEfficiency()
+    {
+        Out(SYS_GEN | LOG_DEBUG) << "testDistributionEfficiency" << endl;
+        const Uint32 num_chunks = 100;
+        const Uint32 num_peers = 20;
+        const Uint64 chunk_size = 256 * 1024;
+        SuperSeeder ss(num_chunks);
+        std::vector<std::unique_ptr<DummyPeer>> swarm;
+        for (Uint32 i = 0; i < num_peers; i++) {
+            swarm.push_back(std::make_unique<DummyPeer>(num_chunks));
+            ss.peerAdded(swarm.back().get());
+        }
+
+        auto complete = [&swarm]() {
+            for (const auto &p : swarm) {
+                if (!p->getBitSet().allOn()) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        QRandomGenerator rng(1234);
+        Uint32 chunks_uploaded = 0;
+        Uint32 rounds = 0;
+        while (!complete() && rounds < 10000) {
+            rounds++;
+            // the seed uploads one chunk per round, to a peer which has been allowed to download one
+            for (Uint32 i = 0; i < num_peers; i++) {
+                DummyPeer *p = swarm[(rounds + i) % num_peers].get();
+                auto itr = std::find_if(p->allowed.begin(), p->allowed.end(), [p](Uint32 chunk) {
+                    return !p->getBitSet().get(chunk);
+                });
+                if (itr != p->allowed.end()) {
+                    p->have(*itr);
+                    ss.have(p, *itr);
+                    chunks_uploaded++;
+                    break;
+                }
+            }
+
+            // and every peer downloads one chunk per round from a random other peer
+            for (const auto &p : swarm) {
+                const DummyPeer *other = swarm[rng.bounded(num_peers)].get();
+                if (other == p.get() || p->getBitSet().allOn()) {
+                    continue;
+                }
+
+                const Uint32 start = rng.bounded(num_chunks);
+                for (Uint32 i = 0; i < num_chunks; i++) {
+                    const Uint32 chunk = (start + i) % num_chunks;
+                    if (other->getBitSet().get(chunk) && !p->getBitSet().get(chunk)) {
+                        p->have(chunk);
+                        ss.have(p.get(), chunk);
+                        break;
+                    }
+                }
+            }
+        }
+
+        QVERIFY(complete());
+        // bytes the seed uploaded per unique chunk which made it into the swarm, ideally the chunk size
+        const double bytes_per_chunk = (double)(chunks_uploaded * chunk_size) / num_chunks;
+        Out(SYS_GEN | LOG_DEBUG) << "Distribution efficiency: " << rounds << " rounds, " << chunks_uploaded << " chunks uploaded, "
+                                 << bytes_per_chunk / chunk_size << " x chunk size per unique chunk" << endl;
+        QVERIFY(chunks_uploaded >= num_chunks);
+        QVERIFY(chunks_uploaded <= num_chunks * 3 / 2);
+
+        for (const auto &p : swarm) {
+            ss.peerRemoved(p.get());
+        }
+    }
+
 #if 0
     void testSeed()
     {
@@ -6,11 +6,11 @@
 
 #include "utmetadata.h"
 #include "peer.h"
+#include "peermanager.h"
 #include <QByteArray>
 #include <bcodec/bdecoder.h>
 #include <bcodec/bencoder.h>
 #include <bcodec/bnode.h>
-#include <magnet/metadatadownload.h>
 #include <torrent/torrent.h>
 #include <util/log.h>
 
@@ -26,6 +26,9 @@ UTMetaData::UTMetaData(const Torrent &tor, bt::Uint32 id, Peer *peer)
 
 UTMetaData::~UTMetaData()
 {
+    if (download) {
+        download->removeSource(this);
+    }
 }
 
 void UTMetaData::handlePacket(QByteArrayView packet)
@@ -63,7 +66,7 @@ void UTMetaData::handlePacket(QByteArrayView packet)
 void UTMetaData::data(BDictNode *dict, QByteArrayView piece_data)
 {
     if (download) {
-        if (download->data(dict->getInt("piece"), piece_data)) {
+        if (download->data(this, dict->getInt("piece"), piece_data)) {
             peer->emitMetadataDownloaded(download->result());
         }
     }
@@ -72,7 +75,7 @@ void UTMetaData::data(BDictNode *dict, QByteArrayView piece_data)
 void UTMetaData::reject(BDictNode *dict)
 {
     if (download) {
-        download->reject(dict->getInt("piece"));
+        download->reject(this, dict->getInt("piece"));
     }
 }
 
@@ -128,8 +131,22 @@ void UTMetaData::setReportedMetadataSize(Uint32 metadata_size)
 {
     reported_metadata_size = metadata_size;
     if (reported_metadata_size > 0 && !tor.isLoaded() && !download) {
-        download = new MetadataDownload(this, reported_metadata_size);
+        MetadataDownload *md = peer->getPeerManager()->getMetadataDownload();
+        if (md && md->addSource(this, reported_metadata_size)) {
+            download = md;
+        }
     }
 }
 
+void UTMetaData::requestMetadataPiece(Uint32 piece)
+{
+    QByteArray request;
+    BEncoder enc(std::make_unique<BEncoderBufferOutput>(request));
+    enc.beginDict();
+    enc.write("msg_type", (bt::Uint32)0);
+    enc.write("piece", piece);
+    enc.end();
+    sendPacket(request);
+}
+
 }
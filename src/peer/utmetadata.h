@@ -7,11 +7,11 @@
 #ifndef BT_UTMETADATA_H
 #define BT_UTMETADATA_H
 
+#include <magnet/metadatadownload.h>
 #include <peer/peerprotocolextension.h>
 
 namespace bt
 {
-class MetadataDownload;
 class BDictNode;
 class Peer;
 class Torrent;
@@ -20,7 +20,7 @@ class Torrent;
  * \headerfile peer/utmetadata.h
  * \brief Handles the ut_metadata extension (BEP 0009).
  */
-class KTORRENT_EXPORT UTMetaData : public PeerProtocolExtension
+class KTORRENT_EXPORT UTMetaData : public PeerProtocolExtension, public MetadataSource
 {
 public:
     UTMetaData(const Torrent &tor, bt::Uint32 id, Peer *peer);
@@ -36,6 +36,9 @@ public:
     */
     void setReportedMetadataSize(Uint32 metadata_size);
 
+    //! Send a request for a metadata piece
+    void requestMetadataPiece(Uint32 piece) override;
+
 private:
     void request(BDictNode *dict);
     void reject(BDictNode *dict);
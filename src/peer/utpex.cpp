@@ -42,15 +42,17 @@ void UTPex::handlePacket(QByteArrayView packet)
             const BValueNode *peers4 = dict->getValue("added");
             if (peers4) {
                 const QByteArray data = peers4->data().toByteArray();
+                const BValueNode *flags4 = dict->getValue("added.f");
                 if (!data.isEmpty()) {
-                    peer->emitPex(data, 4);
+                    peer->emitPex(data, flags4 ? flags4->data().toByteArray() : QByteArray(), 4);
                 }
             }
             const BValueNode *peers6 = dict->getValue("added6");
             if (peers6) {
                 const QByteArray data = peers6->data().toByteArray();
+                const BValueNode *flags6 = dict->getValue("added6.f");
                 if (!data.isEmpty()) {
-                    peer->emitPex(data, 6);
+                    peer->emitPex(data, flags6 ? flags6->data().toByteArray() : QByteArray(), 6);
                 }
             }
         }
@@ -90,7 +92,7 @@ void UTPex::visit(const bt::Peer *p,
 
             Uint8 flag = 0;
             if (p->isSeeder()) {
-                flag |= 0x02;
+                flag |= SEED_FLAG;
             }
             if (p->getStats().fast_extensions) {
                 flag |= 0x01;
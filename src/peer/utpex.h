@@ -30,6 +30,9 @@ public:
     UTPex(Peer *peer, Uint32 id);
     ~UTPex() override;
 
+    //! Flag in added.f which marks a peer as seeder
+    static constexpr Uint8 SEED_FLAG = 0x02;
+
     /*!
      * Handle a PEX packet
      * \param packet The packet
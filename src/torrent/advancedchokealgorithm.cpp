@@ -84,30 +84,35 @@ static bool ACAGreaterThan(Peer *a, Peer *b)
     return a->getStats().aca_score > b->getStats().aca_score;
 }
 
-void AdvancedChokeAlgorithm::doChokingLeechingState(PeerManager &pman, ChunkManager &cman, const TorrentStats &stats)
+void AdvancedChokeAlgorithm::collectCandidates(PeerManager &pman, ChunkManager &cman, const TorrentStats &stats)
 {
-    QList<Peer *> ppl = pman.getPeers();
-    for (auto i = ppl.begin(); i != ppl.end();) {
-        Peer *p = *i;
-        if (!calcACAScore(p, cman, stats)) {
+    candidates.clear();
+    const QList<Peer *> ppl = pman.getPeers();
+    for (Peer *p : ppl) {
+        if (calcACAScore(p, cman, stats)) {
+            candidates.push_back(p);
+        } else {
             // choke seeders they do not want to download from us anyway
             p->choke();
-            i = ppl.erase(i);
-        } else {
-            ++i;
         }
     }
+    num_candidates = candidates.size();
+}
 
-    // sort list by ACA score
-    std::sort(ppl.begin(), ppl.end(), ACAGreaterThan);
+void AdvancedChokeAlgorithm::doChokingLeechingState(PeerManager &pman, ChunkManager &cman, const TorrentStats &stats)
+{
+    collectCandidates(pman, cman, stats);
 
-    doUnchoking(ppl, updateOptimisticPeer(pman, ppl));
+    // only the peers which get a slot need to be ordered by ACA score
+    SelectBest(candidates, num_upload_slots, ACAGreaterThan);
+
+    doUnchoking(candidates, updateOptimisticPeer(pman, candidates));
 }
 
-void AdvancedChokeAlgorithm::doUnchoking(const QList<Peer *> &ppl, Peer *poup)
+void AdvancedChokeAlgorithm::doUnchoking(const std::vector<Peer *> &ppl, Peer *poup)
 {
     // Get the number of upload slots
-    const Uint32 num_slots = Choker::getNumUploadSlots();
+    const Uint32 num_slots = num_upload_slots;
     // Do the choking and unchoking
     Uint32 num_unchoked = 0;
     for (Peer *p : ppl) {
@@ -132,24 +137,14 @@ static bool UploadRateGreaterThan(Peer *a, Peer *b)
 
 void AdvancedChokeAlgorithm::doChokingSeedingState(PeerManager &pman, ChunkManager &cman, const TorrentStats &stats)
 {
-    QList<Peer *> ppl = pman.getPeers();
-    for (auto i = ppl.begin(); i != ppl.end();) {
-        Peer *p = *i;
-        if (!calcACAScore(p, cman, stats)) {
-            // choke seeders they do not want to download from us anyway
-            p->choke();
-            i = ppl.erase(i);
-        } else {
-            ++i;
-        }
-    }
+    collectCandidates(pman, cman, stats);
 
-    std::sort(ppl.begin(), ppl.end(), UploadRateGreaterThan);
+    SelectBest(candidates, num_upload_slots, UploadRateGreaterThan);
 
-    doUnchoking(ppl, updateOptimisticPeer(pman, ppl));
+    doUnchoking(candidates, updateOptimisticPeer(pman, candidates));
 }
 
-static Uint32 FindPlannedOptimisticUnchokedPeer(const QList<Peer *> &ppl)
+static Uint32 FindPlannedOptimisticUnchokedPeer(const std::vector<Peer *> &ppl)
 {
     const Uint32 num_peers = ppl.size();
     if (num_peers == 0) {
@@ -160,8 +155,8 @@ static Uint32 FindPlannedOptimisticUnchokedPeer(const QList<Peer *> &ppl)
     const Uint32 start = QRandomGenerator::global()->bounded(num_peers);
     Uint32 i = (start + 1) % num_peers;
     while (i != start) {
-        const Peer *p = ppl.at(i);
-        if (p && p->isChoked() && p->isInterested() && !p->isSeeder() && ppl.contains(p)) {
+        const Peer *p = ppl[i];
+        if (p && p->isChoked() && p->isInterested() && !p->isSeeder()) {
             return p->getID();
         }
         i = (i + 1) % num_peers;
@@ -171,7 +166,7 @@ static Uint32 FindPlannedOptimisticUnchokedPeer(const QList<Peer *> &ppl)
     return UNDEFINED_ID;
 }
 
-Peer *AdvancedChokeAlgorithm::updateOptimisticPeer(PeerManager &pman, const QList<Peer *> &ppl)
+Peer *AdvancedChokeAlgorithm::updateOptimisticPeer(PeerManager &pman, const std::vector<Peer *> &ppl)
 {
     // get the planned optimistic unchoked peer and change it if necessary
     Peer *poup = pman.findPeer(opt_unchoked_peer_id);
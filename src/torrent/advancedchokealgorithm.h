@@ -9,10 +9,36 @@
 #include "choker.h"
 #include <peer/peer.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace bt
 {
 struct TorrentStats;
 
+/*!
+ * Move the k best items to the front of a list, sorted from best to worst.
+ * The order of the remaining items is unspecified.
+ * This takes O(n + k log k) instead of the O(n log n) of sorting the whole list.
+ * \param items The list
+ * \param k The number of items to select
+ * \param better Comparison function, returns true if the first argument is better than the second
+ */
+template<class T, class Better>
+void SelectBest(std::vector<T> &items, Uint32 k, Better better)
+{
+    if (k == 0 || items.empty()) {
+        return;
+    }
+
+    if (k < items.size()) {
+        std::nth_element(items.begin(), items.begin() + (k - 1), items.end(), better);
+    } else {
+        k = items.size();
+    }
+    std::sort(items.begin(), items.begin() + k, better);
+}
+
 /*!
     \headerfile torrent/advancedchokealgorithm.h
     \author Joris Guisson <joris.guisson@gmail.com>
@@ -29,11 +55,13 @@ public:
 
 private:
     bool calcACAScore(Peer *p, ChunkManager &cman, const TorrentStats &stats);
-    Peer *updateOptimisticPeer(PeerManager &pman, const QList<Peer *> &ppl);
-    void doUnchoking(const QList<Peer *> &ppl, Peer *poup);
+    void collectCandidates(PeerManager &pman, ChunkManager &cman, const TorrentStats &stats);
+    Peer *updateOptimisticPeer(PeerManager &pman, const std::vector<Peer *> &ppl);
+    void doUnchoking(const std::vector<Peer *> &ppl, Peer *poup);
 
 private:
     TimeStamp last_opt_sel_time; // last time we updated the optimistic unchoked peer
+    std::vector<Peer *> candidates; // kept around to avoid reallocating it every round
 };
 
 }
@@ -6,12 +6,17 @@
 #include "choker.h"
 #include "advancedchokealgorithm.h"
 #include <peer/peermanager.h>
+#include <torrent/torrentstats.h>
 #include <util/functions.h>
 
+#include <cmath>
+
 namespace bt
 {
 ChokeAlgorithm::ChokeAlgorithm()
     : opt_unchoked_peer_id(0)
+    , num_upload_slots(Choker::getNumUploadSlots())
+    , num_candidates(0)
 {
 }
 
@@ -22,26 +27,78 @@ ChokeAlgorithm::~ChokeAlgorithm()
 /////////////////////////////////
 
 Uint32 Choker::num_upload_slots = 2;
+Uint32 Choker::num_global_upload_slots = 0;
+
+// sum of the demand and upload rate of all chokers, as measured in their last update
+static Uint64 total_demand = 0;
+static Uint64 total_upload_rate = 0;
 
 Choker::Choker(PeerManager &pman, ChunkManager &cman)
     : pman(pman)
     , cman(cman)
+    , demand(0)
+    , upload_rate(0)
+    , allocated_slots(num_upload_slots)
+    , measured(false)
 {
     choke = new AdvancedChokeAlgorithm();
 }
 
 Choker::~Choker()
 {
+    reset();
     delete choke;
 }
 
+void Choker::reset()
+{
+    total_demand -= demand;
+    total_upload_rate -= upload_rate;
+    demand = 0;
+    upload_rate = 0;
+    measured = false;
+}
+
 void Choker::update(bool have_all, const TorrentStats &stats)
 {
+    total_upload_rate -= upload_rate;
+    upload_rate = stats.upload_rate;
+    total_upload_rate += upload_rate;
+
+    // until the demand of this torrent is known, use the per torrent number of slots
+    if (num_global_upload_slots == 0 || !measured) {
+        allocated_slots = num_upload_slots;
+    } else {
+        allocated_slots = uploadSlotShare(num_global_upload_slots, demand, total_demand, upload_rate, total_upload_rate);
+    }
+    choke->setNumUploadSlots(allocated_slots);
+
     if (have_all) {
         choke->doChokingSeedingState(pman, cman, stats);
     } else {
         choke->doChokingLeechingState(pman, cman, stats);
     }
+
+    total_demand -= demand;
+    demand = choke->getNumCandidates();
+    total_demand += demand;
+    measured = true;
+}
+
+Uint32 Choker::uploadSlotShare(Uint32 global_slots, Uint32 demand, Uint64 total_demand, Uint32 rate, Uint64 total_rate)
+{
+    if (demand == 0 || total_demand == 0) {
+        return 1;
+    }
+
+    double share = (double)demand / total_demand;
+    if (total_rate > 0) {
+        share = 0.5 * share + 0.5 * (double)rate / total_rate;
+    }
+
+    // round down, but ignore rounding errors in the share
+    const Uint32 slots = (Uint32)std::floor(global_slots * share + 1e-9);
+    return slots < 1 ? 1 : slots;
 }
 
 }
@@ -27,6 +27,8 @@ class ChokeAlgorithm
 {
 protected:
     Uint32 opt_unchoked_peer_id;
+    Uint32 num_upload_slots;
+    Uint32 num_candidates;
 
 public:
     ChokeAlgorithm();
@@ -53,6 +55,18 @@ public:
     {
         return opt_unchoked_peer_id;
     }
+
+    //! Set the number of upload slots to use in the next run (including the optimistic one)
+    void setNumUploadSlots(Uint32 n)
+    {
+        num_upload_slots = n;
+    }
+
+    //! Get the number of peers which wanted to be unchoked during the last run
+    [[nodiscard]] Uint32 getNumCandidates() const
+    {
+        return num_candidates;
+    }
 };
 
 /*!
@@ -62,13 +76,28 @@ public:
  *
  * This class handles the choking and unchoking of Peer's.
  * This class needs to be updated every 10 seconds.
+ *
+ * When a global number of upload slots is set, the slots are divided over all torrents
+ * instead of giving every torrent the same number of slots. Each torrent gets a share based on
+ * its demand (the number of peers which want to be unchoked) and on its upload rate.
+ * The totals are kept up to date incrementally, every time a Choker is updated it replaces its
+ * own contribution, so no torrent needs to look at the peers of other torrents. Torrents which
+ * are stopped, paused or sleeping remove their contribution with reset().
+ *
+ * The global number of slots is a soft limit: shares are rounded down, but every torrent gets
+ * at least one slot, so with more torrents than slots the sum can be higher.
  */
 class KTORRENT_EXPORT Choker
 {
     ChokeAlgorithm *choke;
     PeerManager &pman;
     ChunkManager &cman;
+    Uint32 demand;
+    Uint32 upload_rate;
+    Uint32 allocated_slots;
+    bool measured;
     static Uint32 num_upload_slots;
+    static Uint32 num_global_upload_slots;
 
 public:
     Choker(PeerManager &pman, ChunkManager &cman);
@@ -81,6 +110,12 @@ public:
      */
     void update(bool have_all, const TorrentStats &stats);
 
+    /*!
+     * Remove the demand and upload rate of this torrent from the totals of all torrents.
+     * Must be called when the torrent stops uploading, the next update adds them again.
+     */
+    void reset();
+
     //! Get the PeerID of the optimisticly unchoked peer.
     [[nodiscard]] Uint32 getOptimisticlyUnchokedPeerID() const
     {
@@ -98,6 +133,42 @@ public:
     {
         return num_upload_slots;
     }
+
+    /*!
+     * Set the number of upload slots shared by all torrents.
+     * \param n The number of slots, 0 gives every torrent the per torrent number of slots
+     */
+    static void setNumGlobalUploadSlots(Uint32 n)
+    {
+        num_global_upload_slots = n;
+    }
+
+    //! Get the number of upload slots shared by all torrents
+    static Uint32 getNumGlobalUploadSlots()
+    {
+        return num_global_upload_slots;
+    }
+
+    //! Get the number of upload slots used in the last update
+    [[nodiscard]] Uint32 getAllocatedUploadSlots() const
+    {
+        return allocated_slots;
+    }
+
+    /*!
+     * Calculate the share of the global upload slots of a torrent.
+     * Half of the slots are divided by demand and the other half by upload rate,
+     * when nothing is being uploaded all slots are divided by demand.
+     * The share is rounded down, so the shares of all torrents never add up to more than
+     * global_slots, except that every torrent gets at least one slot.
+     * \param global_slots The number of global upload slots
+     * \param demand The number of peers of the torrent which want to be unchoked
+     * \param total_demand The demand of all torrents
+     * \param rate The upload rate of the torrent
+     * \param total_rate The upload rate of all torrents
+     * \return The number of upload slots of the torrent
+     */
+    static Uint32 uploadSlotShare(Uint32 global_slots, Uint32 demand, Uint64 total_demand, Uint32 rate, Uint64 total_rate);
 };
 
 }
@@ -9,6 +9,8 @@
 #include <dht/dht.h>
 #include <net/portlist.h>
 #include <net/reverseresolver.h>
+#include <tracker/httptrackerclient.h>
+#include <tracker/scrapecoordinator.h>
 #include <utp/utpserver.h>
 
 namespace bt
@@ -20,6 +22,8 @@ Globals::Globals()
     plist = new net::PortList();
     tcp_server = nullptr;
     utp_server = nullptr;
+    http_tracker_client = nullptr;
+    scrape_coordinator = nullptr;
     dh_table = new dht::DHT();
 }
 
@@ -29,6 +33,8 @@ Globals::~Globals()
     net::ReverseResolver::shutdown();
     shutdownUTPServer();
     delete tcp_server;
+    delete scrape_coordinator;
+    delete http_tracker_client;
     delete dh_table;
     delete plist;
 }
@@ -41,6 +47,22 @@ Globals &Globals::instance()
     return *inst;
 }
 
+HTTPTrackerClient &Globals::getHTTPTrackerClient()
+{
+    if (!http_tracker_client) {
+        http_tracker_client = new HTTPTrackerClient();
+    }
+    return *http_tracker_client;
+}
+
+ScrapeCoordinator &Globals::getScrapeCoordinator()
+{
+    if (!scrape_coordinator) {
+        scrape_coordinator = new ScrapeCoordinator();
+    }
+    return *scrape_coordinator;
+}
+
 void Globals::cleanup()
 {
     delete inst;
@@ -27,6 +27,8 @@ class DHTBase;
 namespace bt
 {
 class Server;
+class HTTPTrackerClient;
+class ScrapeCoordinator;
 
 /*!
  * \headerfile torrent/globals.h
@@ -69,6 +71,12 @@ public:
         return *utp_server;
     }
 
+    //! Get the HTTP client of the HTTP trackers, it is created on first use
+    HTTPTrackerClient &getHTTPTrackerClient();
+
+    //! Get the ScrapeCoordinator which batches the scrapes of all trackers, it is created on first use
+    ScrapeCoordinator &getScrapeCoordinator();
+
     static Globals &instance();
     static void cleanup();
 
@@ -79,6 +87,8 @@ private:
     dht::DHTBase *dh_table;
     net::PortList *plist;
     utp::UTPServer *utp_server;
+    HTTPTrackerClient *http_tracker_client;
+    ScrapeCoordinator *scrape_coordinator;
 
     static Globals *inst;
 };
@@ -0,0 +1,185 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include <torrent/advancedchokealgorithm.h>
+#include <torrent/choker.h>
+#include <util/log.h>
+
+#include <QRandomGenerator>
+
+#include <algorithm>
+#include <vector>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+// the part of a peer the choke algorithm sorts on
+struct SyntheticPeer {
+    double aca_score;
+    Uint32 upload_rate;
+};
+
+static bool ACAGreaterThan(const SyntheticPeer *a, const SyntheticPeer *b)
+{
+    return a->aca_score > b->aca_score;
+}
+
+static std::vector<SyntheticPeer> MakeSwarm(Uint32 num_peers)
+{
+    QRandomGenerator rng(42);
+    std::vector<SyntheticPeer> swarm(num_peers);
+    for (SyntheticPeer &p : swarm) {
+        p.aca_score = rng.generateDouble() * 20.0 - 10.0;
+        p.upload_rate = rng.bounded(1024 * 1024);
+    }
+    return swarm;
+}
+
+static std::vector<SyntheticPeer *> PointersTo(std::vector<SyntheticPeer> &swarm)
+{
+    std::vector<SyntheticPeer *> ppl;
+    for (SyntheticPeer &p : swarm) {
+        ppl.push_back(&p);
+    }
+    return ppl;
+}
+
+class ChokerTest : public QObject
+{
+    Q_OBJECT
+public:
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"chokertest.log"_s);
+    }
+
+    void cleanupTestCase()
+    {
+    }
+
+    void testShareByDemand()
+    {
+        // nothing is being uploaded, so the slots are divided by demand
+        QCOMPARE(Choker::uploadSlotShare(100, 10, 100, 0, 0), 10u);
+        QCOMPARE(Choker::uploadSlotShare(100, 50, 100, 0, 0), 50u);
+        QCOMPARE(Choker::uploadSlotShare(100, 100, 100, 0, 0), 100u);
+    }
+
+    void testShareByRate()
+    {
+        // half by demand, half by rate
+        QCOMPARE(Choker::uploadSlotShare(100, 10, 100, 0, 1000), 5u);
+        QCOMPARE(Choker::uploadSlotShare(100, 10, 100, 500, 1000), 30u);
+        QCOMPARE(Choker::uploadSlotShare(100, 100, 100, 1000, 1000), 100u);
+    }
+
+    void testMinimum()
+    {
+        // torrents without demand or a tiny share still get one slot for the optimistic unchoke
+        QCOMPARE(Choker::uploadSlotShare(100, 0, 100, 0, 0), 1u);
+        QCOMPARE(Choker::uploadSlotShare(100, 0, 0, 0, 0), 1u);
+        QCOMPARE(Choker::uploadSlotShare(10, 1, 100000, 0, 1000000), 1u);
+    }
+
+    void testBudget()
+    {
+        // 2000 torrents with equal demand share the global budget instead of getting slots each
+        Uint32 total = 0;
+        for (Uint32 i = 0; i < 2000; i++) {
+            total += Choker::uploadSlotShare(4000, 5, 2000 * 5, 0, 0);
+        }
+        QCOMPARE(total, 4000u);
+    }
+
+    void testUnevenBudget()
+    {
+        // three torrents with a third of the demand each, rounding up would hand out 6 slots
+        Uint32 total = 0;
+        for (Uint32 i = 0; i < 3; i++) {
+            total += Choker::uploadSlotShare(4, 1, 3, 0, 0);
+        }
+        QCOMPARE(total, 3u);
+
+        // random demand and upload rates, every torrent gets at least one slot from the shares
+        QRandomGenerator rng(42);
+        std::vector<Uint32> demand(500);
+        std::vector<Uint32> rate(500);
+        Uint64 total_demand = 0;
+        Uint64 total_rate = 0;
+        for (Uint32 i = 0; i < demand.size(); i++) {
+            demand[i] = 1 + rng.bounded(50);
+            rate[i] = rng.bounded(1024 * 1024);
+            total_demand += demand[i];
+            total_rate += rate[i];
+        }
+
+        const Uint32 global_slots = 100000;
+        total = 0;
+        for (Uint32 i = 0; i < demand.size(); i++) {
+            total += Choker::uploadSlotShare(global_slots, demand[i], total_demand, rate[i], total_rate);
+        }
+        QVERIFY(total <= global_slots);
+        QVERIFY(total > global_slots - demand.size());
+    }
+
+    void testSoftBudget()
+    {
+        // more torrents than slots, the budget is exceeded by the minimum of one slot each
+        Uint32 total = 0;
+        for (Uint32 i = 0; i < 10; i++) {
+            total += Choker::uploadSlotShare(4, 1, 10, 0, 0);
+        }
+        QCOMPARE(total, 10u);
+    }
+
+    void testSelectBest()
+    {
+        std::vector<SyntheticPeer> swarm = MakeSwarm(1000);
+        std::vector<SyntheticPeer *> sorted = PointersTo(swarm);
+        std::sort(sorted.begin(), sorted.end(), ACAGreaterThan);
+
+        for (Uint32 k : {1u, 4u, 20u, 999u, 1000u, 2000u}) {
+            std::vector<SyntheticPeer *> ppl = PointersTo(swarm);
+            SelectBest(ppl, k, ACAGreaterThan);
+            QCOMPARE(ppl.size(), swarm.size());
+            for (Uint32 i = 0; i < k && i < ppl.size(); i++) {
+                QCOMPARE(ppl[i]->aca_score, sorted[i]->aca_score);
+            }
+        }
+
+        std::vector<SyntheticPeer *> empty;
+        SelectBest(empty, 4, ACAGreaterThan);
+        QVERIFY(empty.empty());
+    }
+
+    void benchmarkFullSort()
+    {
+        std::vector<SyntheticPeer> swarm = MakeSwarm(1000);
+        std::vector<SyntheticPeer *> ppl;
+        QBENCHMARK {
+            ppl = PointersTo(swarm);
+            std::sort(ppl.begin(), ppl.end(), ACAGreaterThan);
+        }
+    }
+
+    void benchmarkSelectBest()
+    {
+        std::vector<SyntheticPeer> swarm = MakeSwarm(1000);
+        std::vector<SyntheticPeer *> ppl;
+        QBENCHMARK {
+            ppl = PointersTo(swarm);
+            SelectBest(ppl, Choker::getNumUploadSlots(), ACAGreaterThan);
+        }
+    }
+};
+
+QTEST_MAIN(ChokerTest)
+
+#include "chokertest.moc"
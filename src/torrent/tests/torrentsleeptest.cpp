@@ -0,0 +1,190 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include <interfaces/queuemanagerinterface.h>
+#include <interfaces/serverinterface.h>
+#include <mse/encryptedpacketsocket.h>
+#include <peer/peer.h>
+#include <peer/peerid.h>
+#include <peer/peermanager.h>
+#include <testlib/dummytorrentcreator.h>
+#include <testlib/utils.h>
+#include <torrent/torrentcontrol.h>
+#include <util/error.h>
+#include <util/fileops.h>
+#include <util/functions.h>
+#include <util/log.h>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+const bt::Uint32 TEST_FILE_SIZE = 1024 * 1024;
+
+class TorrentSleepTest : public QEventLoop, public bt::QueueManagerInterface
+{
+    Q_OBJECT
+public:
+    TorrentSleepTest(QObject *parent = nullptr)
+        : QEventLoop(parent)
+    {
+    }
+
+    [[nodiscard]] bool alreadyLoaded(const bt::SHA1Hash &ih) const override
+    {
+        Q_UNUSED(ih);
+        return false;
+    }
+
+    void mergeAnnounceList(const bt::SHA1Hash &ih, const bt::TrackerTier *trk) override
+    {
+        Q_UNUSED(ih);
+        Q_UNUSED(trk);
+    }
+
+private:
+    // how long the torrent sleeps, measured right after an update
+    TimeStamp sleepTime() const
+    {
+        return tc.wakeUpTime() - bt::CurrentTime();
+    }
+
+    void waitForWakeUp()
+    {
+        const TimeStamp now = bt::Now();
+        if (tc.wakeUpTime() > now) {
+            QTest::qWait(int(tc.wakeUpTime() - now) + 10);
+        }
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QVERIFY(bt::InitLibKTorrent());
+        bt::InitLog(u"torrentsleeptest.log"_s, false, false);
+        Peer::setResolveHostnames(false);
+        QVERIFY(creator.createSingleFileTorrent(TEST_FILE_SIZE, u"test.avi"_s));
+
+        try {
+            tc.init(this, bt::LoadFile(creator.torrentPath()), creator.tempPath() + "tor0"_L1, creator.tempPath() + "data/"_L1);
+            tc.createFiles();
+            tc.startDataCheck(false, 0, tc.getStats().total_chunks);
+            do {
+                processEvents(AllEvents, 1000);
+            } while (tc.getStats().status == bt::CHECKING_DATA);
+            QVERIFY(tc.getStats().completed);
+        } catch (bt::Error &err) {
+            Out(SYS_GEN | LOG_DEBUG) << "Failed to load torrent: " << creator.torrentPath() << endl;
+            QFAIL("Torrent load failure");
+        }
+    }
+
+    void cleanupTestCase()
+    {
+        tc.stop();
+    }
+
+    void testSleep()
+    {
+        tc.start();
+        QVERIFY(tc.getStats().running);
+
+        // no peers and nothing to download, so it falls asleep right away
+        tc.update();
+        QVERIFY(tc.isSleeping());
+        QCOMPARE(sleepTime(), TimeStamp(1000));
+
+        // updates before the wake up time are skipped
+        const TorrentControl::SchedulerStats before = TorrentControl::schedulerStats();
+        tc.update();
+        QVERIFY(tc.isSleeping());
+        const TorrentControl::SchedulerStats after = TorrentControl::schedulerStats();
+        QCOMPARE(after.skipped_updates, before.skipped_updates + 1);
+        QCOMPARE(after.full_updates, before.full_updates);
+    }
+
+    void testBackOff()
+    {
+        // every time nothing happened, the torrent sleeps twice as long, up to 8 seconds
+        for (const TimeStamp interval : {2000, 4000, 8000, 8000}) {
+            waitForWakeUp();
+            tc.update();
+            QVERIFY(tc.isSleeping());
+            QCOMPARE(sleepTime(), interval);
+        }
+    }
+
+    void testWakeUpOnPotentialPeers()
+    {
+        QVERIFY(tc.isSleeping());
+        PeerManager *pman = ServerInterface::findPeerManager(tc.getInfoHash());
+        QVERIFY(pman);
+
+        Q_EMIT pman->potentialPeersReady();
+        QVERIFY(!tc.isSleeping());
+
+        // the next update is a full one, after which it sleeps the shortest time again
+        const TorrentControl::SchedulerStats before = TorrentControl::schedulerStats();
+        tc.update();
+        QCOMPARE(TorrentControl::schedulerStats().full_updates, before.full_updates + 1);
+        QVERIFY(tc.isSleeping());
+        QCOMPARE(sleepTime(), TimeStamp(1000));
+    }
+
+    void testWakeUpOnNewConnection()
+    {
+        QVERIFY(tc.isSleeping());
+        PeerManager *pman = ServerInterface::findPeerManager(tc.getInfoHash());
+        QVERIFY(pman);
+
+        auto socket_pair = CreateSocketPair(4);
+        QVERIFY(socket_pair.has_value());
+        pman->newConnection(std::make_unique<mse::EncryptedPacketSocket>(std::move(socket_pair->reader)), PeerID(), 0);
+        writer = std::move(socket_pair->writer);
+        QVERIFY(!tc.isSleeping());
+
+        // a peer without traffic keeps it awake
+        const TorrentControl::SchedulerStats before = TorrentControl::schedulerStats();
+        tc.update();
+        QVERIFY(!tc.isSleeping());
+        QCOMPARE(TorrentControl::schedulerStats().full_updates, before.full_updates + 1);
+    }
+
+    void testLowActivityHandlesPackets()
+    {
+        PeerManager *pman = ServerInterface::findPeerManager(tc.getInfoHash());
+        QVERIFY(pman);
+        QCOMPARE(pman->getNumConnectedPeers(), 1u);
+        const Peer *peer = pman->getPeers().first();
+        QVERIFY(peer->getStats().choked);
+
+        // with little traffic only the bookkeeping is delayed, the UNCHOKE is handled on the next ticks
+        const TorrentControl::SchedulerStats before = TorrentControl::schedulerStats();
+        const Uint8 unchoke[] = {0, 0, 0, 1, 1};
+        QCOMPARE(writer->send(QByteArrayView(unchoke, sizeof(unchoke))), int(sizeof(unchoke)));
+        for (int i = 0; i < 40 && peer->getStats().choked; i++) {
+            QTest::qWait(10);
+            tc.update();
+        }
+        QVERIFY(!peer->getStats().choked);
+
+        const TorrentControl::SchedulerStats after = TorrentControl::schedulerStats();
+        QVERIFY(after.light_updates > before.light_updates);
+        QCOMPARE(after.full_updates, before.full_updates);
+        QCOMPARE(after.skipped_updates, before.skipped_updates);
+    }
+
+private:
+    DummyTorrentCreator creator;
+    bt::TorrentControl tc;
+    std::unique_ptr<net::SocketDevice> writer;
+};
+
+QTEST_MAIN(TorrentSleepTest)
+
+#include "torrentsleeptest.moc"
@@ -61,6 +61,18 @@ namespace bt
 bool TorrentControl::completed_datacheck = false;
 Uint32 TorrentControl::min_diskspace = 100;
 
+// sleeping torrents get a full update at least this often, the interval
+// doubles every time they go back to sleep without anything happening
+const Uint32 MIN_SLEEP_INTERVAL = 1000;
+const Uint32 MAX_SLEEP_INTERVAL = 8000;
+
+// torrents with peers but without downloads and with less traffic than LOW_ACTIVITY_RATE
+// in both directions only do the bookkeeping part of update() at this interval
+const Uint32 LOW_ACTIVITY_INTERVAL = 500;
+const Uint32 LOW_ACTIVITY_RATE = 1024;
+
+static TorrentControl::SchedulerStats scheduler_stats = {0, 0, 0, 0};
+
 TorrentControl::TorrentControl()
     : job_queue(new JobQueue(this))
     , m_qman(nullptr)
@@ -68,6 +80,7 @@ TorrentControl::TorrentControl()
     , tmon(nullptr)
     , prealloc(false)
     , last_diskspace_check(bt::CurrentTime())
+    , sleep_interval(MIN_SLEEP_INTERVAL)
 {
     istats.session_bytes_uploaded = 0;
 
@@ -84,6 +97,7 @@ TorrentControl::TorrentControl()
 
 TorrentControl::~TorrentControl()
 {
+    setSleeping(false);
     if (stats.running) {
         // block all signals to prevent crash at exit
         blockSignals(true);
@@ -103,6 +117,13 @@ void TorrentControl::update()
 {
     UpdateCurrentTime();
 
+    if (bt::CurrentTime() < wake_up_time) {
+        scheduler_stats.skipped_updates++;
+        return;
+    }
+    // wake up time reached, do a full update and go back to sleep if nothing changed
+    setSleeping(false);
+
     if (istats.io_error) {
         stop();
         Q_EMIT stoppedByError(this, stats.error_msg);
@@ -110,6 +131,7 @@ void TorrentControl::update()
     }
 
     if (stats.paused) {
+        scheduler_stats.full_updates++;
         stalled_timer.update();
         pman->update();
         updateStatus();
@@ -130,11 +152,19 @@ void TorrentControl::update()
         uploader->update();
         downloader->update();
 
+        stats.completed = cman->completed();
+        // The peers and downloads are handled on every tick, so messages and requests are never delayed,
+        // but with little activity the statistics, timers and choking only need to be looked at now and then.
+        if (stats.completed == comp && bt::CurrentTime() < bookkeeping_time && !pman->chokerNeedsToRun()) {
+            scheduler_stats.light_updates++;
+            return;
+        }
+        scheduler_stats.full_updates++;
+
         // helper var, check if needed to move completed files somewhere
         bool moveCompleted = false;
         bool checkOnCompletion = false;
 
-        stats.completed = cman->completed();
         if (stats.completed && !comp) {
             pman->killSeeders();
             const QDateTime now = QDateTime::currentDateTime();
@@ -253,6 +283,12 @@ void TorrentControl::update()
         if (moveCompleted) {
             moveToCompletedDir();
         }
+
+        if (canSleep()) {
+            setSleeping(true);
+        } else {
+            bookkeeping_time = lowActivity() ? bt::CurrentTime() + LOW_ACTIVITY_INTERVAL : 0;
+        }
     } catch (BusError &e) {
         Out(SYS_DIO | LOG_IMPORTANT) << "Caught SIGBUS " << endl;
         if (!e.write_operation) {
@@ -268,6 +304,7 @@ void TorrentControl::update()
 void TorrentControl::onIOError(const QString &msg)
 {
     Out(SYS_DIO | LOG_IMPORTANT) << "Error : " << msg << endl;
+    wakeUp();
     stats.stopped_by_error = true;
     stats.status = ERROR;
     stats.error_msg = msg;
@@ -275,6 +312,54 @@ void TorrentControl::onIOError(const QString &msg)
     Q_EMIT statusChanged(this);
 }
 
+TorrentControl::SchedulerStats TorrentControl::schedulerStats()
+{
+    return scheduler_stats;
+}
+
+bool TorrentControl::canSleep() const
+{
+    // without peers, pending connections, webseed downloads and jobs, the only
+    // thing left to do is checking the timers, which can be done at the wake up time
+    return stats.running && !stats.paused && !prealloc && !istats.io_error && !job_queue->runningJobs() && pman->getNumConnectedPeers() == 0
+        && pman->getNumPending() == 0 && downloader->numActiveDownloads() == 0 && (stats.completed || downloader->getNumWebSeeds() == 0)
+        && stats.download_rate == 0 && stats.upload_rate == 0;
+}
+
+bool TorrentControl::lowActivity() const
+{
+    // the peers are connected but hardly anything is transferred, so the statistics
+    // and timers change so little that they do not need to be updated on every tick
+    return stats.running && !stats.paused && !istats.io_error && !job_queue->runningJobs() && downloader->numActiveDownloads() == 0
+        && stats.download_rate < LOW_ACTIVITY_RATE && stats.upload_rate < LOW_ACTIVITY_RATE;
+}
+
+void TorrentControl::setSleeping(bool on)
+{
+    if (on == sleeping) {
+        return;
+    }
+
+    sleeping = on;
+    if (on) {
+        scheduler_stats.sleeping++;
+        // nothing is uploaded while sleeping, so give the upload slots to the other torrents
+        choke->reset();
+        wake_up_time = bt::CurrentTime() + sleep_interval;
+        sleep_interval = qMin(2 * sleep_interval, MAX_SLEEP_INTERVAL);
+    } else {
+        scheduler_stats.sleeping--;
+    }
+}
+
+void TorrentControl::wakeUp()
+{
+    setSleeping(false);
+    sleep_interval = MIN_SLEEP_INTERVAL;
+    wake_up_time = 0;
+    bookkeeping_time = 0;
+}
+
 void TorrentControl::pause()
 {
     if (!stats.running || stats.paused) {
@@ -295,6 +380,7 @@ void TorrentControl::pause()
     downloader->saveWebSeeds(tordir + "webseeds"_L1);
     downloader->removeAllWebSeeds();
     cman->stop();
+    choke->reset();
     stats.paused = true;
     updateRunningTimes();
     saveStats();
@@ -309,6 +395,7 @@ void TorrentControl::unpause()
         return;
     }
 
+    wakeUp();
     cman->start();
 
     try {
@@ -340,6 +427,7 @@ void TorrentControl::start()
         return;
     }
 
+    wakeUp();
     stats.paused = false;
     stats.stopped_by_error = false;
     istats.io_error = false;
@@ -414,6 +502,7 @@ void TorrentControl::updateRunningTimes()
 
 void TorrentControl::stop(WaitJob *wjob)
 {
+    wakeUp();
     if (!stats.paused) {
         updateRunningTimes();
     }
@@ -444,6 +533,7 @@ void TorrentControl::stop(WaitJob *wjob)
     pman->savePeerList(tordir + "peer_list"_L1);
     pman->stop();
     cman->stop();
+    choke->reset();
 
     stats.running = false;
     stats.autostart = wjob != nullptr;
@@ -588,6 +678,7 @@ void TorrentControl::setupData()
 
     connect(pman.get(), &PeerManager::newPeer, this, &TorrentControl::onNewPeer);
     connect(pman.get(), &PeerManager::peerKilled, this, &TorrentControl::onPeerRemoved);
+    connect(pman.get(), &PeerManager::potentialPeersReady, this, &TorrentControl::wakeUp);
     connect(cman.get(), &ChunkManager::excluded, downloader.get(), &Downloader::onExcluded);
     connect(cman.get(), &ChunkManager::included, downloader.get(), &Downloader::onIncluded);
     connect(cman.get(), &ChunkManager::corrupted, this, &TorrentControl::corrupted);
@@ -648,6 +739,7 @@ void TorrentControl::scrapeTracker()
 
 void TorrentControl::onNewPeer(Peer *p)
 {
+    wakeUp();
     if (!stats.superseeding) {
         // Only send which chunks we have when we are not superseeding
         if (p->getStats().fast_extensions) {
@@ -1687,6 +1779,7 @@ bool TorrentControl::addWebSeed(const QUrl &url)
     if (ws) {
         downloader->saveWebSeeds(tordir + "webseeds"_L1);
         ws->setGroupIDs(upload_gid, download_gid); // make sure webseed has proper group ID
+        wakeUp();
     }
     return ws != nullptr;
 }
@@ -1764,6 +1857,7 @@ QString TorrentControl::getComments() const
 
 void TorrentControl::allJobsDone()
 {
+    wakeUp();
     updateStatus();
     // update the QM to be sure
     Q_EMIT updateQueue();
@@ -199,12 +199,54 @@ public:
         return stats_save_timer.getElapsedSinceUpdate();
     }
 
+    /*!
+     * Is the torrent sleeping. A sleeping torrent has no peers and nothing else to do,
+     * so update() returns immediately until it is woken up by an event or its wake up time is reached.
+     */
+    [[nodiscard]] bool isSleeping() const
+    {
+        return sleeping;
+    }
+
+    /*!
+     * Get the time at which a sleeping torrent wakes up, it skips the update() calls before it.
+     */
+    [[nodiscard]] TimeStamp wakeUpTime() const
+    {
+        return wake_up_time;
+    }
+
+    /*!
+     * \brief Counters of the torrent update scheduler.
+     */
+    struct SchedulerStats {
+        //! Number of update() calls which did a full update
+        Uint64 full_updates;
+        //! Number of update() calls which only handled the peers and downloads, because the torrent had low activity
+        Uint64 light_updates;
+        //! Number of update() calls which were skipped because the torrent was sleeping
+        Uint64 skipped_updates;
+        //! Number of torrents which are currently sleeping
+        Uint32 sleeping;
+    };
+
+    /*!
+     * Get the counters of the update scheduler. Sampling them every tick
+     * gives the number of torrents which were active during that tick.
+     */
+    static SchedulerStats schedulerStats();
+
 public:
     /*!
      * Update the object, should be called periodically.
      */
     void update() override;
 
+    /*!
+     * Wake up the torrent if it is sleeping, the next update() will be a full update.
+     */
+    void wakeUp();
+
     /*!
      * Pause the torrent.
      */
@@ -302,6 +344,9 @@ private:
     void setDownloadProps(Uint32 limit, Uint32 rate);
     void downloadPriorityChanged(TorrentFile *tf, Priority newpriority, Priority oldpriority) override;
     void updateRunningTimes();
+    [[nodiscard]] bool canSleep() const;
+    [[nodiscard]] bool lowActivity() const;
+    void setSleeping(bool on);
 
 Q_SIGNALS:
     void dataCheckFinished();
@@ -332,6 +377,10 @@ private:
     bool prealloc;
     TimeStamp last_diskspace_check;
     bool loading_stats = false;
+    bool sleeping = false;
+    Uint32 sleep_interval;
+    TimeStamp wake_up_time = 0;
+    TimeStamp bookkeeping_time = 0;
 
     struct InternalStats {
         QDateTime time_started_dl;
@@ -9,11 +9,9 @@
 #include <QHostAddress>
 #include <QUrlQuery>
 
-#include <KIO/StoredTransferJob>
 #include <KLocalizedString>
 
-#include "kioannouncejob.h"
-#include "version.h"
+#include "httptrackerclient.h"
 #include <bcodec/bdecoder.h>
 #include <bcodec/bnode.h>
 #include <interfaces/exitoperation.h>
@@ -36,7 +34,7 @@ Uint16 HTTPTracker::proxy_port = 8080;
 
 HTTPTracker::HTTPTracker(const QUrl &url, TrackerDataSource *tds, const PeerID &id, int tier)
     : Tracker(url, tds, id, tier)
-    , active_job(nullptr)
+    , active_request(nullptr)
     , failures(0)
     , supports_partial_seed_extension(false)
 {
@@ -60,9 +58,9 @@ void HTTPTracker::stop(WaitJob *wjob)
     if (!started) {
         announce_queue.clear();
         reannounce_timer.stop();
-        if (active_job) {
-            active_job->kill();
-            active_job = nullptr;
+        if (active_request) {
+            active_request->abort();
+            active_request = nullptr;
             status = TRACKER_IDLE;
             Q_EMIT requestOK();
         }
@@ -102,37 +100,46 @@ void HTTPTracker::scrape()
         return;
     }
 
+    // the scrape is sent together with those of the other torrents on this tracker
+    Globals::instance().getScrapeCoordinator().add(this, MAX_SCRAPE_BATCH);
+}
+
+void HTTPTracker::scrapeBatch(const ScrapeBatch &batch)
+{
     QUrl scrape_url = url;
     scrape_url.setPath(url.path(QUrl::FullyEncoded).replace(QStringLiteral("announce"), QStringLiteral("scrape")), QUrl::StrictMode);
 
     QString epq = scrape_url.query(QUrl::FullyEncoded);
-    const SHA1Hash &info_hash = tds->infoHash();
-    if (epq.length()) {
-        epq += '&'_L1;
+    for (const QPointer<Tracker> &t : batch) {
+        if (!t) {
+            continue;
+        }
+
+        // all trackers with the same url are HTTPTrackers
+        const SHA1Hash &info_hash = static_cast<HTTPTracker *>(t.data())->tds->infoHash();
+        if (epq.length()) {
+            epq += '&'_L1;
+        }
+        epq += QLatin1String("info_hash=") + info_hash.toURLString();
     }
-    epq += QLatin1String("info_hash=") + info_hash.toURLString();
     scrape_url.setQuery(epq, QUrl::StrictMode);
 
     Out(SYS_TRK | LOG_NOTICE) << "Doing scrape request to url : " << scrape_url << endl;
-    KIO::MetaData md;
-    setupMetaData(md);
-
-    KIO::StoredTransferJob *j = KIO::storedGet(scrape_url, KIO::NoReload, KIO::HideProgressInfo);
-    // set the meta data
-    j->setMetaData(md);
-
-    connect(j, &KIO::StoredTransferJob::result, this, &HTTPTracker::onScrapeResult);
+    HTTPTrackerRequest *req = get(scrape_url);
+    // the request outlives this tracker if it is deleted in the meantime
+    connect(req, &HTTPTrackerRequest::finished, req, [batch](HTTPTrackerRequest *r) {
+        onScrapeResult(r, batch);
+    });
 }
 
-void HTTPTracker::onScrapeResult(const KJob *j)
+void HTTPTracker::onScrapeResult(bt::HTTPTrackerRequest *req, const ScrapeBatch &batch)
 {
-    if (j->error()) {
-        Out(SYS_TRK | LOG_IMPORTANT) << "Scrape failed : " << j->errorString() << endl;
+    if (req->failed()) {
+        Out(SYS_TRK | LOG_IMPORTANT) << "Scrape failed : " << req->errorString() << endl;
         return;
     }
 
-    const auto st = static_cast<const KIO::StoredTransferJob *>(j);
-    BDecoder dec(st->data(), false);
+    BDecoder dec(req->replyData(), false);
     std::unique_ptr<BDictNode> dict;
 
     try {
@@ -142,27 +149,36 @@ void HTTPTracker::onScrapeResult(const KJob *j)
         return;
     }
 
-    if (dict) {
-        BDictNode *d = dict.get();
-        d = d->getDict("files");
-        if (d) {
-            d = d->getDict(tds->infoHash());
-            if (d) {
-                try {
-                    seeders = d->getInt("complete");
-                    leechers = d->getInt("incomplete");
-                    total_downloaded = d->getInt("downloaded");
-                    supports_partial_seed_extension = d->getValue("downloaders") != nullptr;
-                    Out(SYS_TRK | LOG_DEBUG) << "Scrape : leechers = " << leechers << ", seeders = " << seeders << ", downloaded = " << total_downloaded
-                                             << endl;
-                } catch (...) {
-                }
-                Q_EMIT scrapeDone();
-                if (status == bt::TRACKER_ERROR) {
-                    status = bt::TRACKER_OK;
-                    failures = 0;
-                }
-            }
+    BDictNode *files = dict ? dict->getDict("files") : nullptr;
+    if (!files) {
+        return;
+    }
+
+    // hand every tracker the stats of its own torrent
+    for (const QPointer<Tracker> &t : batch) {
+        if (!t) {
+            continue;
+        }
+
+        HTTPTracker *trk = static_cast<HTTPTracker *>(t.data());
+        BDictNode *d = files->getDict(trk->tds->infoHash());
+        if (!d) {
+            continue;
+        }
+
+        try {
+            trk->seeders = d->getInt("complete");
+            trk->leechers = d->getInt("incomplete");
+            trk->total_downloaded = d->getInt("downloaded");
+            trk->supports_partial_seed_extension = d->getValue("downloaders") != nullptr;
+            Out(SYS_TRK | LOG_DEBUG) << "Scrape : leechers = " << trk->leechers << ", seeders = " << trk->seeders
+                                     << ", downloaded = " << trk->total_downloaded << endl;
+        } catch (...) {
+        }
+        Q_EMIT trk->scrapeDone();
+        if (trk->status == bt::TRACKER_ERROR) {
+            trk->status = bt::TRACKER_OK;
+            trk->failures = 0;
         }
     }
 }
@@ -220,14 +236,18 @@ void HTTPTracker::doRequest(WaitJob *wjob)
     QUrl u = url;
     u.setQuery(epq, QUrl::StrictMode);
 
-    if (active_job) {
+    if (active_request) {
         announce_queue.append(u);
         Out(SYS_TRK | LOG_NOTICE) << "Announce ongoing, queueing announce" << endl;
     } else {
         doAnnounce(u);
-        // if there is a wait job, add this job to the waitjob
+        // if there is a wait job, let it wait until the request is gone
         if (wjob) {
-            wjob->addExitOperation(new ExitJobOperation(active_job));
+            ExitOperation *op = new ExitOperation();
+            connect(active_request, &QObject::destroyed, op, [op]() {
+                Q_EMIT op->operationFinished(op);
+            });
+            wjob->addExitOperation(op);
         }
     }
 }
@@ -341,21 +361,17 @@ bool HTTPTracker::updateData(const QByteArray &data)
     return true;
 }
 
-void HTTPTracker::onKIOAnnounceResult(const KJob *j)
-{
-    const auto st = static_cast<const KIOAnnounceJob *>(j);
-    onAnnounceResult(st->announceUrl(), st->replyData(), j);
-}
-
-void HTTPTracker::onAnnounceResult(const QUrl &url, const QByteArray &data, const KJob *j)
+void HTTPTracker::onAnnounceResult(bt::HTTPTrackerRequest *req)
 {
     timer.stop();
-    active_job = nullptr;
-    if (j->error() && data.size() == 0) {
+    active_request = nullptr;
+    const QUrl &url = req->url();
+    const QByteArray &data = req->replyData();
+    if (req->failed() && data.size() == 0) {
         QString err = error;
         error.clear();
         if (err.isEmpty()) {
-            err = j->errorString();
+            err = req->errorString();
         }
 
         Out(SYS_TRK | LOG_IMPORTANT) << "Error : " << err << endl;
@@ -403,30 +419,24 @@ void HTTPTracker::emitInvalidURLFailure()
     failed(i18n("Invalid tracker URL"));
 }
 
-void HTTPTracker::setupMetaData(KIO::MetaData &md)
+HTTPTrackerRequest *HTTPTracker::get(const QUrl &u)
 {
-    md[u"UserAgent"_s] = bt::GetVersionString();
-    md[u"SendLanguageSettings"_s] = u"false"_s;
-    md[u"cookies"_s] = u"none"_s;
-    //  md[u"accept"_s] = u"text/plain"_s;
-    md[u"accept"_s] = u"text/html, image/gif, image/jpeg, *; q=.2, */*; q=.2"_s;
+    HTTPTrackerClient &client = Globals::instance().getHTTPTrackerClient();
+    QString proxy_host;
     if (proxy_on) {
-        QString p = u"%1:%2"_s.arg(proxy).arg(proxy_port);
+        QString p = proxy.trimmed();
         if (!p.startsWith(QLatin1String("http://"))) {
             p = "http://"_L1 + p;
         }
-        // set the proxy if the doNotUseKDEProxy ix enabled (URL must be valid to)
-        const QUrl url(p);
-        if (url.isValid() && proxy.trimmed().length() > 0) {
-            md[u"UseProxy"_s] = p;
-            md[u"ProxyUrls"_s] = p;
-        } else {
-            md[u"UseProxy"_s] = QString();
-            md[u"ProxyUrls"_s] = QString();
+        // the proxy is only used when the URL is valid
+        const QUrl proxy_url(p);
+        if (proxy_url.isValid() && proxy.trimmed().length() > 0) {
+            proxy_host = proxy_url.host();
+            Out(SYS_TRK | LOG_DEBUG) << "Using proxy : " << proxy_host << ":" << proxy_port << endl;
         }
-
-        Out(SYS_TRK | LOG_DEBUG) << "Using proxy : " << md[u"UseProxy"_s] << endl;
     }
+    client.setProxy(proxy_host, proxy_port);
+    return client.get(u);
 }
 
 void HTTPTracker::doAnnounceQueue()
@@ -442,26 +452,26 @@ void HTTPTracker::doAnnounceQueue()
 
 void HTTPTracker::doAnnounce(const QUrl &u)
 {
-    Out(SYS_TRK | LOG_NOTICE) << "Doing tracker request to url (via KIO): " << u.toString() << endl;
+    Out(SYS_TRK | LOG_NOTICE) << "Doing tracker request to url : " << u.toString() << endl;
 
-    KIO::MetaData md;
-    setupMetaData(md);
-    KIOAnnounceJob *j = new KIOAnnounceJob(u, md);
-    connect(j, &KIOAnnounceJob::result, this, &HTTPTracker::onKIOAnnounceResult);
-    active_job = j;
+    active_request = get(u);
+    connect(active_request, &HTTPTrackerRequest::finished, this, &HTTPTracker::onAnnounceResult);
+    // the time spent waiting for other requests to the same host does not count
+    connect(active_request, &HTTPTrackerRequest::started, this, [this]() {
+        timer.start(60 * 1000);
+    });
 
     time_out = false;
-    timer.start(60 * 1000);
     status = TRACKER_ANNOUNCING;
     Q_EMIT requestPending();
 }
 
 void HTTPTracker::onTimeout()
 {
-    if (active_job) {
+    if (active_request) {
         time_out = true;
         error = i18n("Timeout contacting tracker %1", url.toString());
-        active_job->kill(KJob::EmitResult);
+        active_request->cancel(error);
     }
 }
 
@@ -10,21 +10,17 @@
 #include <QTimer>
 #include <ktorrent_export.h>
 
-class KJob;
-
-namespace KIO
-{
-class MetaData;
-}
-
 namespace bt
 {
+class HTTPTrackerRequest;
+
 /*!
  * \headerfile tracker/httptracker.h
  * \author Joris Guisson
  * \brief Communicates with a HTTP tracker.
  *
  * This class uses the HTTP protocol to communicate with the tracker.
+ * The requests go through the HTTPTrackerClient which is shared by all HTTP trackers.
  */
 class KTORRENT_EXPORT HTTPTracker : public Tracker
 {
@@ -41,14 +37,17 @@ public:
         return failures;
     }
     void scrape() override;
+    void scrapeBatch(const ScrapeBatch &batch) override;
+
+    //! Maximum number of info hashes in one scrape request
+    static constexpr Uint32 MAX_SCRAPE_BATCH = 50;
 
     static void setProxy(const QString &proxy, const bt::Uint16 proxy_port);
     static void setProxyEnabled(bool on);
     [[deprecated]] static void setUseQHttp(bool on);
 
 private Q_SLOTS:
-    void onKIOAnnounceResult(const KJob *j);
-    void onScrapeResult(const KJob *j);
+    void onAnnounceResult(bt::HTTPTrackerRequest *req);
     void emitInvalidURLFailure();
     void onTimeout();
     void manualUpdate() override;
@@ -56,13 +55,13 @@ private Q_SLOTS:
 private:
     void doRequest(WaitJob *wjob = nullptr);
     bool updateData(const QByteArray &data);
-    void setupMetaData(KIO::MetaData &md);
     void doAnnounceQueue();
     void doAnnounce(const QUrl &u);
-    void onAnnounceResult(const QUrl &url, const QByteArray &data, const KJob *j);
+    HTTPTrackerRequest *get(const QUrl &u);
+    static void onScrapeResult(bt::HTTPTrackerRequest *req, const ScrapeBatch &batch);
 
 private:
-    KJob *active_job;
+    HTTPTrackerRequest *active_request;
     QList<QUrl> announce_queue;
     QString event;
     QTimer timer;
@@ -0,0 +1,245 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "httptrackerclient.h"
+
+#include <KLocalizedString>
+#include <QNetworkAccessManager>
+#include <QNetworkProxyFactory>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+#include "version.h"
+#include <util/functions.h>
+#include <util/log.h>
+
+namespace bt
+{
+namespace
+{
+// Uses the configured proxy, or the system proxy when none is configured
+class TrackerProxyFactory : public QNetworkProxyFactory
+{
+public:
+    QList<QNetworkProxy> queryProxy(const QNetworkProxyQuery &query) override
+    {
+        if (!host.isEmpty()) {
+            return {QNetworkProxy(QNetworkProxy::HttpProxy, host, port)};
+        }
+        return QNetworkProxyFactory::systemProxyForQuery(query);
+    }
+
+    QString host;
+    Uint16 port = 0;
+};
+}
+
+HTTPTrackerRequest::HTTPTrackerRequest(const QUrl &url, const QString &host, HTTPTrackerClient *client)
+    : QObject(client)
+    , req_url(url)
+    , host(host)
+    , client(client)
+{
+}
+
+HTTPTrackerRequest::~HTTPTrackerRequest()
+{
+}
+
+void HTTPTrackerRequest::abort()
+{
+    client->finish(this, false);
+}
+
+void HTTPTrackerRequest::cancel(const QString &reason)
+{
+    error_string = reason;
+    client->finish(this, true);
+}
+
+HTTPTrackerClient::HTTPTrackerClient(QObject *parent)
+    : QObject(parent)
+    , manager(new QNetworkAccessManager(this))
+    , max_per_host(DEFAULT_MAX_REQUESTS_PER_HOST)
+{
+    manager->setProxyFactory(new TrackerProxyFactory());
+}
+
+HTTPTrackerClient::~HTTPTrackerClient()
+{
+}
+
+HTTPTrackerRequest *HTTPTrackerClient::get(const QUrl &url)
+{
+    const QString host = url.scheme() + QLatin1Char(':') + url.host() + QLatin1Char(':') + QString::number(url.port());
+    HTTPTrackerRequest *req = new HTTPTrackerRequest(url, host, this);
+    hosts[host].queue.append(req);
+    // start it from the event loop, so the caller can connect to the request first
+    QMetaObject::invokeMethod(
+        this,
+        [this, host]() {
+            startQueued(host);
+        },
+        Qt::QueuedConnection);
+    return req;
+}
+
+void HTTPTrackerClient::setMaxRequestsPerHost(Uint32 max)
+{
+    max_per_host = qMax<Uint32>(max, 1);
+}
+
+Uint32 HTTPTrackerClient::numActive() const
+{
+    Uint32 ret = 0;
+    for (const Host &h : hosts) {
+        ret += h.active;
+    }
+    return ret;
+}
+
+Uint32 HTTPTrackerClient::numQueued() const
+{
+    Uint32 ret = 0;
+    for (const Host &h : hosts) {
+        ret += h.queue.size();
+    }
+    return ret;
+}
+
+HTTPTrackerClient::Stats HTTPTrackerClient::stats(const QUrl &url) const
+{
+    return tracker_stats.value(trackerKey(url));
+}
+
+void HTTPTrackerClient::setProxy(const QString &host, Uint16 port)
+{
+    // the manager owns the factory, but hands it out as const
+    auto *factory = static_cast<TrackerProxyFactory *>(const_cast<QNetworkProxyFactory *>(manager->proxyFactory()));
+    factory->host = host;
+    factory->port = port;
+}
+
+QString HTTPTrackerClient::trackerKey(const QUrl &url)
+{
+    return url.adjusted(QUrl::RemoveQuery | QUrl::RemoveFragment).toString();
+}
+
+void HTTPTrackerClient::startQueued(const QString &host)
+{
+    auto i = hosts.find(host);
+    if (i == hosts.end()) {
+        return;
+    }
+
+    // start can not touch the hosts, so the iterator stays valid
+    while (i->active < max_per_host && !i->queue.isEmpty()) {
+        i->active++;
+        start(i->queue.takeFirst());
+    }
+
+    if (i->active == 0 && i->queue.isEmpty()) {
+        hosts.erase(i);
+    }
+}
+
+void HTTPTrackerClient::start(HTTPTrackerRequest *req)
+{
+    QNetworkRequest r(req->req_url);
+    r.setHeader(QNetworkRequest::UserAgentHeader, bt::GetVersionString());
+    r.setRawHeader("Accept", "text/html, image/gif, image/jpeg, *; q=.2, */*; q=.2");
+    r.setAttribute(QNetworkRequest::CookieLoadControlAttribute, QNetworkRequest::Manual);
+    r.setAttribute(QNetworkRequest::CookieSaveControlAttribute, QNetworkRequest::Manual);
+    r.setTransferTimeout(REQUEST_TIMEOUT);
+
+    req->started = CurrentTime();
+    req->reply = manager->get(r);
+    connect(req->reply, &QNetworkReply::readyRead, req, [this, req]() {
+        onReadyRead(req);
+    });
+    connect(req->reply, &QNetworkReply::finished, req, [this, req]() {
+        onFinished(req);
+    });
+    Q_EMIT req->started(req);
+}
+
+void HTTPTrackerClient::onReadyRead(HTTPTrackerRequest *req)
+{
+    if (req->reply_data.size() + req->reply->bytesAvailable() > MAX_REPLY_SIZE) {
+        // If the reply is larger then a mega byte, the server
+        // has probably gone bonkers
+        Out(SYS_TRK | LOG_DEBUG) << "Tracker sending back to much data in announce reply, aborting ..." << endl;
+        req->reply_data.clear();
+        req->cancel(i18n("Tracker sent too much data"));
+        return;
+    }
+
+    req->reply_data.append(req->reply->readAll());
+}
+
+void HTTPTrackerClient::onFinished(HTTPTrackerRequest *req)
+{
+    req->reply_data.append(req->reply->readAll());
+    if (req->reply->error() != QNetworkReply::NoError) {
+        req->error_string = req->reply->errorString();
+    }
+    finish(req, true);
+}
+
+void HTTPTrackerClient::finish(HTTPTrackerRequest *req, bool emit_finished)
+{
+    if (req->done) {
+        return;
+    }
+    req->done = true;
+
+    if (req->reply) {
+        if (emit_finished) {
+            // record how it went, aborted requests say nothing about the tracker
+            Stats &s = tracker_stats[trackerKey(req->req_url)];
+            const TimeStamp latency = CurrentTime() - req->started;
+            s.requests++;
+            s.last_latency = latency;
+            s.max_latency = qMax(s.max_latency, latency);
+            s.total_latency += latency;
+            if (req->failed()) {
+                s.failures++;
+                s.last_error = req->error_string;
+            }
+        }
+
+        QNetworkReply *reply = req->reply;
+        req->reply = nullptr;
+        reply->disconnect(req);
+        reply->abort();
+        reply->deleteLater();
+        release(req);
+    } else {
+        auto i = hosts.find(req->host);
+        if (i != hosts.end()) {
+            i->queue.removeAll(req);
+        }
+        startQueued(req->host);
+    }
+
+    if (emit_finished) {
+        Q_EMIT req->finished(req);
+    }
+    req->deleteLater();
+}
+
+void HTTPTrackerClient::release(HTTPTrackerRequest *req)
+{
+    auto i = hosts.find(req->host);
+    if (i != hosts.end() && i->active > 0) {
+        i->active--;
+    }
+    startQueued(req->host);
+}
+
+}
+
+#include "moc_httptrackerclient.cpp"
@@ -0,0 +1,181 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef BT_HTTPTRACKERCLIENT_H
+#define BT_HTTPTRACKERCLIENT_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QUrl>
+#include <ktorrent_export.h>
+#include <util/constants.h>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+namespace bt
+{
+class HTTPTrackerClient;
+
+/*!
+    \headerfile tracker/httptrackerclient.h
+    \brief A GET request to a HTTP tracker.
+
+    The request is owned by the HTTPTrackerClient, it deletes itself
+    after finished has been emitted or after it has been aborted.
+*/
+class KTORRENT_EXPORT HTTPTrackerRequest : public QObject
+{
+    Q_OBJECT
+public:
+    ~HTTPTrackerRequest() override;
+
+    //! Get the url of the request
+    [[nodiscard]] const QUrl &url() const
+    {
+        return req_url;
+    }
+
+    //! Get the data of the reply
+    [[nodiscard]] const QByteArray &replyData() const
+    {
+        return reply_data;
+    }
+
+    //! Did the request fail
+    [[nodiscard]] bool failed() const
+    {
+        return !error_string.isEmpty();
+    }
+
+    //! Get the reason why the request failed
+    [[nodiscard]] const QString &errorString() const
+    {
+        return error_string;
+    }
+
+    //! Cancel the request, finished is not emitted
+    void abort();
+
+    //! Fail the request with an error, finished is emitted
+    void cancel(const QString &reason);
+
+Q_SIGNALS:
+    //! The request has left the queue and is sent to the tracker
+    void started(bt::HTTPTrackerRequest *req);
+
+    //! The request has finished, successfully or not
+    void finished(bt::HTTPTrackerRequest *req);
+
+private:
+    HTTPTrackerRequest(const QUrl &url, const QString &host, HTTPTrackerClient *client);
+
+    QUrl req_url;
+    QString host;
+    HTTPTrackerClient *client;
+    QNetworkReply *reply = nullptr;
+    QByteArray reply_data;
+    QString error_string;
+    TimeStamp started = 0;
+    bool done = false;
+
+    friend class HTTPTrackerClient;
+};
+
+/*!
+    \headerfile tracker/httptrackerclient.h
+    \brief HTTP client shared by all HTTPTrackers.
+
+    All announces and scrapes are done in process over one QNetworkAccessManager,
+    which keeps the connections to a tracker alive between requests and caches
+    the DNS lookups of the tracker hosts. A lot of torrents on the same tracker
+    tend to announce at the same time, so only a limited number of requests per
+    host are in flight, the others wait in a queue.
+
+    The latency and failures of the requests are recorded per tracker.
+*/
+class KTORRENT_EXPORT HTTPTrackerClient : public QObject
+{
+    Q_OBJECT
+public:
+    HTTPTrackerClient(QObject *parent = nullptr);
+    ~HTTPTrackerClient() override;
+
+    static constexpr Uint32 DEFAULT_MAX_REQUESTS_PER_HOST = 4;
+    static constexpr int REQUEST_TIMEOUT = 60 * 1000;
+    static constexpr int MAX_REPLY_SIZE = 1024 * 1024;
+
+    /*!
+        Do a GET request.
+        \param url The url
+        \return The request, which is queued if too many requests to the same host are in flight
+    */
+    HTTPTrackerRequest *get(const QUrl &url);
+
+    //! Set the maximum number of requests in flight to one host
+    void setMaxRequestsPerHost(Uint32 max);
+
+    //! Get the number of requests in flight
+    [[nodiscard]] Uint32 numActive() const;
+
+    //! Get the number of requests waiting for their host
+    [[nodiscard]] Uint32 numQueued() const;
+
+    struct Stats {
+        Uint32 requests = 0;
+        Uint32 failures = 0;
+        //! Latencies in ms
+        TimeStamp last_latency = 0;
+        TimeStamp max_latency = 0;
+        TimeStamp total_latency = 0;
+        QString last_error;
+
+        [[nodiscard]] TimeStamp averageLatency() const
+        {
+            return requests > 0 ? total_latency / requests : 0;
+        }
+    };
+
+    /*!
+        Get the statistics of a tracker.
+        \param url The url of the tracker, the query is ignored
+    */
+    [[nodiscard]] Stats stats(const QUrl &url) const;
+
+    /*!
+        Set the HTTP proxy to use, an empty host means the system proxy is used.
+        \param host Hostname or IP address of the proxy
+        \param port Port of the proxy
+    */
+    void setProxy(const QString &host, Uint16 port);
+
+private:
+    struct Host {
+        Uint32 active = 0;
+        QList<HTTPTrackerRequest *> queue;
+    };
+
+    void startQueued(const QString &host);
+    void start(HTTPTrackerRequest *req);
+    void onReadyRead(HTTPTrackerRequest *req);
+    void onFinished(HTTPTrackerRequest *req);
+    void finish(HTTPTrackerRequest *req, bool emit_finished);
+    void release(HTTPTrackerRequest *req);
+    static QString trackerKey(const QUrl &url);
+
+private:
+    QNetworkAccessManager *manager;
+    QHash<QString, Host> hosts;
+    QHash<QString, Stats> tracker_stats;
+    Uint32 max_per_host;
+
+    friend class HTTPTrackerRequest;
+};
+
+}
+
+#endif // BT_HTTPTRACKERCLIENT_H
@@ -16,8 +16,11 @@ namespace bt
 /*!
  * \headerfile tracker/kioannouncejob.h
  * \brief KIO::Job that announces to a tracker (a HTTP get request).
+ *
+ * \deprecated HTTPTracker does its requests with HTTPTrackerClient now,
+ * this class is no longer used and will be removed.
  */
-class KTORRENT_EXPORT KIOAnnounceJob : public KIO::Job
+class KTORRENT_DEPRECATED_EXPORT KIOAnnounceJob : public KIO::Job
 {
     Q_OBJECT
 public:
@@ -0,0 +1,86 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "scrapecoordinator.h"
+#include "tracker.h"
+#include <util/log.h>
+
+namespace bt
+{
+ScrapeCoordinator::ScrapeCoordinator(QObject *parent)
+    : QObject(parent)
+{
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, &ScrapeCoordinator::flush);
+}
+
+ScrapeCoordinator::~ScrapeCoordinator()
+{
+}
+
+void ScrapeCoordinator::add(Tracker *t, Uint32 max_batch)
+{
+    Group &g = queued[t->trackerURL()];
+    g.max_batch = qMax<Uint32>(max_batch, 1);
+    if (!g.trackers.contains(t)) {
+        g.trackers.append(t);
+    }
+
+    if (!timer.isActive()) {
+        timer.start(BATCH_DELAY);
+    }
+}
+
+void ScrapeCoordinator::flush()
+{
+    timer.stop();
+    // scraping can queue new scrapes, they go in the next round
+    const QHash<QUrl, Group> groups = std::move(queued);
+    queued.clear();
+
+    for (auto i = groups.cbegin(); i != groups.cend(); ++i) {
+        const QList<ScrapeBatch> batches = makeBatches(i->trackers, i->max_batch);
+        for (const ScrapeBatch &batch : batches) {
+            Out(SYS_TRK | LOG_DEBUG) << "Scraping " << batch.size() << " torrents at " << i.key() << endl;
+            batch.first()->scrapeBatch(batch);
+        }
+    }
+}
+
+Uint32 ScrapeCoordinator::numQueued() const
+{
+    Uint32 ret = 0;
+    for (const Group &g : queued) {
+        ret += g.trackers.size();
+    }
+    return ret;
+}
+
+QList<ScrapeBatch> ScrapeCoordinator::makeBatches(const ScrapeBatch &trackers, Uint32 max_batch)
+{
+    QList<ScrapeBatch> batches;
+    ScrapeBatch batch;
+    for (const QPointer<Tracker> &t : trackers) {
+        if (!t) {
+            continue;
+        }
+
+        batch.append(t);
+        if (Uint32(batch.size()) >= max_batch) {
+            batches.append(batch);
+            batch.clear();
+        }
+    }
+
+    if (!batch.isEmpty()) {
+        batches.append(batch);
+    }
+    return batches;
+}
+
+}
+
+#include "moc_scrapecoordinator.cpp"
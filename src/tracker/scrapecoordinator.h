@@ -0,0 +1,77 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef BT_SCRAPECOORDINATOR_H
+#define BT_SCRAPECOORDINATOR_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QUrl>
+#include <ktorrent_export.h>
+#include <util/constants.h>
+
+namespace bt
+{
+class Tracker;
+
+using ScrapeBatch = QList<QPointer<Tracker>>;
+
+/*!
+    \headerfile tracker/scrapecoordinator.h
+    \brief Batches the scrapes of all torrents on the same tracker.
+
+    Every torrent has its own Tracker objects, and each of them used to scrape its
+    own info hash. HTTP and UDP trackers both accept many info hashes in one scrape
+    request, so the trackers queue their scrape here instead. After a short delay
+    the queued trackers are grouped by url, and the first tracker of every group
+    scrapes the info hashes of the whole group. The results are handed back to
+    each tracker of the group.
+*/
+class KTORRENT_EXPORT ScrapeCoordinator : public QObject
+{
+    Q_OBJECT
+public:
+    ScrapeCoordinator(QObject *parent = nullptr);
+    ~ScrapeCoordinator() override;
+
+    //! Time in ms the scrapes are collected before they are sent
+    static constexpr int BATCH_DELAY = 2000;
+
+    /*!
+        Queue the scrape of a tracker.
+        \param t The tracker
+        \param max_batch The maximum number of info hashes in one request to the tracker
+    */
+    void add(Tracker *t, Uint32 max_batch);
+
+    //! Send all queued scrapes now
+    void flush();
+
+    //! Get the number of trackers which wait for their scrape
+    [[nodiscard]] Uint32 numQueued() const;
+
+    /*!
+        Split the trackers in batches of at most max_batch trackers.
+        Trackers which have been deleted are left out.
+    */
+    static QList<ScrapeBatch> makeBatches(const ScrapeBatch &trackers, Uint32 max_batch);
+
+private:
+    struct Group {
+        Uint32 max_batch = 1;
+        ScrapeBatch trackers;
+    };
+
+    QHash<QUrl, Group> queued;
+    QTimer timer;
+};
+
+}
+
+#endif // BT_SCRAPECOORDINATOR_H
@@ -0,0 +1,181 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include <download/tests/localhttpserver.h>
+#include <tracker/httptrackerclient.h>
+#include <util/log.h>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+class HTTPTrackerClientTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    HTTPTrackerClientTest()
+    {
+    }
+    ~HTTPTrackerClientTest() override
+    {
+    }
+
+private:
+    // Count the finished requests and remember their data
+    HTTPTrackerRequest *get(HTTPTrackerClient &client, const QUrl &url)
+    {
+        HTTPTrackerRequest *req = client.get(url);
+        connect(req, &HTTPTrackerRequest::finished, this, [this](HTTPTrackerRequest *r) {
+            num_finished++;
+            if (r->failed()) {
+                num_failed++;
+            } else {
+                replies.append(r->replyData());
+            }
+        });
+        return req;
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"httptrackerclienttest.log"_s);
+    }
+
+    void init()
+    {
+        num_finished = 0;
+        num_failed = 0;
+        replies.clear();
+    }
+
+    void testMaxRequestsPerHost()
+    {
+        LocalHttpServer server;
+        server.addFile(u"/announce"_s, "d8:intervali1800ee");
+        server.setLatency(100);
+
+        HTTPTrackerClient client;
+        client.setMaxRequestsPerHost(2);
+        const QUrl url = server.url(u"/announce"_s);
+        for (int i = 0; i < 5; i++) {
+            get(client, QUrl(url.toString() + u"?info_hash=%1"_s.arg(i)));
+        }
+
+        // the requests are started from the event loop
+        QCOMPARE(client.numQueued(), 5u);
+        QTRY_COMPARE(client.numActive(), 2u);
+        QCOMPARE(client.numQueued(), 3u);
+
+        QTRY_COMPARE_WITH_TIMEOUT(num_finished, 5, 10000);
+        QCOMPARE(num_failed, 0);
+        for (const QByteArray &r : std::as_const(replies)) {
+            QCOMPARE(r, QByteArray("d8:intervali1800ee"));
+        }
+        QCOMPARE(client.numActive(), 0u);
+
+        // the connections are kept alive and reused
+        QVERIFY(server.num_connections <= 2);
+
+        // the query does not matter for the statistics
+        const HTTPTrackerClient::Stats s = client.stats(url);
+        QCOMPARE(s.requests, 5u);
+        QCOMPARE(s.failures, 0u);
+        QVERIFY(s.max_latency >= 90);
+        QVERIFY(s.averageLatency() <= s.max_latency);
+    }
+
+    void testFailure()
+    {
+        LocalHttpServer server;
+        HTTPTrackerClient client;
+        const QUrl url = server.url(u"/announce"_s);
+        get(client, url);
+
+        QTRY_COMPARE_WITH_TIMEOUT(num_finished, 1, 10000);
+        QCOMPARE(num_failed, 1);
+
+        const HTTPTrackerClient::Stats s = client.stats(url);
+        QCOMPARE(s.requests, 1u);
+        QCOMPARE(s.failures, 1u);
+        QVERIFY(!s.last_error.isEmpty());
+    }
+
+    void testAbort()
+    {
+        LocalHttpServer server;
+        server.addFile(u"/announce"_s, "d8:intervali1800ee");
+        server.setLatency(100);
+
+        HTTPTrackerClient client;
+        client.setMaxRequestsPerHost(1);
+        const QUrl url = server.url(u"/announce"_s);
+        HTTPTrackerRequest *first = get(client, url);
+        HTTPTrackerRequest *second = get(client, url);
+        HTTPTrackerRequest *third = get(client, url);
+        QTRY_COMPARE(client.numActive(), 1u);
+
+        // an aborted request does not finish, and does not block the others
+        second->abort();
+        QCOMPARE(client.numQueued(), 1u);
+        first->abort();
+        QCOMPARE(client.numActive(), 1u);
+        QCOMPARE(client.numQueued(), 0u);
+
+        // a canceled request finishes with an error
+        QTRY_COMPARE_WITH_TIMEOUT(num_finished, 1, 10000);
+        QCOMPARE(num_failed, 0);
+        Q_UNUSED(third);
+
+        HTTPTrackerRequest *fourth = get(client, url);
+        QTRY_COMPARE(client.numActive(), 1u);
+        fourth->cancel(u"Timeout"_s);
+        QCOMPARE(num_finished, 2);
+        QCOMPARE(num_failed, 1);
+        QCOMPARE(client.stats(url).last_error, u"Timeout"_s);
+    }
+
+    void testStarted()
+    {
+        LocalHttpServer server;
+        server.addFile(u"/announce"_s, "d8:intervali1800ee");
+        server.setLatency(100);
+
+        HTTPTrackerClient client;
+        client.setMaxRequestsPerHost(1);
+        const QUrl url = server.url(u"/announce"_s);
+
+        // requests waiting in the queue have not been started yet, so their timeout does not run
+        int num_started = 0;
+        for (int i = 0; i < 3; i++) {
+            HTTPTrackerRequest *req = get(client, url);
+            connect(req, &HTTPTrackerRequest::started, this, [&num_started, &client]() {
+                num_started++;
+                QCOMPARE(client.numActive(), 1u);
+            });
+        }
+        QCOMPARE(num_started, 0);
+        QTRY_COMPARE(num_started, 1);
+        QCOMPARE(client.numQueued(), 2u);
+
+        QTRY_COMPARE_WITH_TIMEOUT(num_finished, 1, 10000);
+        QTRY_COMPARE_WITH_TIMEOUT(num_finished, 3, 10000);
+        QCOMPARE(num_started, 3);
+        QCOMPARE(num_failed, 0);
+    }
+
+private:
+    int num_finished = 0;
+    int num_failed = 0;
+    QList<QByteArray> replies;
+};
+
+QTEST_MAIN(HTTPTrackerClientTest)
+
+#include "httptrackerclienttest.moc"
@@ -0,0 +1,155 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QSignalSpy>
+#include <QTest>
+
+#include <download/tests/localhttpserver.h>
+#include <torrent/globals.h>
+#include <tracker/httptracker.h>
+#include <tracker/scrapecoordinator.h>
+#include <util/log.h>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+class DummySource : public TrackerDataSource
+{
+public:
+    DummySource(char c)
+        : hash(QByteArray(20, c))
+    {
+    }
+
+    [[nodiscard]] Uint64 bytesDownloaded() const override
+    {
+        return 0;
+    }
+    [[nodiscard]] Uint64 bytesUploaded() const override
+    {
+        return 0;
+    }
+    [[nodiscard]] Uint64 bytesLeft() const override
+    {
+        return 0;
+    }
+    [[nodiscard]] const SHA1Hash &infoHash() const override
+    {
+        return hash;
+    }
+    [[nodiscard]] bool isPartialSeed() const override
+    {
+        return false;
+    }
+
+    SHA1Hash hash;
+};
+
+class ScrapeCoordinatorTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    ScrapeCoordinatorTest()
+    {
+    }
+    ~ScrapeCoordinatorTest() override
+    {
+    }
+
+private:
+    static QByteArray scrapeEntry(const SHA1Hash &h, int complete, int downloaded, int incomplete)
+    {
+        return "20:" + h.toByteArray() + "d8:completei" + QByteArray::number(complete) + "e10:downloadedi" + QByteArray::number(downloaded)
+            + "e10:incompletei" + QByteArray::number(incomplete) + "ee";
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"scrapecoordinatortest.log"_s);
+    }
+
+    void cleanupTestCase()
+    {
+        Globals::cleanup();
+    }
+
+    void testMakeBatches()
+    {
+        DummySource src('a');
+        QList<Tracker *> trackers;
+        ScrapeBatch batch;
+        for (int i = 0; i < 7; i++) {
+            trackers.append(new HTTPTracker(QUrl(u"http://localhost/announce"_s), &src, PeerID(), 0));
+            batch.append(trackers.back());
+        }
+
+        QList<ScrapeBatch> batches = ScrapeCoordinator::makeBatches(batch, 3);
+        QCOMPARE(batches.size(), 3);
+        QCOMPARE(batches[0].size(), 3);
+        QCOMPARE(batches[2].size(), 1);
+
+        // deleted trackers are left out
+        delete trackers.takeAt(1);
+        delete trackers.takeAt(1);
+        batches = ScrapeCoordinator::makeBatches(batch, 3);
+        QCOMPARE(batches.size(), 2);
+        QCOMPARE(batches[0].size(), 3);
+        QCOMPARE(batches[1].size(), 2);
+
+        QVERIFY(ScrapeCoordinator::makeBatches(ScrapeBatch(), 3).isEmpty());
+        qDeleteAll(trackers);
+    }
+
+    void testBatchedHTTPScrape()
+    {
+        DummySource a('a');
+        DummySource b('b');
+        DummySource c('c');
+
+        LocalHttpServer server;
+        server.addFile(u"/scrape"_s, "d5:filesd" + scrapeEntry(a.hash, 5, 7, 3) + scrapeEntry(b.hash, 1, 2, 4) + "ee");
+        server.addFile(u"/other/scrape"_s, "d5:filesd" + scrapeEntry(c.hash, 9, 9, 9) + "ee");
+
+        HTTPTracker ta(server.url(u"/announce"_s), &a, PeerID(), 0);
+        HTTPTracker tb(server.url(u"/announce"_s), &b, PeerID(), 0);
+        HTTPTracker tc(server.url(u"/other/announce"_s), &c, PeerID(), 0);
+        QSignalSpy spy_a(&ta, &Tracker::scrapeDone);
+        QSignalSpy spy_b(&tb, &Tracker::scrapeDone);
+        QSignalSpy spy_c(&tc, &Tracker::scrapeDone);
+
+        ScrapeCoordinator &sc = Globals::instance().getScrapeCoordinator();
+        ta.scrape();
+        tb.scrape();
+        tc.scrape();
+        // scraping twice before the batch is sent does not scrape twice
+        ta.scrape();
+        QCOMPARE(sc.numQueued(), 3u);
+
+        sc.flush();
+        QCOMPARE(sc.numQueued(), 0u);
+        QTRY_COMPARE_WITH_TIMEOUT(spy_a.count(), 1, 10000);
+        QTRY_COMPARE_WITH_TIMEOUT(spy_b.count(), 1, 10000);
+        QTRY_COMPARE_WITH_TIMEOUT(spy_c.count(), 1, 10000);
+
+        // one request per tracker url
+        QCOMPARE(server.num_requests, 2);
+
+        QCOMPARE(ta.getNumSeeders(), 5);
+        QCOMPARE(ta.getTotalTimesDownloaded(), 7);
+        QCOMPARE(ta.getNumLeechers(), 3);
+        QCOMPARE(tb.getNumSeeders(), 1);
+        QCOMPARE(tb.getTotalTimesDownloaded(), 2);
+        QCOMPARE(tb.getNumLeechers(), 4);
+        QCOMPARE(tc.getNumSeeders(), 9);
+    }
+};
+
+QTEST_MAIN(ScrapeCoordinatorTest)
+
+#include "scrapecoordinatortest.moc"
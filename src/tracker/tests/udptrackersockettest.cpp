@@ -0,0 +1,191 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QNetworkDatagram>
+#include <QObject>
+#include <QTest>
+#include <QUdpSocket>
+
+#include <net/address.h>
+#include <torrent/globals.h>
+#include <tracker/udptrackersocket.h>
+#include <util/functions.h>
+#include <util/log.h>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+static const Int64 CONNECTION_ID = 0x1234567890LL;
+
+// Answers connects and announces like a UDP tracker, and counts them
+class FakeUDPTracker : public QObject
+{
+public:
+    FakeUDPTracker()
+    {
+        sock.bind(QHostAddress::LocalHost, 0);
+        connect(&sock, &QUdpSocket::readyRead, this, &FakeUDPTracker::onReadyRead);
+    }
+
+    net::Address address() const
+    {
+        return net::Address(QHostAddress(QHostAddress::LocalHost), sock.localPort());
+    }
+
+    void onReadyRead()
+    {
+        while (sock.hasPendingDatagrams()) {
+            const QNetworkDatagram d = sock.receiveDatagram();
+            const QByteArray in = d.data();
+            if (in.size() < 16) {
+                continue;
+            }
+
+            const Int32 action = ReadInt32(in.data(), 8);
+            const Int32 tid = ReadInt32(in.data(), 12);
+            QByteArray out;
+            if (action == UDPTrackerSocket::CONNECT) {
+                num_connects++;
+                out = QByteArray(16, 0);
+                WriteInt32(out.data(), 0, UDPTrackerSocket::CONNECT);
+                WriteInt32(out.data(), 4, tid);
+                WriteInt64(out.data(), 8, CONNECTION_ID);
+            } else if (action == UDPTrackerSocket::ANNOUNCE) {
+                num_announces++;
+                if (ReadInt64(in.data(), 0) != CONNECTION_ID) {
+                    num_bad_connection_ids++;
+                }
+                out = QByteArray(20, 0);
+                WriteInt32(out.data(), 0, UDPTrackerSocket::ANNOUNCE);
+                WriteInt32(out.data(), 4, tid);
+                WriteInt32(out.data(), 8, 1800);
+            }
+            sock.writeDatagram(out, d.senderAddress(), d.senderPort());
+        }
+    }
+
+    QUdpSocket sock;
+    int num_connects = 0;
+    int num_announces = 0;
+    int num_bad_connection_ids = 0;
+};
+
+class TestListener : public UDPTrackerSocket::Listener
+{
+public:
+    void announceReceived(Int32 tid, QByteArrayView buf) override
+    {
+        Q_UNUSED(buf);
+        replies.append(tid);
+    }
+
+    void scrapeReceived(Int32 tid, QByteArrayView buf) override
+    {
+        Q_UNUSED(tid);
+        Q_UNUSED(buf);
+    }
+
+    void transactionFailed(Int32 tid, const QString &error_string) override
+    {
+        Q_UNUSED(error_string);
+        failures.append(tid);
+    }
+
+    void transactionTimedOut(Int32 tid) override
+    {
+        failures.append(tid);
+    }
+
+    QList<Int32> replies;
+    QList<Int32> failures;
+};
+
+class UDPTrackerSocketTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    UDPTrackerSocketTest()
+    {
+    }
+    ~UDPTrackerSocketTest() override
+    {
+    }
+
+private:
+    static QByteArray announcePacket()
+    {
+        QByteArray buf(98, 0);
+        WriteInt32(buf.data(), 8, UDPTrackerSocket::ANNOUNCE);
+        return buf;
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"udptrackersockettest.log"_s);
+        UDPTrackerSocket::setPort(14444);
+    }
+
+    void cleanupTestCase()
+    {
+        Globals::cleanup();
+    }
+
+    void testSharedConnectionID()
+    {
+        FakeUDPTracker tracker;
+        UDPTrackerSocket sock;
+        TestListener a;
+        TestListener b;
+
+        // many announces at once only need one connect
+        QList<Int32> tids;
+        for (int i = 0; i < 10; i++) {
+            tids.append(sock.sendAnnounce(i % 2 ? &a : &b, announcePacket(), tracker.address()));
+        }
+        QCOMPARE(sock.numTransactions(), 11u);
+
+        QTRY_COMPARE_WITH_TIMEOUT(a.replies.size() + b.replies.size(), 10, 10000);
+        QCOMPARE(tracker.num_connects, 1);
+        QCOMPARE(tracker.num_bad_connection_ids, 0);
+        QCOMPARE(sock.connectionID(tracker.address()), CONNECTION_ID);
+        QCOMPARE(sock.numTransactions(), 0u);
+        for (Int32 tid : std::as_const(a.replies)) {
+            QVERIFY(tids.contains(tid));
+        }
+
+        // the connection id is reused
+        sock.sendAnnounce(&a, announcePacket(), tracker.address());
+        QTRY_COMPARE_WITH_TIMEOUT(a.replies.size(), 6, 10000);
+        QCOMPARE(tracker.num_connects, 1);
+        QVERIFY(a.failures.isEmpty());
+        QVERIFY(b.failures.isEmpty());
+    }
+
+    void testCancel()
+    {
+        FakeUDPTracker tracker;
+        UDPTrackerSocket sock;
+        TestListener a;
+        TestListener b;
+
+        const Int32 tid = sock.sendAnnounce(&a, announcePacket(), tracker.address());
+        sock.sendAnnounce(&a, announcePacket(), tracker.address());
+        sock.sendAnnounce(&b, announcePacket(), tracker.address());
+        sock.cancelTransaction(tid);
+        sock.cancelTransactions(&a);
+
+        QTRY_COMPARE_WITH_TIMEOUT(b.replies.size(), 1, 10000);
+        QTest::qWait(100);
+        QVERIFY(a.replies.isEmpty());
+        QCOMPARE(tracker.num_announces, 1);
+    }
+};
+
+QTEST_MAIN(UDPTrackerSocketTest)
+
+#include "udptrackersockettest.moc"
@@ -0,0 +1,202 @@
+/*
+    SPDX-FileCopyrightText: 2026 The KTorrent Authors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QMap>
+#include <QNetworkDatagram>
+#include <QObject>
+#include <QSignalSpy>
+#include <QTest>
+#include <QUdpSocket>
+
+#include <memory>
+#include <torrent/globals.h>
+#include <tracker/scrapecoordinator.h>
+#include <tracker/udptracker.h>
+#include <util/functions.h>
+#include <util/log.h>
+#include <vector>
+
+using namespace bt;
+using namespace Qt::Literals::StringLiterals;
+
+static const Int64 CONNECTION_ID = 0x1234567890LL;
+
+struct ScrapeStats {
+    Int32 seeders = 0;
+    Int32 completed = 0;
+    Int32 leechers = 0;
+};
+
+// Answers connects and scrapes like a UDP tracker, and keeps the scrape requests
+class FakeUDPTracker : public QObject
+{
+public:
+    FakeUDPTracker()
+    {
+        sock.bind(QHostAddress::LocalHost, 0);
+        connect(&sock, &QUdpSocket::readyRead, this, &FakeUDPTracker::onReadyRead);
+    }
+
+    QUrl url() const
+    {
+        return QUrl(QStringLiteral("udp://127.0.0.1:%1/announce").arg(sock.localPort()));
+    }
+
+    void onReadyRead()
+    {
+        while (sock.hasPendingDatagrams()) {
+            const QNetworkDatagram d = sock.receiveDatagram();
+            const QByteArray in = d.data();
+            if (in.size() < 16) {
+                continue;
+            }
+
+            const Int32 action = ReadInt32(in.data(), 8);
+            const Int32 tid = ReadInt32(in.data(), 12);
+            QByteArray out;
+            if (action == UDPTrackerSocket::CONNECT) {
+                out = QByteArray(16, 0);
+                WriteInt32(out.data(), 0, UDPTrackerSocket::CONNECT);
+                WriteInt32(out.data(), 4, tid);
+                WriteInt64(out.data(), 8, CONNECTION_ID);
+            } else if (action == UDPTrackerSocket::SCRAPE) {
+                scrape_requests.append(in);
+                // the stats of every info hash, in the order they were asked for
+                const int num = (in.size() - 16) / 20;
+                out = QByteArray(8 + 12 * num, 0);
+                WriteInt32(out.data(), 0, UDPTrackerSocket::SCRAPE);
+                WriteInt32(out.data(), 4, tid);
+                for (int n = 0; n < num; n++) {
+                    const ScrapeStats s = stats.value(in.mid(16 + 20 * n, 20));
+                    WriteInt32(out.data(), 8 + 12 * n, s.seeders);
+                    WriteInt32(out.data(), 12 + 12 * n, s.completed);
+                    WriteInt32(out.data(), 16 + 12 * n, s.leechers);
+                }
+            }
+            sock.writeDatagram(out, d.senderAddress(), d.senderPort());
+        }
+    }
+
+    QUdpSocket sock;
+    QMap<QByteArray, ScrapeStats> stats;
+    QList<QByteArray> scrape_requests;
+};
+
+class DummySource : public TrackerDataSource
+{
+public:
+    DummySource(char c)
+        : hash(QByteArray(20, c))
+    {
+    }
+
+    [[nodiscard]] Uint64 bytesDownloaded() const override
+    {
+        return 0;
+    }
+    [[nodiscard]] Uint64 bytesUploaded() const override
+    {
+        return 0;
+    }
+    [[nodiscard]] Uint64 bytesLeft() const override
+    {
+        return 0;
+    }
+    [[nodiscard]] const SHA1Hash &infoHash() const override
+    {
+        return hash;
+    }
+    [[nodiscard]] bool isPartialSeed() const override
+    {
+        return false;
+    }
+
+    SHA1Hash hash;
+};
+
+class UDPTrackerTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    UDPTrackerTest()
+    {
+    }
+    ~UDPTrackerTest() override
+    {
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(u"udptrackertest.log"_s);
+        UDPTrackerSocket::setPort(14445);
+    }
+
+    void cleanupTestCase()
+    {
+        Globals::cleanup();
+    }
+
+    void testScrapeBatch()
+    {
+        const int NUM_TORRENTS = 5;
+        FakeUDPTracker server;
+        std::vector<std::unique_ptr<DummySource>> sources;
+        std::vector<std::unique_ptr<UDPTracker>> trackers;
+        for (int i = 0; i < NUM_TORRENTS; i++) {
+            sources.push_back(std::make_unique<DummySource>('a' + i));
+            trackers.push_back(std::make_unique<UDPTracker>(server.url(), sources.back().get(), PeerID(), 0));
+            // every torrent gets different numbers, so a mixed up reply shows
+            server.stats.insert(sources.back()->hash.toByteArray(), ScrapeStats{10 * i + 1, 10 * i + 2, 10 * i + 3});
+        }
+
+        // a batch in a different order than the trackers were created, with one which is gone by the time it is sent
+        const std::vector<int> order = {3, 0, 4, 2, 1};
+        ScrapeBatch batch;
+        for (const int i : order) {
+            batch.append(QPointer<Tracker>(trackers[i].get()));
+        }
+        trackers[2].reset();
+
+        std::vector<std::unique_ptr<QSignalSpy>> spies;
+        for (const auto &trk : trackers) {
+            spies.push_back(trk ? std::make_unique<QSignalSpy>(trk.get(), &Tracker::scrapeDone) : nullptr);
+        }
+
+        trackers[3]->scrapeBatch(batch);
+        QTRY_COMPARE_WITH_TIMEOUT(server.scrape_requests.size(), 1, 10000);
+
+        // one packet with the info hashes of the remaining trackers, in the order of the batch
+        const QByteArray req = server.scrape_requests.first();
+        QCOMPARE(req.size(), 16 + 20 * (NUM_TORRENTS - 1));
+        QCOMPARE(ReadInt64(req.data(), 0), CONNECTION_ID);
+        QCOMPARE(ReadInt32(req.data(), 8), Int32(UDPTrackerSocket::SCRAPE));
+        int n = 0;
+        for (const int i : order) {
+            if (i == 2) {
+                continue;
+            }
+            QCOMPARE(req.mid(16 + 20 * n, 20), sources[i]->hash.toByteArray());
+            n++;
+        }
+
+        // and every triple in the reply ends up at the torrent it belongs to
+        for (int i = 0; i < NUM_TORRENTS; i++) {
+            if (!trackers[i]) {
+                continue;
+            }
+            QTRY_COMPARE_WITH_TIMEOUT(spies[i]->count(), 1, 10000);
+            QCOMPARE(trackers[i]->getNumSeeders(), 10 * i + 1);
+            QCOMPARE(trackers[i]->getTotalTimesDownloaded(), 10 * i + 2);
+            QCOMPARE(trackers[i]->getNumLeechers(), 10 * i + 3);
+        }
+    }
+};
+
+QTEST_MAIN(UDPTrackerTest)
+
+#include "udptrackertest.moc"
@@ -13,6 +13,7 @@
 #include <interfaces/trackerinterface.h>
 #include <ktorrent_export.h>
 #include <peer/peerid.h>
+#include <tracker/scrapecoordinator.h>
 #include <util/sha1hash.h>
 
 class QUrl;
@@ -79,6 +80,13 @@ public:
      */
     virtual void scrape() = 0;
 
+    /*!
+     * Scrape the torrents of a batch of trackers with the same url in one request.
+     * The ScrapeCoordinator calls this on the first tracker of the batch.
+     * \param batch The trackers, this tracker is one of them
+     */
+    virtual void scrapeBatch(const ScrapeBatch &batch) = 0;
+
     //! Get the trackers tier
     [[nodiscard]] int getTier() const
     {
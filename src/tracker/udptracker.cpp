@@ -5,11 +5,8 @@
 */
 #include "udptracker.h"
 
-#include <array>
-#include <cstddef>
 #include <cstdlib>
 
-#include "udptrackersocket.h"
 #include <KLocalizedString>
 #include <interfaces/torrentinterface.h>
 #include <net/addressresolver.h>
@@ -26,7 +23,6 @@ Uint32 UDPTracker::num_instances = 0;
 
 UDPTracker::UDPTracker(const QUrl &url, TrackerDataSource *tds, const PeerID &id, int tier)
     : Tracker(url, tds, id, tier)
-    , connection_id(0)
     , transaction_id(0)
     , scrape_transaction_id(0)
     , data_read(0)
@@ -41,17 +37,11 @@ UDPTracker::UDPTracker(const QUrl &url, TrackerDataSource *tds, const PeerID &id
     }
 
     interval = 0;
-
-    conn_timer.setSingleShot(true);
-    connect(&conn_timer, &QTimer::timeout, this, &UDPTracker::onConnTimeout);
-    connect(socket, &UDPTrackerSocket::announceReceived, this, &UDPTracker::announceReceived);
-    connect(socket, &UDPTrackerSocket::connectReceived, this, &UDPTracker::connectReceived);
-    connect(socket, &UDPTrackerSocket::error, this, &UDPTracker::onError);
-    connect(socket, &UDPTrackerSocket::scrapeReceived, this, &UDPTracker::scrapeReceived);
 }
 
 UDPTracker::~UDPTracker()
 {
+    socket->cancelTransactions(this);
     num_instances--;
     if (num_instances == 0) {
         delete socket;
@@ -63,7 +53,6 @@ void UDPTracker::start()
 {
     event = STARTED;
     resetTrackerStats();
-    conn_timer.stop();
     doRequest();
 }
 
@@ -80,7 +69,6 @@ void UDPTracker::stop(WaitJob *)
     } else {
         event = STOPPED;
         reannounce_timer.stop();
-        conn_timer.stop();
         doRequest();
         started = false;
     }
@@ -89,13 +77,11 @@ void UDPTracker::stop(WaitJob *)
 void UDPTracker::completed()
 {
     event = COMPLETED;
-    conn_timer.stop();
     doRequest();
 }
 
 void UDPTracker::manualUpdate()
 {
-    conn_timer.stop();
     if (!started) {
         start();
     } else {
@@ -103,28 +89,15 @@ void UDPTracker::manualUpdate()
     }
 }
 
-void UDPTracker::connectReceived(Int32 tid, Int64 cid)
-{
-    if (tid != transaction_id) {
-        return;
-    }
-
-    connection_id = cid;
-    failures = 0;
-    if (todo & ANNOUNCE_REQUEST) {
-        sendAnnounce();
-    }
-    if (todo & SCRAPE_REQUEST) {
-        sendScrape();
-    }
-}
-
 void UDPTracker::announceReceived(Int32 tid, QByteArrayView buf)
 {
     if (tid != transaction_id || buf.size() < 20) {
         return;
     }
 
+    transaction_id = 0;
+    failures = 0;
+    time_out = false;
     /*
     0  32-bit integer  action  1
     4  32-bit integer  transaction_id
@@ -146,8 +119,6 @@ void UDPTracker::announceReceived(Int32 tid, QByteArrayView buf)
     }
 
     Q_EMIT peersReady(this);
-    connection_id = 0;
-    conn_timer.stop();
     if (event != STOPPED) {
         if (event == STARTED) {
             started = true;
@@ -166,26 +137,55 @@ void UDPTracker::announceReceived(Int32 tid, QByteArrayView buf)
     request_time = QDateTime::currentDateTime();
 }
 
-void UDPTracker::onError(Int32 tid, const QString &error_string)
+void UDPTracker::transactionFailed(Int32 tid, const QString &error_string)
 {
+    if (tid == scrape_transaction_id) {
+        scrape_transaction_id = 0;
+        scrape_batch.clear();
+        Out(SYS_TRK | LOG_NOTICE) << "UDPTracker scrape failed : " << error_string << endl;
+        return;
+    }
+
     if (tid != transaction_id) {
         return;
     }
 
+    transaction_id = 0;
     Out(SYS_TRK | LOG_IMPORTANT) << "UDPTracker::error : " << error_string << endl;
     failed(error_string);
 }
 
+void UDPTracker::transactionTimedOut(Int32 tid)
+{
+    if (tid == scrape_transaction_id) {
+        scrape_transaction_id = 0;
+        scrape_batch.clear();
+        return;
+    }
+
+    if (tid != transaction_id) {
+        return;
+    }
+
+    transaction_id = 0;
+    time_out = true;
+    failures++;
+    if (event != STOPPED) {
+        const QString error_string = i18n("Timeout contacting tracker %1", url.toDisplayString());
+        Out(SYS_TRK | LOG_IMPORTANT) << "UDPTracker::error : " << error_string << endl;
+        failed(error_string);
+    } else {
+        status = TRACKER_IDLE;
+        Q_EMIT stopDone();
+    }
+}
+
 bool UDPTracker::doRequest()
 {
     Out(SYS_TRK | LOG_NOTICE) << "Doing tracker request to url : " << url << endl;
     if (!resolved) {
         todo |= ANNOUNCE_REQUEST;
         net::AddressResolver::resolve(url.host(), url.port(80), this, SLOT(onResolverResults(net::AddressResolver *)));
-    } else if (connection_id == 0) {
-        todo |= ANNOUNCE_REQUEST;
-        failures = 0;
-        sendConnect();
     } else {
         sendAnnounce();
     }
@@ -197,14 +197,17 @@ bool UDPTracker::doRequest()
 
 void UDPTracker::scrape()
 {
-    Out(SYS_TRK | LOG_NOTICE) << "Doing scrape request to url : " << url << endl;
+    // the scrape is sent together with those of the other torrents on this tracker
+    Globals::instance().getScrapeCoordinator().add(this, MAX_SCRAPE_BATCH);
+}
+
+void UDPTracker::scrapeBatch(const ScrapeBatch &batch)
+{
+    Out(SYS_TRK | LOG_NOTICE) << "Doing scrape request for " << batch.size() << " torrents to url : " << url << endl;
+    scrape_batch = batch;
     if (!resolved) {
         todo |= SCRAPE_REQUEST;
         net::AddressResolver::resolve(url.host(), url.port(80), this, SLOT(onResolverResults(net::AddressResolver *)));
-    } else if (connection_id == 0) {
-        todo |= SCRAPE_REQUEST;
-        failures = 0;
-        sendConnect();
     } else {
         sendScrape();
     }
@@ -224,29 +227,34 @@ void UDPTracker::scrapeReceived(Int32 tid, QByteArrayView buf)
         return;
     }
 
-    seeders = ReadInt32(buf.data(), 8);
-    total_downloaded = ReadInt32(buf.data(), 12);
-    leechers = ReadInt32(buf.data(), 16);
-    Out(SYS_TRK | LOG_DEBUG) << "Scrape : leechers = " << leechers << ", seeders = " << seeders << ", downloaded = " << total_downloaded << endl;
-}
+    scrape_transaction_id = 0;
+    // the stats are in the order of the info hashes in the request
+    const ScrapeBatch batch = std::move(scrape_batch);
+    scrape_batch.clear();
+    const qsizetype num = qMin<qsizetype>((buf.size() - 8) / 12, batch.size());
+    for (qsizetype n = 0; n < num; n++) {
+        if (!batch[n]) {
+            continue;
+        }
 
-void UDPTracker::sendConnect()
-{
-    transaction_id = socket->newTransactionID();
-    socket->sendConnect(transaction_id, address);
-    int tn = 1;
-    for (int i = 0; i < failures; i++) {
-        tn *= 2;
+        // all trackers with the same url are UDPTrackers
+        UDPTracker *trk = static_cast<UDPTracker *>(batch[n].data());
+        trk->seeders = ReadInt32(buf.data(), 8 + 12 * n);
+        trk->total_downloaded = ReadInt32(buf.data(), 12 + 12 * n);
+        trk->leechers = ReadInt32(buf.data(), 16 + 12 * n);
+        Out(SYS_TRK | LOG_DEBUG) << "Scrape : leechers = " << trk->leechers << ", seeders = " << trk->seeders << ", downloaded = " << trk->total_downloaded
+                                 << endl;
+        Q_EMIT trk->scrapeDone();
     }
-    time_out = false;
-    conn_timer.start(60000 * tn);
 }
 
 void UDPTracker::sendAnnounce()
 {
     todo &= ~ANNOUNCE_REQUEST;
     //  Out(SYS_TRK|LOG_NOTICE) << "UDPTracker::sendAnnounce()" << endl;
-    transaction_id = socket->newTransactionID();
+    if (transaction_id) {
+        socket->cancelTransaction(transaction_id);
+    }
     /*
     0  64-bit integer  connection_id
     8  32-bit integer  action  1
@@ -272,10 +280,9 @@ void UDPTracker::sendAnnounce()
     const Uint32 ip_addr = cip.isNull() ? 0 : QHostAddress{cip}.toIPv4Address();
     const Int32 num_want = ev != STOPPED ? 100 : 0;
 
-    std::array<std::byte, 98> buf;
-    WriteInt64(buf.data(), 0, connection_id);
+    // the connection_id and transaction_id are filled in by the socket
+    QByteArray buf(98, 0);
     WriteInt32(buf.data(), 8, UDPTrackerSocket::ANNOUNCE);
-    WriteInt32(buf.data(), 12, transaction_id);
     memcpy(buf.data() + 16, info_hash.getData(), 20);
     memcpy(buf.data() + 36, peer_id.data(), 20);
     WriteInt64(buf.data(), 56, bytesDownloaded());
@@ -287,7 +294,7 @@ void UDPTracker::sendAnnounce()
     WriteInt32(buf.data(), 92, num_want);
     WriteUint16(buf.data(), 96, port);
 
-    socket->sendAnnounce(transaction_id, buf, address);
+    transaction_id = socket->sendAnnounce(this, buf, address);
 }
 
 void UDPTracker::sendScrape()
@@ -300,34 +307,30 @@ void UDPTracker::sendScrape()
     16 + 20 * n     20-byte string  info_hash
     16 + 20 * N
     */
-    scrape_transaction_id = socket->newTransactionID();
-    const SHA1Hash &info_hash = tds->infoHash();
-
-    std::array<std::byte, 36> buf;
-    WriteInt64(buf.data(), 0, connection_id);
-    WriteInt32(buf.data(), 8, UDPTrackerSocket::SCRAPE);
-    WriteInt32(buf.data(), 12, scrape_transaction_id);
-    memcpy(buf.data() + 16, info_hash.getData(), 20);
+    ScrapeBatch batch;
+    for (const QPointer<Tracker> &t : std::as_const(scrape_batch)) {
+        if (t) {
+            batch.append(t);
+        }
+    }
+    scrape_batch = batch;
+    if (scrape_batch.isEmpty()) {
+        return;
+    }
 
-    socket->sendScrape(scrape_transaction_id, buf, address);
-}
+    if (scrape_transaction_id) {
+        socket->cancelTransaction(scrape_transaction_id);
+    }
 
-void UDPTracker::onConnTimeout()
-{
-    time_out = true;
-    if (connection_id) {
-        connection_id = 0;
-        failures++;
-        if (event != STOPPED) {
-            onError(transaction_id, i18n("Timeout contacting tracker %1", url.toDisplayString()));
-        } else {
-            status = TRACKER_IDLE;
-            Q_EMIT stopDone();
-        }
-    } else {
-        failures++;
-        onError(transaction_id, i18n("Timeout contacting tracker %1", url.toDisplayString()));
+    // the connection_id and transaction_id are filled in by the socket
+    QByteArray buf(16 + 20 * scrape_batch.size(), 0);
+    WriteInt32(buf.data(), 8, UDPTrackerSocket::SCRAPE);
+    for (qsizetype n = 0; n < scrape_batch.size(); n++) {
+        const UDPTracker *trk = static_cast<const UDPTracker *>(scrape_batch[n].data());
+        memcpy(buf.data() + 16 + 20 * n, trk->tds->infoHash().getData(), 20);
     }
+
+    scrape_transaction_id = socket->sendScrape(this, buf, address);
 }
 
 void UDPTracker::onResolverResults(net::AddressResolver *ar)
@@ -336,16 +339,11 @@ void UDPTracker::onResolverResults(net::AddressResolver *ar)
         address = ar->address();
         resolved = true;
         // continue doing request
-        if (connection_id == 0) {
-            failures = 0;
-            sendConnect();
-        } else {
-            if (todo & ANNOUNCE_REQUEST) {
-                sendAnnounce();
-            }
-            if (todo & SCRAPE_REQUEST) {
-                sendScrape();
-            }
+        if (todo & ANNOUNCE_REQUEST) {
+            sendAnnounce();
+        }
+        if (todo & SCRAPE_REQUEST) {
+            sendScrape();
         }
     } else {
         failures++;
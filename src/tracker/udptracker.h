@@ -7,8 +7,8 @@
 #define BTUDPTRACKER_H
 
 #include "tracker.h"
+#include "udptrackersocket.h"
 #include <QByteArray>
-#include <QTimer>
 #include <QUrl>
 #include <net/address.h>
 
@@ -19,8 +19,6 @@ class AddressResolver;
 
 namespace bt
 {
-class UDPTrackerSocket;
-
 /*!
  * \headerfile tracker/udptracker.h
  * \author Joris Guisson
@@ -28,8 +26,10 @@ class UDPTrackerSocket;
  *
  * This is an implementation of the protocol described in
  * http://xbtt.sourceforge.net/udp_tracker_protocol.html
+ *
+ * Connecting and retransmitting is left to the UDPTrackerSocket, which is shared by all UDPTrackers.
  */
-class UDPTracker : public Tracker
+class KTORRENT_EXPORT UDPTracker : public Tracker, public UDPTrackerSocket::Listener
 {
     Q_OBJECT
 public:
@@ -44,18 +44,22 @@ public:
         return failures;
     }
     void scrape() override;
+    void scrapeBatch(const ScrapeBatch &batch) override;
+
+    //! Maximum number of info hashes in one scrape packet
+    static constexpr Uint32 MAX_SCRAPE_BATCH = 70;
+
+private:
+    void announceReceived(Int32 tid, QByteArrayView buf) override;
+    void scrapeReceived(Int32 tid, QByteArrayView buf) override;
+    void transactionFailed(Int32 tid, const QString &error_string) override;
+    void transactionTimedOut(Int32 tid) override;
 
 private Q_SLOTS:
-    void onConnTimeout();
-    void connectReceived(Int32 tid, Int64 connection_id);
-    void announceReceived(Int32 tid, QByteArrayView buf);
-    void scrapeReceived(Int32 tid, QByteArrayView buf);
-    void onError(Int32 tid, const QString &error_string);
     void onResolverResults(net::AddressResolver *ar);
     void manualUpdate() override;
 
 private:
-    void sendConnect();
     void sendAnnounce();
     void sendScrape();
     bool doRequest();
@@ -75,16 +79,15 @@ private:
 
 private:
     net::Address address;
-    Int64 connection_id;
     Int32 transaction_id;
     Int32 scrape_transaction_id;
+    ScrapeBatch scrape_batch;
 
     Uint32 data_read;
     int failures;
     bool resolved;
     Uint32 todo;
     Event event;
-    QTimer conn_timer;
 
     static UDPTrackerSocket *socket;
     static Uint32 num_instances;
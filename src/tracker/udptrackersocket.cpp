@@ -8,13 +8,18 @@
 
 #include <array>
 #include <cstddef>
+#include <map>
+#include <vector>
 
+#include <QHash>
 #include <QHostAddress>
 #include <QRandomGenerator>
+#include <QTimer>
 #include <QtAssert>
 
 #include <KLocalizedString>
 
+#include <net/address.h>
 #include <net/portlist.h>
 #include <net/serversocket.h>
 #include <net/socket.h>
@@ -33,12 +38,42 @@ namespace bt
 {
 Uint16 UDPTrackerSocket::port = 4444;
 
+// number of one second slots in the timer wheel
+static const Uint32 WHEEL_SIZE = 64;
+
+UDPTrackerSocket::Listener::~Listener()
+{
+}
+
 class UDPTrackerSocket::Private : public net::ServerSocket::DataHandler
 {
 public:
+    struct Transaction {
+        Action action = CONNECT;
+        net::Address addr;
+        QByteArray packet;
+        Listener *listener = nullptr;
+        // number of times the packet has been sent
+        Uint32 attempts = 0;
+        // only the last entry in the timer wheel counts
+        Uint32 timer_generation = 0;
+        // full turns of the timer wheel before the timeout
+        Uint32 rounds = 0;
+    };
+
+    struct Endpoint {
+        Int64 connection_id = 0;
+        TimeStamp received = 0;
+        Int32 connect_tid = 0;
+        // transactions waiting for a connection id
+        QList<Int32> waiting;
+    };
+
     Private(UDPTrackerSocket *p)
         : p(p)
     {
+        timer.setInterval(1000);
+        QObject::connect(&timer, &QTimer::timeout, p, &UDPTrackerSocket::onTimerTick);
     }
 
     ~Private() override
@@ -93,8 +128,155 @@ public:
         Q_UNUSED(sock);
     }
 
+    Int32 newTransactionID() const
+    {
+        Int32 transaction_id = QRandomGenerator::global()->generate();
+        // 0 is used by the trackers for no transaction
+        while (transaction_id == 0 || transactions.contains(transaction_id)) {
+            transaction_id++;
+        }
+        return transaction_id;
+    }
+
+    Int32 start(Action action, Listener *l, const QByteArray &data, const net::Address &addr)
+    {
+        const Int32 tid = newTransactionID();
+        Transaction t;
+        t.action = action;
+        t.addr = addr;
+        t.packet = data;
+        t.listener = l;
+        transactions.insert(tid, t);
+        transmit(tid);
+        return tid;
+    }
+
+    void connect(const net::Address &addr)
+    {
+        const Int32 tid = newTransactionID();
+        Transaction t;
+        t.action = CONNECT;
+        t.addr = addr;
+        t.packet = QByteArray(16, 0);
+        WriteInt64(t.packet.data(), 0, 0x41727101980LL);
+        WriteInt32(t.packet.data(), 8, CONNECT);
+        WriteInt32(t.packet.data(), 12, tid);
+        transactions.insert(tid, t);
+        endpoints[addr].connect_tid = tid;
+        transmit(tid);
+    }
+
+    // Send the packet of a transaction, or let it wait for a connection id
+    void transmit(Int32 tid)
+    {
+        const auto i = transactions.find(tid);
+        if (i == transactions.end()) {
+            return;
+        }
+
+        if (i->action != CONNECT) {
+            Endpoint &ep = endpoints[i->addr];
+            if (ep.connection_id == 0 || Now() - ep.received >= CONNECTION_ID_LIFETIME * 1000) {
+                ep.connection_id = 0;
+                if (!ep.waiting.contains(tid)) {
+                    ep.waiting.append(tid);
+                }
+                if (ep.connect_tid == 0) {
+                    // copy the address, starting the connect can move the transaction
+                    const net::Address addr = i->addr;
+                    connect(addr);
+                }
+                return;
+            }
+
+            WriteInt64(i->packet.data(), 0, ep.connection_id);
+            WriteInt32(i->packet.data(), 12, tid);
+        }
+
+        send(i->packet, i->addr);
+        i->attempts++;
+        schedule(tid, *i, RETRANSMIT_TIMEOUT << (i->attempts - 1));
+    }
+
+    void schedule(Int32 tid, Transaction &t, Uint32 delay)
+    {
+        t.timer_generation++;
+        t.rounds = (delay - 1) / WHEEL_SIZE;
+        wheel[(wheel_pos + delay) % WHEEL_SIZE].emplace_back(tid, t.timer_generation);
+        if (!timer.isActive()) {
+            timer.start();
+        }
+    }
+
+    void tick()
+    {
+        wheel_pos = (wheel_pos + 1) % WHEEL_SIZE;
+        const std::vector<std::pair<Int32, Uint32>> entries = std::move(wheel[wheel_pos]);
+        wheel[wheel_pos].clear();
+        for (const auto &[tid, generation] : entries) {
+            const auto i = transactions.find(tid);
+            if (i == transactions.end() || i->timer_generation != generation) {
+                continue;
+            }
+
+            if (i->rounds > 0) {
+                i->rounds--;
+                wheel[wheel_pos].emplace_back(tid, generation);
+            } else if (i->attempts >= MAX_ATTEMPTS) {
+                fail(tid, QString(), true);
+            } else {
+                transmit(tid);
+            }
+        }
+
+        if (transactions.isEmpty()) {
+            timer.stop();
+        }
+    }
+
+    // Remove a transaction and tell its listener, a failed connect fails all transactions waiting for it
+    void fail(Int32 tid, const QString &error_string, bool timeout)
+    {
+        const Transaction t = transactions.take(tid);
+        if (t.action == CONNECT) {
+            Endpoint &ep = endpoints[t.addr];
+            ep.connect_tid = 0;
+            const QList<Int32> waiting = std::move(ep.waiting);
+            ep.waiting.clear();
+            for (Int32 w : waiting) {
+                if (transactions.contains(w)) {
+                    fail(w, error_string, timeout);
+                }
+            }
+        } else if (t.listener) {
+            if (timeout) {
+                t.listener->transactionTimedOut(tid);
+            } else {
+                t.listener->transactionFailed(tid, error_string);
+            }
+        }
+    }
+
+    void cancel(Int32 tid)
+    {
+        const auto i = transactions.find(tid);
+        if (i == transactions.end()) {
+            return;
+        }
+
+        const auto ep = endpoints.find(i->addr);
+        if (ep != endpoints.end()) {
+            ep->second.waiting.removeAll(tid);
+        }
+        transactions.erase(i);
+    }
+
     std::vector<net::ServerSocket::Ptr> sockets;
-    QMap<Int32, Action> transactions;
+    QHash<Int32, Transaction> transactions;
+    std::map<net::Address, Endpoint> endpoints;
+    std::array<std::vector<std::pair<Int32, Uint32>>, WHEEL_SIZE> wheel;
+    Uint32 wheel_pos = 0;
+    QTimer timer;
     UDPTrackerSocket *p;
 };
 
@@ -128,36 +310,54 @@ UDPTrackerSocket::~UDPTrackerSocket()
     Globals::instance().getPortList().removePort(port, net::UDP);
 }
 
-void UDPTrackerSocket::sendConnect(Int32 tid, const net::Address &addr)
+Int32 UDPTrackerSocket::sendAnnounce(Listener *l, const QByteArray &data, const net::Address &addr)
+{
+    Q_ASSERT(data.size() == 98);
+    return d->start(ANNOUNCE, l, data, addr);
+}
+
+Int32 UDPTrackerSocket::sendScrape(Listener *l, const QByteArray &data, const net::Address &addr)
 {
-    const Int64 cid = 0x41727101980LL;
-    std::array<std::byte, 16> buf;
+    Q_ASSERT(data.size() >= 36 && (data.size() - 16) % 20 == 0);
+    return d->start(SCRAPE, l, data, addr);
+}
 
-    WriteInt64(buf.data(), 0, cid);
-    WriteInt32(buf.data(), 8, CONNECT);
-    WriteInt32(buf.data(), 12, tid);
+void UDPTrackerSocket::cancelTransaction(Int32 tid)
+{
+    d->cancel(tid);
+}
+
+void UDPTrackerSocket::cancelTransactions(Listener *l)
+{
+    QList<Int32> tids;
+    for (auto i = d->transactions.cbegin(); i != d->transactions.cend(); ++i) {
+        if (i->listener == l) {
+            tids.append(i.key());
+        }
+    }
 
-    d->send(buf, addr);
-    d->transactions.insert(tid, CONNECT);
+    for (Int32 tid : std::as_const(tids)) {
+        d->cancel(tid);
+    }
 }
 
-void UDPTrackerSocket::sendAnnounce(Int32 tid, QByteArrayView data, const net::Address &addr)
+Uint32 UDPTrackerSocket::numTransactions() const
 {
-    Q_ASSERT(data.size() == 98);
-    d->send(data, addr);
-    d->transactions.insert(tid, ANNOUNCE);
+    return d->transactions.size();
 }
 
-void UDPTrackerSocket::sendScrape(Int32 tid, QByteArrayView data, const net::Address &addr)
+Int64 UDPTrackerSocket::connectionID(const net::Address &addr) const
 {
-    Q_ASSERT(data.size() == 36);
-    d->send(data, addr);
-    d->transactions.insert(tid, SCRAPE);
+    const auto i = d->endpoints.find(addr);
+    if (i == d->endpoints.end() || Now() - i->second.received >= CONNECTION_ID_LIFETIME * 1000) {
+        return 0;
+    }
+    return i->second.connection_id;
 }
 
-void UDPTrackerSocket::cancelTransaction(Int32 tid)
+void UDPTrackerSocket::onTimerTick()
 {
-    d->transactions.remove(tid);
+    d->tick();
 }
 
 void UDPTrackerSocket::handleConnect(QByteArrayView buf)
@@ -168,22 +368,29 @@ void UDPTrackerSocket::handleConnect(QByteArrayView buf)
 
     // Read the transaction_id and check it
     const Int32 tid = ReadInt32(buf.data(), 4);
-    const QMap<Int32, Action>::iterator i = d->transactions.find(tid);
+    const auto i = d->transactions.find(tid);
     // if we can't find the transaction, just return
     if (i == d->transactions.end()) {
         return;
     }
 
     // check whether the transaction is a CONNECT
-    if (i.value() != CONNECT) {
-        d->transactions.erase(i);
-        Q_EMIT error(tid, QString());
+    if (i->action != CONNECT) {
+        d->fail(tid, QString(), false);
         return;
     }
 
-    // everything ok, emit signal
+    // everything ok, send everything which was waiting for the connection id
+    Private::Endpoint &ep = d->endpoints[i->addr];
     d->transactions.erase(i);
-    Q_EMIT connectReceived(tid, ReadInt64(buf.data(), 8));
+    ep.connection_id = ReadInt64(buf.data(), 8);
+    ep.received = Now();
+    ep.connect_tid = 0;
+    const QList<Int32> waiting = std::move(ep.waiting);
+    ep.waiting.clear();
+    for (Int32 w : waiting) {
+        d->transmit(w);
+    }
 }
 
 void UDPTrackerSocket::handleAnnounce(QByteArrayView buf)
@@ -194,22 +401,24 @@ void UDPTrackerSocket::handleAnnounce(QByteArrayView buf)
 
     // Read the transaction_id and check it
     const Int32 tid = ReadInt32(buf.data(), 4);
-    const QMap<Int32, Action>::iterator i = d->transactions.find(tid);
+    const auto i = d->transactions.find(tid);
     // if we can't find the transaction, just return
     if (i == d->transactions.end()) {
         return;
     }
 
     // check whether the transaction is a ANNOUNCE
-    if (i.value() != ANNOUNCE) {
-        d->transactions.erase(i);
-        Q_EMIT error(tid, QString());
+    if (i->action != ANNOUNCE) {
+        d->fail(tid, QString(), false);
         return;
     }
 
-    // everything ok, emit signal
+    // everything ok, tell the listener
+    Listener *l = i->listener;
     d->transactions.erase(i);
-    Q_EMIT announceReceived(tid, buf);
+    if (l) {
+        l->announceReceived(tid, buf);
+    }
 }
 
 void UDPTrackerSocket::handleError(QByteArrayView buf)
@@ -220,21 +429,18 @@ void UDPTrackerSocket::handleError(QByteArrayView buf)
 
     // Read the transaction_id and check it
     const Int32 tid = ReadInt32(buf.data(), 4);
-    const QMap<Int32, Action>::iterator it = d->transactions.find(tid);
     // if we can't find the transaction, just return
-    if (it == d->transactions.end()) {
+    if (!d->transactions.contains(tid)) {
         return;
     }
 
     // extract error message
-    d->transactions.erase(it);
     QString msg;
     for (Uint32 i = 8; i < buf.size(); i++) {
         msg += QLatin1Char(buf.data()[i]);
     }
 
-    // emit signal
-    Q_EMIT error(tid, msg);
+    d->fail(tid, msg, false);
 }
 
 void UDPTrackerSocket::handleScrape(QByteArrayView buf)
@@ -245,31 +451,24 @@ void UDPTrackerSocket::handleScrape(QByteArrayView buf)
 
     // Read the transaction_id and check it
     const Int32 tid = ReadInt32(buf.data(), 4);
-    const QMap<Int32, Action>::iterator i = d->transactions.find(tid);
+    const auto i = d->transactions.find(tid);
     // if we can't find the transaction, just return
     if (i == d->transactions.end()) {
         return;
     }
 
     // check whether the transaction is a SCRAPE
-    if (i.value() != SCRAPE) {
-        d->transactions.erase(i);
-        Q_EMIT error(tid, QString());
+    if (i->action != SCRAPE) {
+        d->fail(tid, QString(), false);
         return;
     }
 
-    // everything ok, emit signal
+    // everything ok, tell the listener
+    Listener *l = i->listener;
     d->transactions.erase(i);
-    Q_EMIT scrapeReceived(tid, buf);
-}
-
-Int32 UDPTrackerSocket::newTransactionID()
-{
-    Int32 transaction_id = QRandomGenerator::global()->generate();
-    while (d->transactions.contains(transaction_id)) {
-        transaction_id++;
+    if (l) {
+        l->scrapeReceived(tid, buf);
     }
-    return transaction_id;
 }
 
 void UDPTrackerSocket::setPort(Uint16 p)
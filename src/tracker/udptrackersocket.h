@@ -31,6 +31,15 @@ namespace bt
  * \author Joris Guisson
  *
  * \brief Handles communication with one or more UDP trackers.
+ *
+ * All UDP trackers share one socket. The connection id of every tracker endpoint
+ * is cached here and shared by all torrents on that tracker, so a single CONNECT
+ * serves all their announces and scrapes for the lifetime of the connection id.
+ * Requests which need a new connection id wait for it, only one CONNECT per endpoint
+ * is in flight.
+ *
+ * Lost packets are retransmitted as described in BEP 15, after 15 * 2 ^ n seconds.
+ * All timeouts are driven by one timer wheel.
  */
 class KTORRENT_EXPORT UDPTrackerSocket : public QObject
 {
@@ -63,46 +72,83 @@ public:
         ERROR = 3,
     };
 
-    /*!
-     * Send a connect message. As a response to this, the connectReceived
-     * signal will be emitted, classes recieving this signal should check if
-     * the transaction_id is the same.
-     * \param tid The transaction_id
-     * \param addr The address to send to
-     */
-    void sendConnect(Int32 tid, const net::Address &addr);
+    //! Seconds a connection id may be used after it was received
+    static constexpr Uint32 CONNECTION_ID_LIFETIME = 60;
+
+    //! Seconds before the first retransmission, it doubles for every next one
+    static constexpr Uint32 RETRANSMIT_TIMEOUT = 15;
+
+    //! Number of times a packet is sent before the transaction fails
+    static constexpr Uint32 MAX_ATTEMPTS = 3;
+
+    //! Receives the outcome of the transactions it started
+    class KTORRENT_EXPORT Listener
+    {
+    public:
+        virtual ~Listener();
+
+        /*!
+         * An announce reply has been received.
+         * \param tid The transaction_id
+         * \param buf The data
+         */
+        virtual void announceReceived(Int32 tid, QByteArrayView buf) = 0;
+
+        /*!
+         * A scrape reply has been received.
+         * \param tid The transaction_id
+         * \param buf The data
+         */
+        virtual void scrapeReceived(Int32 tid, QByteArrayView buf) = 0;
+
+        /*!
+         * The tracker replied with an error.
+         * \param tid The transaction_id
+         * \param error_string Potential error string
+         */
+        virtual void transactionFailed(Int32 tid, const QString &error_string) = 0;
+
+        /*!
+         * The tracker did not reply, not even to the retransmissions.
+         * \param tid The transaction_id
+         */
+        virtual void transactionTimedOut(Int32 tid) = 0;
+    };
 
     /*!
-     * Send an announce message. As a response to this, the announceReceived
-     * signal will be emitted, classes recieving this signal should check if
-     * the transaction_id is the same.
-     * \param tid The transaction_id
+     * Send an announce message. The connection_id and transaction_id in data
+     * are filled in, and a connection id is requested first when needed.
+     * \param l The Listener which gets the reply
      * \param data The data to send (announce input structure, in UDP Tracker specification)
      * \param addr The address to send to
+     * \return The transaction_id
      */
-    void sendAnnounce(Int32 tid, QByteArrayView data, const net::Address &addr);
+    Int32 sendAnnounce(Listener *l, const QByteArray &data, const net::Address &addr);
 
     /*!
-     * Send a scrape message. As a response to this, the scrapeReceived
-     * signal will be emitted, classes recieving this signal should check if
-     * the transaction_id is the same.
-     * \param tid The transaction_id
+     * Send a scrape message. The connection_id and transaction_id in data
+     * are filled in, and a connection id is requested first when needed.
+     * \param l The Listener which gets the reply
      * \param data The data to send (scrape input structure, in UDP Tracker specification)
      * \param addr The address to send to
+     * \return The transaction_id
      */
-    void sendScrape(Int32 tid, QByteArrayView data, const net::Address &addr);
+    Int32 sendScrape(Listener *l, const QByteArray &data, const net::Address &addr);
 
     /*!
-     * If a transaction times out, this should be used to cancel it.
-     * \param tid
+     * Cancel a transaction, the Listener will not hear about it anymore.
+     * \param tid The transaction_id
      */
     void cancelTransaction(Int32 tid);
 
-    /*!
-     * Compute a free transaction_id.
-     * \return A free transaction_id
-     */
-    Int32 newTransactionID();
+    //! Cancel all transactions of a Listener
+    void cancelTransactions(Listener *l);
+
+    //! Get the number of pending transactions, connects included
+    [[nodiscard]] Uint32 numTransactions() const;
+
+    //! Get the cached connection id of an address, 0 if there is no valid one
+    [[nodiscard]] Int64 connectionID(const net::Address &addr) const;
 
     /*!
      * Set the port ot use.
@@ -113,41 +159,15 @@ public:
     //! Get the port in use.
     static Uint16 getPort();
 
-Q_SIGNALS:
-    /*!
-     * Emitted when a connect message is received.
-     * \param tid The transaction_id
-     * \param connection_id The connection_id returned
-     */
-    void connectReceived(Int32 tid, Int64 connection_id);
-
-    /*!
-     * Emitted when an announce message is received.
-     * \param tid The transaction_id
-     * \param buf The data
-     */
-    void announceReceived(Int32 tid, QByteArrayView buf);
-
-    /*!
-     * Emitted when a scrape message is received.
-     * \param tid The transaction_id
-     * \param buf The data
-     */
-    void scrapeReceived(Int32 tid, QByteArrayView buf);
-
-    /*!
-     * Signal emitted, when an error occurs during a transaction.
-     * \param tid The transaction_id
-     * \param error_string Potential error string
-     */
-    void error(Int32 tid, const QString &error_string);
-
 private:
     void handleConnect(QByteArrayView buf);
     void handleAnnounce(QByteArrayView buf);
     void handleError(QByteArrayView buf);
     void handleScrape(QByteArrayView buf);
 
+private:
+    void onTimerTick();
+
 private:
     class Private;
     std::unique_ptr<Private> d;